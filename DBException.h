@@ -2,6 +2,7 @@
 #define DBEXCEPTION_H
 
 #include <QString>
+#include <QMetaType>
 
 class DBException
 {
@@ -12,4 +13,6 @@ public:
 
 };
 
+Q_DECLARE_METATYPE(DBException)
+
 #endif // DBEXCEPTION_H
@@ -0,0 +1,193 @@
+#include "SqliteChangeDetector.h"
+
+SqliteChangeDetector::SqliteChangeDetector()
+{
+    watcher_ = new QFileSystemWatcher();
+    QObject::connect(watcher_, SIGNAL(fileChanged(const QString &)),
+                     this, SLOT(onFileChanged(const QString &)));
+    QObject::connect(watcher_, SIGNAL(directoryChanged(const QString &)),
+                     this, SLOT(onDirectoryChanged(const QString &)));
+}
+
+bool SqliteChangeDetector::Snapshot::operator==(const Snapshot &other) const
+{
+    return dataVersion == other.dataVersion &&
+           dbSize == other.dbSize &&
+           dbModified == other.dbModified &&
+           walFrames == other.walFrames &&
+           walModified == other.walModified &&
+           walSalt == other.walSalt;
+}
+
+bool SqliteChangeDetector::Snapshot::operator!=(const Snapshot &other) const
+{
+    return !(*this == other);
+}
+
+/*
+ * Привязка к открытой бд.
+ * Запоминается размер страницы (нужен для подсчёта кадров WAL),
+ * ставится наблюдение за файлом бд, WAL-файлом и их каталогом
+ * и снимается исходный снимок, с которым будут сравниваться
+ * последующие проверки. statements - кэш запросов того же
+ * соединения, через него data_version читается без
+ * повторного разбора запроса на каждой проверке.
+*/
+void SqliteChangeDetector::attach(const QSqlDatabase &db, const QString &path, SqliteStatementCache *statements)
+{
+    detach();
+    db_ = db;
+    statements_ = statements;
+    path_ = path;
+    wal_path_ = path + WAL_SUFFIX;
+    QSqlQuery query(db_);
+    if (query.exec("pragma page_size") && query.next()) {
+        page_size_ = query.value(0).toLongLong();
+    }
+    watchFiles();
+    snapshot_ = takeSnapshot();
+}
+
+/*
+ * Отвязка от бд и снятие всех наблюдений
+*/
+void SqliteChangeDetector::detach()
+{
+    if (!watcher_->files().isEmpty()) {
+        watcher_->removePaths(watcher_->files());
+    }
+    if (!watcher_->directories().isEmpty()) {
+        watcher_->removePaths(watcher_->directories());
+    }
+    db_ = QSqlDatabase();
+    statements_ = nullptr;
+    path_ = "";
+    wal_path_ = "";
+    page_size_ = 0;
+    dirty_ = false;
+    snapshot_ = Snapshot();
+}
+
+/*
+ * Дешёвая проверка изменений бд.
+ * PRAGMA data_version меняется, когда другое соединение
+ * фиксирует транзакцию, размер и время изменения файлов
+ * и число кадров WAL ловят запись в обход этого соединения.
+ * Возвращает true только если что-то из этого изменилось с
+ * прошлой проверки, сами данные таблиц не читаются.
+*/
+bool SqliteChangeDetector::hasChanged()
+{
+    if (path_.isEmpty()) {
+        return false;
+    }
+    Snapshot current = takeSnapshot();
+    bool isChanged = dirty_ || current != snapshot_;
+    snapshot_ = current;
+    dirty_ = false;
+    return isChanged;
+}
+
+/*
+ * Количество кадров в WAL-файле на момент последней проверки.
+ * Если бд не в режиме WAL, то 0.
+*/
+qint64 SqliteChangeDetector::walFrameCount() const
+{
+    return snapshot_.walFrames > 0 ? snapshot_.walFrames : 0;
+}
+
+SqliteChangeDetector::Snapshot SqliteChangeDetector::takeSnapshot()
+{
+    Snapshot snapshot;
+    snapshot.dataVersion = readDataVersion();
+    QFileInfo dbInfo(path_);
+    snapshot.dbSize = dbInfo.size();
+    snapshot.dbModified = dbInfo.lastModified();
+    QFileInfo walInfo(wal_path_);
+    if (walInfo.exists()) {
+        qint64 frameSize = page_size_ + WAL_FRAME_HEADER_SIZE;
+        qint64 walSize = walInfo.size();
+        snapshot.walFrames = (walSize > WAL_HEADER_SIZE && page_size_ > 0)
+                ? (walSize - WAL_HEADER_SIZE) / frameSize : 0;
+        snapshot.walModified = walInfo.lastModified();
+        snapshot.walSalt = readWalSalt();
+    }
+    return snapshot;
+}
+
+qint64 SqliteChangeDetector::readDataVersion()
+{
+    if (statements_) {
+        sqlite3_stmt *statement = statements_->prepare("pragma data_version");
+        bool isRead = statement && sqlite3_step(statement) == SQLITE_ROW;
+        qint64 version = isRead ? sqlite3_column_int64(statement, 0) : -1;
+        statements_->release(statement);
+        return version;
+    }
+    QSqlQuery query(db_);
+    if (!query.exec("pragma data_version") || !query.next()) {
+        return -1;
+    }
+    return query.value(0).toLongLong();
+}
+
+/*
+ * Счётчик контрольных точек и соли из заголовка WAL.
+ * Они меняются при перезапуске WAL, даже если размер
+ * файла остался прежним.
+*/
+QByteArray SqliteChangeDetector::readWalSalt() const
+{
+    QFile wal(wal_path_);
+    if (!wal.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    QByteArray header = wal.read(WAL_HEADER_SIZE);
+    if (header.size() < WAL_HEADER_SIZE) {
+        return QByteArray();
+    }
+    return header.mid(12, 12);
+}
+
+/*
+ * Наблюдение за файлом бд и WAL-файлом (inotify на linux).
+ * Каталог нужен, чтобы узнать о появлении или удалении WAL.
+*/
+void SqliteChangeDetector::watchFiles()
+{
+    if (QFileInfo::exists(path_) && !watcher_->files().contains(path_)) {
+        watcher_->addPath(path_);
+    }
+    if (QFileInfo::exists(wal_path_) && !watcher_->files().contains(wal_path_)) {
+        watcher_->addPath(wal_path_);
+    }
+    QString dir = QFileInfo(path_).absolutePath();
+    if (!watcher_->directories().contains(dir)) {
+        watcher_->addPath(dir);
+    }
+}
+
+void SqliteChangeDetector::onFileChanged(const QString &path)
+{
+    Q_UNUSED(path);
+    dirty_ = true;
+    watchFiles();  //файл мог быть заменён, тогда наблюдение слетает
+    emit changed();
+}
+
+/*
+ * В каталоге могло появиться что угодно, поэтому
+ * dirty_ не взводится: решает сравнение снимков.
+*/
+void SqliteChangeDetector::onDirectoryChanged(const QString &path)
+{
+    Q_UNUSED(path);
+    watchFiles();
+    emit changed();
+}
+
+SqliteChangeDetector::~SqliteChangeDetector()
+{
+    delete watcher_;
+}
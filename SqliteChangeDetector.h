@@ -0,0 +1,71 @@
+#ifndef SQLITECHANGEDETECTOR_H
+#define SQLITECHANGEDETECTOR_H
+
+#include <QObject>
+#include <QtSql/QSqlDatabase>
+#include <QSqlQuery>
+#include <QFileSystemWatcher>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+#include <QVariant>
+
+#include "SqliteStatementCache.h"
+
+class SqliteChangeDetector : public QObject
+{
+    Q_OBJECT
+
+public:
+    const QString WAL_SUFFIX = "-wal";  //суффикс WAL-файла рядом с бд
+    const int WAL_HEADER_SIZE = 32;  //размер заголовка WAL-файла
+    const int WAL_FRAME_HEADER_SIZE = 24;  //размер заголовка одного кадра WAL
+    SqliteChangeDetector();
+    void attach(const QSqlDatabase &db, const QString &path, SqliteStatementCache *statements = nullptr);
+    void detach();
+    bool hasChanged();
+    qint64 walFrameCount() const;
+    virtual ~SqliteChangeDetector();
+
+signals:
+    void changed();
+
+private slots:
+    void onFileChanged(const QString &path);
+    void onDirectoryChanged(const QString &path);
+
+private:
+    /*
+     * Снимок дешёвых признаков изменения бд.
+     * Сравнивается целиком, поэтому все поля должны
+     * быть заполнены в takeSnapshot().
+    */
+    struct Snapshot
+    {
+        qint64 dataVersion = -1;
+        qint64 dbSize = -1;
+        QDateTime dbModified;
+        qint64 walFrames = -1;
+        QDateTime walModified;
+        QByteArray walSalt;
+        bool operator==(const Snapshot &other) const;
+        bool operator!=(const Snapshot &other) const;
+    };
+
+    Snapshot takeSnapshot();
+    qint64 readDataVersion();
+    QByteArray readWalSalt() const;
+    void watchFiles();
+
+    QSqlDatabase db_;
+    SqliteStatementCache *statements_ = nullptr;  //кэш запросов соединения db_, может быть nullptr
+    QString path_ = "";
+    QString wal_path_ = "";
+    qint64 page_size_ = 0;
+    bool dirty_ = false;  //взводится наблюдателем файлов до следующей проверки
+    Snapshot snapshot_;
+    QFileSystemWatcher *watcher_;
+};
+
+#endif // SQLITECHANGEDETECTOR_H
@@ -0,0 +1,370 @@
+#include "SqliteChunkFingerprint.h"
+
+const char *const SqliteChunkFingerprint::FUNCTION_NAME = "sqlitereader_fingerprint";
+
+SqliteChunkFingerprint::SqliteChunkFingerprint()
+{
+
+}
+
+/*
+ * Пустые отпечатки таблицы table с колонками columns:
+ * следующее обновление построит их заново
+*/
+void SqliteChunkFingerprint::reset(const QString &table, const QStringList &columns)
+{
+    *this = SqliteChunkFingerprint();
+    table_ = table;
+    columns_ = columns;
+}
+
+bool SqliteChunkFingerprint::isValid() const
+{
+    return is_valid_;
+}
+
+/*
+ * Отпечатки относятся к этой таблице с этими колонками
+ * (построенные или ещё нет)
+*/
+bool SqliteChunkFingerprint::isFor(const QString &table, const QStringList &columns) const
+{
+    return !table_.isEmpty() && table_ == table && columns_ == columns;
+}
+
+QString SqliteChunkFingerprint::table() const
+{
+    return table_;
+}
+
+QStringList SqliteChunkFingerprint::columns() const
+{
+    return columns_;
+}
+
+/*
+ * Конец обновления: максимальный rowid таблицы (hasRows - false,
+ * если таблица пуста). С этого момента отпечатки построены.
+*/
+void SqliteChunkFingerprint::setMaxRowid(bool hasRows, qint64 rowid)
+{
+    is_valid_ = true;
+    has_rows_ = hasRows;
+    max_rowid_ = hasRows ? rowid : 0;
+}
+
+bool SqliteChunkFingerprint::hasRows() const
+{
+    return has_rows_;
+}
+
+qint64 SqliteChunkFingerprint::maxRowid() const
+{
+    return max_rowid_;
+}
+
+/*
+ * Хэш блока. Нулевой хэш - пустой блок, он не хранится.
+*/
+void SqliteChunkFingerprint::setChunk(qint64 chunk, quint64 hash)
+{
+    if (hash == 0) {
+        chunks_.remove(chunk);
+        return;
+    }
+    chunks_.insert(chunk, hash);
+}
+
+/*
+ * Добавление к хэшу блока хэша новых строк
+*/
+void SqliteChunkFingerprint::addToChunk(qint64 chunk, quint64 hash)
+{
+    setChunk(chunk, chunks_.value(chunk, 0) + hash);
+}
+
+/*
+ * Сохранённый хэш блоков с firstChunk по lastChunk включительно
+*/
+quint64 SqliteChunkFingerprint::rangeHash(qint64 firstChunk, qint64 lastChunk) const
+{
+    quint64 hash = 0;
+    for (auto i = chunks_.lowerBound(firstChunk); i != chunks_.constEnd() && i.key() <= lastChunk; ++i) {
+        hash += i.value();
+    }
+    return hash;
+}
+
+/*
+ * Диапазоны блоков, с которых начинается сравнение: в каждом
+ * до SEGMENT_CHUNKS непустых блоков, вместе они без пропусков
+ * покрывают все rowid до maxRowid, так что найдутся и строки,
+ * вставленные в пустые раньше блоки.
+*/
+QList<SqliteChunkFingerprint::Range> SqliteChunkFingerprint::segments() const
+{
+    QList<Range> result;
+    if (!has_rows_) {
+        return result;
+    }
+    qint64 first = chunkOf(LLONG_MIN);
+    int count = 0;
+    for (auto i = chunks_.constBegin(); i != chunks_.constEnd(); ++i) {
+        if (count == SEGMENT_CHUNKS) {
+            result.append(qMakePair(first, i.key() - 1));
+            first = i.key();
+            count = 0;
+        }
+        count++;
+    }
+    result.append(qMakePair(first, chunkOf(max_rowid_)));
+    return result;
+}
+
+/*
+ * Последний блок левой половины диапазона блоков при его
+ * делении пополам. Делятся поровну непустые блоки, а не номера:
+ * rowid бывают разрежены, и деление номеров долго спускалось
+ * бы по пустым промежуткам, перечитывая одни и те же строки.
+ * Одиночный непустой блок отделяется от промежутков вокруг.
+*/
+qint64 SqliteChunkFingerprint::splitChunk(qint64 firstChunk, qint64 lastChunk) const
+{
+    QList<qint64> keys;
+    for (auto i = chunks_.lowerBound(firstChunk); i != chunks_.constEnd() && i.key() <= lastChunk; ++i) {
+        keys.append(i.key());
+    }
+    if (keys.size() >= 2) {
+        return keys[keys.size() / 2] - 1;
+    }
+    if (keys.size() == 1) {
+        return keys.first() > firstChunk ? keys.first() - 1 : firstChunk;
+    }
+    return firstChunk + (lastChunk - firstChunk) / 2;
+}
+
+/*
+ * Диапазон rowid с first по last изменился. Диапазоны добавляются
+ * по возрастанию, соседние склеиваются, а если их больше
+ * MAX_CHANGES, то в changes() все склеиваются в один (запрос
+ * по ним остаётся коротким), а isChanged() помнит их все.
+*/
+void SqliteChunkFingerprint::addChange(qint64 first, qint64 last)
+{
+    if (!changed_rows_.isEmpty() && changed_rows_.last().second >= first - 1) {
+        changed_rows_.last().second = qMax(changed_rows_.last().second, last);
+    } else {
+        changed_rows_.append(qMakePair(first, last));
+    }
+    if (!changes_.isEmpty() && changes_.last().second >= first - 1) {
+        changes_.last().second = qMax(changes_.last().second, last);
+        return;
+    }
+    changes_.append(qMakePair(first, last));
+    if (changes_.size() > MAX_CHANGES) {
+        Range range = qMakePair(changes_.first().first, last);
+        changes_.clear();
+        changes_.append(range);
+    }
+}
+
+void SqliteChunkFingerprint::clearChanges()
+{
+    changes_.clear();
+    changed_rows_.clear();
+}
+
+/*
+ * Диапазоны rowid изменённых, удалённых и новых строк,
+ * найденные последним обновлением. После первого построения
+ * изменений нет.
+*/
+QList<SqliteChunkFingerprint::Range> SqliteChunkFingerprint::changes() const
+{
+    return changes_;
+}
+
+/*
+ * Строка rowid изменилась или появилась при последнем
+ * обновлении. Без таблицы хэшей строк - любая строка
+ * изменённого блока.
+*/
+bool SqliteChunkFingerprint::isChanged(qint64 rowid) const
+{
+    auto range = std::lower_bound(changed_rows_.constBegin(), changed_rows_.constEnd(), rowid,
+                                  [](const Range &change, qint64 key) { return change.second < key; });
+    return range != changed_rows_.constEnd() && range->first <= rowid;
+}
+
+/*
+ * Состояние таблицы хэшей строк исполнителя (rowid, хэш)
+ * после этого обновления, 0 - таблицы нет (см.
+ * SqliteReaderWorker::updateFingerprint)
+*/
+void SqliteChunkFingerprint::setRowHashes(int state)
+{
+    row_hashes_ = state;
+}
+
+int SqliteChunkFingerprint::rowHashes() const
+{
+    return row_hashes_;
+}
+
+qint64 SqliteChunkFingerprint::chunkOf(qint64 rowid)
+{
+    return rowid >> CHUNK_SHIFT;
+}
+
+qint64 SqliteChunkFingerprint::firstRowid(qint64 chunk)
+{
+    return chunk * CHUNK_ROWIDS;
+}
+
+qint64 SqliteChunkFingerprint::lastRowid(qint64 chunk)
+{
+    return chunk * CHUNK_ROWIDS + (CHUNK_ROWIDS - 1);
+}
+
+/*
+ * Хэш строки по значениям её ячеек: тип и байты каждого
+ * значения через FNV-1a, в конце перемешивание (mix),
+ * чтобы суммы хэшей строк не сталкивались на похожих строках.
+*/
+quint64 SqliteChunkFingerprint::rowHash(sqlite3_value **values, int count)
+{
+    quint64 hash = Q_UINT64_C(0xcbf29ce484222325);
+    for (int i = 0; i < count; i++) {
+        int type = sqlite3_value_type(values[i]);
+        switch (type) {
+        case SQLITE_INTEGER:
+            hash = hashCell(hash, type, sqlite3_value_int64(values[i]), 0, nullptr, 0);
+            break;
+        case SQLITE_FLOAT:
+            hash = hashCell(hash, type, 0, sqlite3_value_double(values[i]), nullptr, 0);
+            break;
+        case SQLITE_TEXT: {
+            const unsigned char *text = sqlite3_value_text(values[i]);
+            hash = hashCell(hash, type, 0, 0, text, sqlite3_value_bytes(values[i]));
+            break;
+        }
+        case SQLITE_BLOB: {
+            const void *blob = sqlite3_value_blob(values[i]);
+            hash = hashCell(hash, type, 0, 0, blob, sqlite3_value_bytes(values[i]));
+            break;
+        }
+        default:
+            hash = hashCell(hash, type, 0, 0, nullptr, 0);
+            break;
+        }
+    }
+    return mix(hash);
+}
+
+/*
+ * Тот же хэш для текущей строки запроса, колонки
+ * которого - аргументы FUNCTION_NAME
+*/
+quint64 SqliteChunkFingerprint::rowHash(sqlite3_stmt *statement)
+{
+    quint64 hash = Q_UINT64_C(0xcbf29ce484222325);
+    for (int i = 0; i < sqlite3_column_count(statement); i++) {
+        int type = sqlite3_column_type(statement, i);
+        switch (type) {
+        case SQLITE_INTEGER:
+            hash = hashCell(hash, type, sqlite3_column_int64(statement, i), 0, nullptr, 0);
+            break;
+        case SQLITE_FLOAT:
+            hash = hashCell(hash, type, 0, sqlite3_column_double(statement, i), nullptr, 0);
+            break;
+        case SQLITE_TEXT: {
+            const unsigned char *text = sqlite3_column_text(statement, i);
+            hash = hashCell(hash, type, 0, 0, text, sqlite3_column_bytes(statement, i));
+            break;
+        }
+        case SQLITE_BLOB: {
+            const void *blob = sqlite3_column_blob(statement, i);
+            hash = hashCell(hash, type, 0, 0, blob, sqlite3_column_bytes(statement, i));
+            break;
+        }
+        default:
+            hash = hashCell(hash, type, 0, 0, nullptr, 0);
+            break;
+        }
+    }
+    return mix(hash);
+}
+
+/*
+ * Регистрация агрегатной функции FUNCTION_NAME(rowid, колонки...)
+ * в соединении: сумма rowHash строк, 0 на пустом диапазоне.
+*/
+bool SqliteChunkFingerprint::install(sqlite3 *handle)
+{
+    return sqlite3_create_function_v2(handle, FUNCTION_NAME, -1, SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+                                      nullptr, nullptr, &SqliteChunkFingerprint::stepFunction,
+                                      &SqliteChunkFingerprint::finalFunction, nullptr) == SQLITE_OK;
+}
+
+quint64 SqliteChunkFingerprint::hashCell(quint64 hash, int type, qint64 integer, double real,
+                                         const void *data, int size)
+{
+    quint8 tag = static_cast<quint8>(type);
+    hash = hashBytes(hash, &tag, sizeof(tag));
+    switch (type) {
+    case SQLITE_INTEGER:
+        return hashBytes(hash, &integer, sizeof(integer));
+    case SQLITE_FLOAT:
+        return hashBytes(hash, &real, sizeof(real));
+    case SQLITE_TEXT:
+    case SQLITE_BLOB:
+        return hashBytes(hash, data, size);
+    default:
+        return hash;
+    }
+}
+
+quint64 SqliteChunkFingerprint::hashBytes(quint64 hash, const void *data, int size)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (int i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= Q_UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+/*
+ * Перемешивание splitmix64
+*/
+quint64 SqliteChunkFingerprint::mix(quint64 hash)
+{
+    hash ^= hash >> 30;
+    hash *= Q_UINT64_C(0xbf58476d1ce4e5b9);
+    hash ^= hash >> 27;
+    hash *= Q_UINT64_C(0x94d049bb133111eb);
+    hash ^= hash >> 31;
+    return hash;
+}
+
+void SqliteChunkFingerprint::stepFunction(sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+    quint64 *sum = static_cast<quint64 *>(sqlite3_aggregate_context(context, sizeof(quint64)));
+    if (sum) {
+        *sum += rowHash(argv, argc);
+    }
+}
+
+void SqliteChunkFingerprint::finalFunction(sqlite3_context *context)
+{
+    quint64 *sum = static_cast<quint64 *>(sqlite3_aggregate_context(context, 0));
+    quint64 hash = sum ? *sum : 0;
+    qint64 result;
+    std::memcpy(&result, &hash, sizeof(result));
+    sqlite3_result_int64(context, result);
+}
+
+SqliteChunkFingerprint::~SqliteChunkFingerprint()
+{
+
+}
@@ -0,0 +1,90 @@
+#ifndef SQLITECHUNKFINGERPRINT_H
+#define SQLITECHUNKFINGERPRINT_H
+
+#include <QList>
+#include <QMap>
+#include <QMetaType>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include <sqlite3.h>
+
+/*
+ * Отпечатки таблицы с rowid по блокам из CHUNK_ROWIDS rowid:
+ * хэш блока - сумма 64-битных хэшей его строк (rowid и все
+ * колонки, FNV-1a с перемешиванием). Сумма не зависит от
+ * порядка строк, поэтому хэш любого диапазона блоков - сумма
+ * их хэшей, а sqlite считает его одним запросом через
+ * агрегатную функцию FUNCTION_NAME, не отдавая строки наружу.
+ * После изменения бд исполнитель (updateFingerprint) сравнивает
+ * диапазоны примерно по SEGMENT_CHUNKS блоков и делит несовпавшие
+ * пополам (по непустым блокам, см. splitChunk) до отдельных блоков,
+ * а строки после прошлого максимального rowid просто дочитывает.
+ * Найденные диапазоны rowid изменённых и новых строк - в changes().
+ * Если у исполнителя есть таблица хэшей строк (rowHashes()),
+ * в изменённых блоках находятся сами изменённые строки, и
+ * isChanged() отвечает точно по строке, а не по блоку.
+*/
+class SqliteChunkFingerprint
+{
+public:
+    enum {CHUNK_SHIFT = 12};  //блок - rowid с одинаковым rowid >> CHUNK_SHIFT
+    enum {CHUNK_ROWIDS = 1 << CHUNK_SHIFT};  //rowid в одном блоке
+    enum {SEGMENT_CHUNKS = 16};  //непустых блоков в диапазоне, с которого начинается деление пополам
+    enum {MAX_CHANGES = 256};  //диапазонов изменений, больше склеиваются в один
+    typedef QPair<qint64, qint64> Range;  //первый и последний rowid или номер блока
+    static const char *const FUNCTION_NAME;  //имя агрегатной функции хэша строк в sql
+    SqliteChunkFingerprint();
+    void reset(const QString &table, const QStringList &columns);
+    bool isValid() const;
+    bool isFor(const QString &table, const QStringList &columns) const;
+    QString table() const;
+    QStringList columns() const;
+    void setMaxRowid(bool hasRows, qint64 rowid = 0);
+    bool hasRows() const;
+    qint64 maxRowid() const;
+    void setChunk(qint64 chunk, quint64 hash);
+    void addToChunk(qint64 chunk, quint64 hash);
+    quint64 rangeHash(qint64 firstChunk, qint64 lastChunk) const;
+    QList<Range> segments() const;
+    qint64 splitChunk(qint64 firstChunk, qint64 lastChunk) const;
+    void addChange(qint64 first, qint64 last);
+    void clearChanges();
+    QList<Range> changes() const;
+    bool isChanged(qint64 rowid) const;
+    void setRowHashes(int state);
+    int rowHashes() const;
+    static qint64 chunkOf(qint64 rowid);
+    static qint64 firstRowid(qint64 chunk);
+    static qint64 lastRowid(qint64 chunk);
+    static quint64 rowHash(sqlite3_value **values, int count);
+    static quint64 rowHash(sqlite3_stmt *statement);
+    static bool install(sqlite3 *handle);
+    virtual ~SqliteChunkFingerprint();
+
+private:
+    static quint64 hashCell(quint64 hash, int type, qint64 integer, double real, const void *data, int size);
+    static quint64 hashBytes(quint64 hash, const void *data, int size);
+    static quint64 mix(quint64 hash);
+    static void stepFunction(sqlite3_context *context, int argc, sqlite3_value **argv);
+    static void finalFunction(sqlite3_context *context);
+
+    QString table_ = "";
+    QStringList columns_;
+    bool is_valid_ = false;  //отпечатки построены хотя бы один раз
+    bool has_rows_ = false;
+    qint64 max_rowid_ = 0;  //максимальный rowid на момент отпечатков
+    QMap<qint64, quint64> chunks_;  //хэши непустых блоков по номеру блока
+    QList<Range> changes_;  //диапазоны rowid, изменённые с прошлых отпечатков, не больше MAX_CHANGES
+    QList<Range> changed_rows_;  //те же диапазоны без склейки сверх MAX_CHANGES
+    int row_hashes_ = 0;  //состояние таблицы хэшей строк исполнителя, с которым согласованы отпечатки, 0 - её нет
+};
+
+Q_DECLARE_METATYPE(SqliteChunkFingerprint)
+
+#endif // SQLITECHUNKFINGERPRINT_H
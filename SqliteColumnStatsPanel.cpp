@@ -0,0 +1,159 @@
+#include "SqliteColumnStatsPanel.h"
+
+SqliteColumnStatsPanel::SqliteColumnStatsPanel(QWidget *parent)
+    : QWidget(parent)
+{
+    setFixedWidth(PANEL_WIDTH);
+    status_label_ = new QLabel();
+    status_label_->setWordWrap(true);
+    column_box_ = new QComboBox();
+    values_label_ = new QLabel();
+    nulls_label_ = new QLabel();
+    minimum_label_ = new QLabel();
+    maximum_label_ = new QLabel();
+    distinct_label_ = new QLabel();
+    for (QLabel *label : {minimum_label_, maximum_label_}) {
+        label->setTextInteractionFlags(Qt::TextSelectableByMouse);
+        label->setWordWrap(true);
+    }
+    QFormLayout *stats = new QFormLayout();
+    stats->addRow("Values", values_label_);
+    stats->addRow("NULLs", nulls_label_);
+    stats->addRow("Min", minimum_label_);
+    stats->addRow("Max", maximum_label_);
+    stats->addRow("Distinct", distinct_label_);
+    top_table_ = new QTableWidget(0, 2);
+    top_table_->setHorizontalHeaderLabels(QStringList() << "Most frequent" << "Count");
+    top_table_->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    top_table_->horizontalHeader()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
+    top_table_->verticalHeader()->hide();
+    top_table_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    histogram_ = new SqliteHistogramWidget();
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(column_box_);
+    layout->addWidget(status_label_);
+    layout->addLayout(stats);
+    layout->addWidget(top_table_);
+    layout->addWidget(histogram_);
+
+    QObject::connect(column_box_, SIGNAL(currentIndexChanged(int)),
+                     this, SLOT(showColumn()));
+    clear();
+}
+
+/*
+ * Профиль таблицы table считается. Колонки остаются
+ * те же, если это пересчёт после изменения бд.
+*/
+void SqliteColumnStatsPanel::setPending(const QString &table)
+{
+    if (table != table_) {
+        column_box_->clear();
+    }
+    table_ = table;
+    is_ready_ = false;
+    status_label_->setText("Profiling " + table + "...");
+    status_label_->show();
+    showColumn();
+}
+
+/*
+ * Профиль посчитан. Профиль другой таблицы (пользователь
+ * успел её сменить) не показывается.
+*/
+void SqliteColumnStatsPanel::setProfile(const QString &table, const QStringList &columns,
+                                        const SqliteScanSummary &profile)
+{
+    if (table != table_) {
+        return;
+    }
+    profile_ = profile;
+    is_ready_ = true;
+    if (column_box_->count() != columns.size()) {
+        int column = column_box_->currentIndex();
+        column_box_->blockSignals(true);
+        column_box_->clear();
+        column_box_->addItems(columns);
+        column_box_->setCurrentIndex(qMax(0, column));
+        column_box_->blockSignals(false);
+    }
+    status_label_->setText(QString::number(profile.rowCount()) + " rows");
+    showColumn();
+}
+
+void SqliteColumnStatsPanel::clear()
+{
+    table_ = "";
+    is_ready_ = false;
+    profile_ = SqliteScanSummary();
+    column_box_->clear();
+    status_label_->setText("No table");
+    showColumn();
+}
+
+/*
+ * Выбор колонки, например по выделению в таблице
+*/
+void SqliteColumnStatsPanel::setColumn(int column)
+{
+    if (column >= 0 && column < column_box_->count()) {
+        column_box_->setCurrentIndex(column);
+    }
+}
+
+/*
+ * Статистика выбранной колонки. У частых значений, которые
+ * могли вытеснять другие, счётчик - верхняя граница.
+*/
+void SqliteColumnStatsPanel::showColumn()
+{
+    int column = column_box_->currentIndex();
+    bool isShown = is_ready_ && column >= 0 && column < profile_.columnCount();
+    top_table_->setRowCount(0);
+    if (!isShown) {
+        for (QLabel *label : {values_label_, nulls_label_, minimum_label_, maximum_label_, distinct_label_}) {
+            label->setText("");
+        }
+        histogram_->setHistogram(SqliteHistogram());
+        return;
+    }
+    values_label_->setText(QString::number(profile_.valueCount(column)));
+    nulls_label_->setText(QString::number(profile_.nullCount(column)));
+    minimum_label_->setText(valueText(profile_.minimum(column)));
+    maximum_label_->setText(valueText(profile_.maximum(column)));
+    distinct_label_->setText("~" + QString::number(profile_.distinctEstimate(column)));
+    for (const SqliteSpaceSaving::Item &item : profile_.frequentValues(column, TOP_VALUES)) {
+        int row = top_table_->rowCount();
+        top_table_->insertRow(row);
+        top_table_->setItem(row, 0, new QTableWidgetItem(valueText(item.value)));
+        QString count = QString::number(item.count);
+        top_table_->setItem(row, 1, new QTableWidgetItem(item.error > 0 ? "<= " + count : count));
+    }
+    histogram_->setHistogram(profile_.histogram(column));
+}
+
+/*
+ * Значение для показа: blob - размером и началом в hex,
+ * длинный текст обрезается
+*/
+QString SqliteColumnStatsPanel::valueText(const QVariant &value) const
+{
+    if (!value.isValid()) {
+        return "";
+    }
+    if (value.type() == QVariant::ByteArray) {
+        QByteArray bytes = value.toByteArray();
+        return "x'" + QString::fromLatin1(bytes.left(VALUE_LENGTH / 2).toHex()) +
+               (bytes.size() > VALUE_LENGTH / 2 ? "...'" : "'");
+    }
+    QString text = value.toString();
+    if (text.size() > VALUE_LENGTH) {
+        text = text.left(VALUE_LENGTH) + QChar(0x2026);
+    }
+    return text;
+}
+
+SqliteColumnStatsPanel::~SqliteColumnStatsPanel()
+{
+
+}
@@ -0,0 +1,62 @@
+#ifndef SQLITECOLUMNSTATSPANEL_H
+#define SQLITECOLUMNSTATSPANEL_H
+
+#include <QWidget>
+#include <QComboBox>
+#include <QFormLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QTableWidget>
+#include <QVBoxLayout>
+#include <QString>
+#include <QStringList>
+
+#include "SqliteScanSummary.h"
+#include "SqliteHistogramWidget.h"
+
+/*
+ * Панель статистики колонки рядом с таблицей: количество
+ * null, минимум и максимум, примерное количество различных
+ * значений, самые частые значения и гистограмма чисел.
+ * Профиль всех колонок таблицы считает модель одним проходом
+ * (SqliteReaderModel::profileColumns), панель только показывает
+ * выбранную колонку.
+*/
+class SqliteColumnStatsPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    const int PANEL_WIDTH = 300;  //ширина панели
+    const int TOP_VALUES = 10;  //сколько частых значений показывается
+    const int VALUE_LENGTH = 64;  //символов значения, которые видны в панели
+    SqliteColumnStatsPanel(QWidget *parent = nullptr);
+    void setPending(const QString &table);
+    void setProfile(const QString &table, const QStringList &columns, const SqliteScanSummary &profile);
+    void clear();
+    virtual ~SqliteColumnStatsPanel();
+
+public slots:
+    void setColumn(int column);
+
+private slots:
+    void showColumn();
+
+private:
+    QString valueText(const QVariant &value) const;
+
+    QLabel *status_label_;
+    QComboBox *column_box_;
+    QLabel *values_label_;
+    QLabel *nulls_label_;
+    QLabel *minimum_label_;
+    QLabel *maximum_label_;
+    QLabel *distinct_label_;
+    QTableWidget *top_table_;
+    SqliteHistogramWidget *histogram_;
+    QString table_ = "";  //таблица, профиль которой показывается или считается
+    SqliteScanSummary profile_;
+    bool is_ready_ = false;  //профиль table_ посчитан
+};
+
+#endif // SQLITECOLUMNSTATSPANEL_H
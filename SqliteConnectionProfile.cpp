@@ -0,0 +1,77 @@
+#include "SqliteConnectionProfile.h"
+
+SqliteConnectionProfile::SqliteConnectionProfile()
+{
+
+}
+
+/*
+ * Профиль просмотра больших файлов: программа ничего не пишет
+ * в бд, поэтому она открывается только для чтения, страницы
+ * читаются через mmap (256 МиБ) без лишних системных вызовов
+ * read(), кэш страниц увеличен до 64 МиБ, а временные таблицы
+ * фильтров лежат в памяти.
+*/
+SqliteConnectionProfile SqliteConnectionProfile::viewer()
+{
+    SqliteConnectionProfile profile;
+    profile.isReadOnly = true;
+    profile.isQueryOnly = true;
+    profile.mmapSize = 256 * 1024 * 1024;
+    profile.cacheSize = -64 * 1024;
+    profile.tempStore = 2;
+    return profile;
+}
+
+/*
+ * Имя бд для QSqlDatabase. Для неизменяемого режима -
+ * URI файла с параметром immutable=1.
+*/
+QString SqliteConnectionProfile::databaseName(const QString &path) const
+{
+    if (!isImmutable) {
+        return path;
+    }
+    return QUrl::fromLocalFile(path).toString(QUrl::FullyEncoded) + "?immutable=1";
+}
+
+/*
+ * Опции открытия для QSqlDatabase::setConnectOptions
+*/
+QString SqliteConnectionProfile::connectOptions() const
+{
+    QStringList options;
+    if (isReadOnly || isImmutable) {
+        options.append("QSQLITE_OPEN_READONLY");
+    }
+    if (isImmutable) {
+        options.append("QSQLITE_OPEN_URI");
+    }
+    return options.join(";");
+}
+
+/*
+ * Прагмы, которые нужно выполнить после открытия
+*/
+QStringList SqliteConnectionProfile::pragmas() const
+{
+    QStringList result;
+    if (mmapSize >= 0) {
+        result.append("pragma mmap_size = " + QString::number(mmapSize));
+    }
+    if (cacheSize != 0) {
+        result.append("pragma cache_size = " + QString::number(cacheSize));
+    }
+    if (tempStore >= 0) {
+        result.append("pragma temp_store = " + QString::number(tempStore));
+    }
+    if (isQueryOnly) {
+        result.append("pragma query_only = 1");
+    }
+    return result;
+}
+
+SqliteConnectionProfile::~SqliteConnectionProfile()
+{
+
+}
@@ -0,0 +1,39 @@
+#ifndef SQLITECONNECTIONPROFILE_H
+#define SQLITECONNECTIONPROFILE_H
+
+#include <QMetaType>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+
+/*
+ * Настройки соединения с бд: режим открытия и прагмы,
+ * которые выполняются сразу после открытия.
+ * По умолчанию ничего не меняется (как у QSQLITE),
+ * viewer() - режим просмотра: только чтение, файл читается
+ * через mmap, кэш страниц и временные таблицы в памяти.
+ * Неизменяемый режим (isImmutable) отключает блокировки и
+ * проверки изменений, его можно включать только для файлов,
+ * которые никто не пишет.
+*/
+class SqliteConnectionProfile
+{
+public:
+    SqliteConnectionProfile();
+    static SqliteConnectionProfile viewer();
+    QString databaseName(const QString &path) const;
+    QString connectOptions() const;
+    QStringList pragmas() const;
+    virtual ~SqliteConnectionProfile();
+
+    bool isReadOnly = false;  //SQLITE_OPEN_READONLY
+    bool isImmutable = false;  //URI с immutable=1
+    bool isQueryOnly = false;  //pragma query_only
+    qint64 mmapSize = -1;  //pragma mmap_size в байтах, -1 - не менять
+    int cacheSize = 0;  //pragma cache_size (меньше нуля - в КиБ), 0 - не менять
+    int tempStore = -1;  //pragma temp_store (0 - по умолчанию, 1 - файл, 2 - память), -1 - не менять
+};
+
+Q_DECLARE_METATYPE(SqliteConnectionProfile)
+
+#endif // SQLITECONNECTIONPROFILE_H
@@ -0,0 +1,499 @@
+#include "SqliteExporter.h"
+
+SqliteExporter::SqliteExporter()
+{
+
+}
+
+/*
+ * Номер новой выгрузки, передаётся в exportRows. Берётся
+ * при постановке выгрузки в очередь, чтобы cancel() отменял
+ * и выгрузки, которые ещё не начались.
+*/
+int SqliteExporter::queueExport()
+{
+    return last_request_.fetchAndAddOrdered(1) + 1;
+}
+
+/*
+ * Отмена текущей выгрузки и всех поставленных в очередь.
+ * Можно вызывать из любого потока: выполняющийся sqlite3_step
+ * прерывается, а недописанный файл удаляется.
+*/
+void SqliteExporter::cancel()
+{
+    cancelled_request_.storeRelease(last_request_.loadAcquire());
+    QMutexLocker locker(&mutex_);
+    if (handle_) {
+        sqlite3_interrupt(handle_);
+    }
+}
+
+/*
+ * Расширение файла для формата
+*/
+QString SqliteExporter::suffix(Format format)
+{
+    switch (format) {
+    case Csv:
+        return "csv";
+    case JsonLines:
+        return "jsonl";
+    default:
+        return "sqrc";
+    }
+}
+
+/*
+ * Выгрузка номер request (см. queueExport): строки
+ * запроса query пишутся в файл path в формате format.
+ * keyColumns первых колонок запроса (ключ строки) пропускаются,
+ * columns - имена остальных. expectedRows - сколько строк
+ * ожидается (для прогресса), -1 если неизвестно.
+ * Результат сообщается одним из сигналов finished,
+ * cancelled или failed.
+*/
+void SqliteExporter::exportRows(int request, const QString &databasePath, const SqliteConnectionProfile &profile,
+                                const QString &query, const QVariantList &values, const QStringList &columns,
+                                int keyColumns, int format, qint64 expectedRows, const QString &path)
+{
+    request_ = request;
+    if (isCancelled()) {  //отменена, пока ждала в очереди
+        emit cancelled(path);
+        return;
+    }
+    columns_ = columns;
+    key_columns_ = keyColumns;
+    sqlite3 *handle = openDatabase(databasePath, profile);
+    if (!handle) {
+        emit failed(path, "Cannot open the database");
+        return;
+    }
+    QByteArray sql = query.toUtf8();
+    sqlite3_stmt *statement = nullptr;
+    QString error;
+    if (sqlite3_prepare_v2(handle, sql.constData(), sql.size(), &statement, nullptr) != SQLITE_OK ||
+            !SqliteReaderWorker::bindValues(statement, values)) {
+        error = QString::fromUtf8(sqlite3_errmsg(handle));
+    }
+    file_.setFileName(path + PART_SUFFIX);
+    if (error.isEmpty() && !file_.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+        error = "Cannot write " + file_.fileName();
+    }
+    qint64 rows = 0;
+    if (error.isEmpty()) {
+        buffer_.reserve(BUFFER_SIZE + BUFFER_SIZE / 4);
+        buffer_.resize(0);
+        file_offset_ = 0;
+        row_groups_.clear();
+        is_write_failed_ = false;
+        writeHeader(static_cast<Format>(format));
+        bool isRead = writeRows(statement, static_cast<Format>(format), expectedRows, rows);
+        if (!isRead && !isCancelled()) {
+            error = QString::fromUtf8(sqlite3_errmsg(handle));
+        }
+        flush(true);
+        if (is_write_failed_ && error.isEmpty()) {
+            error = "Cannot write " + file_.fileName();
+        }
+        file_.close();
+    }
+    sqlite3_finalize(statement);
+    {
+        QMutexLocker locker(&mutex_);
+        handle_ = nullptr;
+    }
+    sqlite3_close(handle);
+    buffer_ = QByteArray();  //буфер не держится между выгрузками
+    if (isCancelled()) {
+        QFile::remove(path + PART_SUFFIX);
+        emit cancelled(path);
+        return;
+    }
+    if (!error.isEmpty()) {
+        QFile::remove(path + PART_SUFFIX);
+        emit failed(path, error);
+        return;
+    }
+    QFile::remove(path);
+    if (!QFile::rename(path + PART_SUFFIX, path)) {
+        emit failed(path, "Cannot rename " + path + PART_SUFFIX);
+        return;
+    }
+    emit finished(path, rows);
+}
+
+/*
+ * Своё соединение только для чтения с прагмами профиля
+ * и функцией поиска подстроки для фильтров
+*/
+sqlite3 *SqliteExporter::openDatabase(const QString &databasePath, const SqliteConnectionProfile &profile)
+{
+    sqlite3 *handle = nullptr;
+    int flags = SQLITE_OPEN_READONLY | (profile.isImmutable ? SQLITE_OPEN_URI : 0);
+    QByteArray name = profile.databaseName(databasePath).toUtf8();
+    if (sqlite3_open_v2(name.constData(), &handle, flags, nullptr) != SQLITE_OK ||
+            !SqliteSubstringSearch::install(handle)) {
+        sqlite3_close(handle);
+        return nullptr;
+    }
+    for (const QString &pragma : profile.pragmas()) {
+        sqlite3_exec(handle, pragma.toUtf8().constData(), nullptr, nullptr, nullptr);
+    }
+    QMutexLocker locker(&mutex_);
+    handle_ = handle;
+    return handle;
+}
+
+/*
+ * Чтение строк курсором и запись их в буфер.
+ * Колоночный формат копит строки группы в SqliteResultBlock,
+ * остальные пишутся сразу. Прогресс отправляется не чаще
+ * раза в PROGRESS_TIME мс.
+*/
+bool SqliteExporter::writeRows(sqlite3_stmt *statement, Format format, qint64 expectedRows, qint64 &rows)
+{
+    QElapsedTimer timer;
+    timer.start();
+    qint64 reported = 0;
+    int columnCount = sqlite3_column_count(statement);
+    SqliteResultBlock group(columnCount);
+    qint64 groupBytes = 0;
+    int status = SQLITE_DONE;
+    while (!is_write_failed_ && !isCancelled() && (status = sqlite3_step(statement)) == SQLITE_ROW) {
+        if (format == Csv) {
+            appendCsvRow(statement);
+        } else if (format == JsonLines) {
+            appendJsonRow(statement);
+        } else {
+            group.appendRow(statement);
+            for (int i = key_columns_; i < columnCount; i++) {
+                groupBytes += sqlite3_column_bytes(statement, i);
+            }
+            if (group.rowCount() >= ROW_GROUP_ROWS || groupBytes >= ROW_GROUP_BYTES) {
+                writeRowGroup(group);
+                group = SqliteResultBlock(columnCount);
+                groupBytes = 0;
+            }
+        }
+        rows++;
+        flush(false);
+        if (timer.elapsed() - reported >= PROGRESS_TIME) {
+            reported = timer.elapsed();
+            emit progress(rows, expectedRows);
+        }
+    }
+    if (is_write_failed_) {
+        return true;  //ошибка записи, а не чтения
+    }
+    if (isCancelled()) {
+        return false;  //отмена между строками, sqlite3_interrupt прерывает только sqlite3_step
+    }
+    if (status != SQLITE_DONE) {
+        return false;
+    }
+    if (format == Columnar) {
+        if (group.rowCount() > 0) {
+            writeRowGroup(group);
+        }
+        writeFooter(rows);
+    }
+    emit progress(rows, expectedRows);
+    return true;
+}
+
+/*
+ * Текущая выгрузка отменена
+*/
+bool SqliteExporter::isCancelled() const
+{
+    return request_ <= cancelled_request_.loadAcquire();
+}
+
+void SqliteExporter::appendCsvRow(sqlite3_stmt *statement)
+{
+    int columnCount = sqlite3_column_count(statement);
+    for (int i = key_columns_; i < columnCount; i++) {
+        if (i > key_columns_) {
+            buffer_.append(',');
+        }
+        switch (sqlite3_column_type(statement, i)) {
+        case SQLITE_INTEGER:
+        case SQLITE_FLOAT:
+            appendNumber(statement, i);
+            break;
+        case SQLITE_TEXT:
+            appendCsvText(reinterpret_cast<const char *>(sqlite3_column_text(statement, i)),
+                          sqlite3_column_bytes(statement, i));
+            break;
+        case SQLITE_BLOB: {
+            const char *data = static_cast<const char *>(sqlite3_column_blob(statement, i));
+            buffer_.append(QByteArray::fromRawData(data, sqlite3_column_bytes(statement, i)).toBase64());
+            break;
+        }
+        default:
+            break;  //null - пустое поле
+        }
+    }
+    buffer_.append("\r\n");
+}
+
+void SqliteExporter::appendJsonRow(sqlite3_stmt *statement)
+{
+    int columnCount = sqlite3_column_count(statement);
+    buffer_.append('{');
+    for (int i = key_columns_; i < columnCount && i - key_columns_ < columns_.size(); i++) {
+        if (i > key_columns_) {
+            buffer_.append(',');
+        }
+        buffer_.append(json_names_[i - key_columns_]);
+        switch (sqlite3_column_type(statement, i)) {
+        case SQLITE_INTEGER:
+            appendNumber(statement, i);
+            break;
+        case SQLITE_FLOAT:
+            if (std::isfinite(sqlite3_column_double(statement, i))) {
+                appendNumber(statement, i);
+            } else {
+                buffer_.append("null");  //в json нет бесконечностей
+            }
+            break;
+        case SQLITE_TEXT:
+            appendJsonText(reinterpret_cast<const char *>(sqlite3_column_text(statement, i)),
+                           sqlite3_column_bytes(statement, i));
+            break;
+        case SQLITE_BLOB: {
+            const char *data = static_cast<const char *>(sqlite3_column_blob(statement, i));
+            buffer_.append('"');
+            buffer_.append(QByteArray::fromRawData(data, sqlite3_column_bytes(statement, i)).toBase64());
+            buffer_.append('"');
+            break;
+        }
+        default:
+            buffer_.append("null");
+            break;
+        }
+    }
+    buffer_.append("}\n");
+}
+
+/*
+ * Поле csv: в кавычках, только если в нём есть
+ * разделитель, кавычка или перевод строки
+*/
+void SqliteExporter::appendCsvText(const char *data, int size)
+{
+    bool isQuoted = false;
+    for (int i = 0; i < size && !isQuoted; i++) {
+        isQuoted = data[i] == ',' || data[i] == '"' || data[i] == '\n' || data[i] == '\r';
+    }
+    if (!isQuoted) {
+        buffer_.append(data, size);
+        return;
+    }
+    buffer_.append('"');
+    const char *begin = data;
+    const char *end = data + size;
+    while (const char *quote = static_cast<const char *>(std::memchr(begin, '"', end - begin))) {
+        buffer_.append(begin, quote - begin + 1);
+        buffer_.append('"');
+        begin = quote + 1;
+    }
+    buffer_.append(begin, end - begin);
+    buffer_.append('"');
+}
+
+/*
+ * Строка json. UTF-8 пишется как есть, экранируются
+ * только кавычки, обратная косая черта и управляющие символы.
+*/
+void SqliteExporter::appendJsonText(const char *data, int size)
+{
+    static const char HEX[] = "0123456789abcdef";
+    buffer_.append('"');
+    int plain = 0;  //начало ещё не записанного куска без экранирования
+    for (int i = 0; i < size; i++) {
+        unsigned char c = static_cast<unsigned char>(data[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        buffer_.append(data + plain, i - plain);
+        plain = i + 1;
+        switch (c) {
+        case '"':
+            buffer_.append("\\\"");
+            break;
+        case '\\':
+            buffer_.append("\\\\");
+            break;
+        case '\n':
+            buffer_.append("\\n");
+            break;
+        case '\r':
+            buffer_.append("\\r");
+            break;
+        case '\t':
+            buffer_.append("\\t");
+            break;
+        default: {
+            char escaped[] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 15]};
+            buffer_.append(escaped, sizeof(escaped));
+            break;
+        }
+        }
+    }
+    buffer_.append(data + plain, size - plain);
+    buffer_.append('"');
+}
+
+/*
+ * Число так же, как его показывает таблица
+ * (вещественные - кратчайшей точной записью)
+*/
+void SqliteExporter::appendNumber(sqlite3_stmt *statement, int column)
+{
+    if (sqlite3_column_type(statement, column) == SQLITE_INTEGER) {
+        buffer_.append(QByteArray::number(sqlite3_column_int64(statement, column)));
+        return;
+    }
+    double value = sqlite3_column_double(statement, column);
+    buffer_.append(QString::number(value, 'g', QLocale::FloatingPointShortest).toLatin1());
+}
+
+/*
+ * Заголовок csv - имена колонок. Для json lines заголовка
+ * нет, но ключи объектов экранируются здесь один раз.
+ * Заголовок колоночного формата: "SQRC", версия (u32),
+ * количество колонок (u32) и имена колонок (u32 длина
+ * и UTF-8). Все числа little-endian.
+*/
+void SqliteExporter::writeHeader(Format format)
+{
+    if (format == Csv) {
+        for (int i = 0; i < columns_.size(); i++) {
+            if (i > 0) {
+                buffer_.append(',');
+            }
+            QByteArray name = columns_[i].toUtf8();
+            appendCsvText(name.constData(), name.size());
+        }
+        buffer_.append("\r\n");
+    } else if (format == JsonLines) {
+        json_names_.clear();
+        for (const QString &column : columns_) {
+            int start = buffer_.size();
+            QByteArray name = column.toUtf8();
+            appendJsonText(name.constData(), name.size());
+            buffer_.append(':');
+            json_names_.append(buffer_.mid(start));
+            buffer_.resize(start);
+        }
+    } else if (format == Columnar) {
+        buffer_.append("SQRC", 4);
+        appendLittleEndian<quint32>(buffer_, 1);
+        appendLittleEndian<quint32>(buffer_, columns_.size());
+        for (const QString &column : columns_) {
+            QByteArray name = column.toUtf8();
+            appendLittleEndian<quint32>(buffer_, name.size());
+            buffer_.append(name);
+        }
+    }
+}
+
+/*
+ * Группа строк колоночного формата: количество строк (u32),
+ * затем каждая колонка отдельным куском, перед которым его
+ * размер (u64), чтобы ненужные колонки можно было пропустить.
+ * Кусок колонки: типы значений (u8 на строку, коды sqlite:
+ * 1 - integer, 2 - float, 3 - text, 4 - blob, 5 - null),
+ * числа (i64 на строку: целое или биты double, у остальных 0),
+ * смещения текста и blob (u32 на строку плюс одно в конце)
+ * и сами байты текста и blob подряд.
+*/
+void SqliteExporter::writeRowGroup(const SqliteResultBlock &rows)
+{
+    row_groups_.append(file_offset_ + buffer_.size());
+    int rowCount = rows.rowCount();
+    appendLittleEndian<quint32>(buffer_, rowCount);
+    for (int column = key_columns_; column < rows.columnCount(); column++) {
+        QByteArray types;
+        QByteArray numbers;
+        QByteArray offsets;
+        QByteArray data;
+        types.reserve(rowCount);
+        numbers.reserve(rowCount * 8);
+        offsets.reserve((rowCount + 1) * 4);
+        for (int row = 0; row < rowCount; row++) {
+            int type = rows.type(row, column);
+            types.append(static_cast<char>(type));
+            qint64 number = 0;
+            if (type == SQLITE_INTEGER) {
+                number = rows.integer(row, column);
+            } else if (type == SQLITE_FLOAT) {
+                double value = rows.real(row, column);
+                std::memcpy(&number, &value, sizeof(number));
+            }
+            appendLittleEndian<qint64>(numbers, number);
+            appendLittleEndian<quint32>(offsets, data.size());
+            if (type == SQLITE_TEXT || type == SQLITE_BLOB) {
+                data.append(rows.bytes(row, column));
+            }
+        }
+        appendLittleEndian<quint32>(offsets, data.size());
+        appendLittleEndian<quint64>(buffer_, types.size() + numbers.size() + offsets.size() + data.size());
+        buffer_.append(types);
+        buffer_.append(numbers);
+        buffer_.append(offsets);
+        buffer_.append(data);
+        flush(false);
+    }
+}
+
+/*
+ * Конец колоночного файла: количество строк (u64),
+ * количество групп (u32), смещения групп (u64 каждое),
+ * смещение начала этого блока (u64) и "SQRC".
+ * Читатель начинает с последних 12 байт.
+*/
+void SqliteExporter::writeFooter(qint64 rows)
+{
+    qint64 footer = file_offset_ + buffer_.size();
+    appendLittleEndian<quint64>(buffer_, rows);
+    appendLittleEndian<quint32>(buffer_, row_groups_.size());
+    for (qint64 offset : row_groups_) {
+        appendLittleEndian<quint64>(buffer_, offset);
+    }
+    appendLittleEndian<quint64>(buffer_, footer);
+    buffer_.append("SQRC", 4);
+}
+
+/*
+ * Запись буфера в файл, когда он набрал BUFFER_SIZE байт
+ * (или всегда, если isForced). Память буфера остаётся
+ * за ним до конца выгрузки.
+*/
+bool SqliteExporter::flush(bool isForced)
+{
+    if (buffer_.isEmpty() || (!isForced && buffer_.size() < BUFFER_SIZE) || is_write_failed_) {
+        return !is_write_failed_;
+    }
+    if (file_.write(buffer_) != buffer_.size()) {
+        is_write_failed_ = true;
+        return false;
+    }
+    file_offset_ += buffer_.size();
+    buffer_.resize(0);
+    return true;
+}
+
+template<typename T>
+void SqliteExporter::appendLittleEndian(QByteArray &target, T value)
+{
+    T stored = qToLittleEndian(value);
+    target.append(reinterpret_cast<const char *>(&stored), sizeof(stored));
+}
+
+SqliteExporter::~SqliteExporter()
+{
+
+}
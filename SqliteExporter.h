@@ -0,0 +1,99 @@
+#ifndef SQLITEEXPORTER_H
+#define SQLITEEXPORTER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QtEndian>
+
+#include <cmath>
+#include <cstring>
+
+#include <sqlite3.h>
+
+#include "SqliteConnectionProfile.h"
+#include "SqliteReaderWorker.h"
+#include "SqliteResultBlock.h"
+#include "SqliteSubstringSearch.h"
+
+/*
+ * Выгрузка результата запроса (таблица с фильтрами и
+ * сортировкой) в файл. Живёт в своём потоке и открывает
+ * своё соединение только для чтения, строки идут прямо из
+ * sqlite3_step в буфер записи размером BUFFER_SIZE, поэтому
+ * память не зависит от размера таблицы.
+ * Форматы:
+ * Csv - RFC 4180, первая строка - имена колонок;
+ * JsonLines - объект на строку, blob в base64;
+ * Columnar - колоночный двоичный формат (см. writeRowGroup):
+ * строки группами до ROW_GROUP_ROWS, внутри группы каждая
+ * колонка лежит подряд, в конце файла - смещения групп.
+ * Файл пишется под временным именем и переименовывается
+ * только после успешного окончания.
+*/
+class SqliteExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Format {Csv, JsonLines, Columnar};
+    const int BUFFER_SIZE = 4 * 1024 * 1024;  //байт, после которых буфер пишется в файл
+    const int ROW_GROUP_ROWS = 65536;  //строк в группе колоночного формата
+    const qint64 ROW_GROUP_BYTES = 64 * 1024 * 1024;  //байт текста и blob в группе колоночного формата
+    const int PROGRESS_TIME = 100;  //мс между сигналами progress
+    const QString PART_SUFFIX = ".part";  //суффикс файла, пока выгрузка не закончена
+    SqliteExporter();
+    int queueExport();
+    void cancel();
+    static QString suffix(Format format);
+    virtual ~SqliteExporter();
+
+public slots:
+    void exportRows(int request, const QString &databasePath, const SqliteConnectionProfile &profile,
+                    const QString &query, const QVariantList &values, const QStringList &columns,
+                    int keyColumns, int format, qint64 expectedRows, const QString &path);
+
+signals:
+    void progress(qint64 rows, qint64 expectedRows);
+    void finished(const QString &path, qint64 rows);
+    void cancelled(const QString &path);
+    void failed(const QString &path, const QString &error);
+
+private:
+    sqlite3 *openDatabase(const QString &databasePath, const SqliteConnectionProfile &profile);
+    bool writeRows(sqlite3_stmt *statement, Format format, qint64 expectedRows, qint64 &rows);
+    void appendCsvRow(sqlite3_stmt *statement);
+    void appendJsonRow(sqlite3_stmt *statement);
+    void appendCsvText(const char *data, int size);
+    void appendJsonText(const char *data, int size);
+    void appendNumber(sqlite3_stmt *statement, int column);
+    void writeHeader(Format format);
+    void writeRowGroup(const SqliteResultBlock &rows);
+    void writeFooter(qint64 rows);
+    bool flush(bool isForced);
+    bool isCancelled() const;
+    template<typename T> void appendLittleEndian(QByteArray &target, T value);
+
+    QStringList columns_;
+    QList<QByteArray> json_names_;  //готовые ключи "имя": для json lines
+    int key_columns_ = 0;  //первые колонки запроса с ключом строки, не выгружаются
+    QFile file_;
+    QByteArray buffer_;
+    bool is_write_failed_ = false;
+    QList<qint64> row_groups_;  //смещения групп колоночного формата в файле
+    qint64 file_offset_ = 0;  //байт уже записано в файл
+    QAtomicInt last_request_;  //номер последней выгрузки, поставленной в очередь
+    QAtomicInt cancelled_request_;  //выгрузки с номерами до него включительно отменены
+    int request_ = 0;  //номер текущей выгрузки
+    sqlite3 *handle_ = nullptr;  //соединение текущей выгрузки
+    QMutex mutex_;  //защищает handle_ для cancel() из другого потока
+};
+
+#endif // SQLITEEXPORTER_H
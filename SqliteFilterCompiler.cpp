@@ -0,0 +1,330 @@
+#include "SqliteFilterCompiler.h"
+
+SqliteFilterCompiler::SqliteFilterCompiler()
+{
+
+}
+
+/*
+ * Таблица и её колонки, к которым относятся фильтры.
+ * key - выражение ключа строки, которое будет первой
+ * колонкой запроса по всей таблице.
+ * Построенный для прошлой таблицы индекс больше не подходит.
+*/
+void SqliteFilterCompiler::setSource(const QString &table, const QStringList &columns, const QString &key)
+{
+    table_ = table;
+    columns_ = columns;
+    key_ = key;
+    is_indexed_ = false;
+}
+
+void SqliteFilterCompiler::setIndexed(bool isIndexed)
+{
+    is_indexed_ = isIndexed;
+}
+
+bool SqliteFilterCompiler::isIndexed() const
+{
+    return is_indexed_;
+}
+
+/*
+ * Ленивое чтение больших значений в запросах по таблице.
+ * eagerColumn читается целиком всегда: по ней сортирует
+ * sqlite, и её значения нужны для чтения страниц поиском.
+ * Работает только для таблиц с rowid: по нему исполнитель
+ * открывает значение через sqlite3_blob_open.
+*/
+void SqliteFilterCompiler::setLazy(bool isLazy, int eagerColumn)
+{
+    is_lazy_ = isLazy;
+    eager_column_ = eagerColumn;
+}
+
+bool SqliteFilterCompiler::isLazy() const
+{
+    return is_lazy_ && hasRowid();
+}
+
+/*
+ * Ключ строк таблицы - rowid: по нему можно открыть blob
+ * и поделить таблицу на диапазоны
+*/
+bool SqliteFilterCompiler::hasRowid() const
+{
+    return key_ == "rowid";
+}
+
+/*
+ * Запрос всей таблицы без фильтров
+*/
+QString SqliteFilterCompiler::tableRequest() const
+{
+    return "select * from " + quoteIdentifier(table_);
+}
+
+/*
+ * Запрос по всей таблице отдаёт ключ строки первой колонкой
+*/
+bool SqliteFilterCompiler::isKeyed(const QString &request) const
+{
+    return !key_.isEmpty() && request == tableRequest();
+}
+
+/*
+ * Запрос request с учётом фильтров.
+ * Если запрос - это просто вся таблица, то к нему добавляется
+ * ключ строки (см. isKeyed).
+ * Значения для плейсхолдеров складываются в values в том
+ * же порядке, в котором плейсхолдеры идут в запросе.
+*/
+QString SqliteFilterCompiler::compile(const QString &request, const QStringList &filters, QVariantList &values) const
+{
+    bool isTableScan = request == tableRequest();
+    QStringList conditions = filterConditions(filters, values, isTableScan);
+    QString select = isKeyed(request) ? keyedSelect() + " from " : "select * from ";
+    QString source = isTableScan ? quoteIdentifier(table_) : "(" + request + ")";
+    if (conditions.isEmpty()) {
+        return isTableScan ? select + source : request;
+    }
+    return select + source + " where " + conditions.join(" and ");
+}
+
+/*
+ * Запрос ключей строк таблицы, подходящих под фильтры,
+ * для сохранения множества совпадений. Если source >= 0,
+ * то строки ищутся только среди множества поколения source.
+*/
+QString SqliteFilterCompiler::matchesSelect(const QStringList &filters, QVariantList &values, int source) const
+{
+    QStringList conditions;
+    if (source >= 0) {
+        conditions.append(key_ + " in (select key from temp." + matchesTable(source) + ")");
+    }
+    conditions.append(filterConditions(filters, values, true));
+    QString select = "select " + key_ + " from " + quoteIdentifier(table_);
+    if (conditions.isEmpty()) {
+        return select;
+    }
+    return select + " where " + conditions.join(" and ");
+}
+
+/*
+ * Запрос по всей таблице, ограниченный сохранённым
+ * множеством поколения generation. Фильтры уже учтены
+ * при сохранении, поэтому заново не проверяются.
+*/
+QString SqliteFilterCompiler::matchedRequest(int generation) const
+{
+    return keyedSelect() + " from " + quoteIdentifier(table_) +
+           " where " + key_ + " in (select key from temp." + matchesTable(generation) + ")";
+}
+
+/*
+ * Запрос по таблице с rowid, ограниченный диапазонами rowid
+ * ranges (первый и последний rowid), с фильтрами. Так читаются
+ * только строки, которые изменились (SqliteChunkFingerprint).
+ * Границы диапазонов идут в values перед значениями фильтров.
+*/
+QString SqliteFilterCompiler::rangeRequest(const QStringList &filters, QVariantList &values,
+                                           const QList<QPair<qint64, qint64>> &ranges) const
+{
+    QStringList bounds;
+    for (const QPair<qint64, qint64> &range : ranges) {
+        bounds.append("rowid between ? and ?");
+        values << range.first << range.second;
+    }
+    QStringList conditions("(" + (bounds.isEmpty() ? QString("0") : bounds.join(" or ")) + ")");
+    conditions.append(filterConditions(filters, values, true));
+    return keyedSelect() + " from " + quoteIdentifier(table_) + " where " + conditions.join(" and ");
+}
+
+/*
+ * Запрос для SqliteParallelScan: ключ строки и, для сводки
+ * (isSummary), все колонки строк таблицы, подошедших под фильтры.
+ * У таблиц с rowid первые два плейсхолдера - границы диапазона
+ * rowid, их значения подставляет проход, в values идут только
+ * значения фильтров. Индекс fts5 лежит во временной таблице
+ * исполнителя, поэтому фильтры здесь проверяются без него.
+*/
+QString SqliteFilterCompiler::scanRequest(const QStringList &filters, QVariantList &values, bool isSummary) const
+{
+    SqliteFilterCompiler compiler = *this;
+    compiler.setIndexed(false);
+    QStringList conditions;
+    if (hasRowid()) {
+        conditions.append("rowid between ? and ?");
+    }
+    conditions.append(compiler.filterConditions(filters, values, true));
+    QString key = key_.isEmpty() ? "null" : key_;
+    QString select = "select " + key + (isSummary ? ", * from " : " from ") + quoteIdentifier(table_);
+    if (conditions.isEmpty()) {
+        return select;
+    }
+    return select + " where " + conditions.join(" and ");
+}
+
+/*
+ * Имя временной таблицы с ключами строк, подошедших
+ * под фильтры в поколении generation
+*/
+QString SqliteFilterCompiler::matchesTable(int generation)
+{
+    return "sqlitereader_filter_matches_" + QString::number(generation);
+}
+
+/*
+ * Имя колонки с длиной ленивых значений колонки name таблицы
+ * table, значения которой идут в запросе колонкой column.
+ * Исполнитель узнаёт из него, откуда читать начало значения.
+*/
+QString SqliteFilterCompiler::lazyAlias(int column, const QString &table, const QString &name)
+{
+    return "sqlitereader_lazy:" + QString::number(column) + ":" +
+           QString::fromLatin1(QUrl::toPercentEncoding(table)) + ":" +
+           QString::fromLatin1(QUrl::toPercentEncoding(name));
+}
+
+bool SqliteFilterCompiler::parseLazyAlias(const char *alias, int &column, QByteArray &table, QByteArray &name)
+{
+    QList<QByteArray> parts = QByteArray(alias).split(':');
+    if (parts.size() != 4 || parts[0] != "sqlitereader_lazy") {
+        return false;
+    }
+    bool isNumber = false;
+    column = parts[1].toInt(&isNumber);
+    table = QByteArray::fromPercentEncoding(parts[2]);
+    name = QByteArray::fromPercentEncoding(parts[3]);
+    return isNumber;
+}
+
+QString SqliteFilterCompiler::dropIndexStatement() const
+{
+    return "drop table if exists temp." + INDEX_TABLE;
+}
+
+/*
+ * Индекс без содержимого (content=''): хранит только
+ * триграммы и rowid, сами значения остаются в таблице.
+ * case_sensitive 1, чтобы совпадать с поиском подстроки в фильтрах.
+*/
+QString SqliteFilterCompiler::createIndexStatement() const
+{
+    QStringList indexColumns;
+    for (int i = 0; i < columns_.size(); i++) {
+        indexColumns.append(indexColumn(i));
+    }
+    return "create virtual table temp." + INDEX_TABLE + " using fts5(" +
+           indexColumns.join(", ") + ", content='', tokenize='trigram case_sensitive 1')";
+}
+
+QString SqliteFilterCompiler::fillIndexStatement() const
+{
+    QStringList indexColumns;
+    QStringList tableColumns;
+    for (int i = 0; i < columns_.size(); i++) {
+        indexColumns.append(indexColumn(i));
+        tableColumns.append(quoteIdentifier(columns_[i]));
+    }
+    return "insert into temp." + INDEX_TABLE + "(rowid, " + indexColumns.join(", ") + ") " +
+           "select rowid, " + tableColumns.join(", ") + " from " + quoteIdentifier(table_);
+}
+
+QString SqliteFilterCompiler::quoteIdentifier(const QString &name)
+{
+    return "\"" + QString(name).replace("\"", "\"\"") + "\"";
+}
+
+/*
+ * Условия для непустых фильтров.
+ * Каждый фильтр даёт вызов функции поиска подстроки
+ * с учётом регистра (см. SqliteSubstringSearch). Если есть индекс
+ * и условия накладываются прямо на таблицу, то длинные
+ * фильтры сначала сужаются через match по индексу, а поиск
+ * проверяет уже только найденные строки.
+*/
+QStringList SqliteFilterCompiler::filterConditions(const QStringList &filters, QVariantList &values,
+                                                   bool isTableScan) const
+{
+    QStringList conditions;
+    QStringList matches;
+    QVariantList searchValues;
+    for (int i = 0; i < filters.size() && i < columns_.size(); i++) {
+        if (filters[i].isEmpty()) {
+            continue;
+        }
+        conditions.append(QString(SqliteSubstringSearch::FUNCTION_NAME) + "(" +
+                          quoteIdentifier(columns_[i]) + ", ?)");
+        searchValues.append(filters[i]);
+        if (is_indexed_ && isTableScan && filters[i].size() >= TRIGRAM_LENGTH) {
+            matches.append(indexColumn(i) + " : \"" + QString(filters[i]).replace("\"", "\"\"") + "\"");
+        }
+    }
+    if (!matches.isEmpty()) {
+        conditions.prepend("rowid in (select rowid from temp." + INDEX_TABLE +
+                           " where " + INDEX_TABLE + " match ?)");
+        values.append(matches.join(" AND "));
+    }
+    values.append(searchValues);
+    return conditions;
+}
+
+/*
+ * Колонки индекса называются c0, c1, ..., чтобы их можно
+ * было писать в match без кавычек.
+*/
+QString SqliteFilterCompiler::indexColumn(int column) const
+{
+    return "c" + QString::number(column);
+}
+
+/*
+ * Начало запроса по всей таблице: ключ строки и колонки.
+ * В ленивом режиме большое значение заменяется на null, а его
+ * длина (умноженная на 2, младший бит - blob ли это) идёт
+ * в колонке lazyAlias после колонок таблицы. sqlite считает
+ * length и typeof, не читая страниц переполнения, поэтому
+ * большие значения совсем не читаются с диска.
+*/
+QString SqliteFilterCompiler::keyedSelect() const
+{
+    if (!isLazy()) {
+        return "select " + key_ + ", *";
+    }
+    QStringList values;
+    QStringList lengths;
+    QString limit = QString::number(LAZY_SIZE);
+    for (int i = 0; i < columns_.size(); i++) {
+        QString column = quoteIdentifier(columns_[i]);
+        if (i == eager_column_) {
+            values.append(column);
+            continue;
+        }
+        QString size = sizeExpression(column);
+        values.append("iif(" + size + " > " + limit + ", null, " + column + ") as " + column);
+        lengths.append("iif(" + size + " > " + limit + ", " + size + " * 2 + (typeof(" + column + ") = 'blob'), null)" +
+                       " as " + quoteIdentifier(lazyAlias(i + 1, table_, columns_[i])));
+    }
+    return "select " + key_ + ", " + (values + lengths).join(", ");
+}
+
+/*
+ * Длина значения в байтах без чтения самого значения.
+ * octet_length появился в sqlite 3.43, в старых версиях
+ * без чтения можно узнать только длину blob
+ * (length текста считает символы), так что текст там
+ * читается целиком.
+*/
+QString SqliteFilterCompiler::sizeExpression(const QString &column)
+{
+    if (sqlite3_libversion_number() >= 3043000) {
+        return "octet_length(" + column + ")";
+    }
+    return "iif(typeof(" + column + ") = 'blob', length(" + column + "), 0)";
+}
+
+SqliteFilterCompiler::~SqliteFilterCompiler()
+{
+
+}
@@ -0,0 +1,74 @@
+#ifndef SQLITEFILTERCOMPILER_H
+#define SQLITEFILTERCOMPILER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QList>
+#include <QPair>
+#include <QUrl>
+
+#include "SqliteSubstringSearch.h"
+
+/*
+ * Превращение фильтров колонок в условие where,
+ * которое считает сам sqlite. Значения фильтров
+ * никогда не подставляются в текст запроса, а
+ * передаются через плейсхолдеры.
+ * По желанию фильтры ускоряются временным индексом
+ * fts5 с токенайзером trigram: подстрока длиной от
+ * TRIGRAM_LENGTH символов ищется по индексу, а не
+ * полным проходом по таблице.
+ * Ключи строк, подошедших под фильтры, можно сохранить во
+ * временную таблицу (matchesSelect), чтобы следующий, более
+ * узкий, проход искал только среди них.
+ * В ленивом режиме (setLazy) запрос по таблице с ключом rowid
+ * не читает значения длиннее LAZY_SIZE байт: вместо них null,
+ * а в дополнительной колонке после всех колонок таблицы - длина
+ * (см. lazyAlias), начало значения исполнитель читает сам.
+*/
+class SqliteFilterCompiler
+{
+public:
+    const int TRIGRAM_LENGTH = 3;  //минимальная длина подстроки, которую может найти trigram
+    const QString INDEX_TABLE = "sqlitereader_filter_index";  //имя временной fts5 таблицы
+    const int LAZY_SIZE = 4096;  //байт, длиннее которых текст и blob читаются лениво
+    SqliteFilterCompiler();
+    void setSource(const QString &table, const QStringList &columns, const QString &key);
+    void setIndexed(bool isIndexed);
+    bool isIndexed() const;
+    void setLazy(bool isLazy, int eagerColumn = -1);
+    bool isLazy() const;
+    bool hasRowid() const;
+    QString tableRequest() const;
+    bool isKeyed(const QString &request) const;
+    QString compile(const QString &request, const QStringList &filters, QVariantList &values) const;
+    QString matchesSelect(const QStringList &filters, QVariantList &values, int source) const;
+    QString matchedRequest(int generation) const;
+    QString scanRequest(const QStringList &filters, QVariantList &values, bool isSummary) const;
+    QString rangeRequest(const QStringList &filters, QVariantList &values,
+                         const QList<QPair<qint64, qint64>> &ranges) const;
+    QString dropIndexStatement() const;
+    QString createIndexStatement() const;
+    QString fillIndexStatement() const;
+    static QString quoteIdentifier(const QString &name);
+    static QString matchesTable(int generation);
+    static QString lazyAlias(int column, const QString &table, const QString &name);
+    static bool parseLazyAlias(const char *alias, int &column, QByteArray &table, QByteArray &name);
+    virtual ~SqliteFilterCompiler();
+
+private:
+    QStringList filterConditions(const QStringList &filters, QVariantList &values, bool isTableScan) const;
+    QString indexColumn(int column) const;
+    QString keyedSelect() const;
+    static QString sizeExpression(const QString &column);
+
+    QString table_ = "";
+    QStringList columns_;
+    QString key_ = "";  //выражение ключа строки (rowid или первичный ключ), пустое если ключа нет
+    bool is_indexed_ = false;  //индекс построен и соответствует данным
+    bool is_lazy_ = false;  //большие значения не читаются запросом по таблице
+    int eager_column_ = -1;  //колонка, которая читается целиком и в ленивом режиме (сортировка)
+};
+
+#endif // SQLITEFILTERCOMPILER_H
@@ -0,0 +1,123 @@
+#include "SqliteFilterScheduler.h"
+
+SqliteFilterScheduler::SqliteFilterScheduler()
+{
+    timer_ = new QTimer();
+    timer_->setSingleShot(true);
+    timer_->setInterval(DEBOUNCE_TIME);
+    QObject::connect(timer_, SIGNAL(timeout()),
+                     this, SLOT(onTimeout()));
+}
+
+/*
+ * Новая таблица: все фильтры пустые,
+ * отложенные правки и сохранённое множество забываются.
+*/
+void SqliteFilterScheduler::reset(int columns)
+{
+    timer_->stop();
+    filters_.clear();
+    for (int i = 0; i < columns; i++) {
+        filters_.append("");
+    }
+    invalidate();
+}
+
+/*
+ * Сохранённое множество больше не соответствует данным
+ * (бд изменилась), сужать по нему нельзя.
+*/
+void SqliteFilterScheduler::invalidate()
+{
+    expected_generation_ = -1;
+    expected_filters_.clear();
+    matched_generation_ = -1;
+    matched_filters_.clear();
+}
+
+/*
+ * Исполнитель начал сохранять множество строк,
+ * подходящих под filters, для поколения generation.
+*/
+void SqliteFilterScheduler::expectMatches(int generation, const QStringList &filters)
+{
+    expected_generation_ = generation;
+    expected_filters_ = filters;
+}
+
+/*
+ * Поколение сохранённого множества, по которому можно
+ * искать строки для filters, или -1 если искать нужно
+ * по всей таблице.
+*/
+int SqliteFilterScheduler::narrowingSource(const QStringList &filters) const
+{
+    if (matched_generation_ < 0 || !isNarrowing(matched_filters_, filters)) {
+        return -1;
+    }
+    return matched_generation_;
+}
+
+/*
+ * Новые фильтры сужают старые, если каждый новый фильтр
+ * содержит старый как подстроку: тогда всё, что подходит
+ * под новые, подходило и под старые.
+*/
+bool SqliteFilterScheduler::isNarrowing(const QStringList &previous, const QStringList &current)
+{
+    if (previous.size() != current.size()) {
+        return false;
+    }
+    for (int i = 0; i < current.size(); i++) {
+        if (!current[i].contains(previous[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Правка фильтра: запоминается и откладывает применение
+ * всех фильтров ещё на DEBOUNCE_TIME мс.
+*/
+void SqliteFilterScheduler::changeFilter(int column, const QString &filter)
+{
+    if (column < 0 || column >= filters_.size()) {
+        return;
+    }
+    filters_[column] = filter;
+    timer_->start();
+}
+
+/*
+ * Применение отложенных правок сразу, без паузы
+ * (запросы, которые ждут результат, а не печатают)
+*/
+void SqliteFilterScheduler::flush()
+{
+    timer_->stop();
+    emit filtersReady(filters_);
+}
+
+/*
+ * Исполнитель сохранил множество. Ответы для поколений,
+ * которые уже не ожидаются, пропускаются.
+*/
+void SqliteFilterScheduler::onMatchesKept(int generation)
+{
+    if (generation != expected_generation_) {
+        return;
+    }
+    matched_generation_ = expected_generation_;
+    matched_filters_ = expected_filters_;
+}
+
+void SqliteFilterScheduler::onTimeout()
+{
+    emit filtersReady(filters_);
+}
+
+SqliteFilterScheduler::~SqliteFilterScheduler()
+{
+    delete timer_;
+}
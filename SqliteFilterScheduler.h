@@ -0,0 +1,52 @@
+#ifndef SQLITEFILTERSCHEDULER_H
+#define SQLITEFILTERSCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QString>
+#include <QStringList>
+
+/*
+ * Планировщик фильтрации.
+ * Склеивает быстрые правки фильтров: проход запускается
+ * только когда пользователь перестал печатать на DEBOUNCE_TIME мс.
+ * Помнит, для каких фильтров исполнитель сохранил множество
+ * подходящих строк, и если новые фильтры его сужают (например
+ * допечатан ещё один символ), то следующий проход можно
+ * делать только по этому множеству, а не по всей таблице.
+*/
+class SqliteFilterScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    const int DEBOUNCE_TIME = 150;  //пауза в наборе, после которой применяются фильтры
+    SqliteFilterScheduler();
+    void reset(int columns);
+    void invalidate();
+    void expectMatches(int generation, const QStringList &filters);
+    int narrowingSource(const QStringList &filters) const;
+    static bool isNarrowing(const QStringList &previous, const QStringList &current);
+    virtual ~SqliteFilterScheduler();
+
+public slots:
+    void changeFilter(int column, const QString &filter);
+    void flush();
+    void onMatchesKept(int generation);
+
+signals:
+    void filtersReady(const QStringList &filters);
+
+private slots:
+    void onTimeout();
+
+private:
+    QTimer *timer_;
+    QStringList filters_;  //фильтры с учётом ещё не применённых правок
+    int expected_generation_ = -1;  //поколение, для которого исполнитель сохраняет множество
+    QStringList expected_filters_;
+    int matched_generation_ = -1;  //поколение сохранённого множества, -1 если его нет
+    QStringList matched_filters_;  //фильтры, которым соответствует сохранённое множество
+};
+
+#endif // SQLITEFILTERSCHEDULER_H
@@ -0,0 +1,174 @@
+#include "SqliteHistogram.h"
+
+SqliteHistogram::SqliteHistogram()
+{
+
+}
+
+void SqliteHistogram::add(double value)
+{
+    if (!std::isfinite(value)) {
+        return;
+    }
+    if (value != 0 && std::ilogb(value) - 60 > exponent_) {
+        rescale(std::ilogb(value) - 60);  //номер корзины должен помещаться в qint64
+    }
+    is_integral_ = is_integral_ && value == std::floor(value);
+    count_++;
+    qint64 index = binIndex(value);
+    if (bins_.isEmpty()) {
+        first_ = index;
+        bins_.append(1);
+        return;
+    }
+    if (index < first_ || index >= first_ + bins_.size()) {
+        fit(qMin(index, first_), qMax(index, first_ + bins_.size() - 1));
+        index = binIndex(value);
+    }
+    bins_[static_cast<int>(index - first_)]++;
+}
+
+/*
+ * Добавление гистограммы другой части значений
+*/
+void SqliteHistogram::merge(const SqliteHistogram &other)
+{
+    if (other.bins_.isEmpty()) {
+        return;
+    }
+    if (bins_.isEmpty()) {
+        *this = other;
+        return;
+    }
+    SqliteHistogram part = other;
+    rescale(qMax(exponent_, part.exponent_));
+    part.rescale(exponent_);
+    fit(qMin(first_, part.first_), qMax(first_ + bins_.size() - 1, part.first_ + part.bins_.size() - 1));
+    part.rescale(exponent_);
+    for (int i = 0; i < part.bins_.size(); i++) {
+        bins_[static_cast<int>(part.first_ + i - first_)] += part.bins_[i];
+    }
+    count_ += part.count_;
+    is_integral_ = is_integral_ && part.is_integral_;
+}
+
+qint64 SqliteHistogram::count() const
+{
+    return count_;
+}
+
+/*
+ * Корзины для показа. У целых значений корзины
+ * не бывают уже единицы: их делит только удвоение.
+*/
+int SqliteHistogram::binCount() const
+{
+    int shift = displayExponent() - exponent_;
+    if (bins_.isEmpty()) {
+        return 0;
+    }
+    return static_cast<int>(((first_ + bins_.size() - 1) >> shift) - (first_ >> shift) + 1);
+}
+
+double SqliteHistogram::binStart(int bin) const
+{
+    int shift = displayExponent() - exponent_;
+    return std::ldexp(static_cast<double>((first_ >> shift) + bin), displayExponent());
+}
+
+double SqliteHistogram::binEnd(int bin) const
+{
+    return binStart(bin + 1);
+}
+
+qint64 SqliteHistogram::binValues(int bin) const
+{
+    int shift = displayExponent() - exponent_;
+    qint64 index = (first_ >> shift) + bin;
+    qint64 values = 0;
+    for (int i = 0; i < bins_.size(); i++) {
+        if (((first_ + i) >> shift) == index) {
+            values += bins_[i];
+        }
+    }
+    return values;
+}
+
+/*
+ * Переход к ширине 2^exponent (не уже текущей):
+ * корзины, попавшие в одну новую, складываются
+*/
+void SqliteHistogram::rescale(int exponent)
+{
+    if (exponent <= exponent_) {
+        return;
+    }
+    int shift = qMin(exponent - exponent_, 63);
+    exponent_ = exponent;
+    if (bins_.isEmpty()) {
+        return;
+    }
+    qint64 first = first_ >> shift;
+    QVector<qint64> bins(static_cast<int>(((first_ + bins_.size() - 1) >> shift) - first + 1), 0);
+    for (int i = 0; i < bins_.size(); i++) {
+        bins[static_cast<int>(((first_ + i) >> shift) - first)] += bins_[i];
+    }
+    first_ = first;
+    bins_ = bins;
+}
+
+/*
+ * Расширение корзин до [first, last] текущей ширины.
+ * Пока они не помещаются в BINS, ширина удваивается.
+*/
+void SqliteHistogram::fit(qint64 first, qint64 last)
+{
+    int shift = 0;
+    while ((last >> shift) - (first >> shift) + 1 > BINS) {
+        shift++;
+    }
+    rescale(exponent_ + shift);
+    first >>= shift;
+    last >>= shift;
+    if (first < first_) {
+        bins_.insert(0, static_cast<int>(first_ - first), 0);
+        first_ = first;
+    }
+    if (last >= first_ + bins_.size()) {
+        bins_.resize(static_cast<int>(last - first_ + 1));
+    }
+}
+
+qint64 SqliteHistogram::binIndex(double value) const
+{
+    return static_cast<qint64>(std::floor(std::ldexp(value, -exponent_)));
+}
+
+int SqliteHistogram::displayExponent() const
+{
+    return is_integral_ ? qMax(exponent_, 0) : exponent_;
+}
+
+SqliteHistogram::~SqliteHistogram()
+{
+
+}
+
+QDataStream &operator<<(QDataStream &stream, const SqliteHistogram &histogram)
+{
+    stream << static_cast<qint32>(histogram.exponent_) << histogram.first_ << histogram.bins_
+           << histogram.count_ << histogram.is_integral_;
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, SqliteHistogram &histogram)
+{
+    qint32 exponent = SqliteHistogram::INITIAL_EXPONENT;
+    stream >> exponent >> histogram.first_ >> histogram.bins_ >> histogram.count_ >> histogram.is_integral_;
+    histogram.exponent_ = exponent;
+    if (histogram.bins_.size() > SqliteHistogram::BINS) {
+        histogram = SqliteHistogram();
+        stream.setStatus(QDataStream::ReadCorruptData);
+    }
+    return stream;
+}
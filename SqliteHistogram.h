@@ -0,0 +1,49 @@
+#ifndef SQLITEHISTOGRAM_H
+#define SQLITEHISTOGRAM_H
+
+#include <QDataStream>
+#include <QVector>
+#include <QtGlobal>
+
+#include <cmath>
+
+/*
+ * Гистограмма числовых значений за один проход без известных
+ * заранее минимума и максимума. Ширина корзины - степень
+ * двойки 2^exponent, корзина значения - floor(value / 2^exponent).
+ * Если значения перестают помещаться в BINS корзин, ширина
+ * удваивается, а соседние корзины складываются, поэтому память
+ * ограничена, а счётчики остаются точными.
+ * Гистограммы частей таблицы объединяются через merge, результат
+ * не зависит от того, как таблица была поделена.
+*/
+class SqliteHistogram
+{
+public:
+    enum {BINS = 64, INITIAL_EXPONENT = -20};  //наибольшее количество корзин и начальная ширина 2^-20
+    SqliteHistogram();
+    void add(double value);
+    void merge(const SqliteHistogram &other);
+    qint64 count() const;
+    int binCount() const;
+    double binStart(int bin) const;
+    double binEnd(int bin) const;
+    qint64 binValues(int bin) const;
+    virtual ~SqliteHistogram();
+    friend QDataStream &operator<<(QDataStream &stream, const SqliteHistogram &histogram);
+    friend QDataStream &operator>>(QDataStream &stream, SqliteHistogram &histogram);
+
+private:
+    void rescale(int exponent);
+    void fit(qint64 first, qint64 last);
+    qint64 binIndex(double value) const;
+    int displayExponent() const;
+
+    int exponent_ = INITIAL_EXPONENT;
+    qint64 first_ = 0;  //номер первой корзины в bins_
+    QVector<qint64> bins_;  //корзины first_, first_ + 1, ...
+    qint64 count_ = 0;
+    bool is_integral_ = true;  //все значения целые: корзины уже единицы не показываются
+};
+
+#endif // SQLITEHISTOGRAM_H
@@ -0,0 +1,85 @@
+#include "SqliteHistogramWidget.h"
+
+SqliteHistogramWidget::SqliteHistogramWidget(QWidget *parent)
+    : QWidget(parent)
+{
+    setMinimumHeight(WIDGET_HEIGHT + LABEL_HEIGHT);
+}
+
+/*
+ * Копируются только столбики для показа,
+ * саму гистограмму виджет не хранит
+*/
+void SqliteHistogramWidget::setHistogram(const SqliteHistogram &histogram)
+{
+    starts_.clear();
+    values_.clear();
+    max_values_ = 0;
+    for (int bin = 0; bin < histogram.binCount(); bin++) {
+        starts_.append(histogram.binStart(bin));
+        values_.append(histogram.binValues(bin));
+        max_values_ = qMax(max_values_, values_.last());
+    }
+    if (!values_.isEmpty()) {
+        starts_.append(histogram.binEnd(values_.size() - 1));
+    }
+    update();
+}
+
+void SqliteHistogramWidget::paintEvent(QPaintEvent *e)
+{
+    Q_UNUSED(e);
+    QPainter painter(this);
+    if (values_.isEmpty()) {
+        painter.drawText(rect(), Qt::AlignCenter, "No numeric values");
+        return;
+    }
+    int barsHeight = height() - LABEL_HEIGHT;
+    for (int bin = 0; bin < values_.size(); bin++) {
+        int left = width() * bin / values_.size();
+        int right = width() * (bin + 1) / values_.size();
+        int barHeight = static_cast<int>(barsHeight * values_[bin] / max_values_);
+        if (values_[bin] > 0 && barHeight == 0) {
+            barHeight = 1;  //непустой столбик видно всегда
+        }
+        painter.fillRect(left, barsHeight - barHeight, qMax(1, right - left - 1), barHeight,
+                         palette().highlight());
+    }
+    painter.setPen(palette().text().color());
+    QRect labels(0, barsHeight, width(), LABEL_HEIGHT);
+    painter.drawText(labels, Qt::AlignLeft | Qt::AlignVCenter, QString::number(starts_.first()));
+    painter.drawText(labels, Qt::AlignRight | Qt::AlignVCenter, QString::number(starts_.last()));
+}
+
+/*
+ * Подсказка столбика под курсором
+*/
+bool SqliteHistogramWidget::event(QEvent *e)
+{
+    if (e->type() != QEvent::ToolTip) {
+        return QWidget::event(e);
+    }
+    QHelpEvent *help = static_cast<QHelpEvent *>(e);
+    int bin = binAt(help->pos().x());
+    if (bin < 0) {
+        QToolTip::hideText();
+        e->ignore();
+        return true;
+    }
+    QToolTip::showText(help->globalPos(), "[" + QString::number(starts_[bin]) + ", " +
+                       QString::number(starts_[bin + 1]) + "): " + QString::number(values_[bin]), this);
+    return true;
+}
+
+int SqliteHistogramWidget::binAt(int x) const
+{
+    if (values_.isEmpty() || width() <= 0 || x < 0 || x >= width()) {
+        return -1;
+    }
+    return qMin(values_.size() - 1, x * values_.size() / width());
+}
+
+SqliteHistogramWidget::~SqliteHistogramWidget()
+{
+
+}
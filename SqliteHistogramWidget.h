@@ -0,0 +1,41 @@
+#ifndef SQLITEHISTOGRAMWIDGET_H
+#define SQLITEHISTOGRAMWIDGET_H
+
+#include <QWidget>
+#include <QEvent>
+#include <QHelpEvent>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QToolTip>
+#include <QVector>
+
+#include "SqliteHistogram.h"
+
+/*
+ * Столбики гистограммы колонки (SqliteHistogram).
+ * Подсказка над столбиком - его границы и количество значений.
+*/
+class SqliteHistogramWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    const int WIDGET_HEIGHT = 120;  //высота области столбиков
+    const int LABEL_HEIGHT = 16;  //высота подписи границ под столбиками
+    SqliteHistogramWidget(QWidget *parent = nullptr);
+    void setHistogram(const SqliteHistogram &histogram);
+    virtual ~SqliteHistogramWidget();
+
+protected:
+    void paintEvent(QPaintEvent *e) override;
+    bool event(QEvent *e) override;
+
+private:
+    int binAt(int x) const;
+
+    QVector<double> starts_;  //начало каждого столбика и конец последнего
+    QVector<qint64> values_;
+    qint64 max_values_ = 0;
+};
+
+#endif // SQLITEHISTOGRAMWIDGET_H
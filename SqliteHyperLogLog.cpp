@@ -0,0 +1,95 @@
+#include "SqliteHyperLogLog.h"
+
+SqliteHyperLogLog::SqliteHyperLogLog()
+{
+    registers_.fill(0, REGISTERS);
+}
+
+void SqliteHyperLogLog::add(quint64 hash)
+{
+    int index = static_cast<int>(hash >> (64 - PRECISION));
+    quint64 rest = (hash << PRECISION) | (quint64(1) << (PRECISION - 1));  //единица-ограничитель, если остальные биты нулевые
+    quint8 rank = static_cast<quint8>(qCountLeadingZeroBits(rest) + 1);
+    if (rank > registers_[index]) {
+        registers_[index] = rank;
+    }
+}
+
+/*
+ * Объединение с оценкой другой части значений:
+ * результат тот же, как если бы все значения добавлялись сюда
+*/
+void SqliteHyperLogLog::merge(const SqliteHyperLogLog &other)
+{
+    quint8 *registers = registers_.data();
+    const quint8 *otherRegisters = other.registers_.constData();
+    for (int i = 0; i < REGISTERS; i++) {
+        registers[i] = qMax(registers[i], otherRegisters[i]);
+    }
+}
+
+/*
+ * Оценка количества различных значений. При малом количестве
+ * (много пустых регистров) считается по доле пустых
+ * регистров (linear counting), она там точнее.
+*/
+qint64 SqliteHyperLogLog::estimate() const
+{
+    double sum = 0;
+    int zeros = 0;
+    for (quint8 rank : registers_) {
+        sum += std::ldexp(1.0, -rank);
+        if (rank == 0) {
+            zeros++;
+        }
+    }
+    double registers = REGISTERS;
+    double alpha = 0.7213 / (1 + 1.079 / registers);
+    double estimate = alpha * registers * registers / sum;
+    if (estimate <= 2.5 * registers && zeros > 0) {
+        estimate = registers * std::log(registers / zeros);
+    }
+    return static_cast<qint64>(estimate + 0.5);
+}
+
+/*
+ * 64-битный хэш байт (FNV-1a с перемешиванием в конце, чтобы
+ * старшие биты, по которым выбирается регистр, зависели от всех байт).
+ * seed различает одинаковые байты разных типов.
+*/
+quint64 SqliteHyperLogLog::hash(const void *data, int size, quint64 seed)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    quint64 hash = 14695981039346656037ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+    for (int i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+SqliteHyperLogLog::~SqliteHyperLogLog()
+{
+
+}
+
+QDataStream &operator<<(QDataStream &stream, const SqliteHyperLogLog &sketch)
+{
+    stream << sketch.registers_;
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, SqliteHyperLogLog &sketch)
+{
+    stream >> sketch.registers_;
+    if (sketch.registers_.size() != SqliteHyperLogLog::REGISTERS) {
+        sketch.registers_.fill(0, SqliteHyperLogLog::REGISTERS);
+        stream.setStatus(QDataStream::ReadCorruptData);
+    }
+    return stream;
+}
@@ -0,0 +1,38 @@
+#ifndef SQLITEHYPERLOGLOG_H
+#define SQLITEHYPERLOGLOG_H
+
+#include <QDataStream>
+#include <QVector>
+#include <QtAlgorithms>
+
+#include <cmath>
+#include <cstring>
+
+/*
+ * Оценка количества различных значений (HyperLogLog).
+ * Значение добавляется своим 64-битным хэшем: первые PRECISION
+ * бит выбирают регистр, а в регистре хранится наибольшая
+ * позиция первой единицы в остальных битах. Память - 2^PRECISION
+ * байт независимо от количества значений, ошибка оценки около
+ * 1.04 / sqrt(2^PRECISION), то есть примерно 1.6%.
+ * Оценки частей таблицы объединяются через merge без потерь,
+ * поэтому её можно считать по частям в разных потоках.
+*/
+class SqliteHyperLogLog
+{
+public:
+    enum {PRECISION = 12, REGISTERS = 1 << PRECISION};  //бит хэша на номер регистра и количество регистров
+    SqliteHyperLogLog();
+    void add(quint64 hash);
+    void merge(const SqliteHyperLogLog &other);
+    qint64 estimate() const;
+    static quint64 hash(const void *data, int size, quint64 seed = 0);
+    virtual ~SqliteHyperLogLog();
+    friend QDataStream &operator<<(QDataStream &stream, const SqliteHyperLogLog &sketch);
+    friend QDataStream &operator>>(QDataStream &stream, SqliteHyperLogLog &sketch);
+
+private:
+    QVector<quint8> registers_;
+};
+
+#endif // SQLITEHYPERLOGLOG_H
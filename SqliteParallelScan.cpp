@@ -0,0 +1,309 @@
+#include "SqliteParallelScan.h"
+
+/*
+ * Задача пула: читает свободные диапазоны, пока они есть
+*/
+class SqliteParallelScan::Task : public QRunnable
+{
+public:
+    Task(SqliteParallelScan *scan, int index)
+        : scan_(scan), index_(index)
+    {
+
+    }
+
+    void run() override
+    {
+        scan_->scanRanges(index_);
+    }
+
+private:
+    SqliteParallelScan *scan_;
+    int index_;
+};
+
+SqliteParallelScan::SqliteParallelScan()
+{
+    pool_.setMaxThreadCount(threadCount());
+}
+
+/*
+ * Сборщик замеров этапов. Задаётся до запуска потока,
+ * сам сборщик потокобезопасен.
+*/
+void SqliteParallelScan::setProfiler(SqliteProfiler *profiler)
+{
+    profiler_ = profiler;
+}
+
+/*
+ * Отмена всех запросов младше request. Можно вызывать из
+ * любого потока: запросы из очереди будут пропущены, а
+ * выполняющийся прерван во всех соединениях пула.
+*/
+void SqliteParallelScan::cancelBefore(int request)
+{
+    QMutexLocker locker(&mutex_);
+    if (request > min_request_.loadAcquire()) {
+        min_request_.storeRelease(request);
+    }
+    if (running_ >= 0 && running_ < request) {
+        for (sqlite3 *handle : handles_) {
+            sqlite3_interrupt(handle);
+        }
+    }
+}
+
+/*
+ * Отмена одного запроса, остальные выполняются
+*/
+void SqliteParallelScan::cancel(int request)
+{
+    QMutexLocker locker(&mutex_);
+    cancelled_.insert(request);
+    if (running_ == request) {
+        for (sqlite3 *handle : handles_) {
+            sqlite3_interrupt(handle);
+        }
+    }
+}
+
+/*
+ * Потоков в пуле - по количеству ядер
+*/
+int SqliteParallelScan::threadCount()
+{
+    return qMax(1, QThread::idealThreadCount());
+}
+
+/*
+ * Проход по строкам select. columns - сколько колонок после
+ * ключа (первой колонки) идёт в сводку, с isKeepingKeys
+ * сохраняются rowid подошедших строк.
+ * Если table не пустая, select по ней ограничен диапазоном
+ * rowid: первые два плейсхолдера - его границы, values - значения
+ * остальных (см. SqliteFilterCompiler::scanRequest). Иначе
+ * select читается целиком одним потоком.
+ * Результат придёт в scanned или failed, об отменённом
+ * запросе не сообщается.
+*/
+void SqliteParallelScan::scan(int request, const QString &databasePath, const SqliteConnectionProfile &profile,
+                              const QString &table, const QString &select, const QVariantList &values,
+                              int columns, bool isKeepingKeys)
+{
+    {
+        QMutexLocker locker(&mutex_);
+        if (isStale(request)) {
+            cancelled_.remove(request);
+            return;
+        }
+        running_ = request;
+        error_ = "";
+    }
+    SqliteProfiler::Scope scope(profiler_, "parallelScan", "scan");
+    database_path_ = databasePath;
+    profile_ = profile;
+    select_ = select;
+    values_ = values;
+    is_ranged_ = !table.isEmpty();
+    is_keeping_keys_ = isKeepingKeys;
+    splitRanges(table);
+    int tasks = qMin(threadCount(), ranges_.size());
+    summaries_ = QVector<SqliteScanSummary>(tasks, SqliteScanSummary(columns));
+    next_range_.storeRelease(0);
+    for (int i = 0; i < tasks; i++) {
+        pool_.start(new Task(this, i));
+    }
+    pool_.waitForDone();
+
+    SqliteScanSummary summary(columns);
+    QVector<qint64> keys;
+    for (const SqliteScanSummary &part : summaries_) {
+        summary.merge(part);
+    }
+    if (is_keeping_keys_) {
+        keys.reserve(static_cast<int>(summary.rowCount()));
+        for (const Range &range : ranges_) {
+            keys += range.keys;  //диапазоны идут по возрастанию rowid
+        }
+    }
+    ranges_.clear();
+    summaries_.clear();
+    QString error;
+    bool isCancelled;
+    {
+        QMutexLocker locker(&mutex_);
+        running_ = -1;
+        error = error_;
+        isCancelled = isStale(request);
+        cancelled_.remove(request);
+    }
+    if (isCancelled) {
+        return;
+    }
+    if (scope.isActive()) {
+        scope.setArg("threads", tasks);
+        scope.setArg("rows", summary.rowCount());
+    }
+    if (!error.isEmpty()) {
+        emit failed(request, error);
+        return;
+    }
+    emit scanned(request, summary, keys);
+}
+
+/*
+ * Деление таблицы на диапазоны по крайним rowid. Их находит
+ * спуск по краям b-дерева, строки при этом не читаются.
+ * Пропуски в rowid делают диапазоны неравными, поэтому их
+ * больше, чем потоков.
+*/
+void SqliteParallelScan::splitRanges(const QString &table)
+{
+    ranges_.clear();
+    if (!is_ranged_) {
+        ranges_.append(Range());
+        return;
+    }
+    sqlite3 *handle = openDatabase();
+    if (!handle) {
+        return;
+    }
+    QByteArray sql = ("select min(rowid), max(rowid) from " + SqliteFilterCompiler::quoteIdentifier(table)).toUtf8();
+    sqlite3_stmt *statement = nullptr;
+    bool isRead = sqlite3_prepare_v2(handle, sql.constData(), sql.size(), &statement, nullptr) == SQLITE_OK &&
+                  sqlite3_step(statement) == SQLITE_ROW;
+    if (!isRead) {
+        fail(QString::fromUtf8(sqlite3_errmsg(handle)));
+    }
+    if (isRead && sqlite3_column_type(statement, 0) != SQLITE_NULL) {  //у пустой таблицы диапазонов нет
+        qint64 first = sqlite3_column_int64(statement, 0);
+        qint64 last = sqlite3_column_int64(statement, 1);
+        quint64 size = static_cast<quint64>(last) - static_cast<quint64>(first) + 1;
+        quint64 count = qMax<quint64>(1, qMin<quint64>(static_cast<quint64>(threadCount() * RANGES_PER_THREAD),
+                                                       size / static_cast<quint64>(MIN_RANGE_SIZE)));
+        quint64 step = size / count + (size % count != 0);
+        for (quint64 i = 0; i < count; i++) {
+            Range range;
+            range.first = static_cast<qint64>(static_cast<quint64>(first) + i * step);
+            range.last = i + 1 == count ? last : static_cast<qint64>(static_cast<quint64>(first) + (i + 1) * step - 1);
+            ranges_.append(range);
+        }
+    }
+    sqlite3_finalize(statement);
+    closeDatabase(handle);
+}
+
+/*
+ * Тело задачи пула: своё соединение и подготовленный запрос,
+ * через которые читаются свободные диапазоны
+*/
+void SqliteParallelScan::scanRanges(int task)
+{
+    SqliteProfiler::Scope scope(profiler_, "scanRanges", "scan");
+    sqlite3 *handle = openDatabase();
+    if (!handle) {
+        return;
+    }
+    QByteArray sql = select_.toUtf8();
+    sqlite3_stmt *statement = nullptr;
+    if (sqlite3_prepare_v2(handle, sql.constData(), sql.size(), &statement, nullptr) != SQLITE_OK) {
+        fail(QString::fromUtf8(sqlite3_errmsg(handle)));
+        closeDatabase(handle);
+        return;
+    }
+    SqliteScanSummary &summary = summaries_[task];
+    int ranges = 0;
+    for (int i = next_range_.fetchAndAddOrdered(1); i < ranges_.size(); i = next_range_.fetchAndAddOrdered(1)) {
+        Range &range = ranges_[i];
+        QVariantList parameters;
+        if (is_ranged_) {
+            parameters << range.first << range.last;
+        }
+        parameters += values_;
+        sqlite3_reset(statement);
+        if (!SqliteReaderWorker::bindValues(statement, parameters)) {
+            fail(QString::fromUtf8(sqlite3_errmsg(handle)));
+            break;
+        }
+        int status;
+        while ((status = sqlite3_step(statement)) == SQLITE_ROW) {
+            if (is_keeping_keys_) {
+                range.keys.append(sqlite3_column_int64(statement, 0));
+            }
+            summary.addRow(statement, 1);
+        }
+        if (status != SQLITE_DONE) {
+            fail(QString::fromUtf8(sqlite3_errmsg(handle)));  //в том числе прерывание при отмене
+            break;
+        }
+        ranges++;
+    }
+    if (scope.isActive()) {
+        scope.setArg("ranges", ranges);
+    }
+    sqlite3_finalize(statement);
+    closeDatabase(handle);
+}
+
+/*
+ * Своё соединение только для чтения с прагмами профиля
+ * и функцией поиска подстроки для фильтров. Пока оно открыто,
+ * его можно прервать через cancelBefore.
+*/
+sqlite3 *SqliteParallelScan::openDatabase()
+{
+    sqlite3 *handle = nullptr;
+    int flags = SQLITE_OPEN_READONLY | (profile_.isImmutable ? SQLITE_OPEN_URI : 0);
+    QByteArray name = profile_.databaseName(database_path_).toUtf8();
+    if (sqlite3_open_v2(name.constData(), &handle, flags, nullptr) != SQLITE_OK ||
+            !SqliteSubstringSearch::install(handle)) {
+        sqlite3_close(handle);
+        fail("Cannot open the database");
+        return nullptr;
+    }
+    for (const QString &pragma : profile_.pragmas()) {
+        sqlite3_exec(handle, pragma.toUtf8().constData(), nullptr, nullptr, nullptr);
+    }
+    QMutexLocker locker(&mutex_);
+    handles_.append(handle);
+    if (isStale(running_)) {
+        sqlite3_interrupt(handle);  //отмена пришла, пока соединение открывалось
+    }
+    return handle;
+}
+
+void SqliteParallelScan::closeDatabase(sqlite3 *handle)
+{
+    {
+        QMutexLocker locker(&mutex_);
+        handles_.removeAll(handle);
+    }
+    sqlite3_close(handle);
+}
+
+/*
+ * Запоминается только первая ошибка, остальные
+ * обычно её следствие. Оставшиеся диапазоны уже не читаются.
+*/
+void SqliteParallelScan::fail(const QString &error)
+{
+    next_range_.storeRelease(ranges_.size());
+    QMutexLocker locker(&mutex_);
+    if (error_.isEmpty()) {
+        error_ = error;
+    }
+}
+
+/*
+ * Запрос отменён. Вызывается под mutex_.
+*/
+bool SqliteParallelScan::isStale(int request) const
+{
+    return request < min_request_.loadAcquire() || cancelled_.contains(request);
+}
+
+SqliteParallelScan::~SqliteParallelScan()
+{
+    pool_.waitForDone();
+}
@@ -0,0 +1,103 @@
+#ifndef SQLITEPARALLELSCAN_H
+#define SQLITEPARALLELSCAN_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QRunnable>
+#include <QString>
+#include <QThread>
+#include <QThreadPool>
+#include <QVariant>
+#include <QVector>
+
+#include <sqlite3.h>
+
+#include "SqliteConnectionProfile.h"
+#include "SqliteFilterCompiler.h"
+#include "SqliteProfiler.h"
+#include "SqliteReaderWorker.h"
+#include "SqliteScanSummary.h"
+#include "SqliteSubstringSearch.h"
+
+/*
+ * Параллельный проход по таблице с фильтрами.
+ * Таблица делится на диапазоны rowid, потоки пула читают их
+ * каждый через своё соединение только для чтения. Диапазонов
+ * в RANGES_PER_THREAD раз больше, чем потоков, и каждый поток,
+ * закончив диапазон, забирает следующий свободный, так что
+ * потоки с "дешёвыми" диапазонами не простаивают.
+ * Результат - сводка по колонкам подошедших строк
+ * (SqliteScanSummary) и, если нужно, их rowid. rowid диапазонов
+ * склеиваются по порядку диапазонов, поэтому идут по возрастанию
+ * при любом количестве потоков.
+ * Живёт в своём потоке, запросы выполняются по одному и
+ * отменяются так же, как у SqliteReaderWorker (cancelBefore),
+ * или по одному (cancel).
+*/
+class SqliteParallelScan : public QObject
+{
+    Q_OBJECT
+
+public:
+    const int RANGES_PER_THREAD = 8;  //диапазонов rowid на поток пула
+    const qint64 MIN_RANGE_SIZE = 16384;  //rowid в диапазоне, меньше которого таблица не делится дальше
+    SqliteParallelScan();
+    void setProfiler(SqliteProfiler *profiler);
+    void cancelBefore(int request);
+    void cancel(int request);
+    static int threadCount();
+    virtual ~SqliteParallelScan();
+
+public slots:
+    void scan(int request, const QString &databasePath, const SqliteConnectionProfile &profile,
+              const QString &table, const QString &select, const QVariantList &values,
+              int columns, bool isKeepingKeys);
+
+signals:
+    void scanned(int request, const SqliteScanSummary &summary, const QVector<qint64> &keys);
+    void failed(int request, const QString &error);
+
+private:
+    class Task;
+
+    /*
+     * Диапазон rowid [first, last] и rowid его подошедших строк
+    */
+    struct Range
+    {
+        qint64 first = 0;
+        qint64 last = 0;
+        QVector<qint64> keys;
+    };
+
+    void splitRanges(const QString &table);
+    void scanRanges(int task);
+    sqlite3 *openDatabase();
+    void closeDatabase(sqlite3 *handle);
+    void fail(const QString &error);
+    bool isStale(int request) const;
+
+    QThreadPool pool_;
+    SqliteProfiler *profiler_ = nullptr;  //замеры этапов, может быть nullptr
+    QString database_path_ = "";  //параметры текущего прохода, только для чтения из потоков пула
+    SqliteConnectionProfile profile_;
+    QString select_ = "";
+    QVariantList values_;
+    bool is_ranged_ = false;  //select ограничен диапазоном rowid (первые два плейсхолдера)
+    bool is_keeping_keys_ = false;
+    QVector<Range> ranges_;
+    QVector<SqliteScanSummary> summaries_;  //сводка каждого потока пула
+    QAtomicInt next_range_;  //следующий свободный диапазон
+    QAtomicInt min_request_;  //запросы младше этого отменены
+    int running_ = -1;  //выполняющийся запрос, -1 если его нет
+    QSet<int> cancelled_;  //отменённые по одному запросы, которые ещё не начались или не закончились
+    QList<sqlite3 *> handles_;  //соединения потоков пула для sqlite3_interrupt
+    QString error_ = "";  //первая ошибка потоков пула
+    QMutex mutex_;  //защищает running_, cancelled_, handles_ и error_
+};
+
+#endif // SQLITEPARALLELSCAN_H
@@ -0,0 +1,181 @@
+#include "SqliteProfiler.h"
+
+SqliteProfiler::Scope::Scope(SqliteProfiler *profiler, const char *name, const char *category)
+{
+    profiler_ = profiler;
+    name_ = name;
+    category_ = category;
+    if (profiler_ && profiler_->isEnabled()) {
+        start_ = profiler_->now();
+    }
+}
+
+bool SqliteProfiler::Scope::isActive() const
+{
+    return start_ >= 0;
+}
+
+/*
+ * Аргумент события, например количество строк или
+ * счётчик sqlite3_stmt_status
+*/
+void SqliteProfiler::Scope::setArg(const QString &name, const QJsonValue &value)
+{
+    if (isActive()) {
+        args_.insert(name, value);
+    }
+}
+
+SqliteProfiler::Scope::~Scope()
+{
+    if (isActive()) {
+        profiler_->record(name_, category_, start_, profiler_->now() - start_, args_);
+    }
+}
+
+SqliteProfiler::SqliteProfiler()
+{
+    clock_.start();
+}
+
+void SqliteProfiler::setEnabled(bool isEnabled)
+{
+    is_enabled_.storeRelease(isEnabled ? 1 : 0);
+}
+
+bool SqliteProfiler::isEnabled() const
+{
+    return is_enabled_.loadAcquire() != 0;
+}
+
+/*
+ * Время в микросекундах от создания сборщика
+*/
+qint64 SqliteProfiler::now() const
+{
+    return clock_.nsecsElapsed() / 1000;
+}
+
+/*
+ * Запись законченного этапа. Если буфер полон,
+ * вытесняется самое старое событие.
+*/
+void SqliteProfiler::record(const char *name, const char *category, qint64 start, qint64 duration,
+                            const QJsonObject &args)
+{
+    QMutexLocker locker(&mutex_);
+    Event event = {name, category, start, duration, threadIndex(), args};
+    if (events_.size() >= MAX_EVENTS) {
+        events_.removeFirst();
+    }
+    events_.append(event);
+    last_events_.insert(QString(name), event);
+}
+
+void SqliteProfiler::clear()
+{
+    QMutexLocker locker(&mutex_);
+    events_.clear();
+    last_events_.clear();
+}
+
+/*
+ * Сводка последних замеров для строки состояния:
+ * чтение строк (время в sqlite3_step и на перенос в блоки,
+ * строк в секунду, счётчики sqlite), подсчёт строк,
+ * отбор по фильтрам и сравнение при синхронизации.
+*/
+QString SqliteProfiler::summary() const
+{
+    QMutexLocker locker(&mutex_);
+    QStringList parts;
+    if (last_events_.contains("fetchRows")) {
+        const Event &fetch = last_events_["fetchRows"];
+        int rows = fetch.args.value("rows").toInt();
+        QString rate = fetch.duration > 0 ? QString::number(rows * 1000000LL / fetch.duration) : "-";
+        parts.append("fetch " + milliseconds(fetch.duration) +
+                     " (step " + milliseconds(fetch.args.value("stepUs").toVariant().toLongLong()) +
+                     ", materialize " + milliseconds(fetch.args.value("materializeUs").toVariant().toLongLong()) +
+                     "), " + QString::number(rows) + " rows, " + rate + " rows/s");
+        parts.append("full scan steps " + QString::number(fetch.args.value("fullScanSteps").toInt()) +
+                     ", sorts " + QString::number(fetch.args.value("sorts").toInt()) +
+                     ", VM steps " + QString::number(fetch.args.value("vmSteps").toInt()));
+    }
+    const char *const stages[][2] = {{"countRows", "count"}, {"keepMatches", "filter"},
+                                     {"sync", "diff"}, {"applyPage", "apply"}};
+    for (const auto &stage : stages) {
+        if (last_events_.contains(stage[0])) {
+            parts.append(QString(stage[1]) + " " + milliseconds(last_events_[stage[0]].duration));
+        }
+    }
+    return parts.isEmpty() ? QString("No queries recorded") : parts.join(" | ");
+}
+
+/*
+ * Буфер событий в формате Chrome trace event:
+ * законченные события ("ph": "X") и имена потоков.
+*/
+QByteArray SqliteProfiler::traceJson() const
+{
+    QMutexLocker locker(&mutex_);
+    qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray trace;
+    for (int i = 0; i < thread_names_.size(); i++) {
+        QJsonObject event;
+        event.insert("name", "thread_name");
+        event.insert("ph", "M");
+        event.insert("pid", static_cast<double>(pid));
+        event.insert("tid", i);
+        event.insert("args", QJsonObject{{"name", thread_names_[i]}});
+        trace.append(event);
+    }
+    for (const Event &recorded : events_) {
+        QJsonObject event;
+        event.insert("name", recorded.name);
+        event.insert("cat", recorded.category);
+        event.insert("ph", "X");
+        event.insert("ts", static_cast<double>(recorded.start));
+        event.insert("dur", static_cast<double>(recorded.duration));
+        event.insert("pid", static_cast<double>(pid));
+        event.insert("tid", recorded.thread);
+        event.insert("args", recorded.args);
+        trace.append(event);
+    }
+    QJsonObject root;
+    root.insert("traceEvents", trace);
+    root.insert("displayTimeUnit", "ms");
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+/*
+ * Номер текущего потока в трассе. Имя потока берётся из
+ * objectName его QThread, у главного потока - "main".
+ * Вызывается под mutex_.
+*/
+int SqliteProfiler::threadIndex()
+{
+    Qt::HANDLE handle = QThread::currentThreadId();
+    if (threads_.contains(handle)) {
+        return threads_.value(handle);
+    }
+    QThread *thread = QThread::currentThread();
+    QString name = thread->objectName();
+    if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+        name = "main";
+    } else if (name.isEmpty()) {
+        name = "thread " + QString::number(thread_names_.size());
+    }
+    threads_.insert(handle, thread_names_.size());
+    thread_names_.append(name);
+    return thread_names_.size() - 1;
+}
+
+QString SqliteProfiler::milliseconds(qint64 microseconds)
+{
+    return QString::number(microseconds / 1000.0, 'f', 1) + " ms";
+}
+
+SqliteProfiler::~SqliteProfiler()
+{
+
+}
@@ -0,0 +1,89 @@
+#ifndef SQLITEPROFILER_H
+#define SQLITEPROFILER_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+
+/*
+ * Сборщик замеров этапов работы с бд.
+ * Этапы (выполнение запроса в sqlite, перенос строк в блоки,
+ * сравнение страниц при синхронизации, обновление view)
+ * замеряются объектами Scope, которые при выходе из блока
+ * записывают событие с длительностью и аргументами (например
+ * счётчиками sqlite3_stmt_status). Писать можно из любого потока.
+ * Пока сборщик выключен, Scope ничего не делает.
+ * Буфер ограничен MAX_EVENTS событиями, его можно выгрузить
+ * в формате Chrome trace (chrome://tracing, Perfetto), а
+ * summary() - короткая сводка последнего запроса для view.
+*/
+class SqliteProfiler
+{
+public:
+    const int MAX_EVENTS = 100000;  //событий в буфере, старые вытесняются
+
+    /*
+     * Замер одного этапа: от создания до удаления объекта
+    */
+    class Scope
+    {
+    public:
+        Scope(SqliteProfiler *profiler, const char *name, const char *category);
+        bool isActive() const;
+        void setArg(const QString &name, const QJsonValue &value);
+        virtual ~Scope();
+
+    private:
+        SqliteProfiler *profiler_;
+        const char *name_;
+        const char *category_;
+        qint64 start_ = -1;  //мкс от запуска сборщика, -1 если сборщик выключен
+        QJsonObject args_;
+    };
+
+    SqliteProfiler();
+    void setEnabled(bool isEnabled);
+    bool isEnabled() const;
+    qint64 now() const;
+    void record(const char *name, const char *category, qint64 start, qint64 duration,
+                const QJsonObject &args);
+    void clear();
+    QString summary() const;
+    QByteArray traceJson() const;
+    virtual ~SqliteProfiler();
+
+private:
+    struct Event
+    {
+        const char *name;
+        const char *category;
+        qint64 start;  //мкс от запуска сборщика
+        qint64 duration;  //мкс
+        int thread;
+        QJsonObject args;
+    };
+
+    int threadIndex();
+    static QString milliseconds(qint64 microseconds);
+
+    QAtomicInt is_enabled_;
+    QElapsedTimer clock_;
+    QList<Event> events_;
+    QHash<QString, Event> last_events_;  //последнее событие каждого этапа
+    QHash<Qt::HANDLE, int> threads_;  //номера потоков в трассе
+    QStringList thread_names_;
+    mutable QMutex mutex_;  //защищает всё, кроме is_enabled_ и clock_
+};
+
+#endif // SQLITEPROFILER_H
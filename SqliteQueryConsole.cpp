@@ -0,0 +1,204 @@
+#include "SqliteQueryConsole.h"
+
+SqliteQueryConsole::SqliteQueryConsole(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("SQL console");
+    resize(DIALOG_WIDTH, DIALOG_HEIGHT);
+
+    editor_ = new QPlainTextEdit();
+    editor_->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    editor_->setPlaceholderText("select ... from ...");
+    rows_box_ = new QSpinBox();
+    rows_box_->setRange(1, MAX_ROWS);
+    rows_box_->setValue(DEFAULT_ROWS);
+    rows_box_->setSuffix(" rows");
+    megabytes_box_ = new QSpinBox();
+    megabytes_box_->setRange(1, MAX_MEGABYTES);
+    megabytes_box_->setValue(DEFAULT_MEGABYTES);
+    megabytes_box_->setSuffix(" MiB");
+    explain_button_ = new QPushButton("Explain");
+    run_button_ = new QPushButton("Run");
+    run_button_->setToolTip("Ctrl+Return");
+    stop_button_ = new QPushButton("Stop");
+    QHBoxLayout *controls = new QHBoxLayout();
+    controls->addWidget(new QLabel("Budget:"));
+    controls->addWidget(rows_box_);
+    controls->addWidget(megabytes_box_);
+    controls->addStretch();
+    controls->addWidget(explain_button_);
+    controls->addWidget(run_button_);
+    controls->addWidget(stop_button_);
+    plan_tree_ = new QTreeWidget();
+    plan_tree_->setHeaderLabels(QStringList() << "Query plan" << "Warning");
+    plan_tree_->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    result_model_ = new SqliteQueryResultModel(this);
+    result_view_ = new QTableView();
+    result_view_->setModel(result_model_);
+    status_label_ = new QLabel();
+    status_label_->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    status_label_->setWordWrap(true);
+    QSplitter *splitter = new QSplitter(Qt::Vertical);
+    splitter->addWidget(editor_);
+    splitter->addWidget(plan_tree_);
+    splitter->addWidget(result_view_);
+    splitter->setStretchFactor(2, 1);
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(splitter);
+    layout->addLayout(controls);
+    layout->addWidget(status_label_);
+    setRunning(false);
+
+    QObject::connect(explain_button_, SIGNAL(clicked()),
+                     this, SLOT(explain()));
+    QObject::connect(run_button_, SIGNAL(clicked()),
+                     this, SLOT(run()));
+    QObject::connect(stop_button_, SIGNAL(clicked()),
+                     this, SLOT(stop()));
+    QShortcut *runShortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::Key_Return), this);
+    QObject::connect(runShortcut, SIGNAL(activated()),
+                     this, SLOT(run()));
+}
+
+/*
+ * Только план запроса, без выполнения
+*/
+void SqliteQueryConsole::explain()
+{
+    request_ = editor_->toPlainText();
+    is_run_pending_ = false;
+    status_label_->setText("Explaining...");
+    emit planRequested(request_);
+}
+
+/*
+ * Выполнение начинается с плана, сам запрос
+ * отправляется из showPlan
+*/
+void SqliteQueryConsole::run()
+{
+    if (!run_button_->isEnabled()) {
+        return;
+    }
+    request_ = editor_->toPlainText();
+    is_run_pending_ = true;
+    status_label_->setText("Explaining...");
+    emit planRequested(request_);
+}
+
+void SqliteQueryConsole::stop()
+{
+    is_run_pending_ = false;
+    setRunning(false);
+    status_label_->setText("Stopped, " + QString::number(result_model_->rowCount()) + " rows read");
+    emit cancelRequested();
+}
+
+/*
+ * Дерево плана: шаги вкладываются в шаг-родитель,
+ * предупреждения видны во второй колонке. Если запрос
+ * ждёт выполнения, а в плане есть тяжёлые шаги,
+ * пользователь подтверждает его.
+*/
+void SqliteQueryConsole::showPlan(const SqliteQueryPlan &plan)
+{
+    plan_tree_->clear();
+    if (!plan.isValid()) {
+        is_run_pending_ = false;
+        status_label_->setText(plan.error());
+        return;
+    }
+    QHash<int, QTreeWidgetItem *> items;
+    QIcon warningIcon = style()->standardIcon(QStyle::SP_MessageBoxWarning);
+    for (int i = 0; i < plan.stepCount(); i++) {
+        const SqliteQueryPlan::Step &step = plan.step(i);
+        QTreeWidgetItem *parent = items.value(step.parent);
+        QTreeWidgetItem *item = parent ? new QTreeWidgetItem(parent) : new QTreeWidgetItem(plan_tree_);
+        item->setText(0, step.detail);
+        QString warning = plan.warning(i);
+        if (!warning.isEmpty()) {
+            item->setText(1, warning);
+            item->setIcon(1, warningIcon);
+        }
+        items.insert(step.id, item);
+    }
+    plan_tree_->expandAll();
+    plan_tree_->resizeColumnToContents(1);
+    QStringList warnings = plan.warnings();
+    status_label_->setText(warnings.isEmpty() ? "The plan uses indexes only" : warnings.join("; "));
+    if (!is_run_pending_) {
+        return;
+    }
+    is_run_pending_ = false;
+    if (!warnings.isEmpty()) {
+        QString question = "The query reads more than it returns:\n\n" + warnings.join("\n") +
+                           "\n\nRun it within the budget of " + rows_box_->text() + " and " +
+                           megabytes_box_->text() + "?";
+        if (QMessageBox::question(this, windowTitle(), question) != QMessageBox::Yes) {
+            return;
+        }
+    }
+    startQuery();
+}
+
+void SqliteQueryConsole::startQuery()
+{
+    result_model_->clear();
+    setRunning(true);
+    status_label_->setText("Running...");
+    emit runRequested(request_, rows_box_->value(), static_cast<qint64>(megabytes_box_->value()) * 1024 * 1024);
+}
+
+void SqliteQueryConsole::onStarted(const QStringList &columns)
+{
+    result_model_->setColumns(columns);
+}
+
+void SqliteQueryConsole::appendRows(const SqliteResultBlock &rows)
+{
+    result_model_->appendRows(rows);
+    status_label_->setText("Running... " + QString::number(result_model_->rowCount()) + " rows");
+}
+
+/*
+ * Запрос закончен. Если бюджет кончился раньше
+ * результата, остаток не читался.
+*/
+void SqliteQueryConsole::onFinished(qint64 rows, qint64 bytes, bool isTruncated)
+{
+    setRunning(false);
+    QString read = QString::number(rows) + " rows, " + sizeText(bytes);
+    if (isTruncated) {
+        status_label_->setText("Stopped at the budget after " + read +
+                               ". Narrow the query or raise the budget to see more.");
+        return;
+    }
+    status_label_->setText(read);
+}
+
+void SqliteQueryConsole::onFailed(const QString &error)
+{
+    is_run_pending_ = false;
+    setRunning(false);
+    status_label_->setText(error);
+}
+
+void SqliteQueryConsole::setRunning(bool isRunning)
+{
+    explain_button_->setEnabled(!isRunning);
+    run_button_->setEnabled(!isRunning);
+    stop_button_->setEnabled(isRunning);
+}
+
+QString SqliteQueryConsole::sizeText(qint64 bytes)
+{
+    if (bytes < 1024 * 1024) {
+        return QString::number(bytes / 1024.0, 'f', 1) + " KiB";
+    }
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MiB";
+}
+
+SqliteQueryConsole::~SqliteQueryConsole()
+{
+
+}
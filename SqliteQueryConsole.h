@@ -0,0 +1,88 @@
+#ifndef SQLITEQUERYCONSOLE_H
+#define SQLITEQUERYCONSOLE_H
+
+#include <QDialog>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QLabel>
+#include <QSplitter>
+#include <QTableView>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QFontDatabase>
+#include <QShortcut>
+#include <QStyle>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include "SqliteQueryPlan.h"
+#include "SqliteQueryResultModel.h"
+#include "SqliteResultBlock.h"
+
+/*
+ * Консоль SQL: запрос пользователя к открытой бд.
+ * Сначала всегда запрашивается план (EXPLAIN QUERY PLAN),
+ * он показывается деревом, а шаги, которые читают таблицы
+ * целиком или сортируют во временном b-дереве, помечаются.
+ * Если такие шаги есть, запрос выполняется только после
+ * подтверждения. Результат приходит блоками и ограничен
+ * бюджетом строк и байт: дальше бюджета строки не читаются.
+ * Сама консоль запросов не выполняет, а отправляет сигналы
+ * модели (см. SqliteReaderModel::runConsoleQuery).
+*/
+class SqliteQueryConsole : public QDialog
+{
+    Q_OBJECT
+
+public:
+    const int DIALOG_WIDTH = 800;
+    const int DIALOG_HEIGHT = 600;
+    const int DEFAULT_ROWS = 100000;  //бюджет строк по умолчанию
+    const int DEFAULT_MEGABYTES = 64;  //бюджет байт по умолчанию, МиБ
+    const int MAX_ROWS = 100000000;
+    const int MAX_MEGABYTES = 4096;
+    SqliteQueryConsole(QWidget *parent = nullptr);
+    virtual ~SqliteQueryConsole();
+
+public slots:
+    void showPlan(const SqliteQueryPlan &plan);
+    void onStarted(const QStringList &columns);
+    void appendRows(const SqliteResultBlock &rows);
+    void onFinished(qint64 rows, qint64 bytes, bool isTruncated);
+    void onFailed(const QString &error);
+
+signals:
+    void planRequested(const QString &request);
+    void runRequested(const QString &request, qint64 rowBudget, qint64 byteBudget);
+    void cancelRequested();
+
+private slots:
+    void explain();
+    void run();
+    void stop();
+
+private:
+    void startQuery();
+    void setRunning(bool isRunning);
+    static QString sizeText(qint64 bytes);
+
+    QPlainTextEdit *editor_;
+    QSpinBox *rows_box_;
+    QSpinBox *megabytes_box_;
+    QPushButton *explain_button_;
+    QPushButton *run_button_;
+    QPushButton *stop_button_;
+    QTreeWidget *plan_tree_;
+    QTableView *result_view_;
+    SqliteQueryResultModel *result_model_;
+    QLabel *status_label_;
+    QString request_ = "";  //запрос, план которого ждёт консоль
+    bool is_run_pending_ = false;  //после плана запрос нужно выполнить
+};
+
+#endif // SQLITEQUERYCONSOLE_H
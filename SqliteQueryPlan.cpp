@@ -0,0 +1,105 @@
+#include "SqliteQueryPlan.h"
+
+SqliteQueryPlan::SqliteQueryPlan()
+{
+
+}
+
+void SqliteQueryPlan::addStep(int id, int parent, const QString &detail)
+{
+    Step step;
+    step.id = id;
+    step.parent = parent;
+    step.detail = detail;
+    steps_.append(step);
+}
+
+void SqliteQueryPlan::setRows(int step, qint64 rows)
+{
+    if (step >= 0 && step < steps_.size()) {
+        steps_[step].rows = rows;
+    }
+}
+
+void SqliteQueryPlan::setError(const QString &error)
+{
+    error_ = error;
+}
+
+int SqliteQueryPlan::stepCount() const
+{
+    return steps_.size();
+}
+
+const SqliteQueryPlan::Step &SqliteQueryPlan::step(int step) const
+{
+    return steps_[step];
+}
+
+QString SqliteQueryPlan::error() const
+{
+    return error_;
+}
+
+bool SqliteQueryPlan::isValid() const
+{
+    return error_.isEmpty();
+}
+
+/*
+ * Таблица (или её псевдоним), которую шаг читает целиком,
+ * пустая строка, если шаг не полный проход. Проход по
+ * покрывающему индексу тоже полный, хоть и читает меньше.
+ * Проходы по константной строке и по результату подзапроса
+ * таблиц бд не читают. Старые sqlite пишут "SCAN TABLE t".
+*/
+QString SqliteQueryPlan::scannedTable(int step) const
+{
+    static const QRegularExpression scan("^SCAN (?:TABLE )?(\\S+)");
+    QRegularExpressionMatch match = scan.match(steps_[step].detail);
+    if (!match.hasMatch()) {
+        return "";
+    }
+    QString table = match.captured(1);
+    if (table == "CONSTANT" || table == "SUBQUERY" || table.startsWith("(")) {
+        return "";
+    }
+    return table;
+}
+
+/*
+ * Предупреждение для шага, пустое - шаг дешёвый
+*/
+QString SqliteQueryPlan::warning(int step) const
+{
+    QString detail = steps_[step].detail;
+    QString table = scannedTable(step);
+    if (!table.isEmpty()) {
+        QString rows = steps_[step].rows >= 0 ? " (~" + QString::number(steps_[step].rows) + " rows)" : "";
+        return "Full scan of " + table + rows;
+    }
+    if (detail.startsWith("USE TEMP B-TREE")) {
+        return "Sorts all matching rows in a temporary b-tree";
+    }
+    if (detail.contains("AUTOMATIC")) {
+        return "Builds a temporary index for this query";
+    }
+    return "";
+}
+
+QStringList SqliteQueryPlan::warnings() const
+{
+    QStringList result;
+    for (int i = 0; i < steps_.size(); i++) {
+        QString text = warning(i);
+        if (!text.isEmpty()) {
+            result.append(text);
+        }
+    }
+    return result;
+}
+
+SqliteQueryPlan::~SqliteQueryPlan()
+{
+
+}
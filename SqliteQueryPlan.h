@@ -0,0 +1,51 @@
+#ifndef SQLITEQUERYPLAN_H
+#define SQLITEQUERYPLAN_H
+
+#include <QList>
+#include <QMetaType>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+
+/*
+ * План запроса из EXPLAIN QUERY PLAN: шаги с номером,
+ * номером родителя (дерево плана) и описанием sqlite.
+ * Шаги, которые читают таблицу целиком, строят временное
+ * b-дерево или автоматический индекс, помечаются
+ * предупреждениями: такой запрос на большой бд читает
+ * много больше, чем отдаёт.
+ * rows - оценка строк таблицы полного прохода из каталога
+ * (-1, если неизвестна: таблица названа псевдонимом).
+*/
+class SqliteQueryPlan
+{
+public:
+    struct Step
+    {
+        int id = 0;
+        int parent = 0;
+        QString detail = "";
+        qint64 rows = -1;
+    };
+
+    SqliteQueryPlan();
+    void addStep(int id, int parent, const QString &detail);
+    void setRows(int step, qint64 rows);
+    void setError(const QString &error);
+    int stepCount() const;
+    const Step &step(int step) const;
+    QString error() const;
+    bool isValid() const;
+    QString scannedTable(int step) const;
+    QString warning(int step) const;
+    QStringList warnings() const;
+    virtual ~SqliteQueryPlan();
+
+private:
+    QList<Step> steps_;
+    QString error_ = "";  //ошибка подготовки запроса, пустая - план есть
+};
+
+Q_DECLARE_METATYPE(SqliteQueryPlan)
+
+#endif // SQLITEQUERYPLAN_H
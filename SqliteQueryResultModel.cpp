@@ -0,0 +1,88 @@
+#include "SqliteQueryResultModel.h"
+
+SqliteQueryResultModel::SqliteQueryResultModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+
+}
+
+/*
+ * Новый результат: колонки запроса, строк пока нет
+*/
+void SqliteQueryResultModel::setColumns(const QStringList &columns)
+{
+    beginResetModel();
+    columns_ = columns;
+    blocks_.clear();
+    offsets_.clear();
+    row_count_ = 0;
+    endResetModel();
+}
+
+void SqliteQueryResultModel::appendRows(const SqliteResultBlock &rows)
+{
+    if (rows.rowCount() == 0) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), row_count_, row_count_ + rows.rowCount() - 1);
+    blocks_.append(rows);
+    offsets_.append(row_count_);
+    row_count_ += rows.rowCount();
+    endInsertRows();
+}
+
+void SqliteQueryResultModel::clear()
+{
+    setColumns(QStringList());
+}
+
+int SqliteQueryResultModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return row_count_;
+}
+
+int SqliteQueryResultModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return columns_.size();
+}
+
+/*
+ * Значение ячейки: блок строки ищется по offsets_
+ * двоичным поиском
+*/
+QVariant SqliteQueryResultModel::data(const QModelIndex &index, int role) const
+{
+    if (role != Qt::DisplayRole || !index.isValid() || index.row() >= row_count_) {
+        return QVariant();
+    }
+    int block = static_cast<int>(std::upper_bound(offsets_.begin(), offsets_.end(), index.row()) -
+                                 offsets_.begin()) - 1;
+    const SqliteResultBlock &rows = blocks_[block];
+    int row = index.row() - offsets_[block];
+    if (index.column() >= rows.columnCount()) {
+        return QVariant();
+    }
+    return rows.text(row, index.column());
+}
+
+QVariant SqliteQueryResultModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    if (orientation == Qt::Horizontal) {
+        return section < columns_.size() ? columns_[section] : QVariant();
+    }
+    return QString::number(section);
+}
+
+SqliteQueryResultModel::~SqliteQueryResultModel()
+{
+
+}
@@ -0,0 +1,46 @@
+#ifndef SQLITEQUERYRESULTMODEL_H
+#define SQLITEQUERYRESULTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+#include <algorithm>
+
+#include "SqliteResultBlock.h"
+
+/*
+ * Модель результата запроса консоли SQL. В отличие от
+ * SqliteTableModel строки не перечитываются страницами:
+ * запрос пользователя может быть дорогим, поэтому его
+ * результат читается один раз и приходит блоками по мере
+ * чтения (appendRows), а view видит новые строки сразу.
+ * Размер результата ограничивает бюджет исполнителя.
+*/
+class SqliteQueryResultModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    SqliteQueryResultModel(QObject *parent = nullptr);
+    void setColumns(const QStringList &columns);
+    void appendRows(const SqliteResultBlock &rows);
+    void clear();
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const override;
+    virtual ~SqliteQueryResultModel();
+
+private:
+    QStringList columns_;
+    QList<SqliteResultBlock> blocks_;
+    QVector<int> offsets_;  //номер первой строки каждого блока
+    int row_count_ = 0;
+};
+
+#endif // SQLITEQUERYRESULTMODEL_H
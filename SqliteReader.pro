@@ -24,6 +24,10 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 CONFIG += c++11
 
+# sqlite3_interrupt and other C API calls are made through the
+# native handle of the QSQLITE connection.
+LIBS += -lsqlite3
+
 SOURCES += \
         main.cpp \
     SqliteReaderView.cpp \
@@ -31,7 +35,37 @@ SOURCES += \
     SqliteReaderController.cpp \
     UnsupportedDBException.cpp \
     UnreachableDBException.cpp \
-    DBException.cpp
+    DBException.cpp \
+    SqliteChangeDetector.cpp \
+    SqliteTableModel.cpp \
+    SqliteReaderWorker.cpp \
+    SqliteFilterCompiler.cpp \
+    SqliteRowDiff.cpp \
+    SqliteFilterScheduler.cpp \
+    SqliteResultBlock.cpp \
+    SqliteSubstringSearch.cpp \
+    SqliteSchemaCatalog.cpp \
+    SqliteConnectionProfile.cpp \
+    SqliteProfiler.cpp \
+    SqliteSortOrder.cpp \
+    SqliteStatementCache.cpp \
+    SqliteExporter.cpp \
+    SqliteReaderCli.cpp \
+    SqliteSyncScheduler.cpp \
+    SqliteValueDialog.cpp \
+    SqliteHyperLogLog.cpp \
+    SqliteScanSummary.cpp \
+    SqliteParallelScan.cpp \
+    SqliteHistogram.cpp \
+    SqliteSpaceSaving.cpp \
+    SqliteHistogramWidget.cpp \
+    SqliteColumnStatsPanel.cpp \
+    SqliteQueryPlan.cpp \
+    SqliteQueryResultModel.cpp \
+    SqliteQueryConsole.cpp \
+    SqliteSidecarCache.cpp \
+    SqliteChunkFingerprint.cpp \
+    SqliteResultPage.cpp
 
 HEADERS += \
     SqliteReaderView.h \
@@ -39,7 +73,37 @@ HEADERS += \
     SqliteReaderController.h \
     UnsupportedDBException.h \
     UnreachableDBException.h \
-    DBException.h
+    DBException.h \
+    SqliteChangeDetector.h \
+    SqliteTableModel.h \
+    SqliteReaderWorker.h \
+    SqliteFilterCompiler.h \
+    SqliteRowDiff.h \
+    SqliteFilterScheduler.h \
+    SqliteResultBlock.h \
+    SqliteSubstringSearch.h \
+    SqliteSchemaCatalog.h \
+    SqliteConnectionProfile.h \
+    SqliteProfiler.h \
+    SqliteSortOrder.h \
+    SqliteStatementCache.h \
+    SqliteExporter.h \
+    SqliteReaderCli.h \
+    SqliteSyncScheduler.h \
+    SqliteValueDialog.h \
+    SqliteHyperLogLog.h \
+    SqliteScanSummary.h \
+    SqliteParallelScan.h \
+    SqliteHistogram.h \
+    SqliteSpaceSaving.h \
+    SqliteHistogramWidget.h \
+    SqliteColumnStatsPanel.h \
+    SqliteQueryPlan.h \
+    SqliteQueryResultModel.h \
+    SqliteQueryConsole.h \
+    SqliteSidecarCache.h \
+    SqliteChunkFingerprint.h \
+    SqliteResultPage.h
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
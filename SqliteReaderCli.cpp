@@ -0,0 +1,542 @@
+#include "SqliteReaderCli.h"
+
+const QStringList SqliteReaderCli::CLI_OPTIONS = {
+    "table", "filter", "follow", "sync", "append-only", "interval", "summary", "no-header", "help"
+};
+
+SqliteReaderCli::SqliteReaderCli()
+    : out_(stdout), err_(stderr)
+{
+    out_.setCodec("UTF-8");
+    err_.setCodec("UTF-8");
+    model_ = new SqliteReaderModel();
+
+    /*
+     * Модель открывает бд и таблицу так же, как для окна,
+     * только строки вместо view читает проход по таблице
+    */
+    QObject::connect(model_, SIGNAL(catalogReady(const SqliteSchemaCatalog &)),
+                     this, SLOT(onCatalogReady(const SqliteSchemaCatalog &)));
+    QObject::connect(model_, SIGNAL(queryReady(const QStringList &)),
+                     this, SLOT(onQueryReady(const QStringList &)));
+    QObject::connect(model_->filterScheduler, SIGNAL(filtersReady(const QStringList &)),
+                     this, SLOT(onFiltersReady(const QStringList &)));
+    QObject::connect(model_->tableModel, SIGNAL(refreshed(int)),
+                     this, SLOT(onRefreshed(int)));
+    QObject::connect(model_->tableModel, SIGNAL(dataChanged(const QModelIndex &, const QModelIndex &, const QVector<int> &)),
+                     this, SLOT(onDataChanged()));
+    QObject::connect(model_, SIGNAL(dbUnreachable(const DBException &)),
+                     this, SLOT(onError(const DBException &)));
+    QObject::connect(model_, SIGNAL(tableFailed(const QString &, const QString &)),
+                     this, SLOT(onTableFailed(const QString &, const QString &)));
+    QObject::connect(model_, SIGNAL(summaryReady(const SqliteScanSummary &)),
+                     this, SLOT(onSummaryReady(const SqliteScanSummary &)));
+    QObject::connect(model_, SIGNAL(summaryFailed(const QString &)),
+                     this, SLOT(onSummaryFailed(const QString &)));
+}
+
+/*
+ * Опции командной строки. Одни и те же для parse
+ * и для isRequested, чтобы режим включали те же формы
+ * опций, которые потом разбираются (-tlogs, -fcol=x).
+*/
+void SqliteReaderCli::addOptions(QCommandLineParser &parser)
+{
+    parser.setApplicationDescription("Prints rows of an SQLite table, optionally following its changes.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("database", "SQLite database file.");
+    parser.addOption(QCommandLineOption(QStringList() << "t" << "table",
+                                        "Table or view to print (the first one by default).", "table"));
+    parser.addOption(QCommandLineOption(QStringList() << "f" << "filter",
+                                        "Keep rows whose column contains substring. Can be repeated.",
+                                        "column=substring"));
+    parser.addOption(QCommandLineOption(QStringList() << "F" << "follow",
+                                        "Keep running and print new and changed rows."));
+    parser.addOption(QCommandLineOption("sync",
+                                        "How --follow notices changes: interval (polling with backoff, "
+                                        "the default) or event (file system notifications).", "policy"));
+    parser.addOption(QCommandLineOption("append-only",
+                                        "With --follow, assume rows are only appended: read only rows "
+                                        "after the last seen rowid instead of checking the whole table."));
+    parser.addOption(QCommandLineOption("interval",
+                                        "Milliseconds between change checks before backoff with --follow.", "ms"));
+    parser.addOption(QCommandLineOption("summary",
+                                        "Print the number of values and NULLs, the minimum, the maximum and "
+                                        "an estimate of distinct values of each column instead of the rows."));
+    parser.addOption(QCommandLineOption("no-header", "Do not print column names."));
+}
+
+/*
+ * Разбор аргументов. false, если программу нужно
+ * сразу завершить с exitCode() (ошибка или --help).
+*/
+bool SqliteReaderCli::parse(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    addOptions(parser);
+    if (!parser.parse(arguments)) {
+        fail(parser.errorText(), EXIT_USAGE);
+        return false;
+    }
+    if (parser.isSet("help")) {
+        out_ << parser.helpText();
+        out_.flush();
+        return false;
+    }
+    if (parser.positionalArguments().size() != 1) {
+        fail("Expected exactly one database file, see --help", EXIT_USAGE);
+        return false;
+    }
+    path_ = parser.positionalArguments().first();
+    table_ = parser.value("table");
+    filter_arguments_ = parser.values("filter");
+    for (const QString &filter : filter_arguments_) {
+        if (filter.indexOf('=') <= 0) {
+            fail("Filter must look like column=substring: " + filter, EXIT_USAGE);
+            return false;
+        }
+    }
+    is_follow_ = parser.isSet("follow");
+    is_append_only_ = parser.isSet("append-only");
+    is_header_ = !parser.isSet("no-header");
+    is_summary_ = parser.isSet("summary");
+    if (is_summary_ && is_follow_) {
+        fail("--summary cannot be combined with --follow", EXIT_USAGE);
+        return false;
+    }
+    if (is_append_only_ && !is_follow_) {
+        fail("--append-only requires --follow", EXIT_USAGE);
+        return false;
+    }
+    QString sync = parser.value("sync");
+    if (sync == "event") {
+        sync_policy_ = SqliteSyncScheduler::Event;
+    } else if (!sync.isEmpty() && sync != "interval") {
+        fail("Sync policy must be interval or event", EXIT_USAGE);
+        return false;
+    }
+    if (parser.isSet("interval")) {
+        bool isNumber = false;
+        interval_ = parser.value("interval").toInt(&isNumber);
+        if (!isNumber || interval_ <= 0) {
+            fail("Interval must be a positive number of milliseconds", EXIT_USAGE);
+            return false;
+        }
+    }
+    return true;
+}
+
+int SqliteReaderCli::exitCode() const
+{
+    return exit_code_;
+}
+
+/*
+ * Открытие бд. Дальше всё идёт через цикл событий:
+ * каталог, колонки, фильтры и проходы по строкам.
+ * С --follow бд проверяет планировщик модели, как в окне,
+ * но с политикой из аргументов, а не сохранённой для файла,
+ * а у таблиц с rowid после изменения читаются только изменённые
+ * блоки rowid (SqliteReaderModel::setChangeTracking).
+*/
+void SqliteReaderCli::start()
+{
+    model_->setLazyValues(false);  //в stdout значения печатаются целиком
+    model_->setChangeTracking(is_follow_, is_append_only_);
+    model_->connectToDatabase(path_, SqliteConnectionProfile::viewer(), table_);
+    if (is_follow_) {
+        model_->syncScheduler->setPolicy(sync_policy_, interval_ > 0 ? interval_ : -1);
+    } else {
+        model_->syncScheduler->setPolicy(SqliteSyncScheduler::Manual);
+    }
+}
+
+/*
+ * Режим командной строки включает только явная опция из
+ * CLI_OPTIONS в любой форме, которую понимает parse (-t logs,
+ * -tlogs, --table=logs). Просто путь к бд (открыть с помощью,
+ * ассоциация файлов) открывает окно. Опции Qt вроде -style
+ * и -psn_ от macOS парсер не знает, и разбор не удаётся
+ * (их нельзя смотреть как склеенные короткие опции: в -style
+ * есть t). Тогда режим включают только длинные опции
+ * --опция и --опция=значение до аргумента --, а с опциями
+ * не для окна parse потом сообщит об ошибке.
+*/
+bool SqliteReaderCli::isRequested(int argc, char *argv[])
+{
+    QStringList arguments;
+    for (int i = 0; i < argc; i++) {
+        arguments.append(QString::fromLocal8Bit(argv[i]));
+    }
+    QCommandLineParser parser;
+    addOptions(parser);
+    if (parser.parse(arguments)) {
+        for (const QString &option : CLI_OPTIONS) {
+            if (parser.isSet(option)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    for (int i = 1; i < arguments.size(); i++) {
+        const QString &argument = arguments[i];
+        if (argument == "--") {
+            return false;
+        }
+        if (argument.startsWith("--") && CLI_OPTIONS.contains(argument.mid(2).section('=', 0, 0))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SqliteReaderCli::onCatalogReady(const SqliteSchemaCatalog &catalog)
+{
+    if (!table_.isEmpty() && !catalog.contains(table_)) {
+        fail("No table or view " + table_ + " in " + path_, EXIT_USAGE);
+    }
+}
+
+/*
+ * Таблица открыта: имена колонок фильтров превращаются
+ * в номера, и фильтры отдаются модели. Пока модель их не
+ * применит, проходы по таблице без фильтров не печатаются.
+*/
+void SqliteReaderCli::onQueryReady(const QStringList &dbColumns)
+{
+    if (!filters_.isEmpty() || is_ready_) {
+        return;
+    }
+    for (int i = 0; i < dbColumns.size(); i++) {
+        filters_.append("");
+    }
+    for (const QString &filter : filter_arguments_) {
+        int separator = filter.indexOf('=');
+        int column = dbColumns.indexOf(filter.left(separator));
+        if (column < 0) {
+            fail("No column " + filter.left(separator) + " in " + model_->currentTable(), EXIT_USAGE);
+            return;
+        }
+        filters_[column] = filter.mid(separator + 1);
+    }
+    if (is_header_ && !is_summary_) {
+        out_ << dbColumns.join('\t') << '\n';
+        out_.flush();
+    }
+    if (filters_.join("").isEmpty()) {
+        is_ready_ = true;
+        return;
+    }
+    for (int i = 0; i < filters_.size(); i++) {
+        if (!filters_[i].isEmpty()) {
+            model_->changeFilter(i, filters_[i]);
+        }
+    }
+}
+
+/*
+ * Планировщик отдал модели все фильтры, следующий
+ * проход таблицы уже с ними
+*/
+void SqliteReaderCli::onFiltersReady(const QStringList &filters)
+{
+    if (filters == filters_) {
+        is_ready_ = true;
+    }
+}
+
+/*
+ * Таблица соответствует запросу: после открытия,
+ * применения фильтров и каждого изменения бд
+*/
+void SqliteReaderCli::onRefreshed(int rowCount)
+{
+    Q_UNUSED(rowCount);
+    if (!is_ready_) {
+        return;
+    }
+    if (!is_summary_) {
+        beginPass();
+        return;
+    }
+    if (!is_summarizing_) {
+        is_summarizing_ = true;
+        if (!model_->summarizeTable()) {
+            fail("Summary is only available for tables and views", EXIT_USAGE);
+        }
+    }
+}
+
+void SqliteReaderCli::onDataChanged()
+{
+    if (is_passing_) {
+        readRows();
+    }
+}
+
+void SqliteReaderCli::onError(const DBException &e)
+{
+    fail(e.exceptionText, EXIT_ERROR);
+}
+
+/*
+ * Сводка по колонкам, строка на колонку
+*/
+void SqliteReaderCli::onSummaryReady(const SqliteScanSummary &summary)
+{
+    QStringList columns;
+    for (int column = 0; column < model_->tableModel->columnCount(); column++) {
+        columns.append(model_->tableModel->headerData(column, Qt::Horizontal).toString());
+    }
+    if (is_header_) {
+        out_ << "column\tvalues\tnulls\tmin\tmax\tdistinct\n";
+    }
+    for (int column = 0; column < summary.columnCount() && column < columns.size(); column++) {
+        out_ << escape(columns[column]) << '\t'
+             << summary.valueCount(column) << '\t'
+             << summary.nullCount(column) << '\t'
+             << summaryValue(summary.minimum(column)) << '\t'
+             << summaryValue(summary.maximum(column)) << '\t'
+             << summary.distinctEstimate(column) << '\n';
+    }
+    out_.flush();
+    QCoreApplication::exit(exit_code_);
+}
+
+/*
+ * Таблица не открылась. Без -t модель открывает следующую
+ * таблицу бд, и это только предупреждение.
+*/
+void SqliteReaderCli::onTableFailed(const QString &table, const QString &error)
+{
+    if (table == table_ || table == model_->currentTable()) {
+        fail("Cannot read " + table + ": " + error, EXIT_ERROR);
+        return;
+    }
+    err_ << "Skipping " << table << ": " << error << '\n';
+    err_.flush();
+}
+
+void SqliteReaderCli::onSummaryFailed(const QString &error)
+{
+    fail(error, EXIT_ERROR);
+}
+
+/*
+ * Минимум или максимум для сводки: blob в виде x'...'
+ * (только начало длинных), пустое поле у колонки из одних null
+*/
+QString SqliteReaderCli::summaryValue(const QVariant &value) const
+{
+    if (value.type() == QVariant::ByteArray) {
+        return blobValue(value.toByteArray(), SUMMARY_BLOB_BYTES);
+    }
+    return escape(value.toString());
+}
+
+/*
+ * Blob в виде x'...', как литерал sqlite. Если limit
+ * не отрицательный, печатаются только первые limit байт и ...
+*/
+QString SqliteReaderCli::blobValue(const QByteArray &bytes, int limit)
+{
+    if (limit < 0 || bytes.size() <= limit) {
+        return "x'" + QString::fromLatin1(bytes.toHex()) + "'";
+    }
+    return "x'" + QString::fromLatin1(bytes.left(limit).toHex()) + "...'";
+}
+
+/*
+ * Новый проход по всем строкам таблицы. Если прошлый
+ * не закончился, уже напечатанные им строки не печатаются снова.
+*/
+void SqliteReaderCli::beginPass()
+{
+    if (is_passing_ && !is_tracked_pass_) {
+        rememberPass();
+    }
+    is_passing_ = true;
+    is_tracked_pass_ = model_->isChangeTracked();
+    is_changes_pass_ = model_->isChangesShown();
+    pass_rows_ = model_->tableModel->dataRowCount();
+    next_row_ = 1;
+    readRows();
+}
+
+/*
+ * Печать строк прохода, пока они есть в модели таблицы.
+ * На первой непрочитанной строке проход ждёт её страницу
+ * (модель сообщит о ней через dataChanged).
+ * Без --follow хэши не запоминаются: печатается всё.
+*/
+void SqliteReaderCli::readRows()
+{
+    while (next_row_ <= pass_rows_) {
+        if (!model_->tableModel->isRowLoaded(next_row_)) {
+            out_.flush();
+            return;
+        }
+        QString line = rowLine(next_row_);
+        if (is_follow_ && !isNewRow(next_row_, line)) {
+            next_row_++;
+            continue;
+        }
+        out_ << line << '\n';
+        next_row_++;
+    }
+    finishPass();
+}
+
+/*
+ * Строка новая или изменилась с прошлого прохода.
+ * Если модель отслеживает изменения (у таблицы есть rowid),
+ * какие строки изменились, знают отпечатки исполнителя, и здесь
+ * ничего не запоминается: полный проход печатается целиком,
+ * а проход по изменениям - только изменённые строки. Строки
+ * после максимального rowid отпечатков следующий проход по
+ * изменениям найдёт ещё раз, поэтому до его конца помнятся
+ * их хэши (только они, это строки, вставленные между первыми
+ * отпечатками и чтением таблицы).
+ * Без отслеживания строка с ключом печатается, если ключа
+ * ещё не было или хэш её текста другой, так что новая строка,
+ * текст которой совпал с уже напечатанной (повторная запись
+ * лога), тоже печатается. У строк без ключа (представления)
+ * считается, сколько раз текст встретился: печатаются только
+ * повторы сверх прошлого прохода.
+*/
+bool SqliteReaderCli::isNewRow(int row, const QString &line)
+{
+    quint64 hash = lineHash(line);
+    QVariant key = model_->tableModel->rowKey(row);
+    if (is_tracked_pass_) {
+        qint64 rowid = key.toLongLong();
+        if (!is_changes_pass_) {
+            if (!model_->isRowTracked(key)) {
+                pending_rows_.insert(rowid, hash);
+            }
+            return true;
+        }
+        if (!model_->isRowChanged(key)) {
+            return false;
+        }
+        QHash<qint64, quint64>::const_iterator pending = pending_rows_.constFind(rowid);
+        return pending == pending_rows_.constEnd() || pending.value() != hash;
+    }
+    if (key.isValid()) {
+        qint64 rowid = key.type() == QVariant::LongLong ? key.toLongLong() :
+                                                          static_cast<qint64>(lineHash(key.toString()));
+        current_rows_.insert(rowid, hash);
+        QHash<qint64, quint64>::const_iterator known = seen_rows_.constFind(rowid);
+        return known == seen_rows_.constEnd() || known.value() != hash;
+    }
+    int count = ++current_[hash];
+    return count > seen_.value(hash, 0);
+}
+
+/*
+ * Строки текущего прохода без отслеживания добавляются
+ * к известным: хэш строки с тем же ключом заменяется новым
+*/
+void SqliteReaderCli::rememberPass()
+{
+    for (auto i = current_rows_.constBegin(); i != current_rows_.constEnd(); ++i) {
+        seen_rows_.insert(i.key(), i.value());
+    }
+    for (auto i = current_.constBegin(); i != current_.constEnd(); ++i) {
+        seen_[i.key()] = qMax(seen_.value(i.key()), i.value());
+    }
+    current_rows_.clear();
+    current_.clear();
+}
+
+/*
+ * Проход закончен. Без --follow программа завершается.
+ * С отслеживанием изменений известные строки не нужны (см.
+ * isNewRow), после прохода по изменениям забываются и строки
+ * после отпечатков. Без отслеживания строки прохода становятся
+ * известными для следующего.
+*/
+void SqliteReaderCli::finishPass()
+{
+    is_passing_ = false;
+    out_.flush();
+    if (!is_follow_) {
+        QCoreApplication::exit(exit_code_);
+        return;
+    }
+    if (is_tracked_pass_) {
+        if (is_changes_pass_) {
+            pending_rows_.clear();
+        }
+        seen_rows_.clear();
+        current_rows_.clear();
+        seen_.clear();
+        current_.clear();
+        return;
+    }
+    seen_rows_.swap(current_rows_);
+    seen_.swap(current_);
+    current_rows_.clear();
+    current_.clear();
+}
+
+/*
+ * Строка вывода для строки row модели таблицы. Тип ячейки
+ * берётся из блока страницы (cellValue): blob печатается
+ * целиком в виде x'...', а не как текст, в котором после
+ * fromUtf8 были бы U+FFFD и нулевые байты.
+*/
+QString SqliteReaderCli::rowLine(int row) const
+{
+    SqliteTableModel *tableModel = model_->tableModel;
+    QStringList values;
+    for (int column = 0; column < tableModel->columnCount(); column++) {
+        QVariant value = tableModel->cellValue(tableModel->index(row, column));
+        if (value.type() == QVariant::ByteArray) {
+            values.append(blobValue(value.toByteArray(), -1));
+        } else {
+            values.append(escape(value.toString()));
+        }
+    }
+    return values.join('\t');
+}
+
+/*
+ * Экранирование значения, чтобы одна строка таблицы
+ * всегда была одной строкой вывода
+*/
+QString SqliteReaderCli::escape(const QString &value)
+{
+    if (!value.contains('\\') && !value.contains('\t') && !value.contains('\n') && !value.contains('\r')) {
+        return value;
+    }
+    QString result = value;
+    result.replace("\\", "\\\\");
+    result.replace("\t", "\\t");
+    result.replace("\n", "\\n");
+    result.replace("\r", "\\r");
+    return result;
+}
+
+/*
+ * 64-битный хэш строки вывода из двух 32-битных
+ * с разными seed: при 32 битах совпадения начинались бы
+ * уже на десятках тысяч строк
+*/
+quint64 SqliteReaderCli::lineHash(const QString &line)
+{
+    return (static_cast<quint64>(qHash(line, 0)) << 32) | qHash(line, 0x9e3779b9U);
+}
+
+void SqliteReaderCli::fail(const QString &message, int code)
+{
+    err_ << message << '\n';
+    err_.flush();
+    exit_code_ = code;
+    QCoreApplication::exit(code);
+}
+
+SqliteReaderCli::~SqliteReaderCli()
+{
+    delete model_;
+}
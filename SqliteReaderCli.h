@@ -0,0 +1,108 @@
+#ifndef SQLITEREADERCLI_H
+#define SQLITEREADERCLI_H
+
+#include <QObject>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include <cstdio>
+
+#include "SqliteReaderModel.h"
+#include "DBException.h"
+#include "SqliteSchemaCatalog.h"
+#include "SqliteScanSummary.h"
+
+/*
+ * Режим командной строки без виджетов:
+ * SqliteReader [--table T] [--filter col=substr]... [--follow | --summary] file.db3
+ * (--sync, --interval, --append-only и --no-header - см. --help).
+ * Бд читается той же SqliteReaderModel, что и в окне, а строки
+ * таблицы с фильтрами печатаются в stdout через табуляцию
+ * (табуляции, переводы строк и \ в значениях экранируются,
+ * blob печатаются в виде x'...').
+ * С --follow программа не завершается, а как tail -f после
+ * каждого изменения бд печатает только новые и изменённые строки:
+ * у таблиц с rowid проход после изменения читает только изменённые
+ * блоки rowid и новые строки (SqliteChunkFingerprint), с --append-only -
+ * только новые, а какие строки в них изменились, знает исполнитель
+ * по своей временной таблице хэшей строк, так что в памяти программы
+ * строки таблицы не хранятся. У остальных таблиц и представлений
+ * программа помнит 64-битные хэши строк прошлого прохода и
+ * пропускает строки, ключ и хэш которых уже были.
+ * С --summary вместо строк печатается сводка по колонкам
+ * подошедших строк (SqliteScanSummary).
+*/
+class SqliteReaderCli : public QObject
+{
+    Q_OBJECT
+
+public:
+    const int EXIT_ERROR = 1;  //код выхода при ошибке бд
+    const int EXIT_USAGE = 2;  //код выхода при неверных аргументах
+    const int SUMMARY_BLOB_BYTES = 16;  //байт blob, которые печатаются в сводке
+    static const QStringList CLI_OPTIONS;  //имена опций, которые включают режим командной строки
+    SqliteReaderCli();
+    bool parse(const QStringList &arguments);
+    int exitCode() const;
+    void start();
+    static bool isRequested(int argc, char *argv[]);
+    virtual ~SqliteReaderCli();
+
+private slots:
+    void onCatalogReady(const SqliteSchemaCatalog &catalog);
+    void onQueryReady(const QStringList &dbColumns);
+    void onFiltersReady(const QStringList &filters);
+    void onRefreshed(int rowCount);
+    void onDataChanged();
+    void onError(const DBException &e);
+    void onTableFailed(const QString &table, const QString &error);
+    void onSummaryReady(const SqliteScanSummary &summary);
+    void onSummaryFailed(const QString &error);
+
+private:
+    static void addOptions(QCommandLineParser &parser);
+    void beginPass();
+    void readRows();
+    void finishPass();
+    bool isNewRow(int row, const QString &line);
+    void rememberPass();
+    QString rowLine(int row) const;
+    static QString escape(const QString &value);
+    QString summaryValue(const QVariant &value) const;
+    static QString blobValue(const QByteArray &bytes, int limit);
+    static quint64 lineHash(const QString &line);
+    void fail(const QString &message, int code);
+
+    SqliteReaderModel *model_;
+    QTextStream out_;
+    QTextStream err_;
+    QString path_ = "";
+    QString table_ = "";
+    QStringList filter_arguments_;  //фильтры в виде колонка=подстрока
+    QStringList filters_;  //фильтры по колонкам, как их ждёт модель
+    bool is_follow_ = false;
+    bool is_append_only_ = false;  //таблица только растёт, после изменения читаются только новые строки
+    bool is_header_ = true;
+    bool is_summary_ = false;  //печатается сводка по колонкам, а не строки
+    bool is_summarizing_ = false;  //сводка уже запрошена у модели
+    SqliteSyncScheduler::Policy sync_policy_ = SqliteSyncScheduler::Interval;  //как --follow замечает изменения
+    int interval_ = 0;  //период проверки изменений с --follow до отступа, 0 - по умолчанию
+    int exit_code_ = 0;
+    bool is_ready_ = false;  //к таблице применены фильтры, проходы можно печатать
+    bool is_passing_ = false;  //идёт проход по строкам
+    int pass_rows_ = 0;  //строк в текущем проходе
+    int next_row_ = 1;  //следующая строка прохода (данные модели таблицы начинаются с 1)
+    bool is_tracked_pass_ = false;  //модель отслеживает изменения, какие строки новые, знают её отпечатки
+    bool is_changes_pass_ = false;  //в проходе только изменённые строки
+    QHash<qint64, quint64> pending_rows_;  //хэши строк после отпечатков, напечатанных полным проходом, по rowid
+    QHash<qint64, quint64> seen_rows_;  //хэши текста строк с ключом прошлого прохода по rowid (без отслеживания)
+    QHash<qint64, quint64> current_rows_;  //то же для текущего прохода
+    QHash<quint64, int> seen_;  //хэши текста строк без ключа прошлого прохода и сколько раз они встретились
+    QHash<quint64, int> current_;  //то же для текущего прохода
+};
+
+#endif // SQLITEREADERCLI_H
@@ -30,6 +30,15 @@ void SqliteReaderController::onTextChanged(const QString &text)
     emit filterChanged(column, text);
 }
 
+/*
+ * Пользователь выбрал таблицу в меню Table,
+ * её имя хранится в данных пункта меню.
+*/
+void SqliteReaderController::onTableTriggered(QAction *action)
+{
+    emit tableSelected(action->data().toString());
+}
+
 SqliteReaderController::~SqliteReaderController()
 {
 
@@ -3,6 +3,7 @@
 
 #include <QFileDialog>
 #include <QLineEdit>
+#include <QAction>
 
 class SqliteReaderController : public QObject
 {
@@ -15,11 +16,13 @@ public:
 public slots:
     void fileOpen(const QString &path);
     void onTextChanged(const QString &text);
+    void onTableTriggered(QAction *action);
 
 signals:
     void fileOpened(const QString &path);
     void requestReady(QString &request);
     void filterChanged(int column, const QString &filter);
+    void tableSelected(const QString &table);
 };
 
 #endif // SQLITEREADERCONTROLLER_H
@@ -2,80 +2,690 @@
 
 SqliteReaderModel::SqliteReaderModel()
 {
-    db_ = QSqlDatabase::addDatabase("QSQLITE");
-    timer = new QTimer();
-    timer->setInterval(SYNC_TIME);
-    timer->start();
+    qRegisterMetaType<DBException>("DBException");
+    qRegisterMetaType<SqliteResultBlock>("SqliteResultBlock");
+    qRegisterMetaType<SqliteSchemaCatalog>("SqliteSchemaCatalog");
+    qRegisterMetaType<SqliteConnectionProfile>("SqliteConnectionProfile");
+    qRegisterMetaType<SqliteScanSummary>("SqliteScanSummary");
+    qRegisterMetaType<QVector<qint64>>("QVector<qint64>");
+    qRegisterMetaType<SqliteQueryPlan>("SqliteQueryPlan");
+    qRegisterMetaType<SqliteChunkFingerprint>("SqliteChunkFingerprint");
+    qRegisterMetaType<SqliteResultPage>("SqliteResultPage");
+    syncScheduler = new SqliteSyncScheduler();  //запускается, когда бд открыта
+    tableModel = new SqliteTableModel();
+    filterScheduler = new SqliteFilterScheduler();
+    index_timer_ = new QTimer();
+    index_timer_->setSingleShot(true);
+    index_timer_->setInterval(INDEX_DELAY);
+    profiler = new SqliteProfiler();  //выключен, пока его не включит view
+    worker_thread_ = new QThread();
+    worker_thread_->setObjectName("SqliteReaderWorker");
+    worker_ = new SqliteReaderWorker("SqliteReaderWorker");
+    worker_->setProfiler(profiler);
+    worker_->moveToThread(worker_thread_);
+    sync_thread_ = new QThread();
+    sync_thread_->setObjectName("SqliteReaderSync");
+    sync_worker_ = new SqliteReaderWorker("SqliteReaderSync");
+    sync_worker_->setProfiler(profiler);
+    sync_worker_->moveToThread(sync_thread_);
+    console_thread_ = new QThread();
+    console_thread_->setObjectName("SqliteReaderConsole");
+    console_worker_ = new SqliteReaderWorker("SqliteReaderConsole");
+    console_worker_->setProfiler(profiler);
+    console_worker_->moveToThread(console_thread_);
+    export_thread_ = new QThread();
+    export_thread_->setObjectName("SqliteReaderExport");
+    exporter = new SqliteExporter();
+    exporter->moveToThread(export_thread_);
+    scan_thread_ = new QThread();
+    scan_thread_->setObjectName("SqliteReaderScan");
+    parallel_scan_ = new SqliteParallelScan();
+    parallel_scan_->setProfiler(profiler);
+    parallel_scan_->moveToThread(scan_thread_);
+    tableModel->setWorker(worker_);
+    tableModel->setProfiler(profiler);
+
+    /*
+     * Исполнители удаляются в своих потоках после их остановки
+    */
+    QObject::connect(worker_thread_, SIGNAL(finished()),
+                     worker_, SLOT(deleteLater()));
+    QObject::connect(sync_thread_, SIGNAL(finished()),
+                     sync_worker_, SLOT(deleteLater()));
+    QObject::connect(console_thread_, SIGNAL(finished()),
+                     console_worker_, SLOT(deleteLater()));
+    QObject::connect(export_thread_, SIGNAL(finished()),
+                     exporter, SLOT(deleteLater()));
+    QObject::connect(scan_thread_, SIGNAL(finished()),
+                     parallel_scan_, SLOT(deleteLater()));
+
+    /*
+     * Ответы исполнителя приходят через очередь событий
+     * в поток модели
+    */
+    QObject::connect(worker_, SIGNAL(opened(const QString &, const SqliteSchemaCatalog &)),
+                     this, SLOT(onOpened(const QString &, const SqliteSchemaCatalog &)));
+    QObject::connect(worker_, SIGNAL(columnsLoaded(const QString &, const QStringList &, const QString &)),
+                     this, SLOT(onColumnsLoaded(const QString &, const QStringList &, const QString &)));
+    QObject::connect(worker_, SIGNAL(columnsFailed(const QString &, const QString &)),
+                     this, SLOT(onColumnsFailed(const QString &, const QString &)));
+    QObject::connect(worker_, SIGNAL(catalogChecked(bool, const SqliteSchemaCatalog &)),
+                     this, SLOT(onCatalogChecked(bool, const SqliteSchemaCatalog &)));
+    QObject::connect(worker_, SIGNAL(filterIndexReady(int, const QString &, bool)),
+                     this, SLOT(onFilterIndexReady(int, const QString &, bool)));
+    QObject::connect(worker_, SIGNAL(dbUnreachable(const DBException &)),
+                     this, SLOT(onWorkerError(const DBException &)));
+    QObject::connect(worker_, SIGNAL(matchesKept(int)),
+                     filterScheduler, SLOT(onMatchesKept(int)));
+    QObject::connect(worker_, SIGNAL(matchesFailed(int)),
+                     this, SLOT(onMatchesFailed(int)));
+    QObject::connect(worker_, SIGNAL(rowCountReady(int, int)),
+                     tableModel, SLOT(onRowCountReady(int, int)));
+    QObject::connect(worker_, SIGNAL(rowsReady(int, int, const SqliteResultBlock &)),
+                     tableModel, SLOT(onRowsReady(int, int, const SqliteResultBlock &)));
+    QObject::connect(worker_, SIGNAL(queryPlanReady(int, const QStringList &)),
+                     this, SLOT(onQueryPlanReady(int, const QStringList &)));
+    QObject::connect(worker_, SIGNAL(valueRead(int, bool, const QByteArray &)),
+                     this, SLOT(onValueRead(int, bool, const QByteArray &)));
+    QObject::connect(worker_, SIGNAL(queryChecked(int, const QString &)),
+                     this, SLOT(onQueryChecked(int, const QString &)));
+    QObject::connect(parallel_scan_, SIGNAL(scanned(int, const SqliteScanSummary &, const QVector<qint64> &)),
+                     this, SLOT(onScanned(int, const SqliteScanSummary &, const QVector<qint64> &)));
+    QObject::connect(parallel_scan_, SIGNAL(failed(int, const QString &)),
+                     this, SLOT(onScanFailed(int, const QString &)));
+
+    /*
+     * Проверки изменений идут на отдельном соединении и не ждут,
+     * пока основной исполнитель дочитает страницы
+    */
+    QObject::connect(sync_worker_, SIGNAL(changesChecked(bool)),
+                     this, SLOT(onChangesChecked(bool)));
+    QObject::connect(sync_worker_, SIGNAL(dbUnreachable(const DBException &)),
+                     this, SLOT(onWorkerError(const DBException &)));
+    QObject::connect(sync_worker_, SIGNAL(fingerprintReady(int, const SqliteChunkFingerprint &)),
+                     this, SLOT(onFingerprintReady(int, const SqliteChunkFingerprint &)));
+    QObject::connect(syncScheduler, SIGNAL(syncRequested()),
+                     this, SLOT(onSyncRequested()));
+
+    /*
+     * Запросы консоли SQL выполняются на своём соединении,
+     * их ошибки - ошибки запроса, а не бд
+    */
+    QObject::connect(console_worker_, SIGNAL(planReady(int, const SqliteQueryPlan &)),
+                     this, SLOT(onConsolePlanReady(int, const SqliteQueryPlan &)));
+    QObject::connect(console_worker_, SIGNAL(queryStarted(int, const QStringList &)),
+                     this, SLOT(onConsoleStarted(int, const QStringList &)));
+    QObject::connect(console_worker_, SIGNAL(rowsReady(int, int, const SqliteResultBlock &)),
+                     this, SLOT(onConsoleRows(int, int, const SqliteResultBlock &)));
+    QObject::connect(console_worker_, SIGNAL(queryFinished(int, qint64, qint64, bool)),
+                     this, SLOT(onConsoleFinished(int, qint64, qint64, bool)));
+    QObject::connect(console_worker_, SIGNAL(queryFailed(int, const QString &)),
+                     this, SLOT(onConsoleFailed(int, const QString &)));
+
+    /*
+     * Клик по хедеру таблицы: сортирует sqlite
+    */
+    QObject::connect(tableModel, SIGNAL(sortRequested(int, Qt::SortOrder)),
+                     this, SLOT(changeSort(int, Qt::SortOrder)));
+
+    /*
+     * Асинхронные запросы ждут обновления таблицы и своих страниц
+    */
+    QObject::connect(tableModel, SIGNAL(refreshed(int)),
+                     this, SLOT(onTableRefreshed()));
+    QObject::connect(tableModel, SIGNAL(pageReady(int)),
+                     this, SLOT(onPageReady(int)));
+
+    /*
+     * Индекс фильтров перестраивается, когда бд перестала меняться
+    */
+    QObject::connect(index_timer_, SIGNAL(timeout()),
+                     this, SLOT(requestFilterIndex()));
+
+    /*
+     * Фильтры применяются, когда пользователь перестал печатать
+    */
+    QObject::connect(filterScheduler, SIGNAL(filtersReady(const QStringList &)),
+                     this, SLOT(onFiltersReady(const QStringList &)));
+
+    worker_thread_->start();
+    sync_thread_->start();
+    console_thread_->start();
+    export_thread_->start();
+    scan_thread_->start();
+}
+
+/*
+ * Текущий запрос с учётом фильтров.
+ * Фильтры превращаются в условия where, которые
+ * считает сам sqlite, значения фильтров передаются
+ * через плейсхолдеры и складываются в values.
+*/
+QString SqliteReaderModel::filteredRequest(QVariantList &values) const
+{
+    return filter_compiler_.compile(last_request_, filter_list_, values);
+}
+
+/*
+ * Передача запроса с фильтрами и сортировкой в модель таблицы.
+ * Для запроса по всей таблице с фильтрами исполнитель сначала
+ * сохраняет ключи подходящих строк (если фильтры сужают прошлые,
+ * то ищет только среди прошлого множества), а модель таблицы
+ * считает и листает уже только их.
+ * На больших таблицах с rowid без индекса fts5 строки под новые
+ * фильтры ищет параллельный проход на всех ядрах, а модель таблицы
+ * получает запрос, когда он закончит (onScanned).
+ * Ключ строки нужен и сортировке, чтобы читать страницы поиском.
+ * Пока строятся первые отпечатки таблицы, она не читается
+ * (см. onFingerprintReady).
+ * Ошибки придут от исполнителя сигналом.
+*/
+void SqliteReaderModel::updateTable()
+{
+    if (is_baseline_pending_) {
+        return;
+    }
+    is_changes_shown_ = false;
+    filter_compiler_.setLazy(is_lazy_values_, sort_order_.column());  //колонку сортировки sqlite сравнивает целиком
+    cancelFilterScans();
+    QVariantList values;
+    bool isKeyed = filter_compiler_.isKeyed(last_request_);
+    bool isFiltered = filter_list_.join("") != "";
+    SqliteSortOrder order = sort_order_;
+    order.setKey(isKeyed ? catalog_.key(table_) : "");
+    if (!isKeyed || !isFiltered) {
+        QString request = filteredRequest(values);
+        setTableRequest(request, values, isKeyed ? 1 : 0, order);
+        return;
+    }
+    int source = filterScheduler->narrowingSource(filter_list_);
+    if (source < 0 && isParallelScan()) {
+        filter_scan_ = ++scan_request_;
+        QString select = filter_compiler_.scanRequest(filter_list_, values, false);
+        QMetaObject::invokeMethod(parallel_scan_, "scan", Qt::QueuedConnection,
+                                  Q_ARG(int, filter_scan_),
+                                  Q_ARG(QString, path_),
+                                  Q_ARG(SqliteConnectionProfile, profile_),
+                                  Q_ARG(QString, table_),
+                                  Q_ARG(QString, select),
+                                  Q_ARG(QVariantList, values),
+                                  Q_ARG(int, 0),
+                                  Q_ARG(bool, true));
+        return;
+    }
+    keepMatches(source);
+}
+
+/*
+ * Поиск строк под фильтры исполнителем: ключи сохраняются
+ * во временную таблицу его соединения (source >= 0 - поиск среди
+ * сохранённых раньше), а модель таблицы читает уже их. Исполнитель
+ * выполняет запросы по очереди, поэтому модель таблицы может
+ * запросить строки сразу.
+*/
+void SqliteReaderModel::keepMatches(int source)
+{
+    QVariantList values;
+    SqliteSortOrder order = sort_order_;
+    order.setKey(catalog_.key(table_));
+    int generation = tableModel->nextGeneration();
+    QString select = filter_compiler_.matchesSelect(filter_list_, values, source);
+    filterScheduler->expectMatches(generation, filter_list_);
+    QMetaObject::invokeMethod(worker_, "keepMatches", Qt::QueuedConnection,
+                              Q_ARG(int, generation),
+                              Q_ARG(QString, select),
+                              Q_ARG(QVariantList, values),
+                              Q_ARG(int, source));
+    setTableRequest(filter_compiler_.matchedRequest(generation), QVariantList(), 1, order);
+}
+
+/*
+ * Новый запрос модели таблицы. Запоминается, какому изменению
+ * таблицы асинхронными запросами он соответствует: их
+ * результаты готовы, когда модель таблицы его прочитает.
+*/
+void SqliteReaderModel::setTableRequest(const QString &request, const QVariantList &values, int keyColumns,
+                                        const SqliteSortOrder &order)
+{
+    requested_state_ = table_state_;
+    tableModel->setRequest(request, values, keyColumns, order);
+}
+
+/*
+ * Исполнитель не смог сохранить множество строк под фильтры
+ * (например, не хватило места во временной бд). Запросы модели
+ * таблицы по нему он уже отменил, и таблица читается обычным
+ * запросом с фильтрами, как без ключа.
+*/
+void SqliteReaderModel::onMatchesFailed(int generation)
+{
+    if (generation != tableModel->nextGeneration() - 1 || !is_open_) {  //модель таблицы уже читает другой запрос
+        return;
+    }
+    QVariantList values;
+    SqliteSortOrder order = sort_order_;
+    order.setKey(catalog_.key(table_));
+    QString request = filteredRequest(values);
+    setTableRequest(request, values, 1, order);
+}
+
+/*
+ * Фильтры ищет параллельный проход: таблицу можно делить по
+ * rowid, индекса нет, и строк столько, что один поток заметно
+ * медленнее всех ядер
+*/
+bool SqliteReaderModel::isParallelScan() const
+{
+    return filter_compiler_.hasRowid() && !filter_compiler_.isIndexed() &&
+           catalog_.rowEstimate(table_) >= PARALLEL_ROWS && SqliteParallelScan::threadCount() > 1;
+}
+
+/*
+ * Отмена параллельных проходов: их результат
+ * относится к старым фильтрам или к старой бд
+*/
+void SqliteReaderModel::cancelScans()
+{
+    if (filter_scan_ == 0 && summary_scan_ == 0 && profile_scan_ == 0) {
+        return;
+    }
+    filter_scan_ = 0;
+    summary_scan_ = 0;
+    profile_scan_ = 0;
+    parallel_scan_->cancelBefore(++scan_request_);
 }
 
 /*
- * Из query заполняется двумерный список строк
- * с учётом фильтров.
+ * Отмена проходов по старым фильтрам. Профиль колонок
+ * от фильтров не зависит и продолжает считаться.
 */
-void SqliteReaderModel::fillListFromSqlQuery(QList<QStringList> &dbCopy, QSqlQuery &query)
+void SqliteReaderModel::cancelFilterScans()
 {
-    query.first();
-    query.previous();
-    while (query.next()) {
-        QStringList tableRow;
-        bool filter = true;
-        for (int i = 0; i < db_columns_.size(); i++) {
-            QString value = query.value(i).toString();
-            filter = filter && value.contains(filter_list_[i]);
-            tableRow.append(value);
+    for (int request : {filter_scan_, summary_scan_}) {
+        if (request != 0) {
+            parallel_scan_->cancel(request);
         }
-        if (filter) {
-            dbCopy.append(tableRow);
+    }
+    filter_scan_ = 0;
+    summary_scan_ = 0;
+}
+
+/*
+ * Сводка по колонкам (количество, null, минимум, максимум,
+ * оценка различных значений) строк открытой таблицы с текущими
+ * фильтрами. Считается параллельным проходом, придёт
+ * в summaryReady. false, если считать нечего.
+*/
+bool SqliteReaderModel::summarizeTable()
+{
+    if (!is_open_ || last_request_ != filter_compiler_.tableRequest()) {
+        return false;
+    }
+    summary_scan_ = ++scan_request_;
+    QVariantList values;
+    QString select = filter_compiler_.scanRequest(filter_list_, values, true);
+    QMetaObject::invokeMethod(parallel_scan_, "scan", Qt::QueuedConnection,
+                              Q_ARG(int, summary_scan_),
+                              Q_ARG(QString, path_),
+                              Q_ARG(SqliteConnectionProfile, profile_),
+                              Q_ARG(QString, filter_compiler_.hasRowid() ? table_ : QString()),
+                              Q_ARG(QString, select),
+                              Q_ARG(QVariantList, values),
+                              Q_ARG(int, db_columns_.size()),
+                              Q_ARG(bool, false));
+    return true;
+}
+
+/*
+ * Профиль колонок открытой таблицы без фильтров: сводка
+ * вместе с частыми значениями и гистограммами, чтобы видеть
+ * распределение до того, как фильтровать. Профиль считается
+ * одним параллельным проходом и хранится до изменения бд,
+ * придёт в profileReady. false, если таблица не открыта.
+*/
+bool SqliteReaderModel::profileColumns()
+{
+    if (!is_open_ || table_.isEmpty() || db_columns_.isEmpty()) {
+        return false;
+    }
+    if (profiles_.contains(table_)) {
+        emit profileReady(table_, db_columns_, profiles_.value(table_));
+        return true;
+    }
+    if (profile_scan_ != 0 && profile_table_ == table_) {
+        return true;  //уже считается
+    }
+    profile_scan_ = ++scan_request_;
+    profile_table_ = table_;
+    QVariantList values;
+    QString select = filter_compiler_.scanRequest(QStringList(), values, true);
+    QMetaObject::invokeMethod(parallel_scan_, "scan", Qt::QueuedConnection,
+                              Q_ARG(int, profile_scan_),
+                              Q_ARG(QString, path_),
+                              Q_ARG(SqliteConnectionProfile, profile_),
+                              Q_ARG(QString, filter_compiler_.hasRowid() ? table_ : QString()),
+                              Q_ARG(QString, select),
+                              Q_ARG(QVariantList, values),
+                              Q_ARG(int, db_columns_.size()),
+                              Q_ARG(bool, false));
+    return true;
+}
+
+/*
+ * Параллельный проход закончен. Найденные по фильтрам rowid
+ * исполнитель сохраняет во временную таблицу, как свои, и
+ * модель таблицы читает строки уже по ним.
+*/
+void SqliteReaderModel::onScanned(int request, const SqliteScanSummary &summary, const QVector<qint64> &keys)
+{
+    if (request == summary_scan_) {
+        summary_scan_ = 0;
+        emit summaryReady(summary);
+        return;
+    }
+    if (request == profile_scan_) {
+        profile_scan_ = 0;
+        profiles_.insert(profile_table_, summary);
+        if (profile_table_ == table_) {
+            emit profileReady(table_, db_columns_, summary);
         }
+        return;
+    }
+    if (request != filter_scan_) {
+        return;
     }
+    filter_scan_ = 0;
+    SqliteSortOrder order = sort_order_;
+    order.setKey(catalog_.key(table_));
+    int generation = tableModel->nextGeneration();
+    filterScheduler->expectMatches(generation, filter_list_);
+    QMetaObject::invokeMethod(worker_, "storeMatches", Qt::QueuedConnection,
+                              Q_ARG(int, generation),
+                              Q_ARG(QVector<qint64>, keys));
+    setTableRequest(filter_compiler_.matchedRequest(generation), QVariantList(), 1, order);
 }
 
 /*
- * Установка соединения с бд и получение
- * списка таблиц и колонок. Если что-то идёт не так, то
- * выбрасываются исключения.
- * Приложение работает только с первой таблицей в бд.
+ * Параллельный проход не смог открыть бд или прочитать таблицу.
+ * Тогда фильтры ищет исполнитель, как на маленьких таблицах,
+ * и об ошибке, если она настоящая, сообщит он.
 */
-void SqliteReaderModel::connectToDatabase(const QString &path)
+void SqliteReaderModel::onScanFailed(int request, const QString &error)
 {
-    if (db_.isOpen()) {
-        clearModel();
+    if (request == summary_scan_) {
+        summary_scan_ = 0;
+        emit summaryFailed(error);
+        return;
+    }
+    if (request == profile_scan_) {
+        profile_scan_ = 0;
+        return;
+    }
+    if (request != filter_scan_) {
+        return;
+    }
+    filter_scan_ = 0;
+    keepMatches(-1);
+}
+
+/*
+ * Открытие бд в потоке исполнителя с настройками profile
+ * (по умолчанию - только чтение через mmap, см. SqliteConnectionProfile).
+ * Первой открывается таблица table, если она есть в бд,
+ * иначе первая таблица каталога.
+ * Если включён кэш на диске и он есть для этой версии файла,
+ * таблица показывается из него сразу, не дожидаясь исполнителя.
+ * Каталог схемы придёт в onOpened,
+ * ошибки - в onWorkerError.
+*/
+void SqliteReaderModel::connectToDatabase(const QString &path, const SqliteConnectionProfile &profile,
+                                          const QString &table)
+{
+    clearModel();
+    path_ = path;
+    profile_ = profile;
+    start_table_ = table;
+    int interval = -1;
+    SqliteSyncScheduler::Policy policy = SqliteSyncScheduler::storedPolicy(path, interval);
+    syncScheduler->setPolicy(profile.isImmutable ? SqliteSyncScheduler::Manual : policy, interval);
+    is_opening_ = true;
+    bool isCached = false;
+    if (SqliteSidecarCache::isEnabled()) {
+        isCached = sidecar_.load(path);  //идентичность файла снимается до того, как его откроет исполнитель
+    } else {
+        sidecar_.reset();
+    }
+    QMetaObject::invokeMethod(worker_, "open", Qt::QueuedConnection,
+                              Q_ARG(QString, path),
+                              Q_ARG(SqliteConnectionProfile, profile));
+    QMetaObject::invokeMethod(sync_worker_, "watch", Qt::QueuedConnection,
+                              Q_ARG(QString, path),
+                              Q_ARG(SqliteConnectionProfile, profile));
+    QMetaObject::invokeMethod(console_worker_, "openConsole", Qt::QueuedConnection,
+                              Q_ARG(QString, path),
+                              Q_ARG(SqliteConnectionProfile, profile));
+    if (isCached) {
+        showCached();
+    }
+}
+
+/*
+ * Открытие бд по кэшу: каталог и профили колонок берутся
+ * из него, и первая таблица применяется сразу. Запросы
+ * к исполнителю встают в очередь после открытия бд, так
+ * что модель таблицы перечитает показанные страницы, как
+ * только бд откроется. Если колонки первой таблицы не
+ * сохранены, открытие идёт обычным путём.
+*/
+bool SqliteReaderModel::showCached()
+{
+    SqliteSchemaCatalog catalog = sidecar_.catalog();
+    QString table = catalog.contains(start_table_) ? start_table_ : catalog.tables().value(0);
+    if (!catalog.hasColumns(table)) {
+        return false;
+    }
+    catalog_ = catalog;
+    profiles_ = sidecar_.profiles();
+    is_cache_shown_ = true;
+    emit catalogReady(catalog_);
+    pending_table_ = table;
+    applyTable(table);
+    return true;
+}
+/*
+ * Бд открыта исполнителем. Ответы на открытие
+ * уже неактуальных файлов пропускаются.
+ * Сначала открывается выбранная при открытии
+ * или первая таблица бд.
+*/
+void SqliteReaderModel::onOpened(const QString &path, const SqliteSchemaCatalog &catalog)
+{
+    if (path != path_ || (!is_opening_ && !is_cache_shown_)) {
+        return;
+    }
+    if (is_cache_shown_) {
+        validateCached(catalog);
+        return;
+    }
+    catalog_ = catalog;
+    emit catalogReady(catalog_);
+    selectTable(catalog_.contains(start_table_) ? start_table_ : catalog_.tables().value(0));
+}
+
+/*
+ * Бд открыта после показа из кэша. Если схема та же, живой
+ * каталог (с новыми оценками строк) получает колонки из кэша,
+ * а строки уже перечитывает модель таблицы. Если схема
+ * изменилась, кэш отбрасывается, и таблица открывается заново
+ * по живому каталогу.
+*/
+void SqliteReaderModel::validateCached(const SqliteSchemaCatalog &catalog)
+{
+    is_cache_shown_ = false;
+    SqliteSchemaCatalog live = catalog;
+    if (live.schemaVersion() >= 0 && live.schemaVersion() == catalog_.schemaVersion()) {
+        live.copyColumns(catalog_);
+        catalog_ = live;
+        emit catalogReady(catalog_);
+        return;
+    }
+    sidecar_.invalidate();
+    profiles_.clear();
+    emit profileInvalidated();
+    catalog_ = live;
+    failed_tables_.clear();
+    emit catalogReady(catalog_);
+    QString table = catalog_.contains(table_) ? table_ : catalog_.tables().value(0);
+    table_ = "";
+    selectTable(table);
+}
+
+/*
+ * Переключение на другую таблицу или представление той же бд.
+ * Соединение исполнителя и каталог остаются, колонки таблицы
+ * загружаются только при первом открытии, потом берутся из каталога.
+*/
+void SqliteReaderModel::selectTable(const QString &table)
+{
+    if ((!is_open_ && !is_opening_) || !catalog_.contains(table) || table == table_) {
+        return;
+    }
+    pending_table_ = table;
+    if (catalog_.hasColumns(table)) {
+        applyTable(table);
+        return;
     }
-    db_.setDatabaseName(path);
-    db_.open();
-    if (!db_.isOpen()) {
-        throw UnreachableDBException();
-    }
-    query_ = new QSqlQuery(db_);
-    db_tables_ = db_.tables();
-    if (db_tables_.size() > 0) {
-        try {
-            startRequest(*query_, QString("pragma table_info({})").replace("{}", db_tables_[0]));
-        } catch (UnreachableDBException e) {
-            emit dbUnreachable(e);
+    QMetaObject::invokeMethod(worker_, "loadColumns", Qt::QueuedConnection,
+                              Q_ARG(QString, table));
+}
+
+/*
+ * Колонки загружены. Они сохраняются в каталоге, даже если
+ * пользователь уже выбрал другую таблицу.
+*/
+void SqliteReaderModel::onColumnsLoaded(const QString &table, const QStringList &columns, const QString &key)
+{
+    if ((!is_open_ && !is_opening_) || !catalog_.contains(table)) {
+        return;
+    }
+    catalog_.setColumns(table, columns, key);
+    if (table != pending_table_) {
+        return;
+    }
+    if (table == table_ && columns == db_columns_ && key == table_key_) {
+        pending_table_ = "";  //схема изменилась, но не у открытой таблицы: фильтры остаются
+        applyChanges();
+        return;
+    }
+    applyTable(table);
+}
+
+/*
+ * Колонки таблицы не прочитались (например представление
+ * ссылается на удалённую таблицу). Бд остаётся открытой:
+ * при открытии бд или если сломалась открытая таблица
+ * открывается следующая целая таблица каталога, иначе
+ * остаётся открытой текущая. Если целых таблиц нет,
+ * бд не поддерживается.
+*/
+void SqliteReaderModel::onColumnsFailed(const QString &table, const QString &error)
+{
+    if ((!is_open_ && !is_opening_) || table != pending_table_) {
+        return;
+    }
+    pending_table_ = "";
+    if (!failed_tables_.contains(table)) {
+        failed_tables_.append(table);
+    }
+    emit tableFailed(table, error);
+    if (!is_opening_ && table != table_) {
+        return;
+    }
+    table_ = "";
+    for (const QString &next : catalog_.tables()) {
+        if (!failed_tables_.contains(next)) {
+            selectTable(next);
             return;
         }
-        while (query_->next()) {
-            db_columns_.append(query_->value(1).toString());
-            filter_list_.append("");
-        }
-    } else {
-        clearModel();
-        throw UnsupportedDBException();
     }
+    onWorkerError(UnsupportedDBException());
 }
 
 /*
- * Запрос к бд.
- * Если поизошла ошибка, то
- * выбрасывается исключение
+ * Исполнитель проверил схему после изменения бд. Если она
+ * изменилась, колонки открытой таблицы читаются заново:
+ * когда они те же, фильтры и сортировка остаются (см.
+ * onColumnsLoaded), а если таблицу удалили, открывается
+ * первая таблица нового каталога.
 */
-void SqliteReaderModel::startRequest(QSqlQuery &query, const QString &request)
+void SqliteReaderModel::onCatalogChecked(bool isChanged, const SqliteSchemaCatalog &catalog)
 {
-    if (!query.exec(request)) {
-        clearModel();
-        throw UnreachableDBException();
+    if (!is_open_) {
+        return;
+    }
+    if (!isChanged || catalog.schemaVersion() == catalog_.schemaVersion()) {
+        applyChanges();
+        return;
+    }
+    catalog_ = catalog;
+    failed_tables_.clear();
+    emit catalogReady(catalog_);
+    if (catalog_.isEmpty()) {
+        onWorkerError(UnsupportedDBException());
+        return;
+    }
+    if (!catalog_.contains(table_)) {
+        table_ = "";
+        selectTable(catalog_.tables().value(0));
+        return;
+    }
+    pending_table_ = table_;
+    QMetaObject::invokeMethod(worker_, "loadColumns", Qt::QueuedConnection,
+                              Q_ARG(QString, table_));
+}
+
+/*
+ * Таблица становится текущей: фильтры сбрасываются,
+ * а запрос перевыполняется уже по ней. При открытии бд
+ * выполняется запрос, пришедший раньше.
+*/
+void SqliteReaderModel::applyTable(const QString &table)
+{
+    rememberTable();
+    pending_table_ = "";
+    table_ = table;
+    table_key_ = catalog_.key(table);
+    db_columns_ = catalog_.columns(table);
+    filter_list_.clear();
+    for (int i = 0; i < db_columns_.size(); i++) {
+        filter_list_.append("");
+    }
+    filterScheduler->reset(db_columns_.size());
+    filter_compiler_.setSource(table_, db_columns_, catalog_.key(table_));
+    if (is_filter_index_enabled_) {
+        requestFilterIndex();
+    }
+    if (is_opening_) {
+        is_opening_ = false;
+        is_open_ = true;
+        syncScheduler->start();
+        if (!pending_request_.isEmpty()) {
+            QString request = pending_request_;
+            pending_request_ = "";
+            makeRequest(request);
+        }
+        if (!async_requests_.isEmpty()) {
+            QMetaObject::invokeMethod(this, "startAsync", Qt::QueuedConnection);
+        }
+        return;
     }
+    QString request = "select * from {}";
+    makeRequest(request);
+}
+
+QString SqliteReaderModel::currentTable() const
+{
+    return table_;
 }
 
 /*
@@ -84,100 +694,1003 @@ void SqliteReaderModel::startRequest(QSqlQuery &query, const QString &request)
 */
 void SqliteReaderModel::clearModel()
 {
-    db_.close();
-    delete query_;
-    query_ = nullptr;
+    failAsync("The database was closed");
+    saveCache();
+    cancelScans();
+    if (is_console_running_) {
+        cancelConsoleQuery();
+        emit consoleFailed("The database was closed");
+    }
+    tableModel->clear();
+    QMetaObject::invokeMethod(worker_, "close", Qt::QueuedConnection);
+    QMetaObject::invokeMethod(sync_worker_, "close", Qt::QueuedConnection);
+    QMetaObject::invokeMethod(console_worker_, "close", Qt::QueuedConnection);
+    syncScheduler->stop();
+    path_ = "";
+    is_opening_ = false;
+    is_open_ = false;
+    is_sync_forced_ = false;
+    is_change_deferred_ = false;
+    pending_request_ = "";
+    last_request_ = "";
+    catalog_ = SqliteSchemaCatalog();
+    table_ = "";
+    table_key_ = "";
+    failed_tables_.clear();
+    pending_table_ = "";
     db_columns_.clear();
     filter_list_.clear();
+    sort_order_ = SqliteSortOrder();
+    sort_plan_generation_++;
+    filterScheduler->reset(0);
+    filter_compiler_.setSource("", QStringList(), "");
+    profiles_.clear();
+    sidecar_.reset();
+    is_cache_shown_ = false;
+    cancelFilterIndex();
+    sync_worker_->cancelBefore(++fingerprint_request_);
+    fingerprint_ = SqliteChunkFingerprint();
+    is_baseline_pending_ = false;
+    is_changes_shown_ = false;
+    if (!async_requests_.isEmpty()) {  //отложенные до открытия запросы больше не ждут
+        QMetaObject::invokeMethod(this, "startAsync", Qt::QueuedConnection);
+    }
+}
+
+/*
+ * Первые страницы открытой таблицы для кэша на диске.
+ * Сохраняется только запрос всей таблицы без фильтров
+ * и сортировки: именно его модель показывает при открытии.
+*/
+void SqliteReaderModel::rememberTable()
+{
+    if (!is_open_ || table_.isEmpty() || last_request_ != filter_compiler_.tableRequest() ||
+            filter_list_.join("") != "" || sort_order_.isSorted()) {
+        return;
+    }
+    QList<SqliteResultBlock> pages = tableModel->leadingPages(sidecar_.FIRST_PAGES);
+    if (!pages.isEmpty() || tableModel->dataRowCount() == 0) {
+        sidecar_.setTable(table_, tableModel->dataRowCount(), pages);
+    }
+}
+
+/*
+ * Запись кэша на диск при закрытии бд. Пока бд показана
+ * из кэша и не сверена с живым файлом, кэш не переписывается.
+*/
+void SqliteReaderModel::saveCache()
+{
+    if (!is_open_ || is_cache_shown_) {
+        return;
+    }
+    rememberTable();
+    sidecar_.setCatalog(catalog_);
+    sidecar_.setProfiles(profiles_);
+    sidecar_.save();
+}
+
+/*
+ * Включение кэша на диске. Действует со следующего
+ * открытия бд, выключение удаляет кэш открытой бд из памяти.
+*/
+void SqliteReaderModel::setSidecarCacheEnabled(bool isEnabled)
+{
+    SqliteSidecarCache::setEnabled(isEnabled);
+    if (!isEnabled) {
+        sidecar_.reset();
+    }
 }
 
 /*
  * Запрос к бд.
- * Обратотка исключений в случае ошибок.
- * Формирование двумерного списка строк
- * для отображения в таблицу
+ * Сами строки не читаются: модель таблицы
+ * подгружает их страницами по мере прокрутки.
+ * Если бд ещё открывается, запрос откладывается.
 */
 void SqliteReaderModel::makeRequest(QString &request)
 {
-    if (!query_) {
+    if (is_opening_) {
+        pending_request_ = request;
         return;
     }
-    request.replace("{}", db_tables_[0]);
-    try {
-        startRequest(*query_, request);
-    } catch (UnreachableDBException e) {
-        emit dbUnreachable(e);
+    if (!is_open_) {
         return;
     }
+    request.replace("{}", SqliteFilterCompiler::quoteIdentifier(table_));
     last_request_ = request;
-    QList<QStringList> dbCopy;
-    fillListFromSqlQuery(dbCopy, *query_);
-    emit queryReady(dbCopy, db_columns_);
+    sort_order_ = SqliteSortOrder();  //новый запрос начинается без сортировки
+    sort_plan_generation_++;
+    tableModel->setColumns(db_columns_);
+    if (request == filter_compiler_.tableRequest() && sidecar_.hasTable(table_)) {
+        SqliteSidecarCache::Table cached = sidecar_.table(table_);
+        tableModel->preload(cached.rowCount, cached.pages);
+    }
+    is_baseline_pending_ = is_change_tracked_ && filter_compiler_.hasRowid() &&
+                           request == filter_compiler_.tableRequest() && !fingerprint_.isFor(table_, db_columns_);
+    if (is_baseline_pending_) {
+        requestFingerprint();  //таблица читается после отпечатков, см. onFingerprintReady
+    }
+    updateTable();
+    emit queryReady(db_columns_);
 }
 
 /*
- * Фиксирование изменений фильтров и
- * создание двумерного списка строк для
- * отображения в таблице с учётом фильтров.
+ * Фиксирование изменений фильтров.
+ * Быстрые правки склеиваются планировщиком,
+ * таблица обновляется в onFiltersReady.
 */
 void SqliteReaderModel::changeFilter(int column, const QString &filter)
 {
-    filter_list_[column] = filter;
-    QList<QStringList> dbCopy;
-    QStringList emptyList;
-    fillListFromSqlQuery(dbCopy, *query_);
-    emit queryReady(dbCopy, emptyList);
+    if (!is_open_) {
+        return;
+    }
+    filterScheduler->changeFilter(column, filter);
+}
+
+/*
+ * Сортировка по колонке column (-1 - без сортировки).
+ * Строки сортирует sqlite, после обновления таблицы
+ * запрашивается план, чтобы показать, покрывает ли
+ * сортировку индекс.
+*/
+void SqliteReaderModel::changeSort(int column, Qt::SortOrder order)
+{
+    if (!is_open_ || last_request_.isEmpty()) {
+        return;
+    }
+    SqliteSortOrder sortOrder;
+    if (column >= 0 && column < db_columns_.size()) {
+        sortOrder = SqliteSortOrder(column, SqliteFilterCompiler::quoteIdentifier(db_columns_[column]),
+                                    order == Qt::DescendingOrder);
+    }
+    if (sortOrder == sort_order_) {
+        return;
+    }
+    sort_order_ = sortOrder;
+    updateTable();
+    explainSort();
+}
+
+/*
+ * Запрос плана первой страницы отсортированной таблицы
+*/
+void SqliteReaderModel::explainSort()
+{
+    sort_plan_generation_++;
+    tableModel->setSortPlan("");
+    if (!sort_order_.isSorted()) {
+        return;
+    }
+    QVariantList values;
+    QString request = tableModel->pageRequest(values);
+    QMetaObject::invokeMethod(worker_, "explainQuery", Qt::QueuedConnection,
+                              Q_ARG(int, sort_plan_generation_),
+                              Q_ARG(QString, request),
+                              Q_ARG(QVariantList, values));
+}
+
+/*
+ * План сортировки получен. Если в нём есть временное
+ * b-дерево для order by, то индекса по колонке нет, и каждая
+ * страница сортирует все подходящие строки.
+*/
+void SqliteReaderModel::onQueryPlanReady(int generation, const QStringList &plan)
+{
+    if (generation != sort_plan_generation_ || plan.isEmpty()) {
+        return;
+    }
+    bool isCovered = !plan.join("\n").contains(QRegularExpression("TEMP B-TREE FOR .*ORDER BY"));
+    QString summary = isCovered ? "Sorted by an index" :
+                                  "No index covers this sort: every page is sorted in a temporary b-tree";
+    tableModel->setSortPlan(summary + "\n\n" + plan.join("\n"));
+}
+
+/*
+ * Просмотр значения ячейки целиком. Обычное значение уже
+ * есть в модели таблицы, а ленивое исполнитель читает из
+ * бд по rowid строки, ответ придёт в onValueRead.
+*/
+void SqliteReaderModel::openValue(const QModelIndex &index)
+{
+    if (!is_open_ || !index.isValid() || index.row() == 0 || index.column() >= db_columns_.size()) {
+        return;
+    }
+    QString column = db_columns_[index.column()];
+    QVariant value = tableModel->cellValue(index);
+    QVariant rowid = tableModel->rowKey(index.row());
+    if (!tableModel->isLazy(index) || !rowid.isValid()) {
+        emit valueReady(column, value);
+        return;
+    }
+    value_request_++;
+    value_column_ = column;
+    is_value_text_ = value.type() == QVariant::String;
+    QMetaObject::invokeMethod(worker_, "readValue", Qt::QueuedConnection,
+                              Q_ARG(int, value_request_),
+                              Q_ARG(QString, table_),
+                              Q_ARG(QString, column),
+                              Q_ARG(qint64, rowid.toLongLong()));
+}
+
+/*
+ * Ленивое значение прочитано. Если строку за это время
+ * удалили, показывать нечего.
+*/
+void SqliteReaderModel::onValueRead(int request, bool isRead, const QByteArray &value)
+{
+    if (request != value_request_ || !isRead) {
+        return;
+    }
+    emit valueReady(value_column_, is_value_text_ ? QVariant(QString::fromUtf8(value)) : QVariant(value));
+}
+
+/*
+ * Пользователь перестал печатать: обновление таблицы
+ * с учётом всех фильтров. Прошлый проход, если он ещё идёт,
+ * отменяется моделью таблицы.
+*/
+void SqliteReaderModel::onFiltersReady(const QStringList &filters)
+{
+    if (!is_open_ || filters.size() != filter_list_.size()) {
+        return;
+    }
+    filter_list_ = filters;
+    updateTable();
+}
+
+/*
+ * Включение и выключение индекса fts5 для фильтров.
+ * Пока индекс строится, фильтры работают без него.
+*/
+void SqliteReaderModel::setFilterIndexEnabled(bool isEnabled)
+{
+    is_filter_index_enabled_ = isEnabled;
+    if (!is_open_) {
+        return;
+    }
+    if (isEnabled) {
+        requestFilterIndex();
+        return;
+    }
+    filter_compiler_.setIndexed(false);
+    cancelFilterIndex();
+    QMetaObject::invokeMethod(worker_, "dropFilterIndex", Qt::QueuedConnection);
+    updateTable();
+}
+
+/*
+ * Выгрузка текущего запроса с фильтрами и сортировкой
+ * в файл path (format - SqliteExporter::Format).
+ * Выгрузчик открывает своё соединение и читает строки
+ * курсором, таблица и фильтры в это время работают дальше.
+ * Индекс fts5 и множества совпадений лежат во временных
+ * таблицах соединения исполнителя, поэтому фильтры
+ * компилируются без них. false, если выгружать нечего.
+*/
+bool SqliteReaderModel::exportTable(const QString &path, int format)
+{
+    if (!is_open_ || last_request_.isEmpty()) {
+        return false;
+    }
+    SqliteFilterCompiler compiler = filter_compiler_;
+    compiler.setIndexed(false);
+    compiler.setLazy(false);  //в файл значения выгружаются целиком
+    bool isKeyed = compiler.isKeyed(last_request_);
+    QVariantList values;
+    QString request = compiler.compile(last_request_, filter_list_, values);
+    SqliteSortOrder order = sort_order_;
+    order.setKey(isKeyed ? catalog_.key(table_) : "");
+    QVariantList pageValues;
+    request = order.pageRequest(request, values, QVariantList(), pageValues);
+    QMetaObject::invokeMethod(exporter, "exportRows", Qt::QueuedConnection,
+                              Q_ARG(int, exporter->queueExport()),
+                              Q_ARG(QString, path_),
+                              Q_ARG(SqliteConnectionProfile, profile_),
+                              Q_ARG(QString, request),
+                              Q_ARG(QVariantList, pageValues),
+                              Q_ARG(QStringList, db_columns_),
+                              Q_ARG(int, isKeyed ? 1 : 0),
+                              Q_ARG(int, format),
+                              Q_ARG(qint64, tableModel->dataRowCount()),
+                              Q_ARG(QString, path));
+    return true;
+}
+
+/*
+ * Отмена выгрузки. Выгрузчик занят в своём потоке,
+ * поэтому вызывается напрямую, а не через очередь.
+*/
+void SqliteReaderModel::cancelExport()
+{
+    exporter->cancel();
+}
+
+/*
+ * Построение индекса фильтров текущей таблицы. Прошлое
+ * построение, если оно ещё идёт, прерывается: индекс
+ * строится заново по всей таблице.
+*/
+void SqliteReaderModel::requestFilterIndex()
+{
+    cancelFilterIndex();
+    if ((!is_open_ && !is_opening_) || !is_filter_index_enabled_) {
+        return;
+    }
+    QMetaObject::invokeMethod(worker_, "buildFilterIndex", Qt::QueuedConnection,
+                              Q_ARG(int, index_request_),
+                              Q_ARG(QString, table_),
+                              Q_ARG(QStringList, db_columns_));
+}
+
+/*
+ * Отмена отложенного и идущего построения индекса фильтров
+*/
+void SqliteReaderModel::cancelFilterIndex()
+{
+    index_timer_->stop();
+    worker_->cancelIndexBefore(++index_request_);
+}
+
+/*
+ * Индекс построен (или не получилось). Ответы для
+ * другой таблицы или уже выключенного индекса пропускаются.
+*/
+void SqliteReaderModel::onFilterIndexReady(int request, const QString &table, bool isBuilt)
+{
+    if (request != index_request_ || !is_open_ || !is_filter_index_enabled_ || table != table_) {
+        return;
+    }
+    filter_compiler_.setIndexed(isBuilt);
+    if (!last_request_.isEmpty()) {
+        updateTable();
+    }
 }
 
 /*
- * Синхронизация бд с программой.
- * Выполняется по таймеру.
- * Создаются 2 двумерных списка строк
- * и сравниваются. Если занчения не совпадают, то
- * таблица обновляется.
+ * Синхронизация бд с программой по команде пользователя.
+ * Изменение применяется при любой политике проверок,
+ * в том числе найденное раньше, пока окно было скрыто.
 */
 void SqliteReaderModel::syncDatabase()
 {
-    if (!query_) {
+    if (!is_open_ || last_request_.isEmpty()) {
+        return;
+    }
+    is_sync_forced_ = true;
+    requestChanges();
+}
+
+/*
+ * Политика проверок изменений для открытой бд
+ * (policy - SqliteSyncScheduler::Policy). Запоминается
+ * для этого файла и применяется при следующем открытии.
+*/
+void SqliteReaderModel::setSyncPolicy(int policy, int interval)
+{
+    if (policy < SqliteSyncScheduler::Manual || policy > SqliteSyncScheduler::Event) {
+        return;
+    }
+    SqliteSyncScheduler::Policy syncPolicy = static_cast<SqliteSyncScheduler::Policy>(policy);
+    syncScheduler->setPolicy(syncPolicy, interval);
+    if (!path_.isEmpty()) {
+        SqliteSyncScheduler::storePolicy(path_, syncPolicy, interval);
+    }
+}
+
+/*
+ * Проверка по таймеру планировщика
+*/
+void SqliteReaderModel::onSyncRequested()
+{
+    if (!is_open_ || last_request_.isEmpty()) {
+        return;
+    }
+    requestChanges();
+}
+
+/*
+ * Исполнитель проверок дёшево проверяет data_version,
+ * размер и время изменения файлов и кадры WAL.
+ * Пока прошлая проверка в очереди, новая не ставится.
+*/
+void SqliteReaderModel::requestChanges()
+{
+    if (is_sync_pending_) {
+        return;
+    }
+    is_sync_pending_ = true;
+    QMetaObject::invokeMethod(sync_worker_, "checkChanges", Qt::QueuedConnection);
+}
+
+/*
+ * Таблица перечитывается только если бд действительно
+ * изменилась. Сюда же приходят проверки, запущенные
+ * наблюдателем файлов в потоке исполнителя.
+ * Пока окно скрыто или политика Manual, изменение
+ * только запоминается до следующей явной проверки.
+*/
+void SqliteReaderModel::onChangesChecked(bool isChanged)
+{
+    is_sync_pending_ = false;
+    syncScheduler->onChecked(isChanged);
+    bool isForced = is_sync_forced_;
+    is_sync_forced_ = false;
+    is_change_deferred_ = is_change_deferred_ || isChanged;
+    if (!is_change_deferred_ || !is_open_ || (!isForced && !syncScheduler->isActive())) {
+        return;
+    }
+    is_change_deferred_ = false;
+    filterScheduler->invalidate();  //сохранённые совпадения фильтров тоже устарели
+    profiles_.clear();  //профили колонок пересчитываются по запросу view
+    sidecar_.invalidate();
+    if (profile_scan_ != 0) {
+        parallel_scan_->cancel(profile_scan_);
+        profile_scan_ = 0;
+    }
+    emit profileInvalidated();
+    if (is_filter_index_enabled_) {
+        filter_compiler_.setIndexed(false);  //индекс устарел, до перестройки фильтры работают без него
+        cancelFilterIndex();
+        index_timer_->start();  //пока бд меняется, индекс не перестраивается
+    }
+    QMetaObject::invokeMethod(worker_, "checkCatalog", Qt::QueuedConnection,
+                              Q_ARG(qint64, catalog_.schemaVersion()));  //таблица перечитывается после проверки схемы
+}
+
+/*
+ * Изменения бд при неизменной схеме: перечитываются только
+ * изменённые строки или вся таблица.
+*/
+void SqliteReaderModel::applyChanges()
+{
+    if (isChangeTracked()) {
+        requestFingerprint();
+        return;
+    }
+    if (!last_request_.isEmpty()) {
+        updateTable();
+    }
+}
+
+/*
+ * Чтение больших значений таблицы лениво (по умолчанию,
+ * для view): в модели таблицы только их начало. Без view
+ * (командная строка, асинхронные запросы) значения часто
+ * нужны целиком, как при выгрузке. Действует со следующего
+ * обновления таблицы.
+*/
+void SqliteReaderModel::setLazyValues(bool isLazy)
+{
+    is_lazy_values_ = isLazy;
+}
+
+/*
+ * Отслеживание изменений по отпечаткам блоков rowid
+ * (SqliteChunkFingerprint) для таблиц с rowid: после изменения
+ * бд модель таблицы читает не всю таблицу, а только строки
+ * изменённых блоков и новые строки. С isAppendOnly таблица
+ * считается только растущей, и читаются только строки после
+ * прошлого максимального rowid. Включается до открытия таблицы.
+*/
+void SqliteReaderModel::setChangeTracking(bool isTracked, bool isAppendOnly)
+{
+    is_change_tracked_ = isTracked;
+    is_append_only_ = isAppendOnly;
+}
+
+/*
+ * Отпечатки текущей таблицы построены, и после следующего
+ * изменения бд в модели таблицы будут только изменённые строки
+*/
+bool SqliteReaderModel::isChangeTracked() const
+{
+    return is_change_tracked_ && fingerprint_.isValid() && fingerprint_.isFor(table_, db_columns_) &&
+           filter_compiler_.hasRowid() && last_request_ == filter_compiler_.tableRequest();
+}
+
+/*
+ * Модель таблицы запрошена только по диапазонам последних
+ * изменений, а не по всей таблице
+*/
+bool SqliteReaderModel::isChangesShown() const
+{
+    return is_changes_shown_ && isChangeTracked();
+}
+
+/*
+ * Строка с ключом key (rowid) новая или изменилась при
+ * последнем обновлении отпечатков. Точно по строке, если у
+ * исполнителя проверок есть хэши строк, иначе по блоку rowid.
+*/
+bool SqliteReaderModel::isRowChanged(const QVariant &key) const
+{
+    return isChangeTracked() && fingerprint_.isChanged(key.toLongLong());
+}
+
+/*
+ * Строка с ключом key уже учтена отпечатками: следующее
+ * обновление найдёт её, только если она изменится. Строки
+ * после максимального rowid отпечатков оно найдёт как новые.
+*/
+bool SqliteReaderModel::isRowTracked(const QVariant &key) const
+{
+    return isChangeTracked() && fingerprint_.hasRows() && key.toLongLong() <= fingerprint_.maxRowid();
+}
+
+/*
+ * Построение или обновление отпечатков текущей таблицы
+ * исполнителем проверок. Незаконченное прошлое обновление
+ * отменяется: новое начинается с тех же отпечатков и найдёт
+ * и его изменения.
+*/
+void SqliteReaderModel::requestFingerprint()
+{
+    if (!fingerprint_.isFor(table_, db_columns_)) {
+        fingerprint_.reset(table_, db_columns_);
+    }
+    sync_worker_->cancelBefore(++fingerprint_request_);
+    QMetaObject::invokeMethod(sync_worker_, "updateFingerprint", Qt::QueuedConnection,
+                              Q_ARG(int, fingerprint_request_),
+                              Q_ARG(SqliteChunkFingerprint, fingerprint_),
+                              Q_ARG(bool, is_append_only_));
+}
+
+/*
+ * Отпечатки обновлены: модель таблицы получает запрос только
+ * по изменённым диапазонам rowid, с теми же фильтрами. Если
+ * обновить отпечатки не удалось, таблица перечитывается целиком,
+ * а отпечатки строятся заново.
+ * Первый проход по таблице ждёт первых отпечатков: строки,
+ * добавленные после них, но до прохода, он прочитает, а
+ * следующее сравнение найдёт их ещё раз, так что ни одна
+ * строка не теряется (повторы отсекает тот, кто печатает).
+ * Если бы отпечатки строились после прохода, строки между
+ * ними не нашлись бы ни там, ни там.
+*/
+void SqliteReaderModel::onFingerprintReady(int request, const SqliteChunkFingerprint &fingerprint)
+{
+    if (request != fingerprint_request_ || !is_open_) {
         return;
     }
-    QSqlQuery query(db_);
-    try {
-        startRequest(query, last_request_);
-    } catch (UnreachableDBException e) {
-        emit dbUnreachable(e);
+    bool isBuilt = fingerprint_.isValid();
+    if (is_baseline_pending_) {
+        is_baseline_pending_ = false;
+        fingerprint_ = fingerprint.isValid() ? fingerprint : SqliteChunkFingerprint();
+        updateTable();
         return;
     }
-    QList<QStringList> dbCopyOld;
-    QList<QStringList> dbCopyNew;
-    fillListFromSqlQuery(dbCopyOld, *query_);
-    fillListFromSqlQuery(dbCopyNew, query);
-    bool isEqual = dbCopyNew.size() == dbCopyOld.size();
-    if (isEqual) {
-        for (int i = 0; i < dbCopyNew.size(); i++) {
-            isEqual = isEqual && (dbCopyNew[i] == dbCopyOld[i]);
+    if (!fingerprint.isValid()) {
+        fingerprint_ = SqliteChunkFingerprint();
+        if (isBuilt) {
+            updateTable();
+            requestFingerprint();
         }
+        return;
     }
-    if (!isEqual) {
-        dbCopyOld.clear();
-        try {
-            startRequest(*query_, last_request_);
-        } catch (UnreachableDBException e) {
-            emit dbUnreachable(e);
-            return;
+    fingerprint_ = fingerprint;
+    if (!isBuilt || fingerprint_.changes().isEmpty()) {
+        return;
+    }
+    QVariantList values;
+    QString changed = filter_compiler_.rangeRequest(filter_list_, values, fingerprint_.changes());
+    SqliteSortOrder order = sort_order_;
+    order.setKey(catalog_.key(table_));
+    is_changes_shown_ = true;
+    setTableRequest(changed, values, 1, order);
+}
+
+/*
+ * План запроса консоли: запрос только готовится,
+ * строки не читаются. Придёт в consolePlanReady.
+*/
+void SqliteReaderModel::planConsoleQuery(const QString &request)
+{
+    if (!is_open_) {
+        emit consoleFailed("No database is open");
+        return;
+    }
+    QMetaObject::invokeMethod(console_worker_, "planQuery", Qt::QueuedConnection,
+                              Q_ARG(int, ++console_plan_),
+                              Q_ARG(QString, request));
+}
+
+/*
+ * Выполнение запроса консоли в пределах бюджета строк
+ * и байт. Прошлый запрос консоли, если он ещё идёт,
+ * прерывается. Строки придут в consoleRowsReady по мере
+ * чтения, конец - в consoleFinished или consoleFailed.
+*/
+void SqliteReaderModel::runConsoleQuery(const QString &request, qint64 rowBudget, qint64 byteBudget)
+{
+    if (!is_open_) {
+        emit consoleFailed("No database is open");
+        return;
+    }
+    console_worker_->cancelBefore(++console_query_);
+    is_console_running_ = true;
+    QMetaObject::invokeMethod(console_worker_, "runQuery", Qt::QueuedConnection,
+                              Q_ARG(int, console_query_),
+                              Q_ARG(QString, request),
+                              Q_ARG(qint64, rowBudget),
+                              Q_ARG(qint64, byteBudget));
+}
+
+void SqliteReaderModel::cancelConsoleQuery()
+{
+    console_worker_->cancelBefore(++console_query_);
+    is_console_running_ = false;
+}
+
+/*
+ * Полным проходам по таблицам бд добавляется оценка
+ * строк из каталога: по ней видно, насколько тяжёл запрос
+*/
+void SqliteReaderModel::onConsolePlanReady(int generation, const SqliteQueryPlan &plan)
+{
+    if (generation != console_plan_) {
+        return;
+    }
+    SqliteQueryPlan estimated = plan;
+    for (int i = 0; i < estimated.stepCount(); i++) {
+        QString table = estimated.scannedTable(i);
+        if (!table.isEmpty() && catalog_.contains(table)) {
+            estimated.setRows(i, catalog_.rowEstimate(table));
         }
-        QStringList emptyList;
-        emit queryReady(dbCopyNew, emptyList);
     }
+    emit consolePlanReady(estimated);
 }
 
-SqliteReaderModel::~SqliteReaderModel()
+void SqliteReaderModel::onConsoleStarted(int generation, const QStringList &columns)
+{
+    if (generation == console_query_) {
+        emit consoleStarted(columns);
+    }
+}
+
+void SqliteReaderModel::onConsoleRows(int generation, int offset, const SqliteResultBlock &rows)
+{
+    Q_UNUSED(offset);
+    if (generation == console_query_) {
+        emit consoleRowsReady(rows);
+    }
+}
+
+void SqliteReaderModel::onConsoleFinished(int generation, qint64 rows, qint64 bytes, bool isTruncated)
+{
+    if (generation == console_query_) {
+        is_console_running_ = false;
+        emit consoleFinished(rows, bytes, isTruncated);
+    }
+}
+
+void SqliteReaderModel::onConsoleFailed(int generation, const QString &error)
+{
+    if (generation == console_query_) {
+        is_console_running_ = false;
+        emit consoleFailed(error);
+    }
+}
+
+/*
+ * Ошибка бд: начатые асинхронные запросы заканчиваются
+ * с её текстом, остальные выполнятся уже без бд
+*/
+void SqliteReaderModel::onWorkerError(const DBException &e)
+{
+    failAsync(e.exceptionText);
+    clearModel();
+    emit dbUnreachable(e);
+}
+
+/*
+ * Асинхронные запросы. Их можно вызывать из любого потока:
+ * запрос кладётся в очередь под мьютексом, а выполняет его
+ * модель в своём потоке по порядку прихода. Результат - страница
+ * строк (SqliteResultPage), которая соответствует состоянию
+ * таблицы после запроса, ошибка тоже приходит результатом.
+ * Прогресс - этапы запроса, future можно отменить.
+ * openAsync открывает бд и возвращает первую страницу таблицы
+ * table (или первой таблицы бд).
+*/
+QFuture<SqliteResultPage> SqliteReaderModel::openAsync(const QString &path, const SqliteConnectionProfile &profile,
+                                                       const QString &table)
+{
+    AsyncRequest *request = new AsyncRequest();
+    request->kind = AsyncRequest::Open;
+    request->path = path;
+    request->profile = profile;
+    request->text = table;
+    return enqueueAsync(request);
+}
+
+/*
+ * Запрос к открытой бд, как makeRequest. Результат -
+ * первая страница его строк.
+*/
+QFuture<SqliteResultPage> SqliteReaderModel::queryAsync(const QString &request)
+{
+    AsyncRequest *async = new AsyncRequest();
+    async->kind = AsyncRequest::Query;
+    async->text = request;
+    return enqueueAsync(async);
+}
+
+/*
+ * Фильтр колонки column применяется сразу, без паузы
+ * планировщика. Результат - первая страница строк под все фильтры.
+*/
+QFuture<SqliteResultPage> SqliteReaderModel::filterAsync(int column, const QString &filter)
+{
+    AsyncRequest *request = new AsyncRequest();
+    request->kind = AsyncRequest::Filter;
+    request->column = column;
+    request->text = filter;
+    return enqueueAsync(request);
+}
+
+/*
+ * Страница page (по PAGE_SIZE строк модели таблицы) текущего
+ * запроса после всех асинхронных запросов, пришедших раньше
+*/
+QFuture<SqliteResultPage> SqliteReaderModel::fetchPageAsync(int page)
+{
+    AsyncRequest *request = new AsyncRequest();
+    request->kind = AsyncRequest::Page;
+    request->page = page;
+    return enqueueAsync(request);
+}
+
+QFuture<SqliteResultPage> SqliteReaderModel::enqueueAsync(AsyncRequest *request)
+{
+    request->future.reportStarted();
+    request->future.setProgressRange(0, 2);
+    QFuture<SqliteResultPage> future = request->future.future();
+    async_mutex_.lock();
+    incoming_async_.append(request);
+    async_mutex_.unlock();
+    QMetaObject::invokeMethod(this, "startAsync", Qt::QueuedConnection);
+    return future;
+}
+
+/*
+ * Приём пришедших асинхронных запросов в потоке модели
+ * и запуск ещё не начатых. Запрос, который ждёт открытия бд,
+ * задерживает и все следующие, чтобы они выполнялись по порядку.
+*/
+void SqliteReaderModel::startAsync()
 {
-    delete timer;
-    if (db_.isOpen()) {
-        db_.close();
+    async_mutex_.lock();
+    QList<AsyncRequest *> incoming = incoming_async_;
+    incoming_async_.clear();
+    async_mutex_.unlock();
+    for (AsyncRequest *request : incoming) {
+        request->watcher = new QFutureWatcher<SqliteResultPage>();
+        QObject::connect(request->watcher, SIGNAL(canceled()),
+                         this, SLOT(onAsyncCanceled()));
+        request->watcher->setFuture(request->future.future());
+        async_requests_.append(request);
+        if (request->future.isCanceled()) {  //отменён до того, как watcher начал следить
+            finishAsync(request, SqliteResultPage::failure("Canceled"));
+        }
     }
-    if (query_) {
-        delete query_;
+    QList<AsyncRequest *> requests = async_requests_;
+    for (AsyncRequest *request : requests) {
+        if (request->state < 0 && !runAsync(request)) {
+            break;
+        }
+    }
+    resolveAsync();
+}
+
+/*
+ * Запуск асинхронного запроса: его изменение таблицы
+ * получает следующий номер (table_state_). false, если бд
+ * ещё открывается или исполнитель ещё проверяет запрос
+ * queryAsync, и запрос должен подождать. Запрос, который
+ * не может выполниться, сразу заканчивается ошибкой.
+*/
+bool SqliteReaderModel::runAsync(AsyncRequest *request)
+{
+    if (is_opening_) {
+        return false;
+    }
+    if (request->kind == AsyncRequest::Open) {
+        connectToDatabase(request->path, request->profile, request->text);  //прошлые запросы закрываются с ошибкой
+        request->state = ++table_state_;
+        request->future.setProgressValueAndText(1, "Opening the database");
+        QString query = "select * from {}";
+        makeRequest(query);  //выполнится, когда откроется таблица
+        return true;
+    }
+    if (!is_open_) {
+        finishAsync(request, SqliteResultPage::failure("No database is open"));
+        return true;
+    }
+    switch (request->kind) {
+    case AsyncRequest::Query: {
+        if (!request->isChecked) {  //запрос сначала готовит исполнитель, ответ в onQueryChecked
+            if (request->check == 0) {
+                request->check = ++query_check_;
+                QString query = request->text;
+                query.replace("{}", SqliteFilterCompiler::quoteIdentifier(table_));
+                QMetaObject::invokeMethod(worker_, "checkQuery", Qt::QueuedConnection,
+                                          Q_ARG(int, request->check),
+                                          Q_ARG(QString, query));
+            }
+            return false;
+        }
+        request->state = ++table_state_;
+        QString query = request->text;
+        makeRequest(query);
+        break;
+    }
+    case AsyncRequest::Filter:
+        if (request->column < 0 || request->column >= filter_list_.size()) {
+            finishAsync(request, SqliteResultPage::failure("No such column"));
+            return true;
+        }
+        request->state = ++table_state_;
+        filterScheduler->changeFilter(request->column, request->text);
+        filterScheduler->flush();
+        break;
+    default:
+        if (request->page < 0) {
+            finishAsync(request, SqliteResultPage::failure("No such page"));
+            return true;
+        }
+        request->state = table_state_;
+        break;
+    }
+    request->future.setProgressValueAndText(1, "Reading rows");
+    return true;
+}
+
+/*
+ * Исполнитель подготовил запрос queryAsync. Запрос с ошибкой
+ * заканчивается её текстом, бд остаётся открытой, и очередь
+ * идёт дальше. Ответ на отменённый запрос только продолжает очередь.
+*/
+void SqliteReaderModel::onQueryChecked(int check, const QString &error)
+{
+    for (AsyncRequest *request : async_requests_) {
+        if (request->check != check) {
+            continue;
+        }
+        if (error.isEmpty()) {
+            request->isChecked = true;
+        } else {
+            finishAsync(request, SqliteResultPage::failure(error));
+        }
+        break;
+    }
+    startAsync();
+}
+
+/*
+ * Завершение асинхронных запросов, изменения которых уже
+ * прочитала модель таблицы и страницы которых уже пришли.
+ * Запрос, который успел смениться следующим, получает
+ * страницу уже после следующего: она включает и его изменение.
+*/
+void SqliteReaderModel::resolveAsync()
+{
+    QList<AsyncRequest *> requests = async_requests_;
+    for (AsyncRequest *request : requests) {
+        if (request->state < 0 || request->state > refreshed_state_ ||
+                !tableModel->isPageLoaded(request->page)) {
+            continue;
+        }
+        int firstRow = request->page * tableModel->PAGE_SIZE;
+        finishAsync(request, SqliteResultPage(db_columns_, firstRow, tableModel->dataRowCount(),
+                                              tableModel->pageRows(request->page), tableModel->keyColumns()));
+    }
+}
+
+/*
+ * Модель таблицы прочитала запрос, поставленный последним
+*/
+void SqliteReaderModel::onTableRefreshed()
+{
+    refreshed_state_ = requested_state_;
+    resolveAsync();
+}
+
+void SqliteReaderModel::onPageReady(int page)
+{
+    Q_UNUSED(page)
+    resolveAsync();
+}
+
+/*
+ * Future асинхронного запроса отменили. Запрос больше не
+ * ждёт результата, а отменённое открытие бд закрывает её.
+ * Уже применённые запрос и фильтр не откатываются.
+*/
+void SqliteReaderModel::onAsyncCanceled()
+{
+    AsyncRequest *canceled = nullptr;
+    for (AsyncRequest *request : async_requests_) {
+        if (request->watcher == sender()) {
+            canceled = request;
+        }
+    }
+    if (!canceled) {
+        return;
+    }
+    bool isOpening = canceled->kind == AsyncRequest::Open && canceled->state >= 0 && is_opening_;
+    finishAsync(canceled, SqliteResultPage::failure("Canceled"));
+    if (isOpening) {
+        clearModel();
+    }
+}
+
+/*
+ * Конец асинхронного запроса с результатом page.
+ * У отменённого future результат не сохраняется.
+*/
+void SqliteReaderModel::finishAsync(AsyncRequest *request, const SqliteResultPage &page)
+{
+    async_requests_.removeOne(request);
+    if (!request->future.isCanceled()) {
+        request->future.setProgressValue(2);
+        request->future.reportResult(page);
+    }
+    request->future.reportFinished();
+    if (request->watcher) {
+        request->watcher->deleteLater();  //может вызываться из его же сигнала
+    }
+    delete request;
+}
+
+/*
+ * Все начатые асинхронные запросы заканчиваются ошибкой error,
+ * ещё не начатые остаются в очереди
+*/
+void SqliteReaderModel::failAsync(const QString &error)
+{
+    QList<AsyncRequest *> requests = async_requests_;
+    for (AsyncRequest *request : requests) {
+        if (request->state >= 0) {
+            finishAsync(request, SqliteResultPage::failure(error));
+        }
+    }
+}
+
+SqliteReaderModel::~SqliteReaderModel()
+{
+    async_mutex_.lock();
+    async_requests_.append(incoming_async_);
+    incoming_async_.clear();
+    async_mutex_.unlock();
+    while (!async_requests_.isEmpty()) {
+        finishAsync(async_requests_.first(), SqliteResultPage::failure("The database was closed"));
     }
+    saveCache();
+    delete syncScheduler;
+    exporter->cancel();
+    parallel_scan_->cancelBefore(INT_MAX);
+    worker_->cancelBefore(INT_MAX);
+    console_worker_->cancelBefore(INT_MAX);
+    QMetaObject::invokeMethod(worker_, "close", Qt::BlockingQueuedConnection);
+    QMetaObject::invokeMethod(sync_worker_, "close", Qt::BlockingQueuedConnection);
+    QMetaObject::invokeMethod(console_worker_, "close", Qt::BlockingQueuedConnection);
+    worker_thread_->quit();
+    worker_thread_->wait();
+    delete worker_thread_;
+    sync_thread_->quit();
+    sync_thread_->wait();
+    delete sync_thread_;
+    console_thread_->quit();
+    console_thread_->wait();
+    delete console_thread_;
+    export_thread_->quit();
+    export_thread_->wait();
+    delete export_thread_;
+    scan_thread_->quit();
+    scan_thread_->wait();
+    delete scan_thread_;
+    delete tableModel;
+    delete filterScheduler;
+    delete index_timer_;
+    delete profiler;
 }
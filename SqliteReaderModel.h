@@ -2,48 +2,241 @@
 #define SQLITEREADERMODEL_H
 
 #include <QObject>
-#include <QtSql/QSqlDatabase>
-#include <QSqlQuery>
-#include <QSqlRecord>
+#include <QThread>
 #include <QMap>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QTimer>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QFutureWatcher>
 #include <QString>
 #include <QVariant>
-#include <QTimer>
+#include <QRegularExpression>
+
+#include <climits>
 
 #include "DBException.h"
 #include "UnsupportedDBException.h"
 #include "UnreachableDBException.h"
+#include "SqliteReaderWorker.h"
+#include "SqliteFilterCompiler.h"
+#include "SqliteFilterScheduler.h"
+#include "SqliteSchemaCatalog.h"
+#include "SqliteConnectionProfile.h"
+#include "SqliteTableModel.h"
+#include "SqliteProfiler.h"
+#include "SqliteSortOrder.h"
+#include "SqliteExporter.h"
+#include "SqliteSyncScheduler.h"
+#include "SqliteParallelScan.h"
+#include "SqliteScanSummary.h"
+#include "SqliteSidecarCache.h"
+#include "SqliteChunkFingerprint.h"
+#include "SqliteResultPage.h"
 
 class SqliteReaderModel : public QObject
 {
     Q_OBJECT
 
 public:
+    const qint64 PARALLEL_ROWS = 1000000;  //строк в таблице, начиная с которых фильтры ищет параллельный проход
+    const int INDEX_DELAY = 2000;  //мс без изменений бд, после которых перестраивается индекс фильтров
     SqliteReaderModel();
-    void fillListFromSqlQuery(QList<QStringList> &dbCopy, QSqlQuery &query);
+    QString filteredRequest(QVariantList &values) const;
+    void updateTable();
     void clearModel();
-    void startRequest(QSqlQuery &query, const QString &request);
+    QString currentTable() const;
+    void setChangeTracking(bool isTracked, bool isAppendOnly = false);
+    bool isChangeTracked() const;
+    bool isChangesShown() const;
+    bool isRowChanged(const QVariant &key) const;
+    bool isRowTracked(const QVariant &key) const;
+    void setLazyValues(bool isLazy);
+    QFuture<SqliteResultPage> openAsync(const QString &path,
+                                        const SqliteConnectionProfile &profile = SqliteConnectionProfile::viewer(),
+                                        const QString &table = "");
+    QFuture<SqliteResultPage> queryAsync(const QString &request);
+    QFuture<SqliteResultPage> filterAsync(int column, const QString &filter);
+    QFuture<SqliteResultPage> fetchPageAsync(int page);
     virtual ~SqliteReaderModel();
-    QTimer *timer;
-    const int SYNC_TIME = 1000;  //время через которое бд синхронизируется с приложением.
+    SqliteSyncScheduler *syncScheduler;
+    SqliteTableModel *tableModel;
+    SqliteFilterScheduler *filterScheduler;
+    SqliteProfiler *profiler;
+    SqliteExporter *exporter;  //живёт в своём потоке, сигналы о выгрузке приходят через очередь
 
 public slots:
-    void connectToDatabase(const QString &path);
+    void connectToDatabase(const QString &path,
+                           const SqliteConnectionProfile &profile = SqliteConnectionProfile::viewer(),
+                           const QString &table = "");
     void makeRequest(QString &request);
+    void selectTable(const QString &table);
     void syncDatabase();
+    void setSyncPolicy(int policy, int interval = -1);
     void changeFilter(int column, const QString &filter);
+    void changeSort(int column, Qt::SortOrder order);
+    void setFilterIndexEnabled(bool isEnabled);
+    bool exportTable(const QString &path, int format);
+    void cancelExport();
+    void openValue(const QModelIndex &index);
+    bool summarizeTable();
+    bool profileColumns();
+    void planConsoleQuery(const QString &request);
+    void runConsoleQuery(const QString &request, qint64 rowBudget, qint64 byteBudget);
+    void cancelConsoleQuery();
+    void setSidecarCacheEnabled(bool isEnabled);
 
 signals:
-    void queryReady(const QList<QStringList> &db, const QStringList &dbColumns);
+    void queryReady(const QStringList &dbColumns);
+    void valueReady(const QString &column, const QVariant &value);
+    void summaryReady(const SqliteScanSummary &summary);
+    void summaryFailed(const QString &error);
+    void profileReady(const QString &table, const QStringList &columns, const SqliteScanSummary &profile);
+    void profileInvalidated();
+    void consolePlanReady(const SqliteQueryPlan &plan);
+    void consoleStarted(const QStringList &columns);
+    void consoleRowsReady(const SqliteResultBlock &rows);
+    void consoleFinished(qint64 rows, qint64 bytes, bool isTruncated);
+    void consoleFailed(const QString &error);
+    void catalogReady(const SqliteSchemaCatalog &catalog);
+    void tableFailed(const QString &table, const QString &error);
     void dbUnreachable(const DBException &e);
 
+private slots:
+    void onOpened(const QString &path, const SqliteSchemaCatalog &catalog);
+    void onColumnsLoaded(const QString &table, const QStringList &columns, const QString &key);
+    void onColumnsFailed(const QString &table, const QString &error);
+    void onCatalogChecked(bool isChanged, const SqliteSchemaCatalog &catalog);
+    void onSyncRequested();
+    void onChangesChecked(bool isChanged);
+    void onFiltersReady(const QStringList &filters);
+    void onFilterIndexReady(int request, const QString &table, bool isBuilt);
+    void onMatchesFailed(int generation);
+    void onQueryPlanReady(int generation, const QStringList &plan);
+    void onValueRead(int request, bool isRead, const QByteArray &value);
+    void onScanned(int request, const SqliteScanSummary &summary, const QVector<qint64> &keys);
+    void onScanFailed(int request, const QString &error);
+    void onConsolePlanReady(int generation, const SqliteQueryPlan &plan);
+    void onConsoleStarted(int generation, const QStringList &columns);
+    void onConsoleRows(int generation, int offset, const SqliteResultBlock &rows);
+    void onConsoleFinished(int generation, qint64 rows, qint64 bytes, bool isTruncated);
+    void onConsoleFailed(int generation, const QString &error);
+    void onFingerprintReady(int request, const SqliteChunkFingerprint &fingerprint);
+    void onWorkerError(const DBException &e);
+    void requestFilterIndex();
+    void startAsync();
+    void onTableRefreshed();
+    void onPageReady(int page);
+    void onAsyncCanceled();
+    void onQueryChecked(int check, const QString &error);
+
 private:
-    QSqlDatabase db_;
-    QSqlQuery *query_ = nullptr;
+    /*
+     * Асинхронный запрос. state - номер изменения таблицы,
+     * после которого его страница готова, -1 пока запрос
+     * не начат (например ждёт открытия бд). Future и watcher
+     * живут, пока запрос не закончен.
+    */
+    struct AsyncRequest
+    {
+        enum Kind {Open, Query, Filter, Page};
+        Kind kind = Page;
+        QString path = "";  //для Open
+        SqliteConnectionProfile profile;
+        QString text = "";  //таблица для Open, запрос для Query, фильтр для Filter
+        int column = 0;  //колонка для Filter
+        int page = 0;  //страница результата
+        int check = 0;  //номер проверки запроса Query исполнителем, 0 - ещё не отправлен
+        bool isChecked = false;  //запрос Query подготовлен без ошибок
+        int state = -1;
+        QFutureInterface<SqliteResultPage> future;
+        QFutureWatcher<SqliteResultPage> *watcher = nullptr;
+    };
+
+    void applyTable(const QString &table);
+    void cancelFilterIndex();
+    void requestChanges();
+    void applyChanges();
+    void explainSort();
+    void keepMatches(int source);
+    bool isParallelScan() const;
+    void cancelScans();
+    void cancelFilterScans();
+    bool showCached();
+    void validateCached(const SqliteSchemaCatalog &catalog);
+    void rememberTable();
+    void saveCache();
+    void requestFingerprint();
+    void setTableRequest(const QString &request, const QVariantList &values, int keyColumns,
+                         const SqliteSortOrder &order);
+    QFuture<SqliteResultPage> enqueueAsync(AsyncRequest *request);
+    bool runAsync(AsyncRequest *request);
+    void resolveAsync();
+    void finishAsync(AsyncRequest *request, const SqliteResultPage &page);
+    void failAsync(const QString &error);
+
+    QThread *worker_thread_;
+    SqliteReaderWorker *worker_;  //чтение таблицы, фильтры и их временные таблицы
+    QThread *sync_thread_;
+    SqliteReaderWorker *sync_worker_;  //проверки изменений бд на своём соединении
+    QThread *console_thread_;
+    SqliteReaderWorker *console_worker_;  //запросы консоли SQL на своём соединении
+    QThread *export_thread_;
+    QThread *scan_thread_;
+    SqliteParallelScan *parallel_scan_;  //поиск по фильтрам и сводки на всех ядрах
+    QString path_ = "";  //путь к бд, которую сейчас открывает или держит исполнитель
+    SqliteConnectionProfile profile_;  //настройки, с которыми открыта бд
+    bool is_opening_ = false;  //исполнитель ещё открывает бд
+    bool is_open_ = false;
+    bool is_sync_pending_ = false;  //проверка изменений уже в очереди исполнителя
+    bool is_sync_forced_ = false;  //результат проверки применяется, даже если планировщик не активен
+    bool is_change_deferred_ = false;  //найденное изменение ещё не применено (окно скрыто или политика Manual)
+    QString pending_request_ = "";  //запрос, пришедший до окончания открытия бд
     QString last_request_ = "";  //последний запрос к бд. Сбрасывается при изменении бд.
-    QStringList db_tables_;
+    SqliteSchemaCatalog catalog_;
+    QString table_ = "";  //открытая таблица или представление
+    QString pending_table_ = "";  //таблица, колонки которой загружает исполнитель
+    QString start_table_ = "";  //таблица, которая открывается первой, пустая - первая в каталоге
+    QString table_key_ = "";  //ключ строк открытой таблицы
+    QStringList failed_tables_;  //таблицы, колонки которых не прочитались, до изменения схемы
     QStringList db_columns_;
     QStringList filter_list_;
+    SqliteFilterCompiler filter_compiler_;
+    bool is_filter_index_enabled_ = false;  //пользователь включил индекс fts5 для фильтров
+    QTimer *index_timer_;  //откладывает перестройку индекса фильтров после изменений бд
+    int index_request_ = 0;  //номер последнего построения индекса фильтров, старые отменяются
+    bool is_lazy_values_ = true;  //большие значения читаются только началом (см. SqliteFilterCompiler::setLazy)
+    SqliteSortOrder sort_order_;  //сортировка по клику на хедер, без ключа строки
+    int sort_plan_generation_ = 0;  //номер последнего запроса плана сортировки
+    int value_request_ = 0;  //номер последнего чтения значения целиком
+    QString value_column_ = "";  //колонка значения, которое читает исполнитель
+    bool is_value_text_ = false;  //значение, которое читает исполнитель, - текст
+    int scan_request_ = 0;  //номер последнего запроса параллельного прохода
+    int filter_scan_ = 0;  //проход, который ищет строки под текущие фильтры, 0 если его нет
+    int summary_scan_ = 0;  //проход, который считает сводку по таблице, 0 если его нет
+    int profile_scan_ = 0;  //проход, который считает профиль колонок таблицы, 0 если его нет
+    QString profile_table_ = "";  //таблица, профиль которой считает profile_scan_
+    int console_plan_ = 0;  //номер последнего запроса плана консоли
+    int console_query_ = 0;  //номер последнего запроса консоли, старые отменяются
+    bool is_console_running_ = false;  //запрос console_query_ ещё выполняется
+    QHash<QString, SqliteScanSummary> profiles_;  //профили колонок таблиц без фильтров, до изменения бд
+    SqliteSidecarCache sidecar_;  //кэш бд на диске, пустой путь - выключен
+    bool is_cache_shown_ = false;  //таблица показана из кэша, исполнитель ещё открывает бд
+    bool is_change_tracked_ = false;  //после изменения бд читаются только изменённые строки
+    bool is_append_only_ = false;  //таблица только растёт, старые строки не сравниваются
+    SqliteChunkFingerprint fingerprint_;  //отпечатки блоков rowid текущей таблицы
+    int fingerprint_request_ = 0;  //номер последнего обновления отпечатков, старые отменяются
+    bool is_baseline_pending_ = false;  //первые отпечатки таблицы строятся, таблица читается после них
+    bool is_changes_shown_ = false;  //в модели таблицы только строки последних изменений (см. onFingerprintReady)
+    QMutex async_mutex_;  //защищает incoming_async_, остальное - только в потоке модели
+    QList<AsyncRequest *> incoming_async_;  //асинхронные запросы из любых потоков, ещё не принятые моделью
+    QList<AsyncRequest *> async_requests_;  //принятые асинхронные запросы по порядку прихода
+    int table_state_ = 0;  //номер последнего изменения таблицы асинхронным запросом
+    int requested_state_ = 0;  //изменение, которому соответствует запрос модели таблицы
+    int refreshed_state_ = 0;  //изменение, которому соответствуют строки модели таблицы
+    int query_check_ = 0;  //номер последней проверки запроса queryAsync
 };
 
 #endif // SQLITEREADERMODEL_H
@@ -3,10 +3,10 @@
 SqliteReaderView::SqliteReaderView(QWidget *parent)
     : QWidget(parent)
 {
-    table = new QTableWidget();
+    table = new QTableView();
     controller = new SqliteReaderController();
     model = new SqliteReaderModel();
-    verticalHeaderLabels = new QStringList;
+    table->setModel(model->tableModel);
     initWindow();
     initWindowElements();
     makeConnections();
@@ -39,17 +39,74 @@ void SqliteReaderView::initWindow()
  * -создаёт grid layout и верхнее меню
  * -в лэйаут заносится таблица и верхнее меню
  * -в верхнее меню добавляется всплывающее меню File,
- * в котором есть 2 пункта (выход и открыть файл)
+ * в котором есть пункты: открыть файл, выгрузка таблицы,
+ * консоль SQL, кэш на диске для быстрого повторного открытия и выход
+ * -меню Table со списком таблиц и представлений бд
+ * -меню Filter с переключателем индекса fts5 для фильтров
+ * и панелью статистики колонок справа от таблицы
+ * -меню Sync: проверка изменений бд сейчас и политика проверок
+ * для открытой бд
+ * -и меню Profile: строка замеров под таблицей и выгрузка
+ * трассы в формате Chrome trace
 */
 void SqliteReaderView::initWindowElements()
 {
     gridLayout = new QGridLayout();
     fileMenu = new QMenu("File");
     fileMenu->addAction("Open", this, SLOT(selectFile()), Qt::CTRL + Qt::Key_O);
+    fileMenu->addAction("Export...", this, SLOT(exportTable()), Qt::CTRL + Qt::Key_E);
+    fileMenu->addAction("SQL console...", this, SLOT(openConsole()), Qt::CTRL + Qt::Key_L);
+    cacheAction = fileMenu->addAction("Cache for fast reopen");
+    cacheAction->setCheckable(true);
+    cacheAction->setChecked(SqliteSidecarCache::isEnabled());
     fileMenu->addAction("Quit", this, SLOT(close()), Qt::CTRL + Qt::Key_Q);
+    tableMenu = new QMenu("Table");
+    tableMenu->setToolTipsVisible(true);
+    tableGroup = new QActionGroup(tableMenu);
+    filterMenu = new QMenu("Filter");
+    filterIndexAction = filterMenu->addAction("Substring index (FTS5)");
+    filterIndexAction->setCheckable(true);
+    statsAction = filterMenu->addAction("Column statistics");
+    statsAction->setShortcut(Qt::CTRL + Qt::Key_I);
+    statsAction->setCheckable(true);
+    syncMenu = new QMenu("Sync");
+    syncMenu->addAction("Sync now", model, SLOT(syncDatabase()), Qt::Key_F5);
+    syncMenu->addSeparator();
+    syncGroup = new QActionGroup(syncMenu);
+    QAction *manualAction = syncMenu->addAction("Manual");
+    manualAction->setData(SqliteSyncScheduler::Manual);
+    QAction *intervalAction = syncMenu->addAction("Poll with backoff");
+    intervalAction->setData(SqliteSyncScheduler::Interval);
+    QAction *eventAction = syncMenu->addAction("On file change");
+    eventAction->setData(SqliteSyncScheduler::Event);
+    for (QAction *action : {manualAction, intervalAction, eventAction}) {
+        action->setCheckable(true);
+        syncGroup->addAction(action);
+    }
+    updateSyncMenu();
+    profileMenu = new QMenu("Profile");
+    overlayAction = profileMenu->addAction("Performance overlay");
+    overlayAction->setCheckable(true);
+    profileMenu->addAction("Export trace...", this, SLOT(exportTrace()));
+    overlayLabel = new QLabel();  //строка замеров, видна только вместе с замерами
+    overlayLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    overlayLabel->hide();
+    overlayTimer = new QTimer();
+    overlayTimer->setInterval(OVERLAY_TIME);
+    profileTimer = new QTimer();  //откладывает пересчёт профиля, пока бд меняется
+    profileTimer->setSingleShot(true);
+    profileTimer->setInterval(PROFILE_DELAY);
+    statsPanel = new SqliteColumnStatsPanel();  //панель статистики, видна только по меню Filter
+    statsPanel->hide();
     menuBar = new QMenuBar();  //верхнее меню
     menuBar->addMenu(fileMenu);
-    gridLayout->addWidget(table);
+    menuBar->addMenu(tableMenu);
+    menuBar->addMenu(filterMenu);
+    menuBar->addMenu(syncMenu);
+    menuBar->addMenu(profileMenu);
+    gridLayout->addWidget(table, 0, 0);
+    gridLayout->addWidget(statsPanel, 0, 1, 2, 1);
+    gridLayout->addWidget(overlayLabel, 1, 0);
     gridLayout->setMenuBar(menuBar);
     gridLayout->setSpacing(0);
     gridLayout->setMargin(0);
@@ -62,19 +119,17 @@ void SqliteReaderView::initWindowElements()
  * которому прописывается какой колонке он соответствует.
  * Каждый фильтр связывается со слотом в контроллере, который будет
  * реагировать на изменения.
+ * Клик по хедеру сортирует таблицу запросом к бд, в подсказке
+ * хедера видно, помогает ли сортировке индекс.
 */
 void SqliteReaderView::initTable(const QStringList &columns)
 {
-    table->clear();
-    table->setRowCount(0);
-    table->setColumnCount(columns.size());
     table->setShowGrid(true);
     table->setSelectionMode(QAbstractItemView::SingleSelection);
     table->setSelectionBehavior(QAbstractItemView::SelectColumns);
-    table->setHorizontalHeaderLabels(columns);
     table->horizontalHeader()->setMinimumSectionSize(110);
-    table->horizontalHeader()->sortIndicatorOrder();
-    table->insertRow(table->rowCount());
+    table->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);  //новая таблица не отсортирована
+    table->setSortingEnabled(true);  //клик по хедеру сортирует через sqlite
     for(int i = 0; i < columns.size(); i++) {
         QLineEdit *line = new QLineEdit();
         line->setClearButtonEnabled(true);
@@ -84,9 +139,8 @@ void SqliteReaderView::initTable(const QStringList &columns)
         QObject::connect(line, SIGNAL(textEdited(const QString &)),
                          controller, SLOT(onTextChanged(const QString &)));
 
-        table->setCellWidget(0, i, line);
+        table->setIndexWidget(model->tableModel->index(0, i), line);
     }
-    table->setVerticalHeaderLabels(*verticalHeaderLabels);
 }
 
 /*
@@ -116,11 +170,22 @@ void SqliteReaderView::makeConnections()
                      model, SLOT(makeRequest(QString &)));
 
     /*
-     * Модель на основе фильтров и данных из бд создаёт двумерный лист строк
-     * и отпрвляет его в вид для отображения в таблице.
+     * Модель сообщает, что таблица готова и какие в ней колонки.
+     * Сами строки таблица берёт из model->tableModel по мере прокрутки.
     */
-    QObject::connect(model, SIGNAL(queryReady(const QList<QStringList> &, const QStringList &)),
-                     this, SLOT(fillTable(const QList<QStringList> &, const QStringList &)));
+    QObject::connect(model, SIGNAL(queryReady(const QStringList &)),
+                     this, SLOT(fillTable(const QStringList &)));
+
+    /*
+     * Модель прочитала каталог схемы, по нему строится меню Table.
+     * Выбранная в меню таблица открывается без переоткрытия бд.
+    */
+    QObject::connect(model, SIGNAL(catalogReady(const SqliteSchemaCatalog &)),
+                     this, SLOT(fillTableMenu(const SqliteSchemaCatalog &)));
+    QObject::connect(tableMenu, SIGNAL(triggered(QAction *)),
+                     controller, SLOT(onTableTriggered(QAction *)));
+    QObject::connect(controller, SIGNAL(tableSelected(const QString &)),
+                     model, SLOT(selectTable(const QString &)));
 
     /*
      * передача фильтров и его номера колонки в модель для дальнейшего
@@ -130,16 +195,85 @@ void SqliteReaderView::makeConnections()
                      model, SLOT(changeFilter(int, const QString &)));
 
     /*
-     * синхронизация с бд по таймеру
+     * включение индекса fts5, ускоряющего фильтры на больших таблицах
+    */
+    QObject::connect(filterIndexAction, SIGNAL(toggled(bool)),
+                     model, SLOT(setFilterIndexEnabled(bool)));
+
+    /*
+     * кэш на диске: со следующего открытия бд таблица
+     * показывается из него, пока исполнитель открывает файл
+    */
+    QObject::connect(cacheAction, SIGNAL(toggled(bool)),
+                     model, SLOT(setSidecarCacheEnabled(bool)));
+
+    /*
+     * панель статистики колонок: профиль всех колонок модель
+     * считает одним параллельным проходом и хранит до изменения бд,
+     * панель показывает колонку, выделенную в таблице
+    */
+    QObject::connect(statsAction, SIGNAL(toggled(bool)),
+                     this, SLOT(setStatsVisible(bool)));
+    QObject::connect(model, SIGNAL(profileReady(const QString &, const QStringList &, const SqliteScanSummary &)),
+                     this, SLOT(onProfileReady(const QString &, const QStringList &, const SqliteScanSummary &)));
+    QObject::connect(model, SIGNAL(profileInvalidated()),
+                     this, SLOT(onProfileInvalidated()));
+    QObject::connect(profileTimer, SIGNAL(timeout()),
+                     this, SLOT(requestProfile()));
+    QObject::connect(table->selectionModel(), SIGNAL(currentColumnChanged(const QModelIndex &, const QModelIndex &)),
+                     this, SLOT(onCurrentColumnChanged(const QModelIndex &)));
+
+    /*
+     * строка замеров: включает сборщик замеров модели
+     * и обновляется по своему таймеру
+    */
+    QObject::connect(overlayAction, SIGNAL(toggled(bool)),
+                     this, SLOT(setOverlayVisible(bool)));
+    QObject::connect(overlayTimer, SIGNAL(timeout()),
+                     this, SLOT(updateOverlay()));
+
+    /*
+     * выгрузка идёт в потоке выгрузчика,
+     * её ход показывает окно прогресса
+    */
+    QObject::connect(model->exporter, SIGNAL(progress(qint64, qint64)),
+                     this, SLOT(onExportProgress(qint64, qint64)));
+    QObject::connect(model->exporter, SIGNAL(finished(const QString &, qint64)),
+                     this, SLOT(onExportFinished(const QString &, qint64)));
+    QObject::connect(model->exporter, SIGNAL(cancelled(const QString &)),
+                     this, SLOT(onExportCancelled(const QString &)));
+    QObject::connect(model->exporter, SIGNAL(failed(const QString &, const QString &)),
+                     this, SLOT(onExportFailed(const QString &, const QString &)));
+
+    /*
+     * двойной клик по ячейке открывает её значение целиком,
+     * большие значения модель читает из бд только для этого
     */
-    QObject::connect(model->timer, SIGNAL(timeout()),
-                     model, SLOT(syncDatabase()));
+    QObject::connect(table, SIGNAL(doubleClicked(const QModelIndex &)),
+                     model, SLOT(openValue(const QModelIndex &)));
+    QObject::connect(model, SIGNAL(valueReady(const QString &, const QVariant &)),
+                     this, SLOT(showValue(const QString &, const QVariant &)));
+
+    /*
+     * синхронизацию с бд по своей политике ведёт планировщик модели,
+     * меню Sync меняет политику открытой бд
+    */
+    QObject::connect(syncGroup, SIGNAL(triggered(QAction *)),
+                     this, SLOT(onSyncTriggered(QAction *)));
+    QObject::connect(model, SIGNAL(catalogReady(const SqliteSchemaCatalog &)),
+                     this, SLOT(updateSyncMenu()));
 
     /*
      * Если бд стала недоступна, то вызывается метод onError
     */
     QObject::connect(model, SIGNAL(dbUnreachable(const DBException &)),
                      this, SLOT(onError(const DBException &)));
+
+    /*
+     * Сломанная таблица не закрывает бд, о ней только предупреждение
+    */
+    QObject::connect(model, SIGNAL(tableFailed(const QString &, const QString &)),
+                     this, SLOT(onTableFailed(const QString &, const QString &)));
 }
 
 /*
@@ -161,15 +295,38 @@ void SqliteReaderView::dragEnterEvent(QDragEnterEvent *e)
 */
 void SqliteReaderView::dropEvent(QDropEvent *e)
 {
-    QString path = e->mimeData()->urls().at(0).toLocalFile();
-    path_ = path;
-    try {
-        emit fileSelected(path);
-    } catch (DBException e) {
-        onError(e);
+    openFile(e->mimeData()->urls().at(0).toLocalFile());
+}
+
+/*
+ * Пока окно скрыто или свёрнуто, бд не проверяется
+ * по таймеру, после возвращения проверяется сразу
+*/
+void SqliteReaderView::showEvent(QShowEvent *e)
+{
+    QWidget::showEvent(e);
+    updateSyncPause();
+}
+
+void SqliteReaderView::hideEvent(QHideEvent *e)
+{
+    QWidget::hideEvent(e);
+    updateSyncPause();
+}
+
+void SqliteReaderView::changeEvent(QEvent *e)
+{
+    QWidget::changeEvent(e);
+    if (e->type() == QEvent::WindowStateChange) {
+        updateSyncPause();
     }
 }
 
+void SqliteReaderView::updateSyncPause()
+{
+    model->syncScheduler->setPaused(isHidden() || isMinimized());
+}
+
 /*
  * открытие файла через верхнее меню
 */
@@ -180,12 +337,17 @@ void SqliteReaderView::selectFile()
               "Open db3",
               QDir::currentPath(),
               "Sqlite files (*.db3)");
+    openFile(path);
+}
+
+/*
+ * открытие файла по пути, в том числе переданного
+ * в аргументах (открыть с помощью)
+*/
+void SqliteReaderView::openFile(const QString &path)
+{
     path_ = path;
-    try {
-        emit fileSelected(path);
-    } catch (DBException e) {
-        onError(e);
-    }
+    emit fileSelected(path);  //ошибки открытия приходят в onError
 }
 
 /*
@@ -198,60 +360,220 @@ void SqliteReaderView::onError(const DBException &e)
     messageBox.critical(nullptr, "Error", e.exceptionText);
     messageBox.setFixedSize(500,200);
     resetPath();
-    table->clear();
-    table->setRowCount(0);
-    table->setColumnCount(0);
+    tableMenu->clear();
+    model->tableModel->clear();
 }
 
 /*
- * Добавление ряда в таблицу.
- * Так как вертикальные хедеры не стандартные
- * приходится следить за нумерацией.
+ * Таблица не открылась, бд и открытая таблица остаются.
+ * В меню Table снова отмечается открытая таблица.
 */
-void SqliteReaderView::addRowToTable(const QStringList &data)
-{
-    table->insertRow(table->rowCount());
-    for (int i = 0; i < data.size(); i++) {
-        QTableWidgetItem* item = new QTableWidgetItem(data[i]);
-        item->setFlags(Qt::ItemIsEnabled |
-                       Qt::ItemIsSelectable);
-        table->setItem(table->rowCount() - 1, i, item);
+void SqliteReaderView::onTableFailed(const QString &table, const QString &error)
+{
+    QMessageBox::warning(this, "Table", "Cannot open " + table + ":\n" + error);
+    QString current = model->currentTable();
+    for (QAction *action : tableMenu->actions()) {
+        action->setChecked(action->data().toString() == current);
     }
-    *verticalHeaderLabels << QString::number(table->rowCount() - 1);
-    table->setVerticalHeaderLabels(*verticalHeaderLabels);
 }
 
 /*
- * отчистка таблицы, но не затрагивая ряд фильтров
+ * Таблица заполнена моделью.
+ * Так как после смены колонок модель сбрасывается,
+ * фильтры для новых колонок нужно создать заново.
+ * Так же тайтл окна приводится к формату:
+ * [путь_к_файлу_бд] таблица - название_приложения
+ * и в меню Table отмечается открытая таблица.
 */
-void SqliteReaderView::removeTableRows()
+void SqliteReaderView::fillTable(const QStringList &dbColumns)
 {
-    for (int i = table->rowCount() - 1; i > 0; i--) {
-        table->removeRow(i);
-        table->setRowCount(i);
+    SqliteProfiler::Scope scope(model->profiler, "fillTable", "view");
+    scope.setArg("columns", dbColumns.size());
+    QString table = model->currentTable();
+    setWindowTitle("[" + path_ + "] " + table + " - " + APP_NAME);
+    for (QAction *action : tableMenu->actions()) {
+        action->setChecked(action->data().toString() == table);
     }
+    initTable(dbColumns);
+    requestProfile();
 }
 
 /*
- * Заполнение таблиы данными из модели.
- * Если dbColumns пустой, то в таблице нужно
- * просто обновить содержимое не затрагивая фильтры.
- * Если же dbColumns не пустой, то таблицу нужно
- * сначала полностью отчистить.
- * Так же тайтл окна приводится к формату:
- * [путь_к_файлу_бд] - название_приложения
+ * Меню Table: таблицы и представления бд с примерным
+ * количеством строк, индексы таблицы видны в подсказке.
+*/
+void SqliteReaderView::fillTableMenu(const SqliteSchemaCatalog &catalog)
+{
+    tableMenu->clear();
+    for (const QString &table : catalog.tables()) {
+        QString text = table;
+        if (catalog.isView(table)) {
+            text += " (view)";
+        } else if (catalog.rowEstimate(table) >= 0) {
+            text += "  ~" + QString::number(catalog.rowEstimate(table)) + " rows";
+        }
+        QAction *action = tableMenu->addAction(text);
+        action->setData(table);
+        action->setCheckable(true);
+        action->setChecked(table == model->currentTable());
+        tableGroup->addAction(action);
+        QStringList indexes = catalog.indexes(table);
+        if (!indexes.isEmpty()) {
+            action->setToolTip("Indexes: " + indexes.join(", "));
+        }
+    }
+}
+
+/*
+ * Показ строки замеров. Пока она видна, модель
+ * замеряет этапы запросов, выключение сбрасывает замеры.
+*/
+void SqliteReaderView::setOverlayVisible(bool isVisible)
+{
+    model->profiler->setEnabled(isVisible);
+    overlayLabel->setVisible(isVisible);
+    if (isVisible) {
+        updateOverlay();
+        overlayTimer->start();
+    } else {
+        overlayTimer->stop();
+        model->profiler->clear();
+    }
+}
+
+void SqliteReaderView::updateOverlay()
+{
+    overlayLabel->setText(model->profiler->summary());
+}
+
+/*
+ * Выбор политики проверок изменений в меню Sync.
+ * Запоминается для открытой бд.
+*/
+void SqliteReaderView::onSyncTriggered(QAction *action)
+{
+    model->setSyncPolicy(action->data().toInt());
+}
+
+/*
+ * Отметка в меню Sync политики открытой бд
+ * (у каждой бд она своя)
+*/
+void SqliteReaderView::updateSyncMenu()
+{
+    for (QAction *action : syncGroup->actions()) {
+        action->setChecked(action->data().toInt() == model->syncScheduler->policy());
+    }
+}
+
+/*
+ * Сохранение записанных замеров в json формата
+ * Chrome trace для chrome://tracing или Perfetto.
+ * Замеры пишутся, только пока включена строка замеров.
+*/
+void SqliteReaderView::exportTrace()
+{
+    if (!model->profiler->isEnabled()) {
+        QMessageBox::information(this, "Export trace",
+                                 "Enable Profile > Performance overlay to record a trace.");
+        return;
+    }
+    QString path = QFileDialog::getSaveFileName(
+              this,
+              "Export trace",
+              QDir::currentPath() + "/trace.json",
+              "Trace files (*.json)");
+    if (path.isEmpty()) {
+        return;
+    }
+    QFile file(path);
+    QByteArray trace = model->profiler->traceJson();
+    if (!file.open(QIODevice::WriteOnly) || file.write(trace) != trace.size()) {
+        QMessageBox::warning(this, "Export trace", "Cannot write " + path);
+    }
+}
+
+/*
+ * Выгрузка открытой таблицы с фильтрами и сортировкой.
+ * Формат выбирается фильтром диалога, окно прогресса
+ * не модальное: таблицей можно пользоваться дальше.
+*/
+void SqliteReaderView::exportTable()
+{
+    if (exportProgress) {
+        exportProgress->show();  //одна выгрузка за раз
+        return;
+    }
+    QString filter;
+    QString path = QFileDialog::getSaveFileName(
+              this,
+              "Export table",
+              QDir::currentPath() + "/" + model->currentTable(),
+              EXPORT_FILTERS.join(";;"),
+              &filter);
+    if (path.isEmpty()) {
+        return;
+    }
+    int format = qMax(0, EXPORT_FILTERS.indexOf(filter));
+    QString suffix = SqliteExporter::suffix(static_cast<SqliteExporter::Format>(format));
+    if (QFileInfo(path).suffix().isEmpty()) {
+        path += "." + suffix;
+    }
+    if (!model->exportTable(path, format)) {
+        QMessageBox::information(this, "Export table", "Open a table to export it.");
+        return;
+    }
+    exportProgress = new QProgressDialog("Exporting " + QFileInfo(path).fileName() + "...",
+                                         "Cancel", 0, 0, this);
+    exportProgress->setWindowTitle("Export table");
+    exportProgress->setWindowModality(Qt::NonModal);
+    exportProgress->setAutoClose(false);
+    exportProgress->setAutoReset(false);
+    QObject::connect(exportProgress, SIGNAL(canceled()),
+                     model, SLOT(cancelExport()));
+    exportProgress->show();
+}
+
+/*
+ * Ход выгрузки. Если количество строк неизвестно,
+ * полоса прогресса показывает только занятость.
 */
-void SqliteReaderView::fillTable(const QList<QStringList> &db, const QStringList &dbColumns)
+void SqliteReaderView::onExportProgress(qint64 rows, qint64 expectedRows)
 {
-    setWindowTitle("[" + path_ + "] - " + APP_NAME);
-    verticalHeaderLabels->clear();
-    verticalHeaderLabels->append("");
-    if (!dbColumns.isEmpty()) {
-        initTable(dbColumns);
+    if (!exportProgress) {
+        return;
     }
-    removeTableRows();
-    for (auto row : db) {
-        addRowToTable(row);
+    exportProgress->setLabelText("Exported " + QString::number(rows) + " rows");
+    if (expectedRows > 0) {
+        exportProgress->setMaximum(100);
+        exportProgress->setValue(static_cast<int>(qMin<qint64>(100, rows * 100 / expectedRows)));
+    }
+}
+
+void SqliteReaderView::onExportFinished(const QString &path, qint64 rows)
+{
+    closeExportProgress();
+    QMessageBox::information(this, "Export table",
+                             QString::number(rows) + " rows exported to " + path);
+}
+
+void SqliteReaderView::onExportCancelled(const QString &path)
+{
+    Q_UNUSED(path);
+    closeExportProgress();
+}
+
+void SqliteReaderView::onExportFailed(const QString &path, const QString &error)
+{
+    closeExportProgress();
+    QMessageBox::warning(this, "Export table", "Cannot export " + path + ":\n" + error);
+}
+
+void SqliteReaderView::closeExportProgress()
+{
+    if (exportProgress) {
+        exportProgress->deleteLater();
+        exportProgress = nullptr;
     }
 }
 
@@ -264,13 +586,114 @@ void SqliteReaderView::resetPath()
     setWindowTitle(APP_NAME);
 }
 
+/*
+ * Значение ячейки, которое модель прочитала целиком.
+ * Окно не модальное и удаляется при закрытии.
+*/
+void SqliteReaderView::showValue(const QString &column, const QVariant &value)
+{
+    SqliteValueDialog *dialog = new SqliteValueDialog(column, value, this);
+    dialog->show();
+}
+
+/*
+ * Панель статистики колонок. Профиль таблицы запрашивается,
+ * только пока панель видна.
+*/
+void SqliteReaderView::setStatsVisible(bool isVisible)
+{
+    statsPanel->setVisible(isVisible);
+    requestProfile();
+}
+
+void SqliteReaderView::onProfileReady(const QString &table, const QStringList &columns,
+                                      const SqliteScanSummary &profile)
+{
+    statsPanel->setProfile(table, columns, profile);
+}
+
+void SqliteReaderView::onCurrentColumnChanged(const QModelIndex &current)
+{
+    statsPanel->setColumn(current.column());
+}
+
+/*
+ * Профиль открытой таблицы для панели: из кэша модели
+ * сразу или после прохода по таблице
+*/
+void SqliteReaderView::requestProfile()
+{
+    profileTimer->stop();
+    if (!statsAction->isChecked()) {
+        return;
+    }
+    statsPanel->setPending(model->currentTable());
+    if (!model->profileColumns()) {
+        statsPanel->clear();
+    }
+}
+
+/*
+ * Бд изменилась, профиль устарел. Каждый пересчёт - полный
+ * проход по таблице, поэтому он откладывается, пока бд
+ * не перестанет меняться на PROFILE_DELAY. Со скрытой
+ * панелью профиль пересчитается, когда её покажут.
+*/
+void SqliteReaderView::onProfileInvalidated()
+{
+    if (!statsAction->isChecked()) {
+        return;
+    }
+    statsPanel->setPending(model->currentTable());
+    profileTimer->start();
+}
+
+/*
+ * Консоль SQL. Окно одно на всё время работы, запросы
+ * из него выполняет модель на отдельном соединении.
+*/
+void SqliteReaderView::openConsole()
+{
+    if (!queryConsole) {
+        queryConsole = new SqliteQueryConsole(this);
+        QObject::connect(queryConsole, SIGNAL(planRequested(const QString &)),
+                         model, SLOT(planConsoleQuery(const QString &)));
+        QObject::connect(queryConsole, SIGNAL(runRequested(const QString &, qint64, qint64)),
+                         model, SLOT(runConsoleQuery(const QString &, qint64, qint64)));
+        QObject::connect(queryConsole, SIGNAL(cancelRequested()),
+                         model, SLOT(cancelConsoleQuery()));
+        QObject::connect(model, SIGNAL(consolePlanReady(const SqliteQueryPlan &)),
+                         queryConsole, SLOT(showPlan(const SqliteQueryPlan &)));
+        QObject::connect(model, SIGNAL(consoleStarted(const QStringList &)),
+                         queryConsole, SLOT(onStarted(const QStringList &)));
+        QObject::connect(model, SIGNAL(consoleRowsReady(const SqliteResultBlock &)),
+                         queryConsole, SLOT(appendRows(const SqliteResultBlock &)));
+        QObject::connect(model, SIGNAL(consoleFinished(qint64, qint64, bool)),
+                         queryConsole, SLOT(onFinished(qint64, qint64, bool)));
+        QObject::connect(model, SIGNAL(consoleFailed(const QString &)),
+                         queryConsole, SLOT(onFailed(const QString &)));
+    }
+    queryConsole->show();
+    queryConsole->raise();
+    queryConsole->activateWindow();
+}
+
 SqliteReaderView::~SqliteReaderView()
 {
     delete table;
+    delete statsPanel;
+    delete queryConsole;
     delete gridLayout;
     delete fileMenu;
+    delete tableMenu;
+    delete filterMenu;
+    delete syncMenu;
+    delete profileMenu;
+    delete overlayTimer;
+    delete profileTimer;
+    delete overlayLabel;
+    delete exportProgress;
     delete menuBar;
     delete controller;
     delete model;
-    delete verticalHeaderLabels;
 }
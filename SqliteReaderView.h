@@ -5,7 +5,7 @@
 #include <QGridLayout>
 #include <QMenu>
 #include <QMenuBar>
-#include <QTableWidget>
+#include <QTableView>
 #include <QGuiApplication>
 #include <QScreen>
 #include <QHeaderView>
@@ -14,10 +14,20 @@
 #include <QMimeData>
 #include <QLineEdit>
 #include <QMessageBox>
+#include <QActionGroup>
+#include <QLabel>
+#include <QTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QProgressDialog>
 
 #include "SqliteReaderController.h"
 #include "SqliteReaderModel.h"
 #include "DBException.h"
+#include "SqliteSchemaCatalog.h"
+#include "SqliteValueDialog.h"
+#include "SqliteColumnStatsPanel.h"
+#include "SqliteQueryConsole.h"
 
 class SqliteReaderView : public QWidget
 {
@@ -28,34 +38,77 @@ public:
     const int WIDGET_HEIGHT = 400;  //минимальная высота окна
     const int WIDGET_WIDTH = 800;  //минимальная ширина окна
     const QString FILTER_PLACEHOLDER = "Filter";  //текст отображаемый на фильтрах, когда они пустые
+    const int OVERLAY_TIME = 500;  //период обновления строки замеров
+    const int PROFILE_DELAY = 3000;  //мс без изменений бд, после которых профиль колонок пересчитывается
+    const QStringList EXPORT_FILTERS = {"CSV (*.csv)", "JSON Lines (*.jsonl)",
+                                        "Columnar (*.sqrc)"};  //фильтры диалога выгрузки в порядке SqliteExporter::Format
     SqliteReaderView(QWidget *parent = nullptr);
     void initWindow();
     void initWindowElements();
     void initTable(const QStringList &columns);
     void makeConnections();
-    void addRowToTable(const QStringList &data);
-    void removeTableRows();
     void dragEnterEvent(QDragEnterEvent *e);
     void dropEvent(QDropEvent *e);
+    void showEvent(QShowEvent *e);
+    void hideEvent(QHideEvent *e);
+    void changeEvent(QEvent *e);
     virtual ~SqliteReaderView();
     QGridLayout *gridLayout;
     QMenu *fileMenu;
+    QAction *cacheAction;
+    QMenu *tableMenu;
+    QActionGroup *tableGroup;
+    QMenu *filterMenu;
+    QAction *filterIndexAction;
+    QAction *statsAction;
+    QMenu *syncMenu;
+    QActionGroup *syncGroup;
+    QMenu *profileMenu;
+    QAction *overlayAction;
+    QLabel *overlayLabel;
+    QTimer *overlayTimer;
+    QTimer *profileTimer;
+    QProgressDialog *exportProgress = nullptr;  //есть, только пока идёт выгрузка
+    SqliteQueryConsole *queryConsole = nullptr;  //создаётся при первом открытии консоли
     QMenuBar *menuBar;
-    QTableWidget *table;
+    QTableView *table;
+    SqliteColumnStatsPanel *statsPanel;
     SqliteReaderController *controller;
     SqliteReaderModel *model;
-    QStringList *verticalHeaderLabels;
 
 public slots:
     void selectFile();
-    void fillTable(const QList<QStringList> &db, const QStringList &dbColumns);
+    void openFile(const QString &path);
+    void fillTable(const QStringList &dbColumns);
+    void fillTableMenu(const SqliteSchemaCatalog &catalog);
     void resetPath();
     void onError(const DBException &e);
+    void onTableFailed(const QString &table, const QString &error);
+    void setOverlayVisible(bool isVisible);
+    void updateOverlay();
+    void exportTrace();
+    void onSyncTriggered(QAction *action);
+    void updateSyncMenu();
+    void exportTable();
+    void onExportProgress(qint64 rows, qint64 expectedRows);
+    void onExportFinished(const QString &path, qint64 rows);
+    void onExportCancelled(const QString &path);
+    void onExportFailed(const QString &path, const QString &error);
+    void showValue(const QString &column, const QVariant &value);
+    void openConsole();
+    void setStatsVisible(bool isVisible);
+    void onProfileReady(const QString &table, const QStringList &columns, const SqliteScanSummary &profile);
+    void onCurrentColumnChanged(const QModelIndex &current);
+    void requestProfile();
+    void onProfileInvalidated();
 
 signals:
     void fileSelected(const QString &path);
 
 private:
+    void closeExportProgress();
+    void updateSyncPause();
+
     int screen_height_;
     int screen_width_;
     QList<QScreen *> screens_;
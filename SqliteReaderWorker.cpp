@@ -0,0 +1,1322 @@
+#include "SqliteReaderWorker.h"
+
+const QStringList SqliteReaderWorker::CONSOLE_PRAGMAS = {
+    "application_id", "auto_vacuum", "collation_list", "compile_options", "data_version",
+    "database_list", "encoding", "foreign_key_check", "foreign_keys", "freelist_count",
+    "function_list", "integrity_check", "journal_mode", "module_list", "page_count",
+    "page_size", "pragma_list", "quick_check", "schema_version", "table_list", "user_version"
+};
+
+const QString SqliteReaderWorker::ROW_HASHES = "sqlitereader_row_hashes";
+
+const QStringList SqliteReaderWorker::CONSOLE_TABLE_PRAGMAS = {
+    "foreign_key_check", "foreign_key_list", "index_info", "index_list", "index_xinfo",
+    "integrity_check", "quick_check", "table_info", "table_list", "table_xinfo"
+};
+
+SqliteReaderWorker::SqliteReaderWorker(const QString &connectionName)
+{
+    connection_name_ = connectionName;
+}
+
+/*
+ * Сборщик замеров этапов. Задаётся до запуска потока
+ * исполнителя, сам сборщик потокобезопасен.
+*/
+void SqliteReaderWorker::setProfiler(SqliteProfiler *profiler)
+{
+    profiler_ = profiler;
+}
+
+/*
+ * Отмена всех запросов младше generation.
+ * Единственный метод, который можно вызывать из другого потока:
+ * запросы из очереди будут пропущены, а выполняющийся
+ * прерван через sqlite3_interrupt.
+*/
+void SqliteReaderWorker::cancelBefore(int generation)
+{
+    QMutexLocker locker(&mutex_);
+    if (generation > min_generation_.loadAcquire()) {
+        min_generation_.storeRelease(generation);
+    }
+    if (handle_ && running_ >= 0 && running_ < generation) {
+        sqlite3_interrupt(handle_);
+    }
+}
+
+bool SqliteReaderWorker::isStale(int generation) const
+{
+    return generation < min_generation_.loadAcquire();
+}
+
+/*
+ * Открытие своего соединения с бд с настройками profile
+ * и чтение каталога схемы: таблиц, представлений, индексов
+ * и оценок количества строк.
+ * Колонки таблиц читаются отдельно, в loadColumns.
+ * Ошибки сообщаются сигналом dbUnreachable.
+*/
+void SqliteReaderWorker::open(const QString &path, const SqliteConnectionProfile &profile)
+{
+    if (!openConnection(path, profile)) {
+        return;
+    }
+    SqliteSchemaCatalog catalog;
+    if (!readCatalog(catalog)) {
+        close();
+        emit dbUnreachable(UnreachableDBException());
+        return;
+    }
+    if (catalog.isEmpty()) {
+        close();
+        emit dbUnreachable(UnsupportedDBException());
+        return;
+    }
+    emit opened(path, catalog);
+}
+
+/*
+ * Открытие своего соединения только для проверок изменений
+ * бд (checkChanges): PRAGMA data_version этого соединения
+ * меняется от записи любых других соединений, в том числе
+ * чужих программ. Неизменяемый файл не проверяется.
+*/
+void SqliteReaderWorker::watch(const QString &path, const SqliteConnectionProfile &profile)
+{
+    if (!openConnection(path, profile) || profile_.isImmutable) {
+        return;
+    }
+    detector_ = new SqliteChangeDetector();
+    QObject::connect(detector_, SIGNAL(changed()),
+                     this, SLOT(checkChanges()));
+    detector_->attach(db_, path, &statements_);
+}
+
+/*
+ * Открытие своего соединения для консоли SQL. Запросы
+ * пользователя идут на нём, а не на соединении таблицы,
+ * так что долгий запрос не задерживает страницы таблицы
+ * и отменяется отдельно от них.
+*/
+void SqliteReaderWorker::openConsole(const QString &path, const SqliteConnectionProfile &profile)
+{
+    if (openConnection(path, profile)) {
+        sqlite3_set_authorizer(handle_, &SqliteReaderWorker::consoleAuthorizer, nullptr);
+    }
+}
+
+/*
+ * Авторизатор соединения консоли. sqlite3_stmt_readonly
+ * пропускает управление транзакциями, attach и прагмы,
+ * а они меняют само соединение: открытая begin транзакция
+ * чтения держит снимок бд без ограничений (в режиме журнала
+ * блокирует запись, в WAL - чекпойнты), attach открывает
+ * любой файл. Из прагм разрешены только чтения: без значения
+ * из CONSOLE_PRAGMAS и с именем таблицы или индекса
+ * из CONSOLE_TABLE_PRAGMAS.
+*/
+int SqliteReaderWorker::consoleAuthorizer(void *data, int action, const char *first, const char *second,
+                                          const char *database, const char *trigger)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(database)
+    Q_UNUSED(trigger)
+    switch (action) {
+    case SQLITE_TRANSACTION:
+    case SQLITE_SAVEPOINT:
+    case SQLITE_ATTACH:
+    case SQLITE_DETACH:
+        return SQLITE_DENY;
+    case SQLITE_PRAGMA: {
+        QString pragma = QString::fromUtf8(first).toLower();
+        bool isAllowed = second ? CONSOLE_TABLE_PRAGMAS.contains(pragma) : CONSOLE_PRAGMAS.contains(pragma);
+        return isAllowed ? SQLITE_OK : SQLITE_DENY;
+    }
+    default:
+        return SQLITE_OK;
+    }
+}
+
+/*
+ * Откат транзакции, если запрос консоли всё же оставил
+ * её открытой. Авторизатор запрещает и rollback, поэтому
+ * на время отката он снимается.
+*/
+void SqliteReaderWorker::rollbackConsole()
+{
+    if (!handle_ || sqlite3_get_autocommit(handle_)) {
+        return;
+    }
+    sqlite3_set_authorizer(handle_, nullptr, nullptr);
+    sqlite3_exec(handle_, "rollback", nullptr, nullptr, nullptr);
+    sqlite3_set_authorizer(handle_, &SqliteReaderWorker::consoleAuthorizer, nullptr);
+}
+
+/*
+ * Открытие соединения с настройками profile: режим открытия,
+ * функция поиска подстроки для фильтров и прагмы.
+ * При ошибке соединение закрывается и отправляется dbUnreachable.
+*/
+bool SqliteReaderWorker::openConnection(const QString &path, const SqliteConnectionProfile &profile)
+{
+    close();
+    profile_ = profile;
+    db_ = QSqlDatabase::addDatabase("QSQLITE", connection_name_);
+    db_.setDatabaseName(profile_.databaseName(path));
+    db_.setConnectOptions(profile_.connectOptions());
+    if (!db_.open()) {
+        close();
+        emit dbUnreachable(UnreachableDBException());
+        return false;
+    }
+    QVariant handle = db_.driver()->handle();
+    if (handle.isValid() && qstrcmp(handle.typeName(), "sqlite3*") == 0) {
+        QMutexLocker locker(&mutex_);
+        handle_ = *static_cast<sqlite3 **>(handle.data());
+    }
+    if (!handle_ || !SqliteSubstringSearch::install(handle_) ||  //строки и фильтры идут через нативное соединение
+            !SqliteChunkFingerprint::install(handle_)) {
+        close();
+        emit dbUnreachable(UnsupportedDBException());
+        return false;
+    }
+    statements_.setHandle(handle_);
+    QSqlQuery query(db_);
+    for (const QString &pragma : profile_.pragmas()) {
+        query.exec(pragma);  //прагмы - только подсказки, бд читается и без них
+    }
+    return true;
+}
+
+/*
+ * Закрытие соединения. Наблюдатель файлов удаляется
+ * здесь же, так как он живёт в потоке исполнителя.
+ * Подготовленные запросы финализируются до закрытия,
+ * иначе sqlite не закроет соединение.
+*/
+void SqliteReaderWorker::close()
+{
+    delete detector_;
+    detector_ = nullptr;
+    statements_.setHandle(nullptr);
+    match_generations_.clear();  //временные таблицы исчезают вместе с соединением
+    {
+        QMutexLocker locker(&mutex_);
+        handle_ = nullptr;
+    }
+    if (db_.isOpen()) {
+        db_.close();
+    }
+    db_ = QSqlDatabase();
+    if (QSqlDatabase::contains(connection_name_)) {
+        QSqlDatabase::removeDatabase(connection_name_);
+    }
+}
+
+/*
+ * Подсчёт строк запроса с фильтрами.
+*/
+void SqliteReaderWorker::countRows(int generation, const QString &request, const QVariantList &values)
+{
+    if (!beginRequest(generation)) {
+        return;
+    }
+    SqliteProfiler::Scope scope(profiler_, "countRows", "worker");
+    sqlite3_stmt *statement = statements_.prepare("select count(*) from (" + request + ")");
+    bool isDone = statement && bindValues(statement, values) && sqlite3_step(statement) == SQLITE_ROW;
+    int count = isDone ? sqlite3_column_int(statement, 0) : 0;
+    statements_.release(statement);
+    endRequest();
+    if (!isDone) {
+        failRequest(generation);
+        return;
+    }
+    emit rowCountReady(generation, count);
+}
+
+/*
+ * Чтение pageCount страниц по pageSize строк.
+ * request - запрос страниц без limit/offset, из его результата
+ * пропускается skip строк (при чтении страниц поиском от
+ * известной строки skip меньше offset или равен нулю),
+ * offset - номер первой строки в таблице.
+ * Строки читаются напрямую через sqlite3_step в колоночные
+ * блоки и отправляются по мере чтения, по странице на сигнал,
+ * чтобы view мог показать первую страницу не дожидаясь остальных.
+ * Сигнал отправляется и для пустых страниц, чтобы модель
+ * узнала, что строк там больше нет.
+ * Арена страницы резервируется по размеру прошлой страницы,
+ * так что текст копируется из sqlite один раз и не переезжает
+ * при росте арены.
+ * При включённых замерах отдельно считается время в sqlite3_step
+ * и на перенос строк в блоки, и счётчики sqlite3_stmt_status.
+*/
+void SqliteReaderWorker::fetchRows(int generation, const QString &request, const QVariantList &values,
+                                   int offset, int skip, int pageSize, int pageCount)
+{
+    if (!beginRequest(generation)) {
+        return;
+    }
+    SqliteProfiler::Scope scope(profiler_, "fetchRows", "worker");
+    sqlite3_stmt *statement = statements_.prepare(request + " limit ? offset ?");
+    QVariantList parameters = values;
+    parameters << pageSize * pageCount << skip;
+    bool isDone = statement && bindValues(statement, parameters);
+    QList<LazyColumn> lazies = isDone ? lazyColumns(statement) : QList<LazyColumn>();
+    if (scope.isActive() && statement) {  //запрос из кэша помнит счётчики прошлых выполнений
+        for (int counter : {SQLITE_STMTSTATUS_FULLSCAN_STEP, SQLITE_STMTSTATUS_SORT,
+                            SQLITE_STMTSTATUS_AUTOINDEX, SQLITE_STMTSTATUS_VM_STEP}) {
+            sqlite3_stmt_status(statement, counter, 1);
+        }
+    }
+    int status = SQLITE_ROW;
+    int fetched = 0;
+    qint64 stepTime = 0;  //нс в sqlite3_step, считается только при включённых замерах
+    qint64 materializeTime = 0;  //нс на перенос строк в блоки
+    QElapsedTimer clock;
+    clock.start();
+    for (int page = 0; isDone && page < pageCount; page++) {
+        SqliteResultBlock rows(sqlite3_column_count(statement));
+        rows.reserve(pageSize, page_bytes_ + page_bytes_ / 4);
+        while (rows.rowCount() < pageSize) {
+            qint64 start = scope.isActive() ? clock.nsecsElapsed() : 0;
+            status = sqlite3_step(statement);
+            qint64 stepped = scope.isActive() ? clock.nsecsElapsed() : 0;
+            stepTime += stepped - start;
+            if (status != SQLITE_ROW) {
+                break;
+            }
+            rows.appendRow(statement);
+            if (!lazies.isEmpty()) {
+                readPrefixes(statement, rows, lazies);
+            }
+            materializeTime += scope.isActive() ? clock.nsecsElapsed() - stepped : 0;
+        }
+        if (status != SQLITE_ROW && status != SQLITE_DONE) {
+            isDone = false;
+            break;
+        }
+        if (isStale(generation)) {
+            break;
+        }
+        fetched += rows.rowCount();
+        if (rows.rowCount() == pageSize) {
+            page_bytes_ = rows.byteSize();
+        }
+        emit rowsReady(generation, offset + page * pageSize, rows);
+    }
+    if (scope.isActive() && statement) {
+        scope.setArg("rows", fetched);
+        scope.setArg("pages", pageCount);
+        scope.setArg("skip", skip);
+        scope.setArg("stepUs", static_cast<double>(stepTime / 1000));
+        scope.setArg("materializeUs", static_cast<double>(materializeTime / 1000));
+        scope.setArg("fullScanSteps", sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_FULLSCAN_STEP, 0));
+        scope.setArg("sorts", sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_SORT, 0));
+        scope.setArg("autoIndexes", sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_AUTOINDEX, 0));
+        scope.setArg("vmSteps", sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_VM_STEP, 0));
+        scope.setArg("statementCacheHits", statements_.hitCount());
+        scope.setArg("statementCacheMisses", statements_.missCount());
+    }
+    closeBlobs(lazies);  //открытый blob держит транзакцию чтения
+    statements_.release(statement);
+    endRequest();
+    if (!isDone) {
+        failRequest(generation);
+    }
+}
+
+/*
+ * Колонки ленивых значений запроса по их именам
+ * (см. SqliteFilterCompiler::lazyAlias)
+*/
+QList<SqliteReaderWorker::LazyColumn> SqliteReaderWorker::lazyColumns(sqlite3_stmt *statement) const
+{
+    QList<LazyColumn> lazies;
+    for (int i = 0; i < sqlite3_column_count(statement); i++) {
+        LazyColumn lazy;
+        lazy.length = i;
+        if (SqliteFilterCompiler::parseLazyAlias(sqlite3_column_name(statement, i), lazy.value, lazy.table, lazy.name)) {
+            lazies.append(lazy);
+        }
+    }
+    return lazies;
+}
+
+/*
+ * Начала больших значений последней строки rows.
+ * Ключ строки ленивого запроса - rowid, по нему
+ * blob колонки переоткрывается на нужной строке, а
+ * читаются только страницы с первыми LAZY_PREFIX_SIZE байтами.
+*/
+void SqliteReaderWorker::readPrefixes(sqlite3_stmt *statement, SqliteResultBlock &rows, QList<LazyColumn> &lazies)
+{
+    int row = rows.rowCount() - 1;
+    sqlite3_int64 rowid = sqlite3_column_int64(statement, 0);
+    for (LazyColumn &lazy : lazies) {
+        if (sqlite3_column_type(statement, lazy.length) == SQLITE_NULL) {
+            continue;
+        }
+        qint64 length = sqlite3_column_int64(statement, lazy.length);
+        int type = (length & 1) ? SQLITE_BLOB : SQLITE_TEXT;
+        int status = lazy.blob ? sqlite3_blob_reopen(lazy.blob, rowid) :
+                                 sqlite3_blob_open(handle_, "main", lazy.table.constData(), lazy.name.constData(),
+                                                   rowid, 0, &lazy.blob);
+        QByteArray prefix;
+        if (status == SQLITE_OK) {
+            prefix.resize(qMin(LAZY_PREFIX_SIZE, sqlite3_blob_bytes(lazy.blob)));
+            if (sqlite3_blob_read(lazy.blob, prefix.data(), prefix.size(), 0) != SQLITE_OK) {
+                prefix.clear();
+            }
+        } else {
+            sqlite3_blob_close(lazy.blob);  //после ошибки blob можно только закрыть
+            lazy.blob = nullptr;
+        }
+        if (type == SQLITE_TEXT) {
+            prefix.truncate(utf8Boundary(prefix));
+        }
+        rows.setLazyCell(row, lazy.value, type, length / 2, prefix);
+    }
+}
+
+void SqliteReaderWorker::closeBlobs(QList<LazyColumn> &lazies)
+{
+    for (LazyColumn &lazy : lazies) {
+        sqlite3_blob_close(lazy.blob);
+        lazy.blob = nullptr;
+    }
+}
+
+/*
+ * Длина начала text без последнего неполного символа UTF-8
+*/
+int SqliteReaderWorker::utf8Boundary(const QByteArray &text)
+{
+    int start = text.size();
+    while (start > 0 && (static_cast<unsigned char>(text[start - 1]) & 0xC0) == 0x80) {
+        start--;  //байты продолжения символа
+    }
+    if (start == 0) {
+        return text.size();
+    }
+    unsigned char lead = static_cast<unsigned char>(text[start - 1]);
+    int size = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+    return start - 1 + size <= text.size() ? text.size() : start - 1;
+}
+
+/*
+ * Значение колонки column строки rowid таблицы table целиком,
+ * для просмотра ленивого значения. Читается через
+ * sqlite3_blob_open одним куском, без запроса.
+*/
+void SqliteReaderWorker::readValue(int request, const QString &table, const QString &column, qint64 rowid)
+{
+    QByteArray value;
+    sqlite3_blob *blob = nullptr;
+    bool isRead = handle_ && sqlite3_blob_open(handle_, "main", table.toUtf8().constData(),
+                                               column.toUtf8().constData(), rowid, 0, &blob) == SQLITE_OK;
+    if (isRead) {
+        value.resize(sqlite3_blob_bytes(blob));
+        isRead = sqlite3_blob_read(blob, value.data(), value.size(), 0) == SQLITE_OK;
+    }
+    sqlite3_blob_close(blob);
+    emit valueRead(request, isRead, isRead ? value : QByteArray());
+}
+
+/*
+ * План запроса (explain query plan): строки detail
+ * в порядке обхода. Модель смотрит по нему, покрывает ли
+ * индекс сортировку. Если план получить не удалось,
+ * отправляется пустой список.
+*/
+void SqliteReaderWorker::explainQuery(int generation, const QString &request, const QVariantList &values)
+{
+    QStringList plan;
+    if (db_.isOpen()) {
+        QSqlQuery query(db_);
+        query.setForwardOnly(true);
+        bool isExplained = query.prepare("explain query plan " + request);
+        for (const QVariant &value : values) {
+            query.addBindValue(value);
+        }
+        isExplained = isExplained && query.exec();
+        while (isExplained && query.next()) {
+            plan.append(query.value(3).toString());
+        }
+    }
+    emit queryPlanReady(generation, plan);
+}
+
+/*
+ * Проверка запроса до того, как его получит модель таблицы:
+ * запрос только готовится. Ошибка sqlite (синтаксис, нет
+ * таблицы или колонки) или запрос, который ничего не
+ * возвращает или пишет в бд, приходит текстом в queryChecked,
+ * а не как ошибка бд: модель таблицы не получит такой запрос,
+ * и бд останется открытой. Пустой текст - запрос готов.
+*/
+void SqliteReaderWorker::checkQuery(int request, const QString &query)
+{
+    QString error;
+    if (!handle_) {
+        error = "The database is not open";
+    } else {
+        QByteArray text = query.toUtf8();
+        sqlite3_stmt *statement = nullptr;
+        if (sqlite3_prepare_v2(handle_, text.constData(), text.size(), &statement, nullptr) != SQLITE_OK) {
+            error = QString::fromUtf8(sqlite3_errmsg(handle_));
+        } else if (!statement || sqlite3_column_count(statement) == 0) {
+            error = "The query returns no rows";
+        } else if (!sqlite3_stmt_readonly(statement)) {
+            error = "Only read-only queries can be shown in the table";
+        }
+        sqlite3_finalize(statement);
+    }
+    emit queryChecked(request, error);
+}
+
+/*
+ * План запроса консоли для дерева в её окне. Запрос не
+ * выполняется, только готовится, поэтому план приходит
+ * сразу, даже для запроса на часы. Ошибка подготовки
+ * (синтаксис, несколько запросов, запись) приходит в плане.
+*/
+void SqliteReaderWorker::planQuery(int generation, const QString &request)
+{
+    SqliteQueryPlan plan;
+    QString error;
+    sqlite3_stmt *statement = prepareConsole(request, error);
+    sqlite3_finalize(statement);
+    if (statement) {
+        statement = prepareConsole("explain query plan " + request, error);
+    }
+    while (statement && sqlite3_step(statement) == SQLITE_ROW) {
+        plan.addStep(sqlite3_column_int(statement, 0), sqlite3_column_int(statement, 1),
+                     QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(statement, 3))));
+    }
+    if (statement && sqlite3_finalize(statement) != SQLITE_OK) {
+        error = QString::fromUtf8(sqlite3_errmsg(handle_));
+    }
+    rollbackConsole();
+    plan.setError(error);
+    emit planReady(generation, plan);
+}
+
+/*
+ * Выполнение запроса консоли. Строки читаются курсором
+ * и отправляются блоками по CONSOLE_BLOCK_ROWS, так что view
+ * показывает первые строки сразу. Чтение останавливается,
+ * как только следующая строка вышла бы за rowBudget строк
+ * или byteBudget байт (текст и blob - своей длиной,
+ * остальные ячейки - по CELL_BYTES): тогда isTruncated, и
+ * остаток результата не читается и не хранится.
+ * Ошибки запроса - не ошибки бд, они приходят в queryFailed,
+ * а отмена (cancelBefore) прерывает запрос молча.
+*/
+void SqliteReaderWorker::runQuery(int generation, const QString &request, qint64 rowBudget, qint64 byteBudget)
+{
+    if (!beginRequest(generation)) {
+        return;
+    }
+    SqliteProfiler::Scope scope(profiler_, "runQuery", "worker");
+    QString error;
+    sqlite3_stmt *statement = prepareConsole(request, error);
+    if (!statement) {
+        endRequest();
+        emit queryFailed(generation, error);
+        return;
+    }
+    QStringList columns;
+    for (int i = 0; i < sqlite3_column_count(statement); i++) {
+        columns.append(QString::fromUtf8(sqlite3_column_name(statement, i)));
+    }
+    emit queryStarted(generation, columns);
+    qint64 rows = 0;
+    qint64 bytes = 0;
+    bool isTruncated = false;
+    int status = SQLITE_ROW;
+    int blockBytes = 0;  //размер арены прошлого блока
+    while (status == SQLITE_ROW && !isTruncated && !isStale(generation)) {
+        SqliteResultBlock block(columns.size());
+        block.reserve(CONSOLE_BLOCK_ROWS, blockBytes + blockBytes / 4);
+        while (block.rowCount() < CONSOLE_BLOCK_ROWS && (status = sqlite3_step(statement)) == SQLITE_ROW) {
+            qint64 size = rowBytes(statement);
+            if (rows >= rowBudget || bytes + size > byteBudget) {
+                isTruncated = true;
+                break;
+            }
+            block.appendRow(statement);
+            rows++;
+            bytes += size;
+        }
+        blockBytes = qMax(blockBytes, block.byteSize());
+        if (block.rowCount() > 0) {
+            emit rowsReady(generation, rows - block.rowCount(), block);
+        }
+    }
+    if (status != SQLITE_ROW && status != SQLITE_DONE) {
+        error = QString::fromUtf8(sqlite3_errmsg(handle_));
+    }
+    sqlite3_finalize(statement);
+    rollbackConsole();
+    endRequest();
+    if (scope.isActive()) {
+        scope.setArg("rows", static_cast<double>(rows));
+        scope.setArg("bytes", static_cast<double>(bytes));
+    }
+    if (isStale(generation)) {
+        return;
+    }
+    if (!error.isEmpty()) {
+        emit queryFailed(generation, error);
+        return;
+    }
+    emit queryFinished(generation, rows, bytes, isTruncated);
+}
+
+/*
+ * Подготовка запроса консоли. Выполняется только один запрос
+ * и только читающий и возвращающий строки: консоль смотрит бд,
+ * а не меняет её (соединение просмотра и так query_only, но
+ * профиль может быть другим, а транзакции, attach и прагмы
+ * с записью запрещает consoleAuthorizer).
+ * Остаток текста после первого запроса тоже готовится: если
+ * там не только пробелы и комментарии, это второй запрос.
+*/
+sqlite3_stmt *SqliteReaderWorker::prepareConsole(const QString &request, QString &error)
+{
+    if (!handle_) {
+        error = "The database is not open";
+        return nullptr;
+    }
+    QByteArray text = request.toUtf8();
+    sqlite3_stmt *statement = nullptr;
+    const char *tail = nullptr;
+    if (sqlite3_prepare_v2(handle_, text.constData(), text.size(), &statement, &tail) != SQLITE_OK) {
+        error = QString::fromUtf8(sqlite3_errmsg(handle_));
+        return nullptr;
+    }
+    if (!statement) {
+        error = "The query is empty";
+        return nullptr;
+    }
+    sqlite3_stmt *next = nullptr;
+    int status = sqlite3_prepare_v2(handle_, tail, static_cast<int>(text.constData() + text.size() - tail),
+                                    &next, nullptr);
+    sqlite3_finalize(next);
+    if (status != SQLITE_OK || next) {
+        error = "Only one statement can run at a time";
+    } else if (!sqlite3_stmt_readonly(statement) || sqlite3_column_count(statement) == 0) {
+        error = "Only read-only statements that return rows can run in the console";
+    }
+    if (!error.isEmpty()) {
+        sqlite3_finalize(statement);
+        return nullptr;
+    }
+    return statement;
+}
+
+/*
+ * Размер текущей строки запроса для бюджета консоли
+*/
+qint64 SqliteReaderWorker::rowBytes(sqlite3_stmt *statement) const
+{
+    qint64 bytes = 0;
+    for (int i = 0; i < sqlite3_column_count(statement); i++) {
+        int type = sqlite3_column_type(statement, i);
+        bytes += type == SQLITE_TEXT || type == SQLITE_BLOB ? sqlite3_column_bytes(statement, i) : CELL_BYTES;
+    }
+    return bytes;
+}
+
+/*
+ * Обновление отпечатков блоков rowid таблицы после изменения бд.
+ * Все чтения идут в одной транзакции, то есть по одному снимку бд.
+ * Максимальный rowid читается по b-дереву сразу. Строки до прошлого
+ * максимума сравниваются по диапазонам блоков (compareChunks), кроме
+ * режима isAppendOnly, в котором таблица считается только растущей
+ * и старые строки не читаются вовсе (пока максимальный rowid не
+ * уменьшится). Строки после прошлого максимума
+ * дочитываются и добавляются к хэшам своих блоков (scanChunks).
+ * Первое построение - это то же дочитывание с самого начала таблицы.
+ * Хэши строк (rowid, хэш) лежат во временной таблице ROW_HASHES
+ * этого соединения, в файле, а не в памяти: по ним в изменённых
+ * блоках находятся сами изменённые строки (diffRows). Если
+ * временную таблицу создать нельзя, изменённым считается весь блок.
+ * При ошибке отправляются пустые отпечатки, у прерванного
+ * запроса результата нет.
+*/
+void SqliteReaderWorker::updateFingerprint(int request, const SqliteChunkFingerprint &fingerprint, bool isAppendOnly)
+{
+    if (!beginRequest(request)) {
+        return;
+    }
+    SqliteProfiler::Scope scope(profiler_, "updateFingerprint", "worker");
+    SqliteChunkFingerprint result = fingerprint;
+    result.clearChanges();
+    QString table = SqliteFilterCompiler::quoteIdentifier(fingerprint.table());
+    QStringList values("rowid");
+    for (const QString &column : fingerprint.columns()) {
+        values.append(SqliteFilterCompiler::quoteIdentifier(column));
+    }
+    bool hasOld = fingerprint.isValid() && fingerprint.hasRows();
+    sqlite3_stmt *insert = nullptr;
+    if (!hasOld || fingerprint.rowHashes() != 0) {
+        insert = prepareRowHashes(!hasOld);
+    }
+    bool isExact = insert && fingerprint.rowHashes() == row_hashes_;  //иначе прошлый результат не дошёл до модели
+    if (insert) {
+        row_hashes_++;
+    }
+    bool isDone = sqlite3_exec(handle_, "begin", nullptr, nullptr, nullptr) == SQLITE_OK;
+    bool isBegun = isDone;
+    sqlite3_stmt *statement = isDone ? statements_.prepare("select max(rowid) from " + table) : nullptr;
+    isDone = statement && sqlite3_step(statement) == SQLITE_ROW;
+    bool hasRows = isDone && sqlite3_column_type(statement, 0) != SQLITE_NULL;
+    qint64 maxRowid = hasRows ? sqlite3_column_int64(statement, 0) : 0;
+    statements_.release(statement);
+    bool isShrunk = !hasRows || maxRowid < fingerprint.maxRowid();  //в растущей таблице так не бывает
+    if (isDone && hasOld && (!isAppendOnly || isShrunk)) {
+        QList<SqliteChunkFingerprint::Range> dirty;
+        statement = statements_.prepare("select " + QString(SqliteChunkFingerprint::FUNCTION_NAME) +
+                                        "(" + values.join(", ") + ") from " + table + " where rowid between ? and ?");
+        for (const SqliteChunkFingerprint::Range &segment : result.segments()) {
+            isDone = isDone && compareChunks(request, statement, result, segment.first, segment.second, dirty);
+        }
+        statements_.release(statement);
+        QString select = "select " + values.join(", ") + " from " + table;
+        for (const SqliteChunkFingerprint::Range &range : dirty) {
+            if (!insert) {
+                result.addChange(range.first, range.second);
+                continue;
+            }
+            isDone = isDone && diffRows(request, select, insert, result, range.first, range.second, isExact);
+        }
+    }
+    if (isDone && (!hasOld || (hasRows && maxRowid > fingerprint.maxRowid()))) {
+        statement = statements_.prepare("select " + values.join(", ") + " from " + table +
+                                        " where rowid >= ? order by rowid");
+        isDone = statement && sqlite3_bind_int64(statement, 1, hasOld ? fingerprint.maxRowid() + 1 : LLONG_MIN) == SQLITE_OK &&
+                 scanChunks(request, statement, result, insert);
+        statements_.release(statement);
+        if (hasOld) {
+            result.addChange(fingerprint.maxRowid() + 1, maxRowid);
+        }
+    }
+    if (isBegun) {
+        sqlite3_exec(handle_, "commit", nullptr, nullptr, nullptr);
+    }
+    if (insert) {
+        sqlite3_finalize(insert);
+        allowTempWrites(false);
+    }
+    if (scope.isActive()) {
+        scope.setArg("changes", result.changes().size());
+    }
+    endRequest();
+    if (isStale(request)) {
+        return;
+    }
+    if (!isDone) {
+        emit fingerprintReady(request, SqliteChunkFingerprint());
+        return;
+    }
+    result.setMaxRowid(hasRows, maxRowid);
+    result.setRowHashes(insert ? row_hashes_ : 0);
+    emit fingerprintReady(request, result);
+}
+
+/*
+ * Запрос записи во временную таблицу хэшей строк ROW_HASHES,
+ * с isCreated таблица создаётся заново (первое построение
+ * отпечатков). Временные таблицы этого соединения хранятся
+ * в файле, чтобы хэши строк большой таблицы не держались
+ * в памяти. nullptr, если временную таблицу писать нельзя.
+*/
+sqlite3_stmt *SqliteReaderWorker::prepareRowHashes(bool isCreated)
+{
+    allowTempWrites(true);
+    QByteArray table = ("temp." + ROW_HASHES).toUtf8();
+    bool isReady = true;
+    if (isCreated) {
+        QByteArray create = "create table " + table + "(rowid integer primary key, hash integer)";
+        isReady = sqlite3_exec(handle_, "pragma temp_store = file", nullptr, nullptr, nullptr) == SQLITE_OK &&
+                  sqlite3_exec(handle_, ("drop table if exists " + table).constData(), nullptr, nullptr, nullptr) == SQLITE_OK &&
+                  sqlite3_exec(handle_, create.constData(), nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+    sqlite3_stmt *statement = nullptr;
+    QByteArray sql = "insert or replace into " + table + "(rowid, hash) values (?, ?)";
+    if (!isReady || sqlite3_prepare_v2(handle_, sql.constData(), sql.size(), &statement, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(statement);
+        allowTempWrites(false);
+        return nullptr;
+    }
+    return statement;
+}
+
+/*
+ * Поиск изменённых строк в диапазоне rowid с first по last, где
+ * отпечатки блоков не совпали: строки таблицы (select) и их
+ * прошлые хэши из ROW_HASHES идут по возрастанию rowid рядом.
+ * Подряд идущие новые и изменённые строки добавляются в изменения
+ * отпечатков, хэши в ROW_HASHES обновляются, удалённые строки
+ * из неё убираются. Без isExact таблица хэшей не согласована с
+ * отпечатками, и изменённым считается весь диапазон.
+*/
+bool SqliteReaderWorker::diffRows(int request, const QString &select, sqlite3_stmt *insert,
+                                  SqliteChunkFingerprint &fingerprint, qint64 first, qint64 last, bool isExact)
+{
+    QByteArray table = ("temp." + ROW_HASHES).toUtf8();
+    QByteArray knownSql = "select rowid, hash from " + table + " where rowid between ? and ? order by rowid";
+    QByteArray rowsSql = (select + " where rowid between ? and ? order by rowid").toUtf8();
+    QByteArray removeSql = "delete from " + table + " where rowid = ?";
+    sqlite3_stmt *known = nullptr;
+    sqlite3_stmt *rows = nullptr;
+    sqlite3_stmt *remove = nullptr;
+    bool isRead = sqlite3_prepare_v2(handle_, knownSql.constData(), knownSql.size(), &known, nullptr) == SQLITE_OK &&
+                  sqlite3_prepare_v2(handle_, rowsSql.constData(), rowsSql.size(), &rows, nullptr) == SQLITE_OK &&
+                  sqlite3_prepare_v2(handle_, removeSql.constData(), removeSql.size(), &remove, nullptr) == SQLITE_OK;
+    for (sqlite3_stmt *statement : {known, rows}) {
+        isRead = isRead && sqlite3_bind_int64(statement, 1, first) == SQLITE_OK &&
+                 sqlite3_bind_int64(statement, 2, last) == SQLITE_OK;
+    }
+    QVector<QPair<qint64, quint64>> updated;  //новые и изменённые строки
+    QVector<qint64> removed;  //удалённые строки
+    qint64 runFirst = 0;
+    qint64 runLast = 0;
+    bool isRun = false;
+    qint64 count = 0;
+    int knownStatus = isRead ? sqlite3_step(known) : SQLITE_DONE;
+    int status = SQLITE_DONE;
+    while (isRead && (status = sqlite3_step(rows)) == SQLITE_ROW) {
+        if (++count % 65536 == 0 && isStale(request)) {
+            isRead = false;
+            break;
+        }
+        qint64 rowid = sqlite3_column_int64(rows, 0);
+        quint64 hash = SqliteChunkFingerprint::rowHash(rows);
+        while (knownStatus == SQLITE_ROW && sqlite3_column_int64(known, 0) < rowid) {
+            removed.append(sqlite3_column_int64(known, 0));
+            knownStatus = sqlite3_step(known);
+        }
+        bool isSame = knownStatus == SQLITE_ROW && sqlite3_column_int64(known, 0) == rowid &&
+                      static_cast<quint64>(sqlite3_column_int64(known, 1)) == hash;
+        if (!isSame) {
+            updated.append(qMakePair(rowid, hash));
+        }
+        if (isSame && isExact) {
+            if (isRun) {
+                fingerprint.addChange(runFirst, runLast);
+                isRun = false;
+            }
+            continue;
+        }
+        if (!isRun) {
+            runFirst = rowid;
+            isRun = true;
+        }
+        runLast = rowid;
+    }
+    while (isRead && knownStatus == SQLITE_ROW) {
+        removed.append(sqlite3_column_int64(known, 0));
+        knownStatus = sqlite3_step(known);
+    }
+    isRead = isRead && status == SQLITE_DONE && knownStatus == SQLITE_DONE;
+    if (isRun) {
+        fingerprint.addChange(runFirst, runLast);
+    }
+    for (int i = 0; isRead && i < removed.size(); i++) {
+        sqlite3_bind_int64(remove, 1, removed[i]);
+        isRead = sqlite3_step(remove) == SQLITE_DONE;
+        sqlite3_reset(remove);
+    }
+    for (int i = 0; isRead && i < updated.size(); i++) {
+        sqlite3_bind_int64(insert, 1, updated[i].first);
+        sqlite3_bind_int64(insert, 2, static_cast<qint64>(updated[i].second));
+        isRead = sqlite3_step(insert) == SQLITE_DONE;
+        sqlite3_reset(insert);
+    }
+    sqlite3_finalize(known);
+    sqlite3_finalize(rows);
+    sqlite3_finalize(remove);
+    return isRead;
+}
+
+/*
+ * Сравнение строк блоков с firstChunk по lastChunk (но не дальше
+ * прошлого максимального rowid) с сохранёнными хэшами одним
+ * запросом statement. Несовпавший диапазон делится пополам
+ * (SqliteChunkFingerprint::splitChunk), пока не останется один блок: его хэш обновляется, а rowid попадают
+ * в dirty (соседние блоки склеиваются). Неизменённые части таблицы так читаются один раз.
+*/
+bool SqliteReaderWorker::compareChunks(int request, sqlite3_stmt *statement, SqliteChunkFingerprint &fingerprint,
+                                       qint64 firstChunk, qint64 lastChunk,
+                                       QList<SqliteChunkFingerprint::Range> &dirty)
+{
+    if (!statement || isStale(request)) {
+        return false;
+    }
+    qint64 first = SqliteChunkFingerprint::firstRowid(firstChunk);
+    qint64 last = qMin(SqliteChunkFingerprint::lastRowid(lastChunk), fingerprint.maxRowid());
+    sqlite3_bind_int64(statement, 1, first);
+    sqlite3_bind_int64(statement, 2, last);
+    bool isRead = sqlite3_step(statement) == SQLITE_ROW;
+    quint64 hash = static_cast<quint64>(sqlite3_column_int64(statement, 0));
+    sqlite3_reset(statement);
+    if (!isRead) {
+        return false;
+    }
+    if (hash == fingerprint.rangeHash(firstChunk, lastChunk)) {
+        return true;
+    }
+    if (firstChunk == lastChunk) {
+        fingerprint.setChunk(firstChunk, hash);
+        if (!dirty.isEmpty() && dirty.last().second == first - 1) {
+            dirty.last().second = last;
+        } else {
+            dirty.append(qMakePair(first, last));
+        }
+        return true;
+    }
+    qint64 middle = fingerprint.splitChunk(firstChunk, lastChunk);
+    return compareChunks(request, statement, fingerprint, firstChunk, middle, dirty) &&
+           compareChunks(request, statement, fingerprint, middle + 1, lastChunk, dirty);
+}
+
+/*
+ * Дочитывание строк statement (rowid и все колонки по возрастанию
+ * rowid): хэши строк складываются по блокам и добавляются к
+ * сохранённым, так что блок прошлого максимума не перечитывается.
+ * Если есть insert, хэш каждой строки пишется и в ROW_HASHES.
+*/
+bool SqliteReaderWorker::scanChunks(int request, sqlite3_stmt *statement, SqliteChunkFingerprint &fingerprint,
+                                    sqlite3_stmt *insert)
+{
+    qint64 chunk = 0;
+    quint64 hash = 0;
+    qint64 rows = 0;
+    int status;
+    while ((status = sqlite3_step(statement)) == SQLITE_ROW) {
+        qint64 rowid = sqlite3_column_int64(statement, 0);
+        qint64 rowChunk = SqliteChunkFingerprint::chunkOf(rowid);
+        if (rows > 0 && rowChunk != chunk) {
+            fingerprint.addToChunk(chunk, hash);
+            hash = 0;
+        }
+        chunk = rowChunk;
+        quint64 rowHash = SqliteChunkFingerprint::rowHash(statement);
+        hash += rowHash;
+        if (insert) {
+            sqlite3_bind_int64(insert, 1, rowid);
+            sqlite3_bind_int64(insert, 2, static_cast<qint64>(rowHash));
+            bool isInserted = sqlite3_step(insert) == SQLITE_DONE;
+            sqlite3_reset(insert);
+            if (!isInserted) {
+                return false;
+            }
+        }
+        if (++rows % 65536 == 0 && isStale(request)) {
+            return false;
+        }
+    }
+    if (rows > 0) {
+        fingerprint.addToChunk(chunk, hash);
+    }
+    return status == SQLITE_DONE;
+}
+
+/*
+ * Дешёвая проверка изменения бд.
+ * Результат отправляется всегда, чтобы модель знала,
+ * что проверка закончилась.
+*/
+void SqliteReaderWorker::checkChanges()
+{
+    emit changesChecked(detector_ && detector_->hasChanged());
+}
+
+/*
+ * Чтение колонок таблицы или представления и ключа её строк.
+ * Вызывается один раз на таблицу, дальше модель берёт их
+ * из своего каталога. Сломанная таблица или представление
+ * (например ссылается на удалённую таблицу) сообщается
+ * сигналом columnsFailed, остальная бд остаётся открытой.
+*/
+void SqliteReaderWorker::loadColumns(const QString &table)
+{
+    if (!db_.isOpen()) {
+        return;
+    }
+    QStringList columns;
+    QStringList primaryKey;
+    QSqlQuery query(db_);
+    if (!query.exec(QString("pragma table_info({})").replace("{}", SqliteFilterCompiler::quoteIdentifier(table)))) {
+        emit columnsFailed(table, query.lastError().text());
+        return;
+    }
+    while (query.next()) {
+        columns.append(query.value(1).toString());
+        if (query.value(5).toInt() > 0) {
+            primaryKey.append(query.value(1).toString());
+        }
+    }
+    if (columns.isEmpty()) {
+        emit columnsFailed(table, "The table has no readable columns");
+        return;
+    }
+    emit columnsLoaded(table, columns, findKey(table, primaryKey));
+}
+
+/*
+ * Проверка схемы после изменения бд: каталог читается заново,
+ * только если schema_version бд отличается от schemaVersion,
+ * т.е. таблицы, представления или индексы изменились, иначе
+ * в catalogChecked приходит пустой каталог. Если версию
+ * прочитать не удалось, схема считается неизменной.
+*/
+void SqliteReaderWorker::checkCatalog(qint64 schemaVersion)
+{
+    SqliteSchemaCatalog catalog;
+    QSqlQuery query(db_);
+    if (!db_.isOpen() || !query.exec("pragma schema_version") || !query.next()
+            || query.value(0).toLongLong() == schemaVersion) {
+        emit catalogChecked(false, catalog);
+        return;
+    }
+    query.finish();
+    emit catalogChecked(readCatalog(catalog), catalog);
+}
+
+/*
+ * Список объектов схемы из sqlite_master (без служебных
+ * таблиц sqlite) и
+ * оценки количества строк: из sqlite_stat1, если бд
+ * анализировали, иначе по max(rowid), что стоит один спуск
+ * по b-дереву. У представлений и таблиц without rowid без
+ * статистики количество остаётся неизвестным.
+*/
+bool SqliteReaderWorker::readCatalog(SqliteSchemaCatalog &catalog)
+{
+    QSqlQuery query(db_);
+    query.setForwardOnly(true);
+    if (!query.exec("select type, name, tbl_name from sqlite_master "
+                    "where type in ('table', 'view', 'index') and name not like 'sqlite\\_%' escape '\\' "
+                    "order by rowid")) {
+        return false;
+    }
+    while (query.next()) {
+        QString type = query.value(0).toString();
+        SqliteSchemaCatalog::Object::Type objectType = SqliteSchemaCatalog::Object::Table;
+        if (type == "view") {
+            objectType = SqliteSchemaCatalog::Object::View;
+        } else if (type == "index") {
+            objectType = SqliteSchemaCatalog::Object::Index;
+        }
+        catalog.addObject(objectType, query.value(1).toString(), query.value(2).toString());
+    }
+    if (query.exec("pragma schema_version") && query.next()) {
+        catalog.setSchemaVersion(query.value(0).toLongLong());
+    }
+    if (query.exec("select tbl, max(cast(stat as integer)) from sqlite_stat1 group by tbl")) {
+        while (query.next()) {
+            catalog.setRowEstimate(query.value(0).toString(), query.value(1).toLongLong());
+        }
+    }
+    for (const QString &table : catalog.tables()) {
+        if (catalog.isView(table) || catalog.rowEstimate(table) >= 0) {
+            continue;
+        }
+        if (query.exec("select max(rowid) from " + SqliteFilterCompiler::quoteIdentifier(table)) && query.next()) {
+            catalog.setRowEstimate(table, query.value(0).toLongLong());
+        }
+    }
+    return true;
+}
+
+/*
+ * Ключ, по которому строки сопоставляются при синхронизации:
+ * rowid, а у таблиц without rowid - первичный ключ из одной
+ * колонки. Если ключа нет, возвращается пустая строка.
+*/
+QString SqliteReaderWorker::findKey(const QString &table, const QStringList &primaryKey)
+{
+    QSqlQuery query(db_);
+    if (query.exec("select rowid from " + SqliteFilterCompiler::quoteIdentifier(table) + " limit 0")) {
+        return "rowid";
+    }
+    if (primaryKey.size() == 1) {
+        return SqliteFilterCompiler::quoteIdentifier(primaryKey[0]);
+    }
+    return "";
+}
+
+/*
+ * Построение временного fts5 индекса для фильтров.
+ * Читает всю таблицу, поэтому строится только по явной
+ * просьбе пользователя. Если sqlite собран без fts5
+ * или trigram, индекс просто не строится.
+ * Построения нумеруются отдельно от запросов таблицы:
+ * cancelIndexBefore отменяет устаревшее построение и
+ * прерывает идущее, не трогая чтение страниц.
+*/
+void SqliteReaderWorker::buildFilterIndex(int request, const QString &table, const QStringList &columns)
+{
+    if (!db_.isOpen()) {
+        return;
+    }
+    {
+        QMutexLocker locker(&mutex_);
+        if (request < min_index_request_.loadAcquire()) {
+            return;
+        }
+        running_index_ = request;
+    }
+    SqliteFilterCompiler compiler;
+    compiler.setSource(table, columns, "");
+    allowTempWrites(true);
+    QSqlQuery query(db_);
+    bool isBuilt = query.exec(compiler.dropIndexStatement()) &&
+                   query.exec(compiler.createIndexStatement()) &&
+                   query.exec(compiler.fillIndexStatement());
+    {
+        QMutexLocker locker(&mutex_);
+        running_index_ = -1;
+    }
+    bool isCancelled = request < min_index_request_.loadAcquire();
+    if (!isBuilt || isCancelled) {
+        query.exec(compiler.dropIndexStatement());
+    }
+    allowTempWrites(false);
+    if (!isCancelled) {
+        emit filterIndexReady(request, table, isBuilt);
+    }
+}
+
+/*
+ * Отмена построений индекса фильтров младше request.
+ * Как и cancelBefore, можно вызывать из другого потока.
+*/
+void SqliteReaderWorker::cancelIndexBefore(int request)
+{
+    QMutexLocker locker(&mutex_);
+    if (request > min_index_request_.loadAcquire()) {
+        min_index_request_.storeRelease(request);
+    }
+    if (handle_ && running_index_ >= 0 && running_index_ < request) {
+        sqlite3_interrupt(handle_);
+    }
+}
+
+void SqliteReaderWorker::dropFilterIndex()
+{
+    if (!db_.isOpen()) {
+        return;
+    }
+    SqliteFilterCompiler compiler;
+    allowTempWrites(true);
+    QSqlQuery query(db_);
+    query.exec(compiler.dropIndexStatement());
+    allowTempWrites(false);
+}
+
+/*
+ * Сохранение ключей строк, подходящих под фильтры, во
+ * временную таблицу поколения generation. Прерывается так же,
+ * как и остальные запросы поколения. После успеха удаляются
+ * все прошлые множества, кроме source - по нему ещё могут
+ * идти запросы, которые модель отправила раньше, чем узнала
+ * о новом множестве.
+*/
+void SqliteReaderWorker::keepMatches(int generation, const QString &select, const QVariantList &values, int source)
+{
+    if (!beginRequest(generation)) {
+        return;
+    }
+    SqliteProfiler::Scope scope(profiler_, "keepMatches", "worker");
+    QString table = "temp." + SqliteFilterCompiler::matchesTable(generation);
+    allowTempWrites(true);
+    QSqlQuery query(db_);
+    bool isKept = query.exec("create temp table " + SqliteFilterCompiler::matchesTable(generation) + "(key)") &&
+                  query.prepare("insert into " + table + "(key) " + select);
+    for (const QVariant &value : values) {
+        query.addBindValue(value);
+    }
+    isKept = isKept && query.exec();
+    endRequest();
+    if (!isKept) {
+        failMatches(generation);
+        return;
+    }
+    acceptMatches(generation, source);
+}
+
+/*
+ * Сохранение множества совпадений, найденного параллельным
+ * проходом (SqliteParallelScan): keys - rowid подошедших строк
+ * по возрастанию. Вставка по возрастанию ключа идёт в конец
+ * b-дерева, поэтому стоит мало по сравнению с самим поиском.
+*/
+void SqliteReaderWorker::storeMatches(int generation, const QVector<qint64> &keys)
+{
+    if (!beginRequest(generation)) {
+        return;
+    }
+    SqliteProfiler::Scope scope(profiler_, "storeMatches", "worker");
+    QByteArray table = ("temp." + SqliteFilterCompiler::matchesTable(generation)).toUtf8();
+    QByteArray create = "create table " + table + "(key)";
+    allowTempWrites(true);
+    bool isKept = sqlite3_exec(handle_, create.constData(), nullptr, nullptr, nullptr) == SQLITE_OK &&
+                  sqlite3_exec(handle_, "begin", nullptr, nullptr, nullptr) == SQLITE_OK;
+    bool isBegun = isKept;
+    sqlite3_stmt *statement = nullptr;
+    QByteArray insert = "insert into " + table + "(key) values (?)";
+    isKept = isKept && sqlite3_prepare_v2(handle_, insert.constData(), insert.size(), &statement, nullptr) == SQLITE_OK;
+    for (int i = 0; isKept && i < keys.size(); i++) {
+        sqlite3_bind_int64(statement, 1, keys[i]);
+        isKept = sqlite3_step(statement) == SQLITE_DONE && !(i % 65536 == 0 && isStale(generation));
+        sqlite3_reset(statement);
+    }
+    sqlite3_finalize(statement);
+    if (isBegun) {
+        isKept = sqlite3_exec(handle_, isKept ? "commit" : "rollback", nullptr, nullptr, nullptr) == SQLITE_OK && isKept;
+    }
+    if (scope.isActive()) {
+        scope.setArg("keys", keys.size());
+    }
+    endRequest();
+    if (!isKept) {
+        failMatches(generation);
+        return;
+    }
+    acceptMatches(generation, -1);
+}
+
+/*
+ * Множество не сохранено. Запросы модели таблицы этого
+ * поколения читали бы несуществующую временную таблицу
+ * и закрыли бы бд, поэтому они отменяются, а модель
+ * получает matchesFailed и ищет строки без множества.
+ * Прерванное (устаревшее) сохранение просто отбрасывается.
+*/
+void SqliteReaderWorker::failMatches(int generation)
+{
+    dropMatches(generation);
+    allowTempWrites(false);
+    if (isStale(generation)) {
+        return;
+    }
+    cancelBefore(generation + 1);
+    emit matchesFailed(generation);
+}
+
+/*
+ * Множество generation сохранено: остальные, кроме
+ * source (по нему ещё могут сужаться фильтры), удаляются
+*/
+void SqliteReaderWorker::acceptMatches(int generation, int source)
+{
+    match_generations_.append(generation);
+    for (int kept : QList<int>(match_generations_)) {
+        if (kept != generation && kept != source) {
+            dropMatches(kept);
+        }
+    }
+    allowTempWrites(false);
+    emit matchesKept(generation);
+}
+
+void SqliteReaderWorker::dropMatches(int generation)
+{
+    QSqlQuery query(db_);
+    query.exec("drop table if exists temp." + SqliteFilterCompiler::matchesTable(generation));
+    match_generations_.removeAll(generation);
+}
+
+/*
+ * pragma query_only запрещает и запись во временные таблицы,
+ * поэтому на время работы с ними (индекс и множества фильтров)
+ * она снимается. Основная бд при этом остаётся защищена
+ * режимом только для чтения, если он включён.
+*/
+void SqliteReaderWorker::allowTempWrites(bool isAllowed)
+{
+    if (!profile_.isQueryOnly) {
+        return;
+    }
+    QSqlQuery query(db_);
+    query.exec(isAllowed ? "pragma query_only = 0" : "pragma query_only = 1");
+}
+
+/*
+ * Привязка значений к плейсхолдерам запроса по порядку.
+ * Тип параметра берётся из QVariant, всё, что не число
+ * и не массив байт, привязывается как текст.
+*/
+bool SqliteReaderWorker::bindValues(sqlite3_stmt *statement, const QVariantList &values)
+{
+    for (int i = 0; i < values.size(); i++) {
+        const QVariant &value = values[i];
+        int status;
+        switch (value.isNull() ? QMetaType::Void : static_cast<int>(value.type())) {
+        case QMetaType::Void:
+            status = sqlite3_bind_null(statement, i + 1);
+            break;
+        case QMetaType::Bool:
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::LongLong:
+            status = sqlite3_bind_int64(statement, i + 1, value.toLongLong());
+            break;
+        case QMetaType::Double:
+            status = sqlite3_bind_double(statement, i + 1, value.toDouble());
+            break;
+        case QMetaType::QByteArray: {
+            QByteArray bytes = value.toByteArray();
+            status = sqlite3_bind_blob(statement, i + 1, bytes.constData(), bytes.size(), SQLITE_TRANSIENT);
+            break;
+        }
+        default: {
+            QByteArray text = value.toString().toUtf8();
+            status = sqlite3_bind_text(statement, i + 1, text.constData(), text.size(), SQLITE_TRANSIENT);
+            break;
+        }
+        }
+        if (status != SQLITE_OK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SqliteReaderWorker::beginRequest(int generation)
+{
+    QMutexLocker locker(&mutex_);
+    if (isStale(generation)) {
+        return false;
+    }
+    running_ = generation;
+    return true;
+}
+
+void SqliteReaderWorker::endRequest()
+{
+    QMutexLocker locker(&mutex_);
+    running_ = -1;
+}
+
+/*
+ * Ошибка устаревшего запроса - это, скорее всего,
+ * sqlite3_interrupt, о ней сообщать не нужно.
+*/
+void SqliteReaderWorker::failRequest(int generation)
+{
+    if (!isStale(generation)) {
+        emit dbUnreachable(UnreachableDBException());
+    }
+}
+
+SqliteReaderWorker::~SqliteReaderWorker()
+{
+    close();
+}
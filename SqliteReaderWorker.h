@@ -0,0 +1,178 @@
+#ifndef SQLITEREADERWORKER_H
+#define SQLITEREADERWORKER_H
+
+#include <QObject>
+#include <QtSql/QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicInt>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+#include <sqlite3.h>
+
+#include "DBException.h"
+#include "UnsupportedDBException.h"
+#include "UnreachableDBException.h"
+#include "SqliteChangeDetector.h"
+#include "SqliteFilterCompiler.h"
+#include "SqliteResultBlock.h"
+#include "SqliteSchemaCatalog.h"
+#include "SqliteConnectionProfile.h"
+#include "SqliteProfiler.h"
+#include "SqliteStatementCache.h"
+#include "SqliteQueryPlan.h"
+#include "SqliteChunkFingerprint.h"
+
+/*
+ * Исполнитель запросов к бд в отдельном потоке.
+ * Владеет своим соединением, поэтому все его слоты
+ * нужно вызывать только через очередь событий
+ * (сигналами или QMetaObject::invokeMethod).
+ * Каждый запрос помечается поколением, запросы старых
+ * поколений отбрасываются, а выполняющийся прерывается
+ * через sqlite3_interrupt.
+ * Модель держит пул из двух исполнителей со своими
+ * соединениями: один читает таблицу (open), другой
+ * только следит за изменениями бд (watch), чтобы проверки
+ * синхронизации не ждали в очереди за чтением страниц.
+ * Частые запросы готовятся один раз (SqliteStatementCache).
+ * Большие значения в ленивых запросах (SqliteFilterCompiler::setLazy)
+ * читаются через sqlite3_blob_open: для таблицы только первые
+ * LAZY_PREFIX_SIZE байт, целиком - по readValue.
+ * Третий исполнитель пула (openConsole) выполняет запросы
+ * пользователя из консоли SQL: план и чтение строк в пределах
+ * бюджета (planQuery, runQuery).
+ * Исполнитель проверок, кроме того, обновляет отпечатки блоков
+ * rowid таблицы (updateFingerprint), по которым модель находит
+ * изменённые строки, не читая всю таблицу.
+*/
+class SqliteReaderWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    const int LAZY_PREFIX_SIZE = 256;  //байт начала ленивого значения, которые видны в таблице
+    const int CONSOLE_BLOCK_ROWS = 256;  //строк результата консоли в одном сигнале
+    const int CELL_BYTES = 8;  //байт, которые считаются за ячейку в бюджете консоли, кроме текста и blob
+    static const QStringList CONSOLE_PRAGMAS;  //прагмы, которые консоль может читать без значения
+    static const QStringList CONSOLE_TABLE_PRAGMAS;  //прагмы, которые консоль может читать по имени таблицы или индекса
+    static const QString ROW_HASHES;  //временная таблица хэшей строк для отпечатков (rowid, hash)
+    SqliteReaderWorker(const QString &connectionName = "SqliteReaderWorker");
+    void setProfiler(SqliteProfiler *profiler);
+    void cancelBefore(int generation);
+    void cancelIndexBefore(int request);
+    bool isStale(int generation) const;
+    static bool bindValues(sqlite3_stmt *statement, const QVariantList &values);
+    virtual ~SqliteReaderWorker();
+
+public slots:
+    void open(const QString &path, const SqliteConnectionProfile &profile);
+    void watch(const QString &path, const SqliteConnectionProfile &profile);
+    void openConsole(const QString &path, const SqliteConnectionProfile &profile);
+    void close();
+    void countRows(int generation, const QString &request, const QVariantList &values);
+    void fetchRows(int generation, const QString &request, const QVariantList &values,
+                   int offset, int skip, int pageSize, int pageCount);
+    void explainQuery(int generation, const QString &request, const QVariantList &values);
+    void checkQuery(int request, const QString &query);
+    void checkChanges();
+    void loadColumns(const QString &table);
+    void checkCatalog(qint64 schemaVersion);
+    void buildFilterIndex(int request, const QString &table, const QStringList &columns);
+    void dropFilterIndex();
+    void keepMatches(int generation, const QString &select, const QVariantList &values, int source);
+    void storeMatches(int generation, const QVector<qint64> &keys);
+    void readValue(int request, const QString &table, const QString &column, qint64 rowid);
+    void planQuery(int generation, const QString &request);
+    void runQuery(int generation, const QString &request, qint64 rowBudget, qint64 byteBudget);
+    void updateFingerprint(int request, const SqliteChunkFingerprint &fingerprint, bool isAppendOnly);
+
+signals:
+    void opened(const QString &path, const SqliteSchemaCatalog &catalog);
+    void columnsLoaded(const QString &table, const QStringList &columns, const QString &key);
+    void columnsFailed(const QString &table, const QString &error);
+    void catalogChecked(bool isChanged, const SqliteSchemaCatalog &catalog);
+    void rowCountReady(int generation, int count);
+    void rowsReady(int generation, int offset, const SqliteResultBlock &rows);
+    void changesChecked(bool isChanged);
+    void filterIndexReady(int request, const QString &table, bool isBuilt);
+    void matchesKept(int generation);
+    void matchesFailed(int generation);
+    void queryPlanReady(int generation, const QStringList &plan);
+    void queryChecked(int request, const QString &error);
+    void valueRead(int request, bool isRead, const QByteArray &value);
+    void planReady(int generation, const SqliteQueryPlan &plan);
+    void queryStarted(int generation, const QStringList &columns);
+    void queryFinished(int generation, qint64 rows, qint64 bytes, bool isTruncated);
+    void queryFailed(int generation, const QString &error);
+    void fingerprintReady(int request, const SqliteChunkFingerprint &fingerprint);
+    void dbUnreachable(const DBException &e);
+
+private:
+    /*
+     * Колонка ленивых значений запроса: value - колонка
+     * с самим значением (null, если оно большое), length -
+     * колонка с его длиной, blob открыт на последней строке.
+    */
+    struct LazyColumn
+    {
+        int value = 0;
+        int length = 0;
+        QByteArray table;
+        QByteArray name;
+        sqlite3_blob *blob = nullptr;
+    };
+
+    bool openConnection(const QString &path, const SqliteConnectionProfile &profile);
+    bool readCatalog(SqliteSchemaCatalog &catalog);
+    QString findKey(const QString &table, const QStringList &primaryKey);
+    bool beginRequest(int generation);
+    void endRequest();
+    void failRequest(int generation);
+    void dropMatches(int generation);
+    void failMatches(int generation);
+    void acceptMatches(int generation, int source);
+    void allowTempWrites(bool isAllowed);
+    QList<LazyColumn> lazyColumns(sqlite3_stmt *statement) const;
+    void readPrefixes(sqlite3_stmt *statement, SqliteResultBlock &rows, QList<LazyColumn> &lazies);
+    static void closeBlobs(QList<LazyColumn> &lazies);
+    static int utf8Boundary(const QByteArray &text);
+    sqlite3_stmt *prepareConsole(const QString &request, QString &error);
+    void rollbackConsole();
+    static int consoleAuthorizer(void *data, int action, const char *first, const char *second,
+                                 const char *database, const char *trigger);
+    qint64 rowBytes(sqlite3_stmt *statement) const;
+    bool compareChunks(int request, sqlite3_stmt *statement, SqliteChunkFingerprint &fingerprint,
+                       qint64 firstChunk, qint64 lastChunk, QList<SqliteChunkFingerprint::Range> &dirty);
+    bool scanChunks(int request, sqlite3_stmt *statement, SqliteChunkFingerprint &fingerprint,
+                    sqlite3_stmt *insert);
+    sqlite3_stmt *prepareRowHashes(bool isCreated);
+    bool diffRows(int request, const QString &select, sqlite3_stmt *insert,
+                  SqliteChunkFingerprint &fingerprint, qint64 first, qint64 last, bool isExact);
+
+    QString connection_name_;  //имя соединения потока, у каждого исполнителя своё
+    QSqlDatabase db_;
+    SqliteStatementCache statements_;  //подготовленные запросы соединения handle_
+    SqliteConnectionProfile profile_;  //настройки текущего соединения
+    SqliteChangeDetector *detector_ = nullptr;
+    SqliteProfiler *profiler_ = nullptr;  //замеры этапов, может быть nullptr
+    sqlite3 *handle_ = nullptr;  //нативное соединение для чтения строк и sqlite3_interrupt
+    int page_bytes_ = 0;  //размер арены последней прочитанной страницы, для reserve следующей
+    int running_ = -1;  //поколение выполняющегося запроса, -1 если простаивает
+    QList<int> match_generations_;  //поколения сохранённых множеств совпадений фильтров
+    int row_hashes_ = 0;  //номер состояния таблицы ROW_HASHES, растёт при каждой записи в неё
+    QAtomicInt min_generation_;  //запросы младше этого поколения устарели
+    int running_index_ = -1;  //номер идущего построения индекса фильтров, -1 если его нет
+    QAtomicInt min_index_request_;  //построения индекса младше этого номера отменены
+    mutable QMutex mutex_;  //защищает handle_, running_ и running_index_
+};
+
+#endif // SQLITEREADERWORKER_H
@@ -0,0 +1,417 @@
+#include "SqliteResultBlock.h"
+
+SqliteResultBlock::SqliteResultBlock(int columns)
+{
+    columns_.resize(columns);
+}
+
+/*
+ * Резервирование места под rows строк и bytes байт текста
+ * и blob, чтобы векторы и арена не перевыделялись при
+ * заполнении. bytes обычно берётся из прошлого блока того
+ * же запроса (byteSize).
+*/
+void SqliteResultBlock::reserve(int rows, int bytes)
+{
+    if (bytes > arena_.capacity()) {
+        arena_.reserve(bytes);
+    }
+    for (Column &column : columns_) {
+        column.types.reserve(rows);
+        column.values.reserve(rows);
+        column.nulls.reserve((rows + 63) / 64);
+        column.lazies.reserve((rows + 63) / 64);
+    }
+}
+
+/*
+ * Добавление текущей строки шага statement.
+ * Значения читаются прямо через sqlite3_column_*,
+ * без QVariant и QString.
+*/
+void SqliteResultBlock::appendRow(sqlite3_stmt *statement)
+{
+    for (int i = 0; i < columns_.size(); i++) {
+        Column &column = columns_[i];
+        int type = sqlite3_column_type(statement, i);
+        switch (type) {
+        case SQLITE_INTEGER:
+            appendCell(column, type, sqlite3_column_int64(statement, i));
+            break;
+        case SQLITE_FLOAT: {
+            double real = sqlite3_column_double(statement, i);
+            qint64 bits;
+            std::memcpy(&bits, &real, sizeof(bits));
+            appendCell(column, type, bits);
+            break;
+        }
+        case SQLITE_TEXT: {
+            const unsigned char *text = sqlite3_column_text(statement, i);
+            appendCell(column, type, store(text, sqlite3_column_bytes(statement, i)));
+            break;
+        }
+        case SQLITE_BLOB: {
+            const void *blob = sqlite3_column_blob(statement, i);
+            appendCell(column, type, store(blob, sqlite3_column_bytes(statement, i)));
+            break;
+        }
+        default:
+            appendCell(column, SQLITE_NULL, 0);
+            break;
+        }
+    }
+    row_count_++;
+}
+
+/*
+ * Замена ячейки (обычно null, см. SqliteFilterCompiler::setLazy)
+ * ленивым значением: type - SQLITE_TEXT или SQLITE_BLOB,
+ * length - полная длина в байтах, prefix - начало значения.
+*/
+void SqliteResultBlock::setLazyCell(int row, int column, int type, qint64 length, const QByteArray &prefix)
+{
+    Column &cells = columns_[column];
+    cells.types[row] = static_cast<quint8>(type);
+    cells.nulls[row / 64] &= ~(quint64(1) << (row % 64));
+    cells.lazies[row / 64] |= quint64(1) << (row % 64);
+    cells.values[row] = store(prefix.constData(), prefix.size());
+    arena_.append(reinterpret_cast<const char *>(&length), sizeof(length));
+}
+
+int SqliteResultBlock::rowCount() const
+{
+    return row_count_;
+}
+
+int SqliteResultBlock::columnCount() const
+{
+    return columns_.size();
+}
+
+/*
+ * Занятый размер арены: текст и blob с их длинами
+*/
+int SqliteResultBlock::byteSize() const
+{
+    return arena_.size();
+}
+
+/*
+ * Тип значения ячейки, как у sqlite3_column_type
+*/
+int SqliteResultBlock::type(int row, int column) const
+{
+    return columns_[column].types[row];
+}
+
+bool SqliteResultBlock::isNull(int row, int column) const
+{
+    return (columns_[column].nulls[row / 64] >> (row % 64)) & 1;
+}
+
+/*
+ * В блоке только начало значения, полная длина - length()
+*/
+bool SqliteResultBlock::isLazy(int row, int column) const
+{
+    return (columns_[column].lazies[row / 64] >> (row % 64)) & 1;
+}
+
+/*
+ * Длина текста или blob в байтах, в том числе ленивого
+*/
+qint64 SqliteResultBlock::length(int row, int column) const
+{
+    int size = 0;
+    const char *data = cellData(row, column, size);
+    if (!data || !isLazy(row, column)) {
+        return size;
+    }
+    qint64 length;
+    std::memcpy(&length, data + size, sizeof(length));
+    return length;
+}
+
+/*
+ * Целое значение ячейки. Вещественные округляются к нулю,
+ * у остальных типов 0.
+*/
+qint64 SqliteResultBlock::integer(int row, int column) const
+{
+    switch (type(row, column)) {
+    case SQLITE_INTEGER:
+        return columns_[column].values[row];
+    case SQLITE_FLOAT:
+        return static_cast<qint64>(real(row, column));
+    default:
+        return 0;
+    }
+}
+
+double SqliteResultBlock::real(int row, int column) const
+{
+    qint64 value = columns_[column].values[row];
+    switch (type(row, column)) {
+    case SQLITE_INTEGER:
+        return static_cast<double>(value);
+    case SQLITE_FLOAT: {
+        double real;
+        std::memcpy(&real, &value, sizeof(real));
+        return real;
+    }
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Байты текста (UTF-8) или blob без копирования.
+ * Результат ссылается на арену блока и живёт не дольше его.
+*/
+QByteArray SqliteResultBlock::bytes(int row, int column) const
+{
+    int size = 0;
+    const char *data = cellData(row, column, size);
+    return data ? QByteArray::fromRawData(data, size) : QByteArray();
+}
+
+/*
+ * Значение ячейки в виде строки для показа,
+ * так же, как раньше его давал QVariant::toString.
+ * У ленивого значения - его начало с многоточием.
+*/
+QString SqliteResultBlock::text(int row, int column) const
+{
+    switch (type(row, column)) {
+    case SQLITE_INTEGER:
+        return QString::number(integer(row, column));
+    case SQLITE_FLOAT:
+        return QString::number(real(row, column), 'g', QLocale::FloatingPointShortest);
+    case SQLITE_TEXT:
+    case SQLITE_BLOB: {
+        int size = 0;
+        const char *data = cellData(row, column, size);
+        QString result = QString::fromUtf8(data, size);
+        if (isLazy(row, column)) {
+            result.append(QChar(0x2026));
+        }
+        return result;
+    }
+    default:
+        return QString();
+    }
+}
+
+/*
+ * Значение ячейки с сохранением типа, например чтобы
+ * привязать его к плейсхолдеру запроса. Blob копируется,
+ * так что значение не зависит от блока. У ленивого значения
+ * есть только начало, целиком его читает исполнитель (readValue).
+*/
+QVariant SqliteResultBlock::value(int row, int column) const
+{
+    switch (type(row, column)) {
+    case SQLITE_INTEGER:
+        return QVariant(integer(row, column));
+    case SQLITE_FLOAT:
+        return QVariant(real(row, column));
+    case SQLITE_TEXT:
+        return QVariant(text(row, column));
+    case SQLITE_BLOB: {
+        int size = 0;
+        const char *data = cellData(row, column, size);
+        return QVariant(QByteArray(data, size));
+    }
+    default:
+        return QVariant();
+    }
+}
+
+/*
+ * Ячейка совпадает с ячейкой otherRow другого блока
+ * по типу и значению. Две ленивые ячейки никогда не
+ * совпадают: одинаковые начало и длина не значат, что
+ * совпал остаток (blob постоянной длины, правка json без
+ * смены длины), так что их строка всегда считается
+ * изменённой (SqliteRowDiff), и view перечитывает ячейку.
+*/
+bool SqliteResultBlock::isEqual(int row, int column, const SqliteResultBlock &other, int otherRow) const
+{
+    if (column >= other.columnCount()) {
+        return false;
+    }
+    int cellType = type(row, column);
+    if (cellType != other.type(otherRow, column)) {
+        return false;
+    }
+    if (cellType == SQLITE_INTEGER || cellType == SQLITE_FLOAT) {
+        return columns_[column].values[row] == other.columns_[column].values[otherRow];
+    }
+    if (cellType == SQLITE_NULL) {
+        return true;
+    }
+    if (isLazy(row, column) || other.isLazy(otherRow, column)) {
+        return false;
+    }
+    int size = 0;
+    int otherSize = 0;
+    const char *data = cellData(row, column, size);
+    const char *otherData = other.cellData(otherRow, column, otherSize);
+    return size == otherSize && std::memcmp(data, otherData, size) == 0;
+}
+
+/*
+ * Хэш ключа строки из первых keyColumns колонок для
+ * сопоставления строк разных блоков. Байты текста и blob
+ * хэшируются прямо в арене. Равные ключи дают равный хэш,
+ * обратное проверяет isSameKey.
+*/
+quint64 SqliteResultBlock::keyHash(int row, int keyColumns) const
+{
+    quint64 hash = 0;
+    for (int i = 0; i < keyColumns && i < columns_.size(); i++) {
+        int cellType = type(row, i);
+        if (cellType == SQLITE_TEXT || cellType == SQLITE_BLOB) {
+            int size = 0;
+            const char *data = cellData(row, i, size);
+            hash = hash * 31 + qHashBits(data, size, static_cast<uint>(cellType));
+        } else {
+            qint64 value = columns_[i].values[row];
+            hash = hash * 31 + qHashBits(&value, sizeof(value), static_cast<uint>(cellType));
+        }
+    }
+    return hash;
+}
+
+bool SqliteResultBlock::isSameKey(int row, int keyColumns, const SqliteResultBlock &other, int otherRow) const
+{
+    for (int i = 0; i < keyColumns && i < columns_.size(); i++) {
+        if (!isEqual(row, i, other, otherRow)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SqliteResultBlock::appendCell(Column &column, int type, qint64 value)
+{
+    if (row_count_ % 64 == 0) {
+        column.nulls.append(0);
+        column.lazies.append(0);
+    }
+    if (type == SQLITE_NULL) {
+        column.nulls.last() |= quint64(1) << (row_count_ % 64);
+    }
+    column.types.append(static_cast<quint8>(type));
+    column.values.append(value);
+}
+
+/*
+ * Копирование значения в арену, возвращает его смещение
+*/
+qint64 SqliteResultBlock::store(const void *data, int size)
+{
+    qint64 offset = arena_.size();
+    quint32 length = static_cast<quint32>(size);
+    arena_.append(reinterpret_cast<const char *>(&length), sizeof(length));
+    if (size > 0) {
+        arena_.append(static_cast<const char *>(data), size);
+    }
+    return offset;
+}
+
+/*
+ * Прочитанный из файла блок из rows строк цел: у каждой
+ * ячейки текста и blob длина и байты (и полная длина
+ * ленивой) лежат внутри арены, типы - типы sqlite.
+ * Иначе cellData читал бы за концом арены.
+*/
+bool SqliteResultBlock::isStored(int rows) const
+{
+    qint64 arenaSize = arena_.size();
+    for (const Column &column : columns_) {
+        for (int row = 0; row < rows; row++) {
+            int cellType = column.types[row];
+            if (cellType < SQLITE_INTEGER || cellType > SQLITE_NULL) {
+                return false;
+            }
+            if (cellType != SQLITE_TEXT && cellType != SQLITE_BLOB) {
+                continue;
+            }
+            qint64 offset = column.values[row];
+            if (offset < 0 || offset > arenaSize - static_cast<qint64>(sizeof(quint32))) {
+                return false;
+            }
+            quint32 length;
+            std::memcpy(&length, arena_.constData() + offset, sizeof(length));
+            qint64 end = offset + static_cast<qint64>(sizeof(length)) + length;
+            if ((column.lazies[row / 64] >> (row % 64)) & 1) {
+                end += sizeof(qint64);
+            }
+            if (end > arenaSize) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+const char *SqliteResultBlock::cellData(int row, int column, int &size) const
+{
+    int cellType = type(row, column);
+    if (cellType != SQLITE_TEXT && cellType != SQLITE_BLOB) {
+        size = 0;
+        return nullptr;
+    }
+    const char *data = arena_.constData() + columns_[column].values[row];
+    quint32 length;
+    std::memcpy(&length, data, sizeof(length));
+    size = static_cast<int>(length);
+    return data + sizeof(length);
+}
+
+SqliteResultBlock::~SqliteResultBlock()
+{
+
+}
+
+/*
+ * Блок в двоичном виде для SqliteSidecarCache: векторы
+ * колонок и арена как есть. Длины в арене лежат в порядке
+ * байт машины, поэтому кэш с другим порядком не читается.
+*/
+QDataStream &operator<<(QDataStream &stream, const SqliteResultBlock &block)
+{
+    stream << static_cast<qint32>(block.row_count_) << static_cast<qint32>(block.columns_.size());
+    for (const SqliteResultBlock::Column &column : block.columns_) {
+        stream << column.types << column.values << column.nulls << column.lazies;
+    }
+    stream << block.arena_;
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, SqliteResultBlock &block)
+{
+    qint32 rows = 0;
+    qint32 columns = 0;
+    stream >> rows >> columns;
+    block = SqliteResultBlock(qMax(0, columns));
+    int words = (qMax(0, rows) + 63) / 64;
+    for (SqliteResultBlock::Column &column : block.columns_) {
+        stream >> column.types >> column.values >> column.nulls >> column.lazies;
+        if (rows < 0 || column.types.size() != rows || column.values.size() != rows ||
+                column.nulls.size() != words || column.lazies.size() != words) {
+            stream.setStatus(QDataStream::ReadCorruptData);
+        }
+    }
+    stream >> block.arena_;
+    if (stream.status() == QDataStream::Ok && !block.isStored(rows)) {
+        stream.setStatus(QDataStream::ReadCorruptData);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        block = SqliteResultBlock();
+        return stream;
+    }
+    block.row_count_ = rows;
+    return stream;
+}
@@ -0,0 +1,88 @@
+#ifndef SQLITERESULTBLOCK_H
+#define SQLITERESULTBLOCK_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QHash>
+#include <QLocale>
+#include <QMetaType>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+#include <cstring>
+
+#include <sqlite3.h>
+
+/*
+ * Блок строк результата запроса, хранящийся по колонкам.
+ * Значения не превращаются в QString: у каждой колонки есть
+ * вектор типов (SQLITE_INTEGER, SQLITE_FLOAT, ...), вектор
+ * 64-битных значений и битовая маска null. Целые лежат в векторе
+ * как есть, вещественные - своими битами, а текст (UTF-8 как его
+ * отдаёт sqlite) и blob - в общей арене блока, в векторе хранится
+ * смещение. Строка для view получается только в text(), то есть
+ * только для ячеек, которые view рисует. Арену можно заранее
+ * зарезервировать (reserve), тогда байты каждой ячейки копируются
+ * из sqlite3_column_text один раз и без перевыделений.
+ * Строки разных блоков сопоставляются по хэшу ключа (keyHash)
+ * без сборки ключа в отдельный буфер.
+ * Большие текст и blob могут храниться лениво (setLazyCell):
+ * в арене только начало значения и полная длина, а целиком
+ * значение читается из бд только по запросу.
+ * Копирование дешёвое (неявное разделение Qt), поэтому блок
+ * можно отправлять сигналом между потоками.
+*/
+class SqliteResultBlock
+{
+public:
+    SqliteResultBlock(int columns = 0);
+    void reserve(int rows, int bytes = 0);
+    void appendRow(sqlite3_stmt *statement);
+    void setLazyCell(int row, int column, int type, qint64 length, const QByteArray &prefix);
+    int rowCount() const;
+    int columnCount() const;
+    int byteSize() const;
+    int type(int row, int column) const;
+    bool isNull(int row, int column) const;
+    bool isLazy(int row, int column) const;
+    qint64 length(int row, int column) const;
+    qint64 integer(int row, int column) const;
+    double real(int row, int column) const;
+    QByteArray bytes(int row, int column) const;
+    QString text(int row, int column) const;
+    QVariant value(int row, int column) const;
+    bool isEqual(int row, int column, const SqliteResultBlock &other, int otherRow) const;
+    quint64 keyHash(int row, int keyColumns) const;
+    bool isSameKey(int row, int keyColumns, const SqliteResultBlock &other, int otherRow) const;
+    virtual ~SqliteResultBlock();
+    friend QDataStream &operator<<(QDataStream &stream, const SqliteResultBlock &block);
+    friend QDataStream &operator>>(QDataStream &stream, SqliteResultBlock &block);
+
+private:
+    /*
+     * Одна колонка блока. values[i] - само значение для целых,
+     * биты double для вещественных, смещение в арене для
+     * текста и blob.
+    */
+    struct Column
+    {
+        QVector<quint8> types;
+        QVector<qint64> values;
+        QVector<quint64> nulls;  //бит строки установлен, если значение null
+        QVector<quint64> lazies;  //бит строки установлен, если в арене только начало значения
+    };
+
+    void appendCell(Column &column, int type, qint64 value);
+    qint64 store(const void *data, int size);
+    const char *cellData(int row, int column, int &size) const;
+    bool isStored(int rows) const;
+
+    QVector<Column> columns_;
+    QByteArray arena_;  //текст и blob всех колонок, перед каждым значением его длина, после ленивых - полная длина
+    int row_count_ = 0;
+};
+
+Q_DECLARE_METATYPE(SqliteResultBlock)
+
+#endif // SQLITERESULTBLOCK_H
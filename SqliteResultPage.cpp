@@ -0,0 +1,118 @@
+#include "SqliteResultPage.h"
+
+SqliteResultPage::SqliteResultPage()
+{
+
+}
+
+SqliteResultPage::SqliteResultPage(const QStringList &columns, int firstRow, int totalRowCount,
+                                   const SqliteResultBlock &rows, int keyColumns)
+{
+    columns_ = columns;
+    first_row_ = firstRow;
+    total_row_count_ = totalRowCount;
+    rows_ = rows;
+    key_columns_ = keyColumns;
+}
+
+/*
+ * Результат запроса, который не выполнен.
+ * error - текст ошибки для показа.
+*/
+SqliteResultPage SqliteResultPage::failure(const QString &error)
+{
+    SqliteResultPage page;
+    page.error_ = error.isEmpty() ? QString("Unknown error") : error;
+    return page;
+}
+
+bool SqliteResultPage::isValid() const
+{
+    return error_.isEmpty();
+}
+
+QString SqliteResultPage::error() const
+{
+    return error_;
+}
+
+QStringList SqliteResultPage::columns() const
+{
+    return columns_;
+}
+
+int SqliteResultPage::firstRow() const
+{
+    return first_row_;
+}
+
+int SqliteResultPage::rowCount() const
+{
+    return rows_.rowCount();
+}
+
+int SqliteResultPage::totalRowCount() const
+{
+    return total_row_count_;
+}
+
+/*
+ * Значение ячейки с сохранением типа
+ * (см. SqliteResultBlock::value)
+*/
+QVariant SqliteResultPage::value(int row, int column) const
+{
+    if (row < 0 || row >= rows_.rowCount() || column < 0 || column + key_columns_ >= rows_.columnCount()) {
+        return QVariant();
+    }
+    return rows_.value(row, column + key_columns_);
+}
+
+/*
+ * Значение ячейки в виде строки, как его показывает view
+*/
+QString SqliteResultPage::text(int row, int column) const
+{
+    if (row < 0 || row >= rows_.rowCount() || column < 0 || column + key_columns_ >= rows_.columnCount()) {
+        return QString();
+    }
+    return rows_.text(row, column + key_columns_);
+}
+
+/*
+ * В ячейке только начало значения: value и text его
+ * обрезают (text - с многоточием), целиком его читает
+ * SqliteReaderModel::openValue
+*/
+bool SqliteResultPage::isLazy(int row, int column) const
+{
+    if (row < 0 || row >= rows_.rowCount() || column < 0 || column + key_columns_ >= rows_.columnCount()) {
+        return false;
+    }
+    return rows_.isLazy(row, column + key_columns_);
+}
+
+/*
+ * Полная длина текста или blob в байтах, в том числе ленивого
+*/
+qint64 SqliteResultPage::length(int row, int column) const
+{
+    if (row < 0 || row >= rows_.rowCount() || column < 0 || column + key_columns_ >= rows_.columnCount()) {
+        return 0;
+    }
+    return rows_.length(row, column + key_columns_);
+}
+
+/*
+ * Строки страницы как их прочитал исполнитель,
+ * вместе с колонками ключа
+*/
+const SqliteResultBlock &SqliteResultPage::block() const
+{
+    return rows_;
+}
+
+SqliteResultPage::~SqliteResultPage()
+{
+
+}
@@ -0,0 +1,54 @@
+#ifndef SQLITERESULTPAGE_H
+#define SQLITERESULTPAGE_H
+
+#include <QMetaType>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+#include "SqliteResultBlock.h"
+
+/*
+ * Результат асинхронного запроса к SqliteReaderModel
+ * (openAsync, queryAsync, filterAsync, fetchPageAsync):
+ * одна страница строк текущего запроса таблицы, номер её
+ * первой строки и количество строк всего запроса. Ошибка
+ * тоже возвращается значением (failure), а не исключением,
+ * так что future всегда заканчивается результатом.
+ * Колонки ключа строки в блоке пропускаются: номера колонок
+ * value и text - те же, что в columns.
+ * Большие текст и blob модель таблицы читает лениво: в такой
+ * ячейке (isLazy) только начало значения, полная длина - length.
+*/
+class SqliteResultPage
+{
+public:
+    SqliteResultPage();
+    SqliteResultPage(const QStringList &columns, int firstRow, int totalRowCount,
+                     const SqliteResultBlock &rows, int keyColumns);
+    static SqliteResultPage failure(const QString &error);
+    bool isValid() const;
+    QString error() const;
+    QStringList columns() const;
+    int firstRow() const;
+    int rowCount() const;
+    int totalRowCount() const;
+    QVariant value(int row, int column) const;
+    QString text(int row, int column) const;
+    bool isLazy(int row, int column) const;
+    qint64 length(int row, int column) const;
+    const SqliteResultBlock &block() const;
+    virtual ~SqliteResultPage();
+
+private:
+    QString error_ = "";  //пустая - запрос выполнен
+    QStringList columns_;
+    int first_row_ = 0;  //номер первой строки страницы в запросе, с 0
+    int total_row_count_ = 0;  //строк во всём запросе с фильтрами
+    SqliteResultBlock rows_;
+    int key_columns_ = 0;  //сколько первых колонок блока занимает ключ строки
+};
+
+Q_DECLARE_METATYPE(SqliteResultPage)
+
+#endif // SQLITERESULTPAGE_H
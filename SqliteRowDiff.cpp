@@ -0,0 +1,166 @@
+#include "SqliteRowDiff.h"
+
+SqliteRowDiff::SqliteRowDiff()
+{
+
+}
+
+/*
+ * Список операций, превращающих oldRows в newRows.
+ * keyColumns - сколько первых ячеек строки занимает ключ,
+ * 0 если ключа нет.
+*/
+QList<SqliteRowDiff::Operation> SqliteRowDiff::compute(const SqliteResultBlock &oldRows,
+                                                       const SqliteResultBlock &newRows, int keyColumns)
+{
+    key_columns_ = keyColumns;
+    operations_.clear();
+    if (key_columns_ == 0 || !computeKeyed(oldRows, newRows)) {
+        operations_.clear();
+        computePositional(oldRows, newRows);
+    }
+    return operations_;
+}
+
+/*
+ * Сопоставление по ключу.
+ * Сначала удаления снизу вверх (номера старые), потом вставки
+ * сверху вниз (номера новые), потом изменения (номера новые).
+ * Если ключи (или их хэши) повторяются или оставшиеся строки
+ * поменяли порядок, то возвращается false.
+ * Хэши ключей считаются один раз на строку, ключи
+ * в отдельные буферы не копируются.
+*/
+bool SqliteRowDiff::computeKeyed(const SqliteResultBlock &oldRows, const SqliteResultBlock &newRows)
+{
+    QVector<quint64> oldHashes(oldRows.rowCount());
+    QVector<quint64> newHashes(newRows.rowCount());
+    QHash<quint64, int> oldIndex;
+    QHash<quint64, int> newIndex;
+    oldIndex.reserve(oldRows.rowCount());
+    newIndex.reserve(newRows.rowCount());
+    for (int i = 0; i < oldRows.rowCount(); i++) {
+        oldHashes[i] = oldRows.keyHash(i, key_columns_);
+        oldIndex.insert(oldHashes[i], i);
+    }
+    for (int i = 0; i < newRows.rowCount(); i++) {
+        newHashes[i] = newRows.keyHash(i, key_columns_);
+        newIndex.insert(newHashes[i], i);
+    }
+    if (oldIndex.size() != oldRows.rowCount() || newIndex.size() != newRows.rowCount()) {
+        return false;
+    }
+    int lastKept = -1;
+    for (int i = 0; i < oldRows.rowCount(); i++) {
+        int kept = find(newIndex, newRows, oldHashes[i], oldRows, i);
+        if (kept < 0) {
+            continue;
+        }
+        if (kept < lastKept) {
+            return false;
+        }
+        lastKept = kept;
+    }
+    for (int i = oldRows.rowCount() - 1; i >= 0; i--) {
+        if (find(newIndex, newRows, oldHashes[i], oldRows, i) < 0) {
+            appendOperation(Operation::Remove, i);
+        }
+    }
+    for (int i = 0; i < newRows.rowCount(); i++) {
+        if (find(oldIndex, oldRows, newHashes[i], newRows, i) < 0) {
+            appendOperation(Operation::Insert, i);
+        }
+    }
+    for (int i = 0; i < newRows.rowCount(); i++) {
+        int old = find(oldIndex, oldRows, newHashes[i], newRows, i);
+        if (old >= 0) {
+            compareRows(oldRows, old, newRows, i);
+        }
+    }
+    return true;
+}
+
+/*
+ * Сравнение по позициям: общая часть построчно,
+ * хвост удаляется или добавляется целиком.
+*/
+void SqliteRowDiff::computePositional(const SqliteResultBlock &oldRows, const SqliteResultBlock &newRows)
+{
+    int common = qMin(oldRows.rowCount(), newRows.rowCount());
+    if (oldRows.rowCount() > common) {
+        operations_.append({Operation::Remove, common, oldRows.rowCount() - 1, 0, 0});
+    }
+    if (newRows.rowCount() > common) {
+        operations_.append({Operation::Insert, common, newRows.rowCount() - 1, 0, 0});
+    }
+    for (int i = 0; i < common; i++) {
+        compareRows(oldRows, i, newRows, i);
+    }
+}
+
+/*
+ * Изменение строки newRow, если хотя бы одна ячейка отличается
+ * от строки oldRow старого блока.
+ * Колонки считаются без ключа.
+*/
+void SqliteRowDiff::compareRows(const SqliteResultBlock &oldRows, int oldRow,
+                                const SqliteResultBlock &newRows, int newRow)
+{
+    int columns = qMax(oldRows.columnCount(), newRows.columnCount());
+    int firstColumn = -1;
+    int lastColumn = -1;
+    for (int i = key_columns_; i < columns; i++) {
+        bool isEqual = i < oldRows.columnCount() && oldRows.isEqual(oldRow, i, newRows, newRow);
+        if (!isEqual) {
+            if (firstColumn < 0) {
+                firstColumn = i;
+            }
+            lastColumn = i;
+        }
+    }
+    if (firstColumn >= 0) {
+        appendOperation(Operation::Update, newRow, firstColumn - key_columns_, lastColumn - key_columns_);
+    }
+}
+
+/*
+ * Добавление операции над одной строкой. Соседние строки
+ * с одинаковой операцией склеиваются в один диапазон.
+*/
+void SqliteRowDiff::appendOperation(Operation::Type type, int row, int firstColumn, int lastColumn)
+{
+    if (!operations_.isEmpty() && operations_.last().type == type) {
+        Operation &previous = operations_.last();
+        if (type == Operation::Remove && previous.first == row + 1) {
+            previous.first = row;
+            return;
+        }
+        if (type != Operation::Remove && previous.last == row - 1) {
+            previous.last = row;
+            previous.firstColumn = qMin(previous.firstColumn, firstColumn);
+            previous.lastColumn = qMax(previous.lastColumn, lastColumn);
+            return;
+        }
+    }
+    operations_.append({type, row, row, firstColumn, lastColumn});
+}
+
+/*
+ * Строка блока indexed с тем же ключом, что у строки row
+ * блока rows, или -1. Совпадение хэша проверяется сравнением
+ * самих ключей.
+*/
+int SqliteRowDiff::find(const QHash<quint64, int> &index, const SqliteResultBlock &indexed,
+                        quint64 hash, const SqliteResultBlock &rows, int row) const
+{
+    int found = index.value(hash, -1);
+    if (found < 0 || !rows.isSameKey(row, key_columns_, indexed, found)) {
+        return -1;
+    }
+    return found;
+}
+
+SqliteRowDiff::~SqliteRowDiff()
+{
+
+}
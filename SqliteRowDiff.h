@@ -0,0 +1,53 @@
+#ifndef SQLITEROWDIFF_H
+#define SQLITEROWDIFF_H
+
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+#include "SqliteResultBlock.h"
+
+/*
+ * Сравнение старой и новой версии окна строк.
+ * Если в строках есть ключ (rowid или первичный ключ в
+ * первых keyColumns ячейках), то строки сопоставляются по
+ * хэшу ключа (SqliteResultBlock::keyHash) и получаются
+ * удаления, вставки и изменения.
+ * Без ключа (или если порядок ключей поменялся) строки
+ * сравниваются по позициям.
+ * Операции нужно применять в том порядке, в котором они
+ * лежат в списке: номера строк каждой операции даны для
+ * состояния после всех предыдущих.
+*/
+class SqliteRowDiff
+{
+public:
+    struct Operation
+    {
+        enum Type { Remove, Insert, Update };
+        Type type;
+        int first;  //первая строка относительно начала окна
+        int last;  //последняя строка включительно
+        int firstColumn;  //для Update: изменившиеся колонки (без ключа)
+        int lastColumn;
+    };
+
+    SqliteRowDiff();
+    QList<Operation> compute(const SqliteResultBlock &oldRows,
+                             const SqliteResultBlock &newRows, int keyColumns);
+    virtual ~SqliteRowDiff();
+
+private:
+    bool computeKeyed(const SqliteResultBlock &oldRows, const SqliteResultBlock &newRows);
+    void computePositional(const SqliteResultBlock &oldRows, const SqliteResultBlock &newRows);
+    void compareRows(const SqliteResultBlock &oldRows, int oldRow,
+                     const SqliteResultBlock &newRows, int newRow);
+    void appendOperation(Operation::Type type, int row, int firstColumn = 0, int lastColumn = 0);
+    int find(const QHash<quint64, int> &index, const SqliteResultBlock &indexed,
+             quint64 hash, const SqliteResultBlock &rows, int row) const;
+
+    int key_columns_ = 0;
+    QList<Operation> operations_;
+};
+
+#endif // SQLITEROWDIFF_H
@@ -0,0 +1,270 @@
+#include "SqliteScanSummary.h"
+
+SqliteScanSummary::SqliteScanSummary(int columns)
+{
+    columns_.resize(columns);
+}
+
+/*
+ * Строка текущего шага statement, колонки сводки
+ * начинаются с колонки запроса firstColumn
+*/
+void SqliteScanSummary::addRow(sqlite3_stmt *statement, int firstColumn)
+{
+    row_count_++;
+    for (int i = 0; i < columns_.size(); i++) {
+        Column &column = columns_[i];
+        Value value = cellValue(statement, firstColumn + i);
+        if (value.type == SQLITE_NULL) {
+            column.nulls++;
+            continue;
+        }
+        column.values++;
+        quint64 hash = valueHash(value);
+        column.distinct.add(hash);
+        if (!column.frequent.increment(hash)) {
+            Value shown = value;
+            shown.bytes = value.bytes.left(VALUE_BYTES);
+            column.frequent.insert(hash, variant(shown));
+        }
+        if (value.type == SQLITE_INTEGER) {
+            column.histogram.add(static_cast<double>(value.integer));
+        } else if (value.type == SQLITE_FLOAT) {
+            column.histogram.add(value.real);
+        }
+        if (column.minimum.type == SQLITE_NULL || compare(value, column.minimum) < 0) {
+            column.minimum = copyValue(value);
+        }
+        if (column.maximum.type == SQLITE_NULL || compare(value, column.maximum) > 0) {
+            column.maximum = copyValue(value);
+        }
+    }
+}
+
+/*
+ * Добавление сводки другой части строк с теми же колонками
+*/
+void SqliteScanSummary::merge(const SqliteScanSummary &other)
+{
+    row_count_ += other.row_count_;
+    for (int i = 0; i < columns_.size() && i < other.columns_.size(); i++) {
+        Column &column = columns_[i];
+        const Column &otherColumn = other.columns_[i];
+        column.values += otherColumn.values;
+        column.nulls += otherColumn.nulls;
+        column.distinct.merge(otherColumn.distinct);
+        column.frequent.merge(otherColumn.frequent);
+        column.histogram.merge(otherColumn.histogram);
+        if (otherColumn.minimum.type != SQLITE_NULL &&
+                (column.minimum.type == SQLITE_NULL || compare(otherColumn.minimum, column.minimum) < 0)) {
+            column.minimum = otherColumn.minimum;
+        }
+        if (otherColumn.maximum.type != SQLITE_NULL &&
+                (column.maximum.type == SQLITE_NULL || compare(otherColumn.maximum, column.maximum) > 0)) {
+            column.maximum = otherColumn.maximum;
+        }
+    }
+}
+
+qint64 SqliteScanSummary::rowCount() const
+{
+    return row_count_;
+}
+
+int SqliteScanSummary::columnCount() const
+{
+    return columns_.size();
+}
+
+/*
+ * Количество не null значений колонки
+*/
+qint64 SqliteScanSummary::valueCount(int column) const
+{
+    return columns_[column].values;
+}
+
+qint64 SqliteScanSummary::nullCount(int column) const
+{
+    return columns_[column].nulls;
+}
+
+/*
+ * Минимум колонки: qint64, double, QString или QByteArray (blob),
+ * невалидный, если в колонке только null
+*/
+QVariant SqliteScanSummary::minimum(int column) const
+{
+    return variant(columns_[column].minimum);
+}
+
+QVariant SqliteScanSummary::maximum(int column) const
+{
+    return variant(columns_[column].maximum);
+}
+
+qint64 SqliteScanSummary::distinctEstimate(int column) const
+{
+    if (columns_[column].values == 0) {
+        return 0;
+    }
+    return qMax<qint64>(1, qMin(columns_[column].distinct.estimate(), columns_[column].values));
+}
+
+/*
+ * count самых частых значений колонки по убыванию (у длинных
+ * текста и blob - только начало, VALUE_BYTES байт)
+*/
+QList<SqliteSpaceSaving::Item> SqliteScanSummary::frequentValues(int column, int count) const
+{
+    return columns_[column].frequent.top(count);
+}
+
+/*
+ * Гистограмма целых и вещественных значений колонки
+*/
+const SqliteHistogram &SqliteScanSummary::histogram(int column) const
+{
+    return columns_[column].histogram;
+}
+
+SqliteScanSummary::Value SqliteScanSummary::cellValue(sqlite3_stmt *statement, int column)
+{
+    Value value;
+    value.type = sqlite3_column_type(statement, column);
+    switch (value.type) {
+    case SQLITE_INTEGER:
+        value.integer = sqlite3_column_int64(statement, column);
+        break;
+    case SQLITE_FLOAT:
+        value.real = sqlite3_column_double(statement, column);
+        break;
+    case SQLITE_TEXT: {
+        const char *data = reinterpret_cast<const char *>(sqlite3_column_text(statement, column));
+        value.bytes = QByteArray::fromRawData(data, sqlite3_column_bytes(statement, column));
+        break;
+    }
+    case SQLITE_BLOB: {
+        const char *data = static_cast<const char *>(sqlite3_column_blob(statement, column));
+        value.bytes = QByteArray::fromRawData(data, sqlite3_column_bytes(statement, column));
+        break;
+    }
+    default:
+        break;
+    }
+    return value;
+}
+
+/*
+ * Копия, которая не ссылается на память sqlite3_step
+*/
+SqliteScanSummary::Value SqliteScanSummary::copyValue(const Value &value)
+{
+    Value copy = value;
+    copy.bytes = QByteArray(value.bytes.constData(), value.bytes.size());
+    return copy;
+}
+
+/*
+ * Хэш для оценки различных значений. Целое вещественное
+ * хэшируется как целое: в sqlite 1 и 1.0 - одно значение.
+*/
+quint64 SqliteScanSummary::valueHash(const Value &value)
+{
+    switch (value.type) {
+    case SQLITE_INTEGER:
+        return SqliteHyperLogLog::hash(&value.integer, sizeof(value.integer), SQLITE_INTEGER);
+    case SQLITE_FLOAT: {
+        if (value.real >= -9.2e18 && value.real <= 9.2e18 &&
+                static_cast<double>(static_cast<qint64>(value.real)) == value.real) {
+            qint64 integer = static_cast<qint64>(value.real);
+            return SqliteHyperLogLog::hash(&integer, sizeof(integer), SQLITE_INTEGER);
+        }
+        return SqliteHyperLogLog::hash(&value.real, sizeof(value.real), SQLITE_FLOAT);
+    }
+    default:
+        return SqliteHyperLogLog::hash(value.bytes.constData(), value.bytes.size(), value.type);
+    }
+}
+
+/*
+ * Сравнение не null значений: меньше нуля, если value меньше other
+*/
+int SqliteScanSummary::compare(const Value &value, const Value &other)
+{
+    int rank = value.type == SQLITE_FLOAT ? SQLITE_INTEGER : value.type;  //числа сравниваются между собой
+    int otherRank = other.type == SQLITE_FLOAT ? SQLITE_INTEGER : other.type;
+    if (rank != otherRank) {
+        return rank < otherRank ? -1 : 1;  //SQLITE_INTEGER < SQLITE_TEXT < SQLITE_BLOB
+    }
+    if (value.type == SQLITE_INTEGER && other.type == SQLITE_INTEGER) {
+        return value.integer < other.integer ? -1 : value.integer > other.integer;
+    }
+    if (rank == SQLITE_INTEGER) {
+        double real = value.type == SQLITE_INTEGER ? static_cast<double>(value.integer) : value.real;
+        double otherReal = other.type == SQLITE_INTEGER ? static_cast<double>(other.integer) : other.real;
+        return real < otherReal ? -1 : real > otherReal;
+    }
+    int size = qMin(value.bytes.size(), other.bytes.size());
+    int result = size > 0 ? std::memcmp(value.bytes.constData(), other.bytes.constData(), size) : 0;
+    if (result != 0) {
+        return result;
+    }
+    return value.bytes.size() < other.bytes.size() ? -1 : value.bytes.size() > other.bytes.size();
+}
+
+QVariant SqliteScanSummary::variant(const Value &value)
+{
+    switch (value.type) {
+    case SQLITE_INTEGER:
+        return QVariant(value.integer);
+    case SQLITE_FLOAT:
+        return QVariant(value.real);
+    case SQLITE_TEXT:
+        return QVariant(QString::fromUtf8(value.bytes));
+    case SQLITE_BLOB:
+        return QVariant(value.bytes);
+    default:
+        return QVariant();
+    }
+}
+
+SqliteScanSummary::~SqliteScanSummary()
+{
+
+}
+
+/*
+ * Сводка в двоичном виде для SqliteSidecarCache
+*/
+QDataStream &operator<<(QDataStream &stream, const SqliteScanSummary &summary)
+{
+    stream << summary.row_count_ << static_cast<qint32>(summary.columns_.size());
+    for (const SqliteScanSummary::Column &column : summary.columns_) {
+        stream << column.values << column.nulls;
+        for (const SqliteScanSummary::Value *value : {&column.minimum, &column.maximum}) {
+            stream << static_cast<qint32>(value->type) << value->integer << value->real << value->bytes;
+        }
+        stream << column.distinct << column.frequent << column.histogram;
+    }
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, SqliteScanSummary &summary)
+{
+    qint64 rows = 0;
+    qint32 columns = 0;
+    stream >> rows >> columns;
+    summary = SqliteScanSummary(qMax(0, columns));
+    summary.row_count_ = rows;
+    for (SqliteScanSummary::Column &column : summary.columns_) {
+        stream >> column.values >> column.nulls;
+        for (SqliteScanSummary::Value *value : {&column.minimum, &column.maximum}) {
+            qint32 type = SQLITE_NULL;
+            stream >> type >> value->integer >> value->real >> value->bytes;
+            value->type = type;
+        }
+        stream >> column.distinct >> column.frequent >> column.histogram;
+    }
+    return stream;
+}
@@ -0,0 +1,88 @@
+#ifndef SQLITESCANSUMMARY_H
+#define SQLITESCANSUMMARY_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QMetaType>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+#include <cstring>
+
+#include <sqlite3.h>
+
+#include "SqliteHyperLogLog.h"
+#include "SqliteSpaceSaving.h"
+#include "SqliteHistogram.h"
+
+/*
+ * Сводка по колонкам строк, прочитанных проходом по таблице:
+ * количество строк, и для каждой колонки количество значений
+ * и null, минимум, максимум и оценка количества различных
+ * значений (SqliteHyperLogLog), самые частые значения
+ * (SqliteSpaceSaving) и гистограмма чисел (SqliteHistogram).
+ * Память на колонку ограничена и не зависит от количества строк.
+ * Минимум и максимум сравниваются так же, как в sqlite с
+ * collate binary: числа меньше текста, текст меньше blob.
+ * Сводки частей таблицы объединяются через merge, результат
+ * не зависит от того, как таблица была поделена.
+*/
+class SqliteScanSummary
+{
+public:
+    enum {VALUE_BYTES = 256};  //байт частого значения, которые хранятся для показа
+    SqliteScanSummary(int columns = 0);
+    void addRow(sqlite3_stmt *statement, int firstColumn);
+    void merge(const SqliteScanSummary &other);
+    qint64 rowCount() const;
+    int columnCount() const;
+    qint64 valueCount(int column) const;
+    qint64 nullCount(int column) const;
+    QVariant minimum(int column) const;
+    QVariant maximum(int column) const;
+    qint64 distinctEstimate(int column) const;
+    QList<SqliteSpaceSaving::Item> frequentValues(int column, int count) const;
+    const SqliteHistogram &histogram(int column) const;
+    virtual ~SqliteScanSummary();
+    friend QDataStream &operator<<(QDataStream &stream, const SqliteScanSummary &summary);
+    friend QDataStream &operator>>(QDataStream &stream, SqliteScanSummary &summary);
+
+private:
+    /*
+     * Значение ячейки. bytes у значения прямо из sqlite3_step
+     * не копируется (QByteArray::fromRawData) и копируется только
+     * тогда, когда значение становится минимумом или максимумом.
+    */
+    struct Value
+    {
+        int type = SQLITE_NULL;
+        qint64 integer = 0;
+        double real = 0;
+        QByteArray bytes;
+    };
+
+    struct Column
+    {
+        qint64 values = 0;
+        qint64 nulls = 0;
+        Value minimum;
+        Value maximum;
+        SqliteHyperLogLog distinct;
+        SqliteSpaceSaving frequent;
+        SqliteHistogram histogram;
+    };
+
+    static Value cellValue(sqlite3_stmt *statement, int column);
+    static Value copyValue(const Value &value);
+    static quint64 valueHash(const Value &value);
+    static int compare(const Value &value, const Value &other);
+    static QVariant variant(const Value &value);
+
+    QVector<Column> columns_;
+    qint64 row_count_ = 0;
+};
+
+Q_DECLARE_METATYPE(SqliteScanSummary)
+
+#endif // SQLITESCANSUMMARY_H
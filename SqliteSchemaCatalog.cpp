@@ -0,0 +1,175 @@
+#include "SqliteSchemaCatalog.h"
+
+SqliteSchemaCatalog::SqliteSchemaCatalog()
+{
+
+}
+
+void SqliteSchemaCatalog::addObject(Object::Type type, const QString &name, const QString &table)
+{
+    Object object;
+    object.type = type;
+    object.name = name;
+    object.table = table;
+    objects_.append(object);
+}
+
+void SqliteSchemaCatalog::setRowEstimate(const QString &table, qint64 rows)
+{
+    int i = find(table);
+    if (i >= 0) {
+        objects_[i].rowEstimate = rows;
+    }
+}
+
+/*
+ * Сохранение колонок таблицы после первой загрузки
+*/
+void SqliteSchemaCatalog::setColumns(const QString &table, const QStringList &columns, const QString &key)
+{
+    Columns loaded;
+    loaded.columns = columns;
+    loaded.key = key;
+    columns_.insert(table, loaded);
+}
+
+/*
+ * Колонки таблиц, загруженные в каталоге other, для таблиц,
+ * которые есть и в этом каталоге. Имеет смысл, только если
+ * схема та же (совпадают schemaVersion).
+*/
+void SqliteSchemaCatalog::copyColumns(const SqliteSchemaCatalog &other)
+{
+    for (QHash<QString, Columns>::const_iterator i = other.columns_.constBegin(); i != other.columns_.constEnd(); ++i) {
+        if (contains(i.key())) {
+            columns_.insert(i.key(), i.value());
+        }
+    }
+}
+
+void SqliteSchemaCatalog::setSchemaVersion(qint64 version)
+{
+    schema_version_ = version;
+}
+
+qint64 SqliteSchemaCatalog::schemaVersion() const
+{
+    return schema_version_;
+}
+
+bool SqliteSchemaCatalog::contains(const QString &name) const
+{
+    return find(name) >= 0;
+}
+
+bool SqliteSchemaCatalog::isView(const QString &name) const
+{
+    int i = find(name);
+    return i >= 0 && objects_[i].type == Object::View;
+}
+
+bool SqliteSchemaCatalog::hasColumns(const QString &table) const
+{
+    return columns_.contains(table);
+}
+
+QStringList SqliteSchemaCatalog::columns(const QString &table) const
+{
+    return columns_.value(table).columns;
+}
+
+QString SqliteSchemaCatalog::key(const QString &table) const
+{
+    return columns_.value(table).key;
+}
+
+/*
+ * Таблицы и представления, которые можно открыть,
+ * в порядке sqlite_master
+*/
+QStringList SqliteSchemaCatalog::tables() const
+{
+    QStringList result;
+    for (const Object &object : objects_) {
+        if (object.type != Object::Index) {
+            result.append(object.name);
+        }
+    }
+    return result;
+}
+
+QStringList SqliteSchemaCatalog::indexes(const QString &table) const
+{
+    QStringList result;
+    for (const Object &object : objects_) {
+        if (object.type == Object::Index && object.table == table) {
+            result.append(object.name);
+        }
+    }
+    return result;
+}
+
+qint64 SqliteSchemaCatalog::rowEstimate(const QString &table) const
+{
+    int i = find(table);
+    return i >= 0 ? objects_[i].rowEstimate : -1;
+}
+
+bool SqliteSchemaCatalog::isEmpty() const
+{
+    return tables().isEmpty();
+}
+
+int SqliteSchemaCatalog::find(const QString &name) const
+{
+    for (int i = 0; i < objects_.size(); i++) {
+        if (objects_[i].name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+SqliteSchemaCatalog::~SqliteSchemaCatalog()
+{
+
+}
+
+/*
+ * Каталог в двоичном виде для SqliteSidecarCache
+*/
+QDataStream &operator<<(QDataStream &stream, const SqliteSchemaCatalog &catalog)
+{
+    stream << catalog.schema_version_ << static_cast<qint32>(catalog.objects_.size());
+    for (const SqliteSchemaCatalog::Object &object : catalog.objects_) {
+        stream << static_cast<qint32>(object.type) << object.name << object.table << object.rowEstimate;
+    }
+    stream << static_cast<qint32>(catalog.columns_.size());
+    for (QHash<QString, SqliteSchemaCatalog::Columns>::const_iterator i = catalog.columns_.constBegin();
+         i != catalog.columns_.constEnd(); ++i) {
+        stream << i.key() << i.value().columns << i.value().key;
+    }
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, SqliteSchemaCatalog &catalog)
+{
+    catalog = SqliteSchemaCatalog();
+    qint32 count = 0;
+    stream >> catalog.schema_version_ >> count;
+    for (int i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+        SqliteSchemaCatalog::Object object;
+        qint32 type = 0;
+        stream >> type >> object.name >> object.table >> object.rowEstimate;
+        object.type = static_cast<SqliteSchemaCatalog::Object::Type>(type);
+        catalog.objects_.append(object);
+    }
+    stream >> count;
+    for (int i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+        QString table;
+        SqliteSchemaCatalog::Columns loaded;
+        stream >> table >> loaded.columns >> loaded.key;
+        catalog.columns_.insert(table, loaded);
+    }
+    return stream;
+}
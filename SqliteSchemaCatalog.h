@@ -0,0 +1,77 @@
+#ifndef SQLITESCHEMACATALOG_H
+#define SQLITESCHEMACATALOG_H
+
+#include <QDataStream>
+#include <QHash>
+#include <QList>
+#include <QMetaType>
+#include <QString>
+#include <QStringList>
+
+/*
+ * Каталог схемы открытой бд: таблицы, представления,
+ * индексы и примерное количество строк в таблицах.
+ * Список объектов читает исполнитель при открытии бд,
+ * а колонки и ключ таблицы загружаются только когда таблицу
+ * впервые открывают, и дальше берутся из каталога.
+ * schemaVersion - pragma schema_version: меняется при любом
+ * изменении схемы и хранится в файле бд, поэтому по нему
+ * сохранённый каталог (SqliteSidecarCache) сверяется с живым.
+*/
+class SqliteSchemaCatalog
+{
+public:
+    /*
+     * Объект схемы. table - таблица, к которой относится
+     * индекс (у таблиц и представлений совпадает с name).
+     * rowEstimate - примерное количество строк, -1 если неизвестно.
+    */
+    struct Object
+    {
+        enum Type { Table, View, Index };
+        Type type;
+        QString name;
+        QString table;
+        qint64 rowEstimate = -1;
+    };
+
+    SqliteSchemaCatalog();
+    void addObject(Object::Type type, const QString &name, const QString &table);
+    void setRowEstimate(const QString &table, qint64 rows);
+    void setColumns(const QString &table, const QStringList &columns, const QString &key);
+    void copyColumns(const SqliteSchemaCatalog &other);
+    void setSchemaVersion(qint64 version);
+    qint64 schemaVersion() const;
+    bool contains(const QString &name) const;
+    bool isView(const QString &name) const;
+    bool hasColumns(const QString &table) const;
+    QStringList columns(const QString &table) const;
+    QString key(const QString &table) const;
+    QStringList tables() const;
+    QStringList indexes(const QString &table) const;
+    qint64 rowEstimate(const QString &table) const;
+    bool isEmpty() const;
+    virtual ~SqliteSchemaCatalog();
+    friend QDataStream &operator<<(QDataStream &stream, const SqliteSchemaCatalog &catalog);
+    friend QDataStream &operator>>(QDataStream &stream, SqliteSchemaCatalog &catalog);
+
+private:
+    /*
+     * Загруженные колонки таблицы
+    */
+    struct Columns
+    {
+        QStringList columns;
+        QString key;  //выражение ключа строки, пустое если ключа нет
+    };
+
+    int find(const QString &name) const;
+
+    QList<Object> objects_;
+    QHash<QString, Columns> columns_;
+    qint64 schema_version_ = -1;  //-1, если неизвестна
+};
+
+Q_DECLARE_METATYPE(SqliteSchemaCatalog)
+
+#endif // SQLITESCHEMACATALOG_H
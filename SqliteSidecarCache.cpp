@@ -0,0 +1,249 @@
+#include "SqliteSidecarCache.h"
+
+SqliteSidecarCache::SqliteSidecarCache()
+{
+
+}
+
+/*
+ * Пустой кэш бд path с текущей идентичностью файла:
+ * то, что модель прочитает дальше, соответствует ей.
+ * Пустой path выключает кэш до следующего reset или load.
+*/
+void SqliteSidecarCache::reset(const QString &path)
+{
+    path_ = path;
+    identity_ = path.isEmpty() ? QByteArray() : identity(path);
+    catalog_ = SqliteSchemaCatalog();
+    tables_.clear();
+    table_order_.clear();
+    profiles_.clear();
+}
+
+/*
+ * Чтение кэша бд path. Если файла кэша нет, он повреждён или
+ * сохранён для другой версии файла бд, кэш остаётся пустым
+ * (как после reset), а устаревший файл удаляется.
+ * Данные после заголовка читаются, только если их хэш
+ * совпал с записанным в заголовке: страницы из обрезанного
+ * или испорченного файла не показываются.
+ * Страницы копируются из отображения в свои блоки,
+ * после чтения файл больше не нужен.
+*/
+bool SqliteSidecarCache::load(const QString &path)
+{
+    reset(path);
+    QFile file(cacheFile());
+    if (!file.open(QIODevice::ReadOnly) || file.size() <= 0 || file.size() > INT_MAX) {
+        return false;
+    }
+    uchar *mapped = file.map(0, file.size());
+    if (!mapped) {
+        return false;
+    }
+    QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), static_cast<int>(file.size()));
+    QDataStream header(data);
+    QByteArray magic;
+    qint32 version = 0;
+    qint32 byteOrder = -1;
+    QByteArray fileIdentity;
+    QByteArray checksum;
+    header >> magic >> version >> byteOrder >> fileIdentity >> checksum;
+    bool isValid = header.status() == QDataStream::Ok && magic == MAGIC && version == VERSION &&
+                   byteOrder == QSysInfo::ByteOrder && fileIdentity == identity_;
+    int offset = static_cast<int>(header.device()->pos());
+    QByteArray payload = QByteArray::fromRawData(data.constData() + offset, data.size() - offset);
+    isValid = isValid && QCryptographicHash::hash(payload, QCryptographicHash::Sha1) == checksum;
+    QDataStream stream(payload);
+    qint32 count = 0;
+    if (isValid) {
+        stream >> catalog_ >> count;
+    }
+    for (int i = 0; isValid && i < count && stream.status() == QDataStream::Ok; i++) {
+        QString name;
+        Table table;
+        stream >> name >> table.rowCount >> table.pages;
+        tables_.insert(name, table);
+        table_order_.append(name);
+    }
+    if (isValid) {
+        stream >> profiles_;
+    }
+    isValid = isValid && stream.status() == QDataStream::Ok;
+    file.unmap(mapped);
+    file.close();
+    if (!isValid) {
+        QFile::remove(cacheFile());
+        reset(path);
+    }
+    return isValid;
+}
+
+/*
+ * Запись кэша под текущей идентичностью. Данные собираются
+ * в памяти, чтобы в заголовок попал их хэш, и файл пишется
+ * целиком во временный и подменяет старый только после
+ * успешной записи. Страницы таблиц пишутся, пока данные
+ * не превысили MAX_BYTES, остальные таблицы сохраняются
+ * без страниц.
+*/
+bool SqliteSidecarCache::save()
+{
+    if (path_.isEmpty() || identity_.isEmpty() || catalog_.isEmpty()) {
+        return false;
+    }
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << catalog_;
+    int count = qMin(table_order_.size(), MAX_TABLES);
+    stream << static_cast<qint32>(count);
+    for (int i = 0; i < count; i++) {
+        const QString &name = table_order_[i];
+        Table table = tables_.value(name);
+        if (payload.size() > MAX_BYTES) {
+            table.pages.clear();
+        }
+        stream << name << table.rowCount << table.pages;
+    }
+    stream << profiles_;
+    if (stream.status() != QDataStream::Ok) {
+        return false;
+    }
+    QDir().mkpath(QFileInfo(cacheFile()).absolutePath());
+    QSaveFile file(cacheFile());
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QDataStream header(&file);
+    header << MAGIC << VERSION << static_cast<qint32>(QSysInfo::ByteOrder) << identity_
+           << QCryptographicHash::hash(payload, QCryptographicHash::Sha1);
+    return header.status() == QDataStream::Ok && file.write(payload) == payload.size() && file.commit();
+}
+
+/*
+ * Бд изменилась: сохранённые страницы и профили устарели,
+ * а то, что модель прочитает дальше, соответствует новой
+ * идентичности файла. Каталог модель обновит сама.
+*/
+void SqliteSidecarCache::invalidate()
+{
+    if (path_.isEmpty()) {
+        return;
+    }
+    identity_ = identity(path_);
+    tables_.clear();
+    table_order_.clear();
+    profiles_.clear();
+}
+
+void SqliteSidecarCache::setCatalog(const SqliteSchemaCatalog &catalog)
+{
+    catalog_ = catalog;
+}
+
+SqliteSchemaCatalog SqliteSidecarCache::catalog() const
+{
+    return catalog_;
+}
+
+/*
+ * Первые страницы запроса всей таблицы table. Таблица
+ * становится самой недавней: при записи лишние давние
+ * таблицы отбрасываются.
+*/
+void SqliteSidecarCache::setTable(const QString &table, int rowCount, const QList<SqliteResultBlock> &pages)
+{
+    if (path_.isEmpty()) {
+        return;
+    }
+    Table stored;
+    stored.rowCount = rowCount;
+    stored.pages = pages.mid(0, FIRST_PAGES);
+    tables_.insert(table, stored);
+    table_order_.removeAll(table);
+    table_order_.prepend(table);
+}
+
+bool SqliteSidecarCache::hasTable(const QString &table) const
+{
+    return tables_.contains(table);
+}
+
+SqliteSidecarCache::Table SqliteSidecarCache::table(const QString &table) const
+{
+    return tables_.value(table);
+}
+
+void SqliteSidecarCache::setProfiles(const QHash<QString, SqliteScanSummary> &profiles)
+{
+    profiles_ = profiles;
+}
+
+QHash<QString, SqliteScanSummary> SqliteSidecarCache::profiles() const
+{
+    return profiles_;
+}
+
+bool SqliteSidecarCache::isEnabled()
+{
+    QSettings settings;
+    return settings.value("cache/enabled", false).toBool();
+}
+
+void SqliteSidecarCache::setEnabled(bool isEnabled)
+{
+    QSettings settings;
+    settings.setValue("cache/enabled", isEnabled);
+}
+
+/*
+ * Идентичность файла бд path без открытия соединения:
+ * путь, размер и время изменения файла, из заголовка бд -
+ * счётчик изменений и размер в страницах (смещение 24),
+ * версия схемы (40) и номер версии sqlite, которая писала
+ * последней (92), а у WAL - размер, время изменения
+ * и соли заголовка. Счётчик изменений в режиме WAL
+ * меняется только при контрольной точке, зато каждая
+ * запись меняет WAL.
+*/
+QByteArray SqliteSidecarCache::identity(const QString &path)
+{
+    QFileInfo info(path);
+    QByteArray header = readHeader(path, 100);
+    if (!info.exists() || header.size() < 100) {
+        return QByteArray();
+    }
+    QByteArray result;
+    QDataStream stream(&result, QIODevice::WriteOnly);
+    stream << info.absoluteFilePath() << info.size() << info.lastModified().toMSecsSinceEpoch()
+           << header.mid(24, 8) << header.mid(40, 4) << header.mid(92, 8);
+    QFileInfo wal(path + "-wal");
+    if (wal.exists()) {
+        stream << wal.size() << wal.lastModified().toMSecsSinceEpoch() << readHeader(wal.filePath(), 32).mid(12, 12);
+    }
+    return result;
+}
+
+/*
+ * Файл кэша бд: имя - хэш полного пути к ней
+*/
+QString SqliteSidecarCache::cacheFile() const
+{
+    QByteArray file = QFileInfo(path_).absoluteFilePath().toUtf8();
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/sidecar/" +
+           QString::fromLatin1(QCryptographicHash::hash(file, QCryptographicHash::Sha1).toHex()) + SUFFIX;
+}
+
+QByteArray SqliteSidecarCache::readHeader(const QString &path, int size)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.read(size);
+}
+
+SqliteSidecarCache::~SqliteSidecarCache()
+{
+
+}
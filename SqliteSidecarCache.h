@@ -0,0 +1,91 @@
+#ifndef SQLITESIDECARCACHE_H
+#define SQLITESIDECARCACHE_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QString>
+#include <QSysInfo>
+
+#include <climits>
+
+#include "SqliteResultBlock.h"
+#include "SqliteScanSummary.h"
+#include "SqliteSchemaCatalog.h"
+
+/*
+ * Кэш открытой бд на диске для быстрого повторного открытия:
+ * каталог схемы, количество строк и первые страницы таблиц,
+ * которые открывались, и профили колонок. Лежит в каталоге
+ * кэша пользователя, файл бд и его каталог не трогаются.
+ * При открытии того же файла таблица показывается из кэша
+ * сразу, а исполнитель в это время открывает бд, и модель
+ * таблицы перечитывает показанные страницы, так что
+ * устаревший кэш виден только до первого ответа.
+ * Кэш привязан к идентичности файла (identity): пути, размеру,
+ * времени изменения, счётчику изменений и версии схемы из
+ * заголовка бд и заголовку WAL. PRAGMA data_version для этого
+ * не подходит: её значение имеет смысл только внутри одного
+ * соединения, а счётчик заголовка хранится в самом файле.
+ * Файл кэша отображается в память (QFile::map) и читается
+ * одним проходом, после проверки хэша данных из заголовка.
+ * Кэш включается пользователем (setEnabled).
+*/
+class SqliteSidecarCache
+{
+public:
+    /*
+     * Сохранённая таблица: количество строк запроса
+     * всей таблицы и его первые страницы
+    */
+    struct Table
+    {
+        int rowCount = 0;
+        QList<SqliteResultBlock> pages;
+    };
+
+    const QByteArray MAGIC = "SQLC";  //начало файла кэша
+    const qint32 VERSION = 2;  //версия формата файла кэша
+    const int FIRST_PAGES = 4;  //сколько первых страниц таблицы сохраняется
+    const int MAX_TABLES = 32;  //сколько таблиц сохраняется
+    const qint64 MAX_BYTES = 32 * 1024 * 1024;  //после скольких байт страницы таблиц больше не пишутся
+    const QString SUFFIX = ".sqlc";  //расширение файлов кэша
+    SqliteSidecarCache();
+    void reset(const QString &path = "");
+    bool load(const QString &path);
+    bool save();
+    void invalidate();
+    void setCatalog(const SqliteSchemaCatalog &catalog);
+    SqliteSchemaCatalog catalog() const;
+    void setTable(const QString &table, int rowCount, const QList<SqliteResultBlock> &pages);
+    bool hasTable(const QString &table) const;
+    Table table(const QString &table) const;
+    void setProfiles(const QHash<QString, SqliteScanSummary> &profiles);
+    QHash<QString, SqliteScanSummary> profiles() const;
+    static bool isEnabled();
+    static void setEnabled(bool isEnabled);
+    static QByteArray identity(const QString &path);
+    virtual ~SqliteSidecarCache();
+
+private:
+    QString cacheFile() const;
+    static QByteArray readHeader(const QString &path, int size);
+
+    QString path_ = "";  //бд, к которой относится кэш, пустой - кэш выключен
+    QByteArray identity_;  //идентичность файла, для которой верны данные кэша
+    SqliteSchemaCatalog catalog_;
+    QHash<QString, Table> tables_;
+    QList<QString> table_order_;  //таблицы от недавно открытых к давно открытым
+    QHash<QString, SqliteScanSummary> profiles_;
+};
+
+#endif // SQLITESIDECARCACHE_H
@@ -0,0 +1,106 @@
+#include "SqliteSortOrder.h"
+
+SqliteSortOrder::SqliteSortOrder()
+{
+
+}
+
+SqliteSortOrder::SqliteSortOrder(int column, const QString &name, bool isDescending)
+{
+    column_ = column;
+    name_ = name;
+    is_descending_ = isDescending;
+}
+
+/*
+ * Ключ строки запроса, который идёт в нём первой колонкой.
+ * Пустой ключ отключает чтение страниц поиском.
+*/
+void SqliteSortOrder::setKey(const QString &key)
+{
+    key_ = key;
+}
+
+bool SqliteSortOrder::isSorted() const
+{
+    return column_ >= 0;
+}
+
+bool SqliteSortOrder::isKeyset() const
+{
+    return isSorted() && !key_.isEmpty();
+}
+
+int SqliteSortOrder::column() const
+{
+    return column_;
+}
+
+bool SqliteSortOrder::isDescending() const
+{
+    return is_descending_;
+}
+
+bool SqliteSortOrder::operator==(const SqliteSortOrder &other) const
+{
+    return column_ == other.column_ && (!isSorted() || is_descending_ == other.is_descending_);
+}
+
+bool SqliteSortOrder::operator!=(const SqliteSortOrder &other) const
+{
+    return !(*this == other);
+}
+
+/*
+ * Запрос страниц для request (без limit/offset, их добавит
+ * исполнитель). anchor - значения колонки и ключа последней
+ * строки перед первой нужной страницей, пустой, если читать
+ * с начала. Значения плейсхолдеров складываются в pageValues.
+ * Строки с null в колонке, которые по условию (колонка, ключ)
+ * не сравниваются, добавляются через union all. sqlite
+ * склеивает его части слиянием, и обе части идут по индексу.
+*/
+QString SqliteSortOrder::pageRequest(const QString &request, const QVariantList &values,
+                                     const QVariantList &anchor, QVariantList &pageValues) const
+{
+    QString source = "select * from (" + request + ")";
+    pageValues = values;
+    if (!isSorted()) {
+        return source;
+    }
+    if (!isKeyset() || anchor.size() < 2) {
+        return source + orderClause();
+    }
+    QString after = is_descending_ ? " < " : " > ";
+    if (anchor[0].isNull() && !is_descending_) {  //остаток null, затем все значения
+        pageValues << anchor[1] << values;
+        return "select * from (" + source + " where " + name_ + " is null and " + key_ + after + "?" +
+               " union all " + source + " where " + name_ + " is not null)" + orderClause();
+    }
+    if (anchor[0].isNull()) {  //null идут последними, остаётся только их остаток
+        pageValues << anchor[1];
+        return source + " where " + name_ + " is null and " + key_ + after + "?" + orderClause();
+    }
+    pageValues << anchor[0] << anchor[1];
+    QString seek = "(" + name_ + ", " + key_ + ")" + after + "(?, ?)";
+    if (!is_descending_) {
+        return source + " where " + seek + orderClause();
+    }
+    pageValues << values;
+    return "select * from (" + source + " where " + seek +
+           " union all " + source + " where " + name_ + " is null)" + orderClause();
+}
+
+QString SqliteSortOrder::orderClause() const
+{
+    QString direction = is_descending_ ? " desc" : "";
+    if (key_.isEmpty()) {
+        return " order by " + name_ + direction;
+    }
+    return " order by " + name_ + direction + ", " + key_ + direction;
+}
+
+SqliteSortOrder::~SqliteSortOrder()
+{
+
+}
@@ -0,0 +1,48 @@
+#ifndef SQLITESORTORDER_H
+#define SQLITESORTORDER_H
+
+#include <QMetaType>
+#include <QString>
+#include <QVariant>
+
+/*
+ * Сортировка таблицы по колонке, которую выполняет sqlite.
+ * Строки упорядочиваются по колонке и по ключу строки (rowid
+ * или первичный ключ), так что порядок однозначен, и страницы
+ * читаются не через offset, а поиском от последней строки
+ * предыдущей страницы (keyset): (колонка, ключ) > (?, ?).
+ * Если по колонке есть индекс, чтение любой следующей страницы
+ * стоит один спуск по b-дереву, а не проход по всем строкам до неё.
+ * null в sqlite меньше любых значений, поэтому они идут первыми
+ * при сортировке по возрастанию и последними по убыванию.
+ * Без ключа (представления, произвольные запросы) страницы
+ * читаются через offset.
+*/
+class SqliteSortOrder
+{
+public:
+    SqliteSortOrder();
+    SqliteSortOrder(int column, const QString &name, bool isDescending);
+    void setKey(const QString &key);
+    bool isSorted() const;
+    bool isKeyset() const;
+    int column() const;
+    bool isDescending() const;
+    bool operator==(const SqliteSortOrder &other) const;
+    bool operator!=(const SqliteSortOrder &other) const;
+    QString pageRequest(const QString &request, const QVariantList &values,
+                        const QVariantList &anchor, QVariantList &pageValues) const;
+    virtual ~SqliteSortOrder();
+
+private:
+    QString orderClause() const;
+
+    int column_ = -1;  //номер колонки в таблице, -1 если сортировки нет
+    QString name_ = "";  //колонка в кавычках, как она называется в запросе
+    QString key_ = "";  //выражение ключа строки в запросе, пустое если ключа нет
+    bool is_descending_ = false;
+};
+
+Q_DECLARE_METATYPE(SqliteSortOrder)
+
+#endif // SQLITESORTORDER_H
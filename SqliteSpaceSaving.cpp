@@ -0,0 +1,183 @@
+#include "SqliteSpaceSaving.h"
+
+SqliteSpaceSaving::SqliteSpaceSaving()
+{
+
+}
+
+/*
+ * Ещё одно вхождение значения key. false, если оно не
+ * считается, тогда его нужно добавить через insert: значение
+ * для показа готовится только в этом случае.
+*/
+bool SqliteSpaceSaving::increment(quint64 key)
+{
+    QHash<quint64, int>::const_iterator position = positions_.constFind(key);
+    if (position == positions_.constEnd()) {
+        return false;
+    }
+    int index = position.value();
+    heap_[index].count++;
+    siftDown(index);
+    return true;
+}
+
+/*
+ * Новое значение: на свободное место или вместо самого редкого
+*/
+void SqliteSpaceSaving::insert(quint64 key, const QVariant &value)
+{
+    Item item;
+    item.key = key;
+    item.value = value;
+    item.count = 1;
+    if (heap_.size() < CAPACITY) {
+        heap_.append(item);  //у всех счётчиков не меньше 1, поэтому куча не нарушается
+        positions_.insert(key, heap_.size() - 1);
+        int index = heap_.size() - 1;
+        while (index > 0 && heap_[(index - 1) / 2].count > heap_[index].count) {
+            swapItems(index, (index - 1) / 2);
+            index = (index - 1) / 2;
+        }
+        return;
+    }
+    positions_.remove(heap_[0].key);
+    item.error = heap_[0].count;
+    item.count = heap_[0].count + 1;
+    heap_[0] = item;
+    positions_.insert(key, 0);
+    siftDown(0);
+}
+
+/*
+ * Объединение со сводкой другой части значений: счётчики одного
+ * значения складываются, а значению, которого в другой сводке нет,
+ * добавляется её наименьший счётчик (столько раз оно там могло
+ * быть вытеснено). Остаются CAPACITY наибольших.
+*/
+void SqliteSpaceSaving::merge(const SqliteSpaceSaving &other)
+{
+    qint64 minimum = this->minimum();
+    qint64 otherMinimum = other.minimum();
+    QVector<Item> items;
+    for (const Item &item : heap_) {
+        Item merged = item;
+        QHash<quint64, int>::const_iterator position = other.positions_.constFind(item.key);
+        if (position != other.positions_.constEnd()) {
+            merged.count += other.heap_[position.value()].count;
+            merged.error += other.heap_[position.value()].error;
+        } else {
+            merged.count += otherMinimum;
+            merged.error += otherMinimum;
+        }
+        items.append(merged);
+    }
+    for (const Item &item : other.heap_) {
+        if (!positions_.contains(item.key)) {
+            Item merged = item;
+            merged.count += minimum;
+            merged.error += minimum;
+            items.append(merged);
+        }
+    }
+    rebuild(items);
+}
+
+/*
+ * count самых частых значений по убыванию счётчика
+*/
+QList<SqliteSpaceSaving::Item> SqliteSpaceSaving::top(int count) const
+{
+    QVector<Item> items = heap_;
+    std::sort(items.begin(), items.end(), [](const Item &item, const Item &other) {
+        return item.count != other.count ? item.count > other.count : item.key < other.key;
+    });
+    return items.mid(0, count).toList();
+}
+
+/*
+ * Значение index стало чаще: опускается ниже по куче
+*/
+void SqliteSpaceSaving::siftDown(int index)
+{
+    while (true) {
+        int smallest = index;
+        for (int child = 2 * index + 1; child <= 2 * index + 2 && child < heap_.size(); child++) {
+            if (heap_[child].count < heap_[smallest].count) {
+                smallest = child;
+            }
+        }
+        if (smallest == index) {
+            return;
+        }
+        swapItems(index, smallest);
+        index = smallest;
+    }
+}
+
+void SqliteSpaceSaving::swapItems(int index, int other)
+{
+    std::swap(heap_[index], heap_[other]);
+    positions_[heap_[index].key] = index;
+    positions_[heap_[other].key] = other;
+}
+
+/*
+ * Куча из CAPACITY наибольших items. Равные счётчики
+ * упорядочиваются по ключу, чтобы результат не зависел
+ * от порядка объединения.
+*/
+void SqliteSpaceSaving::rebuild(QVector<Item> items)
+{
+    std::sort(items.begin(), items.end(), [](const Item &item, const Item &other) {
+        return item.count != other.count ? item.count > other.count : item.key < other.key;
+    });
+    items.resize(qMin(items.size(), static_cast<int>(CAPACITY)));
+    std::reverse(items.begin(), items.end());  //по возрастанию счётчика - уже куча
+    heap_ = items;
+    positions_.clear();
+    for (int i = 0; i < heap_.size(); i++) {
+        positions_.insert(heap_[i].key, i);
+    }
+}
+
+/*
+ * Наименьший счётчик, если мест нет, иначе 0:
+ * невытесненное значение не могло быть пропущено
+*/
+qint64 SqliteSpaceSaving::minimum() const
+{
+    return heap_.size() < CAPACITY ? 0 : heap_[0].count;
+}
+
+SqliteSpaceSaving::~SqliteSpaceSaving()
+{
+
+}
+
+QDataStream &operator<<(QDataStream &stream, const SqliteSpaceSaving &sketch)
+{
+    stream << static_cast<qint32>(sketch.heap_.size());
+    for (const SqliteSpaceSaving::Item &item : sketch.heap_) {
+        stream << item.key << item.value << item.count << item.error;
+    }
+    return stream;
+}
+
+/*
+ * Куча восстанавливается через rebuild, так что порядок
+ * значений в потоке не важен
+*/
+QDataStream &operator>>(QDataStream &stream, SqliteSpaceSaving &sketch)
+{
+    qint32 count = 0;
+    stream >> count;
+    QVector<SqliteSpaceSaving::Item> items;
+    for (int i = 0; i < count && i < SqliteSpaceSaving::CAPACITY && stream.status() == QDataStream::Ok; i++) {
+        SqliteSpaceSaving::Item item;
+        stream >> item.key >> item.value >> item.count >> item.error;
+        items.append(item);
+    }
+    sketch.rebuild(items);
+    return stream;
+}
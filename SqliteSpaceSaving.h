@@ -0,0 +1,57 @@
+#ifndef SQLITESPACESAVING_H
+#define SQLITESPACESAVING_H
+
+#include <QDataStream>
+#include <QHash>
+#include <QList>
+#include <QVariant>
+#include <QVector>
+
+#include <algorithm>
+
+/*
+ * Самые частые значения за один проход (Space-Saving).
+ * Считается не больше CAPACITY значений: новое значение, когда
+ * мест нет, вытесняет самое редкое и получает его счётчик плюс
+ * один. Счётчик завышен не больше чем на error значения, а любое
+ * значение, встречающееся чаще N / CAPACITY раз из N, в списке есть.
+ * Значения различаются по 64-битному хэшу, для показа хранится
+ * само значение. Редкое значение ищется через кучу по счётчику.
+ * Сводки частей таблицы объединяются через merge.
+*/
+class SqliteSpaceSaving
+{
+public:
+    enum {CAPACITY = 64};  //сколько значений считается одновременно
+
+    /*
+     * Значение и его счётчик, который может быть завышен на error
+    */
+    struct Item
+    {
+        quint64 key = 0;
+        QVariant value;
+        qint64 count = 0;
+        qint64 error = 0;
+    };
+
+    SqliteSpaceSaving();
+    bool increment(quint64 key);
+    void insert(quint64 key, const QVariant &value);
+    void merge(const SqliteSpaceSaving &other);
+    QList<Item> top(int count) const;
+    virtual ~SqliteSpaceSaving();
+    friend QDataStream &operator<<(QDataStream &stream, const SqliteSpaceSaving &sketch);
+    friend QDataStream &operator>>(QDataStream &stream, SqliteSpaceSaving &sketch);
+
+private:
+    void siftDown(int index);
+    void swapItems(int index, int other);
+    void rebuild(QVector<Item> items);
+    qint64 minimum() const;
+
+    QVector<Item> heap_;  //куча по count, самое редкое значение - первое
+    QHash<quint64, int> positions_;  //место значения в куче по ключу
+};
+
+#endif // SQLITESPACESAVING_H
@@ -0,0 +1,131 @@
+#include "SqliteStatementCache.h"
+
+SqliteStatementCache::SqliteStatementCache()
+{
+
+}
+
+/*
+ * Соединение, для которого готовятся запросы.
+ * Запросы прошлого соединения финализируются.
+*/
+void SqliteStatementCache::setHandle(sqlite3 *handle)
+{
+    clear();
+    handle_ = handle;
+}
+
+/*
+ * Подготовленный запрос sql со сброшенным состоянием
+ * и без привязанных значений. nullptr, если запрос
+ * не разбирается или соединения нет.
+*/
+sqlite3_stmt *SqliteStatementCache::prepare(const QString &sql)
+{
+    if (!handle_) {
+        return nullptr;
+    }
+    QString key = normalize(sql);
+    sqlite3_stmt *statement = statements_.value(key, nullptr);
+    if (statement) {
+        hit_count_++;
+        recent_.removeOne(key);
+        recent_.append(key);
+        sqlite3_reset(statement);
+        sqlite3_clear_bindings(statement);
+        return statement;
+    }
+    miss_count_++;
+    QByteArray text = key.toUtf8();
+    if (sqlite3_prepare_v3(handle_, text.constData(), text.size(), SQLITE_PREPARE_PERSISTENT,
+                           &statement, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(statement);
+        return nullptr;
+    }
+    while (recent_.size() >= MAX_STATEMENTS) {
+        sqlite3_finalize(statements_.take(recent_.takeFirst()));
+    }
+    statements_.insert(key, statement);
+    recent_.append(key);
+    return statement;
+}
+
+/*
+ * Возврат запроса в кэш. Сброс закрывает транзакцию
+ * чтения, иначе соединение не увидит новых данных.
+*/
+void SqliteStatementCache::release(sqlite3_stmt *statement)
+{
+    if (statement) {
+        sqlite3_reset(statement);
+        sqlite3_clear_bindings(statement);
+    }
+}
+
+/*
+ * Финализация всех запросов. Нужна перед закрытием
+ * соединения: sqlite не закроет его с живыми запросами.
+*/
+void SqliteStatementCache::clear()
+{
+    for (sqlite3_stmt *statement : statements_) {
+        sqlite3_finalize(statement);
+    }
+    statements_.clear();
+    recent_.clear();
+}
+
+int SqliteStatementCache::hitCount() const
+{
+    return hit_count_;
+}
+
+int SqliteStatementCache::missCount() const
+{
+    return miss_count_;
+}
+
+/*
+ * Текст запроса без лишних пробелов: любые пробельные
+ * символы вне строк, идентификаторов в кавычках и
+ * комментариев заменяются одним пробелом.
+*/
+QString SqliteStatementCache::normalize(const QString &sql)
+{
+    QString result;
+    result.reserve(sql.size());
+    QChar quote;  //закрывающий символ строки или комментария, пустой вне них
+    bool isSpace = false;
+    for (int i = 0; i < sql.size(); i++) {
+        QChar c = sql[i];
+        if (!quote.isNull()) {
+            result.append(c);
+            if (c == quote) {  //удвоенная кавычка закрывает и сразу открывает строку
+                quote = QChar();
+            }
+            continue;
+        }
+        if (c.isSpace()) {
+            isSpace = true;
+            continue;
+        }
+        if (isSpace && !result.isEmpty()) {
+            result.append(' ');
+        }
+        isSpace = false;
+        if (c == '\'' || c == '"' || c == '`') {
+            quote = c;
+        } else if (c == '[') {
+            quote = ']';
+        } else if (c == '-' && i + 1 < sql.size() && sql[i + 1] == '-') {
+            quote = '\n';  //комментарий до конца строки
+        }
+        result.append(c);
+    }
+    return result;
+}
+
+SqliteStatementCache::~SqliteStatementCache()
+{
+    clear();
+}
@@ -0,0 +1,44 @@
+#ifndef SQLITESTATEMENTCACHE_H
+#define SQLITESTATEMENTCACHE_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include <sqlite3.h>
+
+/*
+ * Кэш подготовленных запросов одного соединения.
+ * Ключ - текст запроса с нормализованными пробелами, значения
+ * всегда передаются через плейсхолдеры, поэтому одни и те же
+ * запросы (страницы, подсчёт строк, проверка data_version)
+ * разбираются и планируются sqlite один раз.
+ * Хранит не больше MAX_STATEMENTS запросов, самые давно
+ * использованные финализируются. Запрос, полученный из
+ * prepare(), нужно вернуть через release() до следующего
+ * prepare() и до закрытия соединения.
+ * Как и соединение, используется только из одного потока.
+*/
+class SqliteStatementCache
+{
+public:
+    const int MAX_STATEMENTS = 32;  //подготовленных запросов на соединение
+    SqliteStatementCache();
+    void setHandle(sqlite3 *handle);
+    sqlite3_stmt *prepare(const QString &sql);
+    void release(sqlite3_stmt *statement);
+    void clear();
+    int hitCount() const;
+    int missCount() const;
+    static QString normalize(const QString &sql);
+    virtual ~SqliteStatementCache();
+
+private:
+    sqlite3 *handle_ = nullptr;
+    QHash<QString, sqlite3_stmt *> statements_;
+    QList<QString> recent_;  //ключи от давно использованных к недавним
+    int hit_count_ = 0;
+    int miss_count_ = 0;
+};
+
+#endif // SQLITESTATEMENTCACHE_H
@@ -0,0 +1,211 @@
+#include "SqliteSubstringSearch.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SQLITESUBSTRINGSEARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/*
+ * Первый байт ищется через memchr, остальные сравниваются целиком
+*/
+bool containsScalar(const char *haystack, int size, const char *needle, int needleSize)
+{
+    if (needleSize == 0) {
+        return true;
+    }
+    if (needleSize > size) {
+        return false;
+    }
+    const char *last = haystack + size - needleSize;
+    const char *position = haystack;
+    while (position <= last) {
+        position = static_cast<const char *>(std::memchr(position, needle[0], last - position + 1));
+        if (!position) {
+            return false;
+        }
+        if (std::memcmp(position + 1, needle + 1, needleSize - 1) == 0) {
+            return true;
+        }
+        position++;
+    }
+    return false;
+}
+
+#ifdef SQLITESUBSTRINGSEARCH_X86
+
+/*
+ * Векторные варианты: в каждом блоке позиций сравниваются
+ * первый байт образца с началом позиции и последний байт
+ * с её концом, битовая маска совпадений обоих даёт кандидатов.
+ * Хвост, на который не хватает целого блока, досматривает
+ * вариант с блоком меньше: после AVX2 - SSE2, после SSE2 -
+ * скалярный. Так и короткие ячейки (до 32 байт с образцом)
+ * проверяются векторно.
+*/
+__attribute__((target("sse2")))
+bool containsSse2(const char *haystack, int size, const char *needle, int needleSize)
+{
+    if (needleSize == 0) {
+        return true;
+    }
+    if (needleSize > size) {
+        return false;
+    }
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needleSize - 1]);
+    int middle = needleSize > 2 ? needleSize - 2 : 0;
+    int i = 0;
+    for (; i + needleSize - 1 + 16 <= size; i += 16) {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i + needleSize - 1));
+        unsigned bits = static_cast<unsigned>(_mm_movemask_epi8(
+                            _mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last))));
+        while (bits != 0) {
+            int offset = __builtin_ctz(bits);
+            if (std::memcmp(haystack + i + offset + 1, needle + 1, middle) == 0) {
+                return true;
+            }
+            bits &= bits - 1;
+        }
+    }
+    return containsScalar(haystack + i, size - i, needle, needleSize);
+}
+
+__attribute__((target("avx2")))
+bool containsAvx2(const char *haystack, int size, const char *needle, int needleSize)
+{
+    if (needleSize == 0) {
+        return true;
+    }
+    if (needleSize > size) {
+        return false;
+    }
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needleSize - 1]);
+    int middle = needleSize > 2 ? needleSize - 2 : 0;
+    int i = 0;
+    for (; i + needleSize - 1 + 32 <= size; i += 32) {
+        __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i));
+        __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i + needleSize - 1));
+        unsigned bits = static_cast<unsigned>(_mm256_movemask_epi8(
+                            _mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first),
+                                             _mm256_cmpeq_epi8(blockLast, last))));
+        while (bits != 0) {
+            int offset = __builtin_ctz(bits);
+            if (std::memcmp(haystack + i + offset + 1, needle + 1, middle) == 0) {
+                return true;
+            }
+            bits &= bits - 1;
+        }
+    }
+    return containsSse2(haystack + i, size - i, needle, needleSize);
+}
+
+#else
+
+bool containsSse2(const char *haystack, int size, const char *needle, int needleSize)
+{
+    return containsScalar(haystack, size, needle, needleSize);
+}
+
+bool containsAvx2(const char *haystack, int size, const char *needle, int needleSize)
+{
+    return containsScalar(haystack, size, needle, needleSize);
+}
+
+#endif
+
+}
+
+const char *const SqliteSubstringSearch::FUNCTION_NAME = "sqlitereader_contains";
+
+/*
+ * Есть ли needle в haystack (оба - байты UTF-8)
+*/
+bool SqliteSubstringSearch::contains(const char *haystack, int size, const char *needle, int needleSize)
+{
+    return kernel()(haystack, size, needle, needleSize);
+}
+
+/*
+ * Регистрация функции FUNCTION_NAME(значение, образец) в соединении.
+ * Как и instr, она ищет с учётом регистра, числа сравнивает
+ * по их тексту, а на null возвращает null.
+*/
+bool SqliteSubstringSearch::install(sqlite3 *handle)
+{
+    return sqlite3_create_function_v2(handle, FUNCTION_NAME, 2, SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+                                      nullptr, &SqliteSubstringSearch::containsFunction,
+                                      nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+/*
+ * Название выбранной реализации, для замеров
+*/
+const char *SqliteSubstringSearch::implementation()
+{
+    Kernel selected = kernel();
+    if (selected == &containsAvx2) {
+        return "avx2";
+    }
+    if (selected == &containsSse2) {
+        return "sse2";
+    }
+    return "scalar";
+}
+
+#ifdef SQLITESUBSTRINGSEARCH_X86
+
+/*
+ * Выбор реализации по возможностям процессора
+*/
+SqliteSubstringSearch::Kernel SqliteSubstringSearch::selectKernel()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return &containsAvx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return &containsSse2;
+    }
+    return &containsScalar;
+}
+
+#else
+
+SqliteSubstringSearch::Kernel SqliteSubstringSearch::selectKernel()
+{
+    return &containsScalar;
+}
+
+#endif
+
+/*
+ * Реализация выбирается при первом поиске
+*/
+SqliteSubstringSearch::Kernel SqliteSubstringSearch::kernel()
+{
+    static const Kernel selected = selectKernel();
+    return selected;
+}
+
+/*
+ * Тело sql-функции. Если оба аргумента blob, то ищутся байты
+ * blob, иначе - текст, как у instr.
+*/
+void SqliteSubstringSearch::containsFunction(sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+    if (argc != 2 || sqlite3_value_type(argv[0]) == SQLITE_NULL || sqlite3_value_type(argv[1]) == SQLITE_NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+    bool isBlob = sqlite3_value_type(argv[0]) == SQLITE_BLOB && sqlite3_value_type(argv[1]) == SQLITE_BLOB;
+    const void *haystack = isBlob ? sqlite3_value_blob(argv[0]) : sqlite3_value_text(argv[0]);
+    int size = sqlite3_value_bytes(argv[0]);
+    const void *needle = isBlob ? sqlite3_value_blob(argv[1]) : sqlite3_value_text(argv[1]);
+    int needleSize = sqlite3_value_bytes(argv[1]);
+    sqlite3_result_int(context, contains(static_cast<const char *>(haystack), size,
+                                         static_cast<const char *>(needle), needleSize) ? 1 : 0);
+}
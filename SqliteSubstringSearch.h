@@ -0,0 +1,36 @@
+#ifndef SQLITESUBSTRINGSEARCH_H
+#define SQLITESUBSTRINGSEARCH_H
+
+#include <cstring>
+
+#include <sqlite3.h>
+
+/*
+ * Поиск подстроки в UTF-8 байтах для фильтров.
+ * Байтовое совпадение в UTF-8 - это то же самое, что совпадение
+ * символов, поэтому значения не нужно переводить в QString.
+ * Кандидаты ищутся векторно: сравниваются сразу 32 (AVX2)
+ * или 16 (SSE2) позиций по первому и последнему байту образца,
+ * целиком образец проверяется только там, где оба совпали.
+ * Реализация выбирается один раз при запуске по возможностям
+ * процессора, на других платформах работает скалярная.
+ * Тот же поиск зарегистрирован в sqlite функцией FUNCTION_NAME,
+ * через неё фильтры выполняются в запросах.
+*/
+class SqliteSubstringSearch
+{
+public:
+    static const char *const FUNCTION_NAME;  //имя функции фильтра в sql
+    static bool contains(const char *haystack, int size, const char *needle, int needleSize);
+    static bool install(sqlite3 *handle);
+    static const char *implementation();
+
+private:
+    typedef bool (*Kernel)(const char *, int, const char *, int);
+
+    static Kernel kernel();
+    static Kernel selectKernel();
+    static void containsFunction(sqlite3_context *context, int argc, sqlite3_value **argv);
+};
+
+#endif // SQLITESUBSTRINGSEARCH_H
@@ -0,0 +1,167 @@
+#include "SqliteSyncScheduler.h"
+
+SqliteSyncScheduler::SqliteSyncScheduler()
+{
+    interval_ = DEFAULT_INTERVAL;
+    current_interval_ = DEFAULT_INTERVAL;
+    timer_ = new QTimer();
+    timer_->setSingleShot(true);
+    QObject::connect(timer_, SIGNAL(timeout()),
+                     this, SLOT(onTimeout()));
+}
+
+/*
+ * Смена политики. interval - период опроса без изменений
+ * для Interval (меньше нуля - DEFAULT_INTERVAL).
+ * Отступ начинается заново.
+*/
+void SqliteSyncScheduler::setPolicy(Policy policy, int interval)
+{
+    policy_ = policy;
+    interval_ = interval > 0 ? interval : DEFAULT_INTERVAL;
+    current_interval_ = interval_;
+    schedule();
+}
+
+SqliteSyncScheduler::Policy SqliteSyncScheduler::policy() const
+{
+    return policy_;
+}
+
+/*
+ * Через сколько мс будет следующая проверка по таймеру,
+ * -1 если проверок по таймеру нет
+*/
+int SqliteSyncScheduler::currentInterval() const
+{
+    return timer_->isActive() ? timer_->interval() : -1;
+}
+
+/*
+ * Бд открыта: проверки начинаются с обычного периода
+*/
+void SqliteSyncScheduler::start()
+{
+    is_started_ = true;
+    current_interval_ = interval_;
+    schedule();
+}
+
+/*
+ * Бд закрыта: проверять нечего
+*/
+void SqliteSyncScheduler::stop()
+{
+    is_started_ = false;
+    timer_->stop();
+}
+
+/*
+ * Окно скрыто или свёрнуто. Изменения бд за это время
+ * увидит проверка сразу после возвращения.
+*/
+void SqliteSyncScheduler::setPaused(bool isPaused)
+{
+    if (isPaused == is_paused_) {
+        return;
+    }
+    is_paused_ = isPaused;
+    if (is_paused_) {
+        timer_->stop();
+        return;
+    }
+    current_interval_ = interval_;
+    if (is_started_ && policy_ != Manual) {
+        emit syncRequested();
+    }
+    schedule();
+}
+
+bool SqliteSyncScheduler::isPaused() const
+{
+    return is_paused_;
+}
+
+/*
+ * Найденные изменения можно применять без команды
+ * пользователя: бд открыта, окно видно и политика не Manual
+*/
+bool SqliteSyncScheduler::isActive() const
+{
+    return is_started_ && !is_paused_ && policy_ != Manual;
+}
+
+/*
+ * Политика, сохранённая для бд path (по умолчанию Interval
+ * с DEFAULT_INTERVAL). В interval - сохранённый период, -1 если его нет.
+*/
+SqliteSyncScheduler::Policy SqliteSyncScheduler::storedPolicy(const QString &path, int &interval)
+{
+    QSettings settings;
+    QString key = settingsKey(path);
+    interval = settings.value(key + "/interval", -1).toInt();
+    int policy = settings.value(key + "/policy", Interval).toInt();
+    if (policy < Manual || policy > Event) {
+        return Interval;
+    }
+    return static_cast<Policy>(policy);
+}
+
+void SqliteSyncScheduler::storePolicy(const QString &path, Policy policy, int interval)
+{
+    QSettings settings;
+    QString key = settingsKey(path);
+    settings.setValue(key + "/policy", static_cast<int>(policy));
+    settings.setValue(key + "/interval", interval);
+}
+
+/*
+ * Результат проверки (по таймеру, по событию или по команде).
+ * Изменение возвращает частый опрос, отсутствие - удваивает период.
+*/
+void SqliteSyncScheduler::onChecked(bool isChanged)
+{
+    if (isChanged) {
+        current_interval_ = MIN_INTERVAL;
+    } else {
+        current_interval_ = qMin(current_interval_ * BACKOFF_FACTOR, qMax(MAX_INTERVAL, interval_));
+    }
+    schedule();
+}
+
+/*
+ * Проверка по таймеру. Следующая ставится сразу: если
+ * проверка не нужна (бд ещё открывается), ответа не будет.
+*/
+void SqliteSyncScheduler::onTimeout()
+{
+    emit syncRequested();
+    schedule();
+}
+
+/*
+ * Перезапуск таймера под текущую политику
+*/
+void SqliteSyncScheduler::schedule()
+{
+    timer_->stop();
+    if (!is_started_ || is_paused_ || policy_ == Manual) {
+        return;
+    }
+    timer_->start(policy_ == Event ? EVENT_INTERVAL : current_interval_);
+}
+
+/*
+ * Ключ настроек бд: полный путь к файлу
+ * (слэши в QSettings разделяют группы)
+*/
+QString SqliteSyncScheduler::settingsKey(const QString &path)
+{
+    QString file = QFileInfo(path).absoluteFilePath();
+    return "sync/" + QString::fromLatin1(file.toUtf8().toBase64(QByteArray::Base64UrlEncoding));
+}
+
+SqliteSyncScheduler::~SqliteSyncScheduler()
+{
+    delete timer_;
+}
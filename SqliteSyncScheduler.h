@@ -0,0 +1,69 @@
+#ifndef SQLITESYNCSCHEDULER_H
+#define SQLITESYNCSCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QSettings>
+#include <QFileInfo>
+#include <QString>
+
+/*
+ * Планировщик проверок изменений бд вместо таймера
+ * с постоянным периодом. Политики (своя для каждой бд):
+ * Manual - бд проверяется только по команде пользователя;
+ * Interval - опрос с отступом: после найденного изменения
+ * следующая проверка через MIN_INTERVAL, после каждой проверки
+ * без изменений период удваивается до MAX_INTERVAL;
+ * Event - бд проверяется по событиям наблюдателя файлов
+ * (SqliteChangeDetector), опрос раз в EVENT_INTERVAL только
+ * на случай пропущенных событий (например сетевой диск).
+ * Пока окно скрыто или свёрнуто (setPaused), проверок по
+ * таймеру нет, после возвращения бд сразу проверяется.
+ * Таймер однократный и работает только пока бд открыта.
+*/
+class SqliteSyncScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Policy {Manual, Interval, Event};
+    const int DEFAULT_INTERVAL = 1000;  //мс, период опроса без изменений до начала отступа
+    const int MIN_INTERVAL = 250;  //мс, проверка сразу после найденного изменения
+    const int MAX_INTERVAL = 30000;  //мс, предел отступа
+    const int EVENT_INTERVAL = 60000;  //мс, страховочная проверка в режиме Event
+    const int BACKOFF_FACTOR = 2;  //во сколько раз растёт период после проверки без изменений
+    SqliteSyncScheduler();
+    void setPolicy(Policy policy, int interval = -1);
+    Policy policy() const;
+    int currentInterval() const;
+    void start();
+    void stop();
+    void setPaused(bool isPaused);
+    bool isPaused() const;
+    bool isActive() const;
+    static Policy storedPolicy(const QString &path, int &interval);
+    static void storePolicy(const QString &path, Policy policy, int interval);
+    virtual ~SqliteSyncScheduler();
+
+public slots:
+    void onChecked(bool isChanged);
+
+signals:
+    void syncRequested();
+
+private slots:
+    void onTimeout();
+
+private:
+    void schedule();
+    static QString settingsKey(const QString &path);
+
+    QTimer *timer_;
+    Policy policy_ = Interval;
+    int interval_ = 0;  //мс, период опроса без изменений (политика Interval)
+    int current_interval_ = 0;  //мс, период с учётом отступа
+    bool is_started_ = false;  //бд открыта
+    bool is_paused_ = false;  //окно скрыто или свёрнуто
+};
+
+#endif // SQLITESYNCSCHEDULER_H
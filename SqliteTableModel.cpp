@@ -0,0 +1,609 @@
+#include "SqliteTableModel.h"
+
+SqliteTableModel::SqliteTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+    pages_.setMaxCost(CACHE_PAGES);
+}
+
+void SqliteTableModel::setWorker(SqliteReaderWorker *worker)
+{
+    worker_ = worker;
+}
+
+void SqliteTableModel::setProfiler(SqliteProfiler *profiler)
+{
+    profiler_ = profiler;
+}
+
+/*
+ * Смена набора колонок (открыта другая бд).
+ * Модель полностью сбрасывается, view при этом
+ * теряет виджеты фильтров и должен создать их заново.
+*/
+void SqliteTableModel::setColumns(const QStringList &columns)
+{
+    beginResetModel();
+    generation_++;
+    if (worker_) {
+        worker_->cancelBefore(generation_);
+    }
+    columns_ = columns;
+    request_ = "";
+    values_.clear();
+    key_columns_ = 0;
+    order_ = SqliteSortOrder();
+    sort_plan_ = "";
+    row_count_ = 0;
+    pending_count_ = -1;
+    pages_.clear();
+    pending_pages_.clear();
+    active_pages_.clear();
+    sync_pages_.clear();
+    sync_rows_.clear();
+    anchors_.clear();
+    endResetModel();
+}
+
+/*
+ * Смена запроса (например изменились фильтры или сортировка).
+ * keyColumns - сколько первых колонок запроса занимает
+ * ключ строки, они не показываются. order - сортировка,
+ * которую нужно добавить к запросу.
+ * Модель не сбрасывается, чтобы не потерять виджеты фильтров
+ * в строке 0.
+*/
+void SqliteTableModel::setRequest(const QString &request, const QVariantList &values, int keyColumns,
+                                  const SqliteSortOrder &order)
+{
+    request_ = request;
+    values_ = values;
+    key_columns_ = keyColumns;
+    order_ = order;
+    refresh();
+}
+
+/*
+ * Запрос первой страницы текущего запроса с сортировкой,
+ * например для explain query plan
+*/
+QString SqliteTableModel::pageRequest(QVariantList &values) const
+{
+    return order_.pageRequest(request_, values_, QVariantList(), values);
+}
+
+/*
+ * Описание того, как sqlite выполняет сортировку
+ * (по индексу или через временное b-дерево).
+ * Показывается в подсказке хедера отсортированной колонки.
+*/
+void SqliteTableModel::setSortPlan(const QString &plan)
+{
+    sort_plan_ = plan;
+    if (order_.isSorted()) {
+        emit headerDataChanged(Qt::Horizontal, order_.column(), order_.column());
+    }
+}
+
+/*
+ * Перечитывание текущего запроса.
+ * Запросы прошлых поколений отменяются, у исполнителя
+ * запрашивается количество строк и заново читаются страницы,
+ * которые view показывал. Пока они не пришли, на экране
+ * остаются старые версии страниц.
+*/
+void SqliteTableModel::refresh()
+{
+    if (request_.isEmpty() || columns_.isEmpty() || !worker_) {
+        return;
+    }
+    generation_++;
+    worker_->cancelBefore(generation_);
+    pending_pages_.clear();
+    anchors_.clear();  //после изменения бд строки могли сдвинуться
+    pending_count_ = -1;
+    sync_rows_.clear();
+    for (int page : active_pages_) {  //незавершённое прошлое сравнение тоже переделывается
+        if (pages_.contains(page)) {
+            sync_pages_.insert(page);
+        }
+    }
+    active_pages_.clear();
+    QMetaObject::invokeMethod(worker_, "countRows", Qt::QueuedConnection,
+                              Q_ARG(int, generation_),
+                              Q_ARG(QString, request_),
+                              Q_ARG(QVariantList, values_));
+    QList<int> pages = sync_pages_.values();
+    std::sort(pages.begin(), pages.end());
+    for (int i = 0; i < pages.size(); i++) {
+        int last = i;
+        while (last + 1 < pages.size() && pages[last + 1] == pages[last] + 1) {
+            last++;
+        }
+        fetchPages(pages[i], pages[last]);
+        i = last;
+    }
+}
+
+/*
+ * Переход модели в изначальное состояние
+*/
+void SqliteTableModel::clear()
+{
+    setColumns(QStringList());
+}
+
+int SqliteTableModel::dataRowCount() const
+{
+    return row_count_;
+}
+
+/*
+ * Строки, сохранённые раньше (SqliteSidecarCache), показываются
+ * до первого ответа исполнителя. Вызывается между setColumns
+ * и setRequest: страницы попадают в кэш как устаревшие и
+ * видимые, поэтому setRequest перечитает их и сравнит, как
+ * после изменения бд.
+*/
+void SqliteTableModel::preload(int rowCount, const QList<SqliteResultBlock> &pages)
+{
+    applyRowCount(rowCount);
+    for (int page = 0; page < pages.size(); page++) {
+        storePage(page, pages[page]);
+        active_pages_.insert(page);
+    }
+}
+
+/*
+ * Первые страницы текущего запроса подряд, не больше count,
+ * если они прочитаны текущим поколением и не ждут сравнения.
+ * Пустой список, если количество строк текущего поколения
+ * ещё не пришло.
+*/
+QList<SqliteResultBlock> SqliteTableModel::leadingPages(int count) const
+{
+    QList<SqliteResultBlock> result;
+    if (counted_generation_ != generation_ || !sync_pages_.isEmpty()) {
+        return result;
+    }
+    for (int page = 0; page < count && page * PAGE_SIZE < row_count_ && isFresh(page); page++) {
+        result.append(pages_.object(page)->rows);
+    }
+    return result;
+}
+
+/*
+ * Строка row (данные начинаются с 1) прочитана текущим
+ * запросом. Если нет, её страница запрашивается, как в data(),
+ * и о её приходе сообщит dataChanged. Нужна тем, кто читает
+ * таблицу целиком без view и не должен видеть устаревшие строки.
+*/
+bool SqliteTableModel::isRowLoaded(int row) const
+{
+    if (row < 1 || row > row_count_) {
+        return false;
+    }
+    int page = (row - 1) / PAGE_SIZE;
+    active_pages_.insert(page);
+    if (!isFresh(page)) {
+        requestPages(page);
+        return false;
+    }
+    return (row - 1) % PAGE_SIZE < pages_.object(page)->rows.rowCount();
+}
+
+/*
+ * Страница page прочитана текущим запросом, и количество
+ * строк этого запроса уже известно. Страница за концом
+ * запроса пустая и считается прочитанной. Если страница не
+ * свежая, она запрашивается, и о её приходе сообщит pageReady.
+ * Пока не пришло количество строк, ничего не запрашивается:
+ * о конце обновления сообщит refreshed.
+*/
+bool SqliteTableModel::isPageLoaded(int page) const
+{
+    if (page < 0 || counted_generation_ != generation_ || !sync_pages_.isEmpty()) {
+        return false;
+    }
+    if (page * PAGE_SIZE >= row_count_) {
+        return true;
+    }
+    active_pages_.insert(page);
+    if (!isFresh(page)) {
+        requestPages(page);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Строки страницы page вместе с колонками ключа,
+ * пустой блок, если страница не свежая или за концом запроса
+*/
+SqliteResultBlock SqliteTableModel::pageRows(int page) const
+{
+    return isFresh(page) ? pages_.object(page)->rows : SqliteResultBlock();
+}
+
+int SqliteTableModel::keyColumns() const
+{
+    return key_columns_;
+}
+
+/*
+ * В ячейке только начало большого значения
+ * (см. SqliteResultBlock::setLazyCell)
+*/
+bool SqliteTableModel::isLazy(const QModelIndex &index) const
+{
+    int pageRow = 0;
+    const SqliteResultBlock *rows = rowBlock(index.row(), pageRow);
+    int column = index.column() + key_columns_;
+    return rows && column < rows->columnCount() && rows->isLazy(pageRow, column);
+}
+
+/*
+ * Значение ячейки со своим типом (blob - QByteArray),
+ * а не строка для view. Для ленивой ячейки - только начало.
+*/
+QVariant SqliteTableModel::cellValue(const QModelIndex &index) const
+{
+    int pageRow = 0;
+    const SqliteResultBlock *rows = rowBlock(index.row(), pageRow);
+    int column = index.column() + key_columns_;
+    if (!rows || column >= rows->columnCount()) {
+        return QVariant();
+    }
+    return rows->value(pageRow, column);
+}
+
+/*
+ * Ключ строки (rowid или первичный ключ),
+ * невалидный, если у запроса нет ключа или строка не прочитана
+*/
+QVariant SqliteTableModel::rowKey(int row) const
+{
+    int pageRow = 0;
+    const SqliteResultBlock *rows = rowBlock(row, pageRow);
+    if (!rows || key_columns_ == 0) {
+        return QVariant();
+    }
+    return rows->value(pageRow, 0);
+}
+
+/*
+ * Поколение, которое получат запросы после следующего
+ * setRequest. Нужно, чтобы поставить исполнителю работу,
+ * которая должна выполниться перед ними и отменяться вместе с ними.
+*/
+int SqliteTableModel::nextGeneration() const
+{
+    return generation_ + 1;
+}
+
+int SqliteTableModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || columns_.isEmpty()) {
+        return 0;
+    }
+    return row_count_ + 1;
+}
+
+int SqliteTableModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return columns_.size();
+}
+
+/*
+ * Значение ячейки.
+ * Если страницы со строкой нет в кэше или она устарела,
+ * то она запрашивается у исполнителя, а пока показывается
+ * то, что есть.
+*/
+QVariant SqliteTableModel::data(const QModelIndex &index, int role) const
+{
+    if (role != Qt::DisplayRole || !index.isValid() || index.row() == 0) {
+        return QVariant();
+    }
+    int row = index.row() - 1;
+    int page = row / PAGE_SIZE;
+    active_pages_.insert(page);
+    Page *cached = pages_.object(page);
+    if (!isFresh(page)) {
+        requestPages(page);
+    }
+    int pageRow = row % PAGE_SIZE;
+    int column = index.column() + key_columns_;
+    if (!cached || pageRow >= cached->rows.rowCount() ||
+            column >= cached->rows.columnCount()) {
+        return QVariant();
+    }
+    return cached->rows.text(pageRow, column);
+}
+
+/*
+ * Блок страницы строки row модели и номер строки в нём,
+ * nullptr если строки нет в кэше
+*/
+const SqliteResultBlock *SqliteTableModel::rowBlock(int row, int &pageRow) const
+{
+    if (row < 1 || row > row_count_) {
+        return nullptr;
+    }
+    Page *cached = pages_.object((row - 1) / PAGE_SIZE);
+    pageRow = (row - 1) % PAGE_SIZE;
+    if (!cached || pageRow >= cached->rows.rowCount()) {
+        return nullptr;
+    }
+    return &cached->rows;
+}
+
+/*
+ * Горизонтальные хедеры - названия колонок.
+ * Вертикальные нумеруются с нуля, начиная со строки
+ * после фильтров, у строки фильтров хедер пустой.
+*/
+QVariant SqliteTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role == Qt::ToolTipRole && orientation == Qt::Horizontal &&
+            section == order_.column() && !sort_plan_.isEmpty()) {
+        return sort_plan_;
+    }
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    if (orientation == Qt::Horizontal) {
+        return section < columns_.size() ? columns_[section] : QVariant();
+    }
+    return section == 0 ? QString("") : QString::number(section - 1);
+}
+
+Qt::ItemFlags SqliteTableModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return Qt::NoItemFlags;
+    }
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+/*
+ * Клик по хедеру view. Строки сортирует не модель,
+ * а sqlite, поэтому запрос перестраивает SqliteReaderModel.
+*/
+void SqliteTableModel::sort(int column, Qt::SortOrder order)
+{
+    emit sortRequested(column, order);
+}
+
+/*
+ * Пришло количество строк текущего запроса.
+ * Применяется вместе с перечитанными страницами.
+*/
+void SqliteTableModel::onRowCountReady(int generation, int count)
+{
+    if (generation != generation_) {
+        return;
+    }
+    pending_count_ = count;
+    finishSync();
+}
+
+/*
+ * Пришла очередная страница от исполнителя.
+ * Страницы, перечитанные для сравнения, откладываются
+ * до прихода остальных, прочие сразу попадают в кэш.
+*/
+void SqliteTableModel::onRowsReady(int generation, int offset, const SqliteResultBlock &rows)
+{
+    if (generation != generation_) {
+        return;
+    }
+    int page = offset / PAGE_SIZE;
+    pending_pages_.remove(page);
+    storeAnchor(page, rows);
+    if (sync_pages_.contains(page)) {
+        sync_rows_.insert(page, rows);
+        finishSync();
+        return;
+    }
+    SqliteProfiler::Scope scope(profiler_, "applyPage", "model");  //вместе с обновлением view
+    scope.setArg("rows", rows.rowCount());
+    storePage(page, rows);
+    int first = offset + 1;
+    int last = qMin(offset + rows.rowCount(), row_count_);
+    if (first <= last) {
+        emit dataChanged(index(first, 0), index(last, columns_.size() - 1));
+    }
+    emit pageReady(page);
+}
+
+/*
+ * Страница есть в кэше и прочитана текущим запросом
+*/
+bool SqliteTableModel::isFresh(int page) const
+{
+    Page *cached = pages_.object(page);
+    return cached && cached->generation == generation_;
+}
+
+/*
+ * Запрос у исполнителя страницы page и PREFETCH_PAGES
+ * соседних страниц одним запросом. Страницы, которые уже
+ * свежие или уже запрошены, повторно не запрашиваются.
+*/
+void SqliteTableModel::requestPages(int page) const
+{
+    if (!worker_ || pending_pages_.contains(page)) {
+        return;
+    }
+    int lastPage = qMax(0, (row_count_ - 1) / PAGE_SIZE);
+    int first = qMax(0, page - PREFETCH_PAGES);
+    int last = qMin(lastPage, page + PREFETCH_PAGES);
+    while (first < page && (pending_pages_.contains(first) || isFresh(first))) {
+        first++;
+    }
+    while (last > page && (pending_pages_.contains(last) || isFresh(last))) {
+        last--;
+    }
+    fetchPages(first, last);
+}
+
+/*
+ * Запрос у исполнителя страниц с first по last.
+ * При сортировке с ключом чтение начинается поиском от
+ * последней строки ближайшей известной страницы перед first,
+ * offset нужен только на страницы между ними. Без неё
+ * (первое чтение после изменения бд) страницы читаются через offset.
+*/
+void SqliteTableModel::fetchPages(int first, int last) const
+{
+    for (int i = first; i <= last; i++) {
+        pending_pages_.insert(i);
+    }
+    QVariantList anchor;
+    int skip = first * PAGE_SIZE;
+    QMap<int, QVariantList>::const_iterator known = anchors_.lowerBound(first);
+    if (order_.isKeyset() && known != anchors_.constBegin()) {
+        known--;
+        anchor = known.value();
+        skip = (first - known.key() - 1) * PAGE_SIZE;
+    }
+    QVariantList values;
+    QString request = order_.pageRequest(request_, values_, anchor, values);
+    QMetaObject::invokeMethod(worker_, "fetchRows", Qt::QueuedConnection,
+                              Q_ARG(int, generation_),
+                              Q_ARG(QString, request),
+                              Q_ARG(QVariantList, values),
+                              Q_ARG(int, first * PAGE_SIZE),
+                              Q_ARG(int, skip),
+                              Q_ARG(int, PAGE_SIZE),
+                              Q_ARG(int, last - first + 1));
+}
+
+/*
+ * Запоминание значений сортировки и ключа последней строки
+ * полной страницы, от неё читается следующая страница
+*/
+void SqliteTableModel::storeAnchor(int page, const SqliteResultBlock &rows)
+{
+    int column = key_columns_ + order_.column();
+    if (!order_.isKeyset() || rows.rowCount() < PAGE_SIZE || column >= rows.columnCount()) {
+        return;
+    }
+    int last = rows.rowCount() - 1;
+    anchors_.insert(page, QVariantList() << rows.value(last, column) << rows.value(last, 0));
+}
+
+/*
+ * Когда пришли и количество строк, и все перечитанные
+ * страницы, они сравниваются со старыми. Страницы
+ * обрабатываются с конца, чтобы вставки и удаления в одной
+ * не сдвигали номера строк ещё не обработанных.
+ * Остаток разницы в количестве строк добавляется или
+ * удаляется в конце таблицы, после чего сообщается, что
+ * таблица соответствует текущему запросу.
+*/
+void SqliteTableModel::finishSync()
+{
+    if (pending_count_ < 0 || sync_rows_.size() < sync_pages_.size()) {
+        return;
+    }
+    SqliteProfiler::Scope scope(profiler_, "sync", "model");  //сравнение и обновление view
+    scope.setArg("pages", sync_rows_.size());
+    QList<int> pages = sync_rows_.keys();
+    std::sort(pages.begin(), pages.end());
+    for (int i = pages.size() - 1; i >= 0; i--) {
+        applyDiff(pages[i], sync_rows_.value(pages[i]));
+    }
+    sync_pages_.clear();
+    sync_rows_.clear();
+    applyRowCount(pending_count_);
+    pending_count_ = -1;
+    counted_generation_ = generation_;
+    emit refreshed(row_count_);
+}
+
+/*
+ * Замена страницы page новой версией rows с сообщением view
+ * только о реально вставленных, удалённых и изменённых строках.
+ * Если старой версии уже нет в кэше или она не сходится
+ * с текущими номерами строк, то страница просто заменяется.
+*/
+void SqliteTableModel::applyDiff(int page, const SqliteResultBlock &rows)
+{
+    Page *cached = pages_.object(page);
+    int base = page * PAGE_SIZE + 1;
+    if (!cached || base + cached->rows.rowCount() - 1 > row_count_) {
+        storePage(page, rows);
+        int last = qMin(base + rows.rowCount() - 1, row_count_);
+        if (base <= last) {
+            emit dataChanged(index(base, 0), index(last, columns_.size() - 1));
+        }
+        return;
+    }
+    SqliteResultBlock oldRows = cached->rows;
+    storePage(page, rows);
+    SqliteRowDiff diff;
+    for (const SqliteRowDiff::Operation &operation : diff.compute(oldRows, rows, key_columns_)) {
+        int first = base + operation.first;
+        int last = base + operation.last;
+        int count = operation.last - operation.first + 1;
+        switch (operation.type) {
+        case SqliteRowDiff::Operation::Remove:
+            beginRemoveRows(QModelIndex(), first, last);
+            row_count_ -= count;
+            endRemoveRows();
+            break;
+        case SqliteRowDiff::Operation::Insert:
+            beginInsertRows(QModelIndex(), first, last);
+            row_count_ += count;
+            endInsertRows();
+            break;
+        case SqliteRowDiff::Operation::Update:
+            emit dataChanged(index(first, operation.firstColumn),
+                             index(last, operation.lastColumn));
+            break;
+        }
+    }
+}
+
+/*
+ * Сохранение страницы текущего поколения.
+ * Пустая страница из кэша удаляется.
+*/
+void SqliteTableModel::storePage(int page, const SqliteResultBlock &rows)
+{
+    if (rows.rowCount() == 0) {
+        pages_.remove(page);
+        return;
+    }
+    Page *cached = new Page();
+    cached->generation = generation_;
+    cached->rows = rows;
+    pages_.insert(page, cached);
+}
+
+/*
+ * Приведение количества строк к count через
+ * сигналы вставки и удаления строк.
+*/
+void SqliteTableModel::applyRowCount(int count)
+{
+    if (count < row_count_) {
+        beginRemoveRows(QModelIndex(), count + 1, row_count_);
+        row_count_ = count;
+        endRemoveRows();
+    } else if (count > row_count_) {
+        beginInsertRows(QModelIndex(), row_count_ + 1, count);
+        row_count_ = count;
+        endInsertRows();
+    }
+}
+
+SqliteTableModel::~SqliteTableModel()
+{
+
+}
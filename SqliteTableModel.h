@@ -0,0 +1,126 @@
+#ifndef SQLITETABLEMODEL_H
+#define SQLITETABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QCache>
+#include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+#include <algorithm>
+
+#include "SqliteReaderWorker.h"
+#include "SqliteResultBlock.h"
+#include "SqliteRowDiff.h"
+#include "SqliteProfiler.h"
+#include "SqliteSortOrder.h"
+
+/*
+ * Виртуальная модель таблицы для QTableView.
+ * Хранит не всю таблицу, а только страницы по PAGE_SIZE строк,
+ * которые view действительно запрашивал, в LRU-кэше на
+ * CACHE_PAGES страниц. Строка 0 зарезервирована под фильтры,
+ * данные начинаются со строки 1.
+ * Строки читает SqliteReaderWorker в своём потоке, пока страница
+ * не пришла, показывается её устаревшая версия (если есть).
+ * При смене запроса страницы, которые view показывал, читаются
+ * заново и сравниваются со старыми через SqliteRowDiff, так что
+ * view получает только вставки, удаления и изменения ячеек.
+ * Сортировку по клику на хедер выполняет sqlite (см. SqliteSortOrder),
+ * модель только запоминает последние строки прочитанных страниц,
+ * чтобы следующие страницы читать поиском от них, а не через offset.
+*/
+class SqliteTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    const int PAGE_SIZE = 256;  //количество строк в одной странице кэша
+    const int CACHE_PAGES = 64;  //максимальное количество страниц в кэше
+    const int PREFETCH_PAGES = 1;  //сколько соседних страниц подгружается вместе с нужной
+    SqliteTableModel(QObject *parent = nullptr);
+    void setWorker(SqliteReaderWorker *worker);
+    void setProfiler(SqliteProfiler *profiler);
+    void setColumns(const QStringList &columns);
+    void setRequest(const QString &request, const QVariantList &values, int keyColumns,
+                    const SqliteSortOrder &order = SqliteSortOrder());
+    QString pageRequest(QVariantList &values) const;
+    void setSortPlan(const QString &plan);
+    void refresh();
+    void clear();
+    int dataRowCount() const;
+    void preload(int rowCount, const QList<SqliteResultBlock> &pages);
+    QList<SqliteResultBlock> leadingPages(int count) const;
+    bool isRowLoaded(int row) const;
+    bool isPageLoaded(int page) const;
+    SqliteResultBlock pageRows(int page) const;
+    int keyColumns() const;
+    bool isLazy(const QModelIndex &index) const;
+    QVariant cellValue(const QModelIndex &index) const;
+    QVariant rowKey(int row) const;
+    int nextGeneration() const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+    virtual ~SqliteTableModel();
+
+signals:
+    void refreshed(int rowCount);
+    void pageReady(int page);
+    void sortRequested(int column, Qt::SortOrder order);
+
+public slots:
+    void onRowCountReady(int generation, int count);
+    void onRowsReady(int generation, int offset, const SqliteResultBlock &rows);
+
+private:
+    /*
+     * Страница кэша. generation - поколение запроса,
+     * которым она прочитана, страницы старых поколений
+     * показываются, но перечитываются.
+    */
+    struct Page
+    {
+        int generation = 0;
+        SqliteResultBlock rows;
+    };
+
+    bool isFresh(int page) const;
+    const SqliteResultBlock *rowBlock(int row, int &pageRow) const;
+    void requestPages(int page) const;
+    void fetchPages(int first, int last) const;
+    void storeAnchor(int page, const SqliteResultBlock &rows);
+    void finishSync();
+    void applyDiff(int page, const SqliteResultBlock &rows);
+    void storePage(int page, const SqliteResultBlock &rows);
+    void applyRowCount(int count);
+
+    SqliteReaderWorker *worker_ = nullptr;
+    SqliteProfiler *profiler_ = nullptr;  //замеры этапов, может быть nullptr
+    QString request_ = "";  //запрос без limit/offset, уже с фильтрами
+    QVariantList values_;  //значения для плейсхолдеров request_
+    int key_columns_ = 0;  //сколько первых колонок запроса занимает ключ строки
+    SqliteSortOrder order_;  //сортировка, которую выполняет sqlite
+    QString sort_plan_ = "";  //описание плана сортировки для подсказки хедера
+    QStringList columns_;
+    int row_count_ = 0;  //количество строк данных (без строки фильтров)
+    int generation_ = 0;  //поколение текущего запроса
+    int pending_count_ = -1;  //количество строк нового поколения, пока не применены страницы
+    int counted_generation_ = 0;  //поколение, количество строк которого применено
+    QSet<int> sync_pages_;  //страницы, которые перечитываются для сравнения
+    QHash<int, SqliteResultBlock> sync_rows_;  //уже пришедшие новые версии sync_pages_
+    mutable QCache<int, Page> pages_;
+    mutable QSet<int> pending_pages_;  //страницы, запрошенные у исполнителя
+    mutable QSet<int> active_pages_;  //страницы, которые view читал в текущем поколении
+    QMap<int, QVariantList> anchors_;  //значения сортировки и ключа последних строк страниц текущего поколения
+};
+
+#endif // SQLITETABLEMODEL_H
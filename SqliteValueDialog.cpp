@@ -0,0 +1,84 @@
+#include "SqliteValueDialog.h"
+
+SqliteValueDialog::SqliteValueDialog(const QString &column, const QVariant &value, QWidget *parent)
+    : QDialog(parent)
+{
+    column_ = column;
+    bool isBlob = value.type() == QVariant::ByteArray;
+    bytes_ = isBlob ? value.toByteArray() : value.toString().toUtf8();
+    setWindowTitle(column);
+    setAttribute(Qt::WA_DeleteOnClose);
+    resize(DIALOG_WIDTH, DIALOG_HEIGHT);
+
+    QPlainTextEdit *text = new QPlainTextEdit();
+    text->setReadOnly(true);
+    QString size = QString::number(bytes_.size()) + " bytes";
+    if (isBlob) {
+        text->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+        text->setLineWrapMode(QPlainTextEdit::NoWrap);
+        text->setPlainText(hexDump(bytes_.left(HEX_LIMIT)));
+        size = "BLOB, " + size;
+        if (bytes_.size() > HEX_LIMIT) {
+            size += ", the first " + QString::number(HEX_LIMIT) + " shown";
+        }
+    } else {
+        text->setPlainText(value.isNull() ? QString() : value.toString());
+        size = value.isNull() ? "NULL" : "Text, " + size;
+    }
+    QPushButton *saveButton = new QPushButton("Save...");
+    saveButton->setEnabled(!value.isNull());
+    QPushButton *closeButton = new QPushButton("Close");
+    QHBoxLayout *buttons = new QHBoxLayout();
+    buttons->addWidget(new QLabel(size));
+    buttons->addStretch();
+    buttons->addWidget(saveButton);
+    buttons->addWidget(closeButton);
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(text);
+    layout->addLayout(buttons);
+
+    QObject::connect(saveButton, SIGNAL(clicked()),
+                     this, SLOT(saveValue()));
+    QObject::connect(closeButton, SIGNAL(clicked()),
+                     this, SLOT(close()));
+}
+
+/*
+ * Сохранение значения в файл без преобразований
+*/
+void SqliteValueDialog::saveValue()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Save value", column_);
+    if (path.isEmpty()) {
+        return;
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(bytes_) != bytes_.size()) {
+        QMessageBox::warning(this, windowTitle(), "Cannot write " + path + ": " + file.errorString());
+    }
+}
+
+/*
+ * Дамп по HEX_WIDTH байт в строке: смещение,
+ * байты и их печатные символы
+*/
+QString SqliteValueDialog::hexDump(const QByteArray &bytes) const
+{
+    QString dump;
+    for (int offset = 0; offset < bytes.size(); offset += HEX_WIDTH) {
+        QByteArray line = bytes.mid(offset, HEX_WIDTH);
+        QString printable;
+        for (char byte : line) {
+            printable += byte >= 0x20 && byte < 0x7f ? QChar(byte) : QChar('.');
+        }
+        dump += QString("%1  %2  %3\n").arg(offset, 8, 16, QChar('0'))
+                                       .arg(QString::fromLatin1(line.toHex(' ')), -HEX_WIDTH * 3 + 1)
+                                       .arg(printable);
+    }
+    return dump;
+}
+
+SqliteValueDialog::~SqliteValueDialog()
+{
+
+}
@@ -0,0 +1,46 @@
+#ifndef SQLITEVALUEDIALOG_H
+#define SQLITEVALUEDIALOG_H
+
+#include <QDialog>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QLabel>
+#include <QFileDialog>
+#include <QFile>
+#include <QMessageBox>
+#include <QFontDatabase>
+#include <QByteArray>
+#include <QString>
+#include <QVariant>
+
+/*
+ * Окно просмотра значения ячейки целиком (двойной клик по ячейке).
+ * Текст показывается как есть, blob - шестнадцатеричным дампом
+ * первых HEX_LIMIT байт. Значение можно сохранить в файл байтами,
+ * как оно лежит в бд (текст - в UTF-8).
+*/
+class SqliteValueDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    const int HEX_LIMIT = 65536;  //байт blob, которые показываются дампом
+    const int HEX_WIDTH = 16;  //байт в одной строке дампа
+    const int DIALOG_WIDTH = 640;
+    const int DIALOG_HEIGHT = 480;
+    SqliteValueDialog(const QString &column, const QVariant &value, QWidget *parent = nullptr);
+    virtual ~SqliteValueDialog();
+
+private slots:
+    void saveValue();
+
+private:
+    QString hexDump(const QByteArray &bytes) const;
+
+    QByteArray bytes_;  //значение в том виде, в котором оно сохраняется
+    QString column_ = "";
+};
+
+#endif // SQLITEVALUEDIALOG_H
@@ -0,0 +1,153 @@
+#include "BenchmarkStats.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+static std::atomic<qint64> allocation_count(0);  //вызовы operator new с начала работы
+
+/*
+ * Замена глобальных operator new/delete, чтобы считать выделения
+*/
+void *operator new(std::size_t size)
+{
+    allocation_count++;
+    void *memory = std::malloc(size > 0 ? size : 1);
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+BenchmarkStats::BenchmarkStats()
+{
+
+}
+
+void BenchmarkStats::add(double milliseconds)
+{
+    samples_.append(milliseconds);
+}
+
+void BenchmarkStats::addAllocations(qint64 count)
+{
+    allocations_ += count;
+}
+
+int BenchmarkStats::count() const
+{
+    return samples_.size();
+}
+
+/*
+ * Перцентиль задержки (fraction от 0 до 1)
+ * методом ближайшего ранга
+*/
+double BenchmarkStats::percentile(double fraction) const
+{
+    if (samples_.isEmpty()) {
+        return 0;
+    }
+    QVector<double> sorted = samples_;
+    std::sort(sorted.begin(), sorted.end());
+    int rank = static_cast<int>(fraction * sorted.size() + 0.999999);
+    return sorted[qBound(0, rank - 1, sorted.size() - 1)];
+}
+
+QJsonObject BenchmarkStats::toJson() const
+{
+    double sum = 0;
+    QJsonArray samples;
+    for (double sample : samples_) {
+        sum += sample;
+        samples.append(sample);
+    }
+    QJsonObject result;
+    result.insert("count", samples_.size());
+    result.insert("meanMs", samples_.isEmpty() ? 0 : sum / samples_.size());
+    result.insert("p50Ms", percentile(0.5));
+    result.insert("p90Ms", percentile(0.9));
+    result.insert("p99Ms", percentile(0.99));
+    result.insert("maxMs", percentile(1));
+    result.insert("newCalls", static_cast<double>(allocations_));
+    result.insert("samplesMs", samples);
+    return result;
+}
+
+qint64 BenchmarkStats::allocationCount()
+{
+    return allocation_count.load();
+}
+
+/*
+ * Пиковый размер резидентной памяти процесса в КиБ,
+ * -1 если платформа не даёт его узнать
+*/
+qint64 BenchmarkStats::peakRssKb()
+{
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#if defined(Q_OS_MACOS)
+    return usage.ru_maxrss / 1024;  //на macOS в байтах
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return -1;
+#endif
+}
+
+/*
+ * Байты, занятые в куче malloc сейчас,
+ * -1 если аллокатор этого не сообщает
+*/
+qint64 BenchmarkStats::heapBytes()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return static_cast<qint64>(info.uordblks + info.hblkhd);
+#else
+    return -1;
+#endif
+}
+
+BenchmarkStats::~BenchmarkStats()
+{
+
+}
@@ -0,0 +1,36 @@
+#ifndef BENCHMARKSTATS_H
+#define BENCHMARKSTATS_H
+
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QVector>
+
+#include <algorithm>
+
+/*
+ * Замеры одного сценария: задержки в миллисекундах
+ * и количество выделений памяти за все запуски.
+ * Выделения считаются по вызовам operator new (он заменён
+ * в BenchmarkStats.cpp), malloc внутри Qt и sqlite сюда
+ * не попадает - для него есть heapBytes.
+*/
+class BenchmarkStats
+{
+public:
+    BenchmarkStats();
+    void add(double milliseconds);
+    void addAllocations(qint64 count);
+    int count() const;
+    double percentile(double fraction) const;
+    QJsonObject toJson() const;
+    static qint64 allocationCount();
+    static qint64 peakRssKb();
+    static qint64 heapBytes();
+    virtual ~BenchmarkStats();
+
+private:
+    QVector<double> samples_;
+    qint64 allocations_ = 0;
+};
+
+#endif // BENCHMARKSTATS_H
@@ -0,0 +1,89 @@
+#-------------------------------------------------
+#
+# Headless benchmark of the model layer: opening,
+# filtering, syncing and feeding rows to a view on
+# generated databases. Results are written as JSON.
+#
+#-------------------------------------------------
+
+QT       += core sql
+QT       -= gui
+
+TARGET = ModelBenchmark
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+LIBS += -lsqlite3
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+        main.cpp \
+    SqliteFixture.cpp \
+    BenchmarkStats.cpp \
+    ../../DBException.cpp \
+    ../../UnsupportedDBException.cpp \
+    ../../UnreachableDBException.cpp \
+    ../../SqliteReaderModel.cpp \
+    ../../SqliteChangeDetector.cpp \
+    ../../SqliteTableModel.cpp \
+    ../../SqliteReaderWorker.cpp \
+    ../../SqliteFilterCompiler.cpp \
+    ../../SqliteRowDiff.cpp \
+    ../../SqliteFilterScheduler.cpp \
+    ../../SqliteResultBlock.cpp \
+    ../../SqliteSubstringSearch.cpp \
+    ../../SqliteSchemaCatalog.cpp \
+    ../../SqliteConnectionProfile.cpp \
+    ../../SqliteProfiler.cpp \
+    ../../SqliteSortOrder.cpp \
+    ../../SqliteStatementCache.cpp \
+    ../../SqliteExporter.cpp \
+    ../../SqliteSyncScheduler.cpp \
+    ../../SqliteHyperLogLog.cpp \
+    ../../SqliteScanSummary.cpp \
+    ../../SqliteParallelScan.cpp \
+    ../../SqliteHistogram.cpp \
+    ../../SqliteSpaceSaving.cpp \
+    ../../SqliteQueryPlan.cpp \
+    ../../SqliteQueryResultModel.cpp \
+    ../../SqliteSidecarCache.cpp \
+    ../../SqliteChunkFingerprint.cpp \
+    ../../SqliteResultPage.cpp
+
+HEADERS += \
+    SqliteFixture.h \
+    BenchmarkStats.h \
+    ../../DBException.h \
+    ../../UnsupportedDBException.h \
+    ../../UnreachableDBException.h \
+    ../../SqliteReaderModel.h \
+    ../../SqliteChangeDetector.h \
+    ../../SqliteTableModel.h \
+    ../../SqliteReaderWorker.h \
+    ../../SqliteFilterCompiler.h \
+    ../../SqliteRowDiff.h \
+    ../../SqliteFilterScheduler.h \
+    ../../SqliteResultBlock.h \
+    ../../SqliteSubstringSearch.h \
+    ../../SqliteSchemaCatalog.h \
+    ../../SqliteConnectionProfile.h \
+    ../../SqliteProfiler.h \
+    ../../SqliteSortOrder.h \
+    ../../SqliteStatementCache.h \
+    ../../SqliteExporter.h \
+    ../../SqliteSyncScheduler.h \
+    ../../SqliteHyperLogLog.h \
+    ../../SqliteScanSummary.h \
+    ../../SqliteParallelScan.h \
+    ../../SqliteHistogram.h \
+    ../../SqliteSpaceSaving.h \
+    ../../SqliteQueryPlan.h \
+    ../../SqliteQueryResultModel.h \
+    ../../SqliteSidecarCache.h \
+    ../../SqliteChunkFingerprint.h \
+    ../../SqliteResultPage.h
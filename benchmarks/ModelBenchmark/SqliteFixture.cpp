@@ -0,0 +1,188 @@
+#include "SqliteFixture.h"
+
+static const char *const SYLLABLES[] = {"ka", "lo", "mi", "ne", "ru", "sa", "to", "vi"};
+
+SqliteFixture::SqliteFixture(const QString &path, int rows, int columns, unsigned seed)
+{
+    path_ = path;
+    rows_ = rows;
+    columns_ = columns;
+    state_ = seed;
+}
+
+/*
+ * Создание файла бд и заполнение таблицы.
+ * Файл перезаписывается, если уже есть.
+*/
+bool SqliteFixture::create()
+{
+    QFile::remove(path_);
+    sqlite3 *handle = nullptr;
+    if (sqlite3_open(path_.toUtf8().constData(), &handle) != SQLITE_OK) {
+        sqlite3_close(handle);
+        return false;
+    }
+    QStringList definitions("id integer primary key");
+    QStringList placeholders;
+    for (int i = 0; i < columns_; i++) {
+        const char *types[] = {"integer", "real", "text", "text"};
+        definitions.append("c" + QString::number(i) + " " + types[i % 4]);
+        placeholders.append("?");
+    }
+    QByteArray create = QString("create table " + TABLE_NAME + "(" + definitions.join(", ") + ")").toUtf8();
+    QByteArray insert = QString("insert into " + TABLE_NAME + " values (null, " + placeholders.join(", ") + ")").toUtf8();
+    bool isCreated = sqlite3_exec(handle, create.constData(), nullptr, nullptr, nullptr) == SQLITE_OK;
+    sqlite3_stmt *statement = nullptr;
+    isCreated = isCreated && sqlite3_prepare_v2(handle, insert.constData(), -1, &statement, nullptr) == SQLITE_OK;
+    for (int row = 0; isCreated && row < rows_; row++) {
+        if (row % INSERT_BATCH == 0) {
+            sqlite3_exec(handle, row == 0 ? "begin" : "commit; begin", nullptr, nullptr, nullptr);
+        }
+        isCreated = bindRow(statement, row);
+    }
+    sqlite3_finalize(statement);
+    sqlite3_exec(handle, "commit", nullptr, nullptr, nullptr);
+    sqlite3_close(handle);
+    return isCreated;
+}
+
+/*
+ * Изменение бд "со стороны": updates строк получают новое
+ * значение короткой строковой колонки, inserts строк
+ * добавляются в конец. Всё одной транзакцией.
+*/
+bool SqliteFixture::modify(int updates, int inserts)
+{
+    sqlite3 *handle = nullptr;
+    if (sqlite3_open(path_.toUtf8().constData(), &handle) != SQLITE_OK) {
+        sqlite3_close(handle);
+        return false;
+    }
+    int column = qMin(2, columns_ - 1);
+    QByteArray update = QString("update " + TABLE_NAME + " set c" + QString::number(column) +
+                                " = ? where id = ?").toUtf8();
+    QStringList placeholders;
+    for (int i = 0; i < columns_; i++) {
+        placeholders.append("?");
+    }
+    QByteArray insert = QString("insert into " + TABLE_NAME + " values (null, " + placeholders.join(", ") + ")").toUtf8();
+    sqlite3_exec(handle, "begin", nullptr, nullptr, nullptr);
+    sqlite3_stmt *statement = nullptr;
+    bool isModified = columns_ > 0 &&
+                      sqlite3_prepare_v2(handle, update.constData(), -1, &statement, nullptr) == SQLITE_OK;
+    for (int i = 0; isModified && i < updates; i++) {
+        QByteArray value = word(next()).toUtf8();
+        sqlite3_bind_text(statement, 1, value.constData(), value.size(), SQLITE_TRANSIENT);
+        sqlite3_bind_int64(statement, 2, 1 + next() % qMax(rows_, 1));
+        isModified = sqlite3_step(statement) == SQLITE_DONE;
+        sqlite3_reset(statement);
+    }
+    sqlite3_finalize(statement);
+    statement = nullptr;
+    isModified = isModified && sqlite3_prepare_v2(handle, insert.constData(), -1, &statement, nullptr) == SQLITE_OK;
+    for (int i = 0; isModified && i < inserts; i++) {
+        isModified = bindRow(statement, rows_);
+        rows_++;
+    }
+    sqlite3_finalize(statement);
+    sqlite3_exec(handle, isModified ? "commit" : "rollback", nullptr, nullptr, nullptr);
+    sqlite3_close(handle);
+    return isModified;
+}
+
+QString SqliteFixture::path() const
+{
+    return path_;
+}
+
+int SqliteFixture::rowCount() const
+{
+    return rows_;
+}
+
+int SqliteFixture::columnCount() const
+{
+    return columns_;
+}
+
+qint64 SqliteFixture::fileSize() const
+{
+    return QFileInfo(path_).size();
+}
+
+/*
+ * Номер колонки модели (с учётом id) с короткими строками,
+ * по которой фильтруют замеры
+*/
+int SqliteFixture::textColumn() const
+{
+    return columns_ > 2 ? 3 : 0;
+}
+
+/*
+ * Фильтры, как их набирает пользователь: каждый следующий
+ * содержит предыдущий, поэтому проходы сужаются.
+*/
+QStringList SqliteFixture::filterSteps() const
+{
+    if (textColumn() == 0) {
+        return QStringList() << "1" << "12" << "123";
+    }
+    return QStringList() << "a" << "ka" << "kalo";
+}
+
+/*
+ * Слово из трёх слогов, определяемое value
+*/
+QString SqliteFixture::word(unsigned value) const
+{
+    QString result;
+    for (int i = 0; i < 3; i++) {
+        result += SYLLABLES[(value >> (i * 3)) & 7];
+    }
+    return result;
+}
+
+bool SqliteFixture::bindRow(sqlite3_stmt *statement, int row)
+{
+    for (int i = 0; i < columns_; i++) {
+        switch (i % 4) {
+        case 0:
+            sqlite3_bind_int64(statement, i + 1, static_cast<qint64>(next() % 1000000));
+            break;
+        case 1:
+            sqlite3_bind_double(statement, i + 1, (next() % 100000) / 100.0);
+            break;
+        case 2: {
+            QByteArray value = word(next()).toUtf8();
+            sqlite3_bind_text(statement, i + 1, value.constData(), value.size(), SQLITE_TRANSIENT);
+            break;
+        }
+        default: {
+            QByteArray value = QString("%1 %2 %3 #%4").arg(word(next()), word(next()), word(next()))
+                               .arg(row).toUtf8();
+            sqlite3_bind_text(statement, i + 1, value.constData(), value.size(), SQLITE_TRANSIENT);
+            break;
+        }
+        }
+    }
+    bool isInserted = sqlite3_step(statement) == SQLITE_DONE;
+    sqlite3_reset(statement);
+    return isInserted;
+}
+
+/*
+ * xorshift32: быстрый и одинаковый на всех платформах
+*/
+unsigned SqliteFixture::next()
+{
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 17;
+    state_ ^= state_ << 5;
+    return state_;
+}
+
+SqliteFixture::~SqliteFixture()
+{
+
+}
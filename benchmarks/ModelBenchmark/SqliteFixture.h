@@ -0,0 +1,45 @@
+#ifndef SQLITEFIXTURE_H
+#define SQLITEFIXTURE_H
+
+#include <QString>
+#include <QStringList>
+#include <QFile>
+#include <QFileInfo>
+
+#include <sqlite3.h>
+
+/*
+ * Сгенерированная бд для замеров - большая версия cars.db3.
+ * Таблица TABLE_NAME: id и columns колонок, которые по кругу
+ * бывают целыми, вещественными, короткими и длинными строками.
+ * Значения детерминированы (зависят только от seed), поэтому
+ * замеры разных сборок сравнимы.
+*/
+class SqliteFixture
+{
+public:
+    const QString TABLE_NAME = "bench";  //имя таблицы с данными
+    const int INSERT_BATCH = 10000;  //строк в одной транзакции при заполнении
+    SqliteFixture(const QString &path, int rows, int columns, unsigned seed = 1);
+    bool create();
+    bool modify(int updates, int inserts);
+    QString path() const;
+    int rowCount() const;
+    int columnCount() const;
+    qint64 fileSize() const;
+    int textColumn() const;
+    QStringList filterSteps() const;
+    virtual ~SqliteFixture();
+
+private:
+    QString word(unsigned value) const;
+    bool bindRow(sqlite3_stmt *statement, int row);
+    unsigned next();
+
+    QString path_;
+    int rows_;  //строк в таблице, растёт после modify
+    int columns_;
+    unsigned state_;  //состояние генератора псевдослучайных чисел
+};
+
+#endif // SQLITEFIXTURE_H
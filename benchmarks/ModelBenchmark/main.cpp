@@ -0,0 +1,237 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTimer>
+
+#include <cstdio>
+#include <functional>
+
+#include "BenchmarkStats.h"
+#include "SqliteFixture.h"
+#include "SqliteReaderModel.h"
+#include "SqliteSubstringSearch.h"
+
+/*
+ * Замеры слоя модели без виджетов.
+ * Для каждого размера генерируется бд, и через SqliteReaderModel
+ * так же, как это делает view, замеряются:
+ * load - открытие бд до первого экрана строк,
+ * render - переход к случайному месту таблицы до готовых строк,
+ * filter - набор фильтра (вместе с паузой планировщика) до первого экрана,
+ * filterClear - сброс фильтра,
+ * sync - от записи в бд другим соединением до обновлённого экрана.
+ * Результат - JSON со значениями перцентилей задержек, пиковой
+ * памятью и количеством выделений.
+*/
+
+const int VISIBLE_ROWS = 40;  //строк на "экране", которые запрашивает view
+const int RENDER_JUMPS = 20;  //переходов по таблице в одном повторе render
+const int SYNC_UPDATES = 100;  //изменённых строк в одном повторе sync
+const int SYNC_INSERTS = 100;  //добавленных строк в одном повторе sync
+const int WAIT_TIMEOUT = 120000;  //мс, после которых замер считается зависшим
+
+/*
+ * Обработка событий, пока не выполнится condition
+*/
+static bool waitUntil(const std::function<bool()> &condition)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!condition()) {
+        if (timer.elapsed() > WAIT_TIMEOUT) {
+            return false;
+        }
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    return true;
+}
+
+/*
+ * Все видимые строки начиная с firstRow уже есть в модели.
+ * Как и view, запрашивает недостающие страницы через data().
+*/
+static bool isScreenReady(SqliteTableModel *tableModel, int firstRow)
+{
+    int last = qMin(firstRow + VISIBLE_ROWS, tableModel->rowCount());
+    bool isReady = true;
+    for (int row = firstRow; row < last; row++) {
+        if (!tableModel->data(tableModel->index(row, 0)).isValid()) {
+            isReady = false;
+        }
+    }
+    return isReady;
+}
+
+/*
+ * Один замер: action запускает операцию, после чего события
+ * обрабатываются до isDone. Время и выделения пишутся в stats.
+*/
+static bool measure(BenchmarkStats &stats, const std::function<void()> &action,
+                    const std::function<bool()> &isDone)
+{
+    qint64 allocations = BenchmarkStats::allocationCount();
+    QElapsedTimer timer;
+    timer.start();
+    action();
+    bool isFinished = waitUntil(isDone);
+    stats.add(timer.nsecsElapsed() / 1000000.0);
+    stats.addAllocations(BenchmarkStats::allocationCount() - allocations);
+    return isFinished;
+}
+
+/*
+ * Все сценарии на одной бд
+*/
+static QJsonObject runFixture(SqliteFixture &fixture, int repeat, QString &error)
+{
+    SqliteReaderModel model;
+    SqliteTableModel *tableModel = model.tableModel;
+    int refreshes = 0;
+    QObject::connect(tableModel, &SqliteTableModel::refreshed, [&refreshes](int) {
+        refreshes++;
+    });
+    QObject::connect(&model, &SqliteReaderModel::dbUnreachable, [&error](const DBException &e) {
+        error = e.exceptionText;
+    });
+    BenchmarkStats load;
+    BenchmarkStats render;
+    BenchmarkStats filter;
+    BenchmarkStats filterClear;
+    BenchmarkStats sync;
+    bool isFinished = true;
+    qint64 heapAfterLoad = -1;
+    auto refreshedScreen = [&](int expected, int firstRow) {
+        return [&, expected, firstRow]() {
+            return !error.isEmpty() || (refreshes >= expected && isScreenReady(tableModel, firstRow));
+        };
+    };
+
+    for (int i = 0; isFinished && i < repeat; i++) {
+        int expected = refreshes + 1;
+        isFinished = measure(load, [&]() {
+            model.connectToDatabase(fixture.path());
+            model.syncScheduler->setPolicy(SqliteSyncScheduler::Manual);  //sync меряется явными проверками
+            QString request = "select * from {}";
+            model.makeRequest(request);
+        }, refreshedScreen(expected, 1));
+    }
+    heapAfterLoad = BenchmarkStats::heapBytes();
+
+    std::srand(1);
+    for (int i = 0; isFinished && i < repeat * RENDER_JUMPS; i++) {
+        int firstRow = 1 + std::rand() % qMax(1, tableModel->rowCount() - 1);
+        isFinished = measure(render, []() {}, refreshedScreen(refreshes, firstRow));
+    }
+
+    int column = fixture.textColumn();
+    for (int i = 0; isFinished && i < repeat; i++) {
+        for (const QString &step : fixture.filterSteps()) {
+            int expected = refreshes + 1;
+            isFinished = isFinished && measure(filter, [&]() {
+                model.changeFilter(column, step);
+            }, refreshedScreen(expected, 1));
+        }
+        int expected = refreshes + 1;
+        isFinished = isFinished && measure(filterClear, [&]() {
+            model.changeFilter(column, "");
+        }, refreshedScreen(expected, 1));
+    }
+
+    for (int i = 0; isFinished && i < repeat; i++) {
+        int expected = refreshes + 1;
+        isFinished = measure(sync, [&]() {
+            fixture.modify(SYNC_UPDATES, SYNC_INSERTS);
+            model.syncDatabase();
+        }, refreshedScreen(expected, 1));
+    }
+
+    if (!isFinished && error.isEmpty()) {
+        error = "timeout";
+    }
+    QJsonObject scenarios;
+    scenarios.insert("load", load.toJson());
+    scenarios.insert("render", render.toJson());
+    scenarios.insert("filter", filter.toJson());
+    scenarios.insert("filterClear", filterClear.toJson());
+    scenarios.insert("sync", sync.toJson());
+    QJsonObject result;
+    result.insert("rows", fixture.rowCount());
+    result.insert("columns", fixture.columnCount());
+    result.insert("fixtureBytes", static_cast<double>(fixture.fileSize()));
+    result.insert("scenarios", scenarios);
+    result.insert("heapBytesAfterLoad", static_cast<double>(heapAfterLoad));
+    result.insert("peakRssKb", static_cast<double>(BenchmarkStats::peakRssKb()));
+    if (!error.isEmpty()) {
+        result.insert("error", error);
+    }
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless benchmark of the SqliteReader model layer");
+    parser.addHelpOption();
+    QCommandLineOption rowsOption("rows", "Comma separated table sizes.", "rows", "10000,100000");
+    QCommandLineOption columnsOption("columns", "Columns in generated tables.", "columns", "8");
+    QCommandLineOption repeatOption("repeat", "Repeats of every scenario.", "repeat", "5");
+    QCommandLineOption outputOption("output", "JSON output file (stdout if empty).", "file");
+    QCommandLineOption dirOption("dir", "Directory for generated databases.", "dir");
+    parser.addOption(rowsOption);
+    parser.addOption(columnsOption);
+    parser.addOption(repeatOption);
+    parser.addOption(outputOption);
+    parser.addOption(dirOption);
+    parser.process(application);
+
+    QTemporaryDir temporaryDir;
+    QString dir = parser.isSet(dirOption) ? parser.value(dirOption) : temporaryDir.path();
+    int columns = parser.value(columnsOption).toInt();
+    int repeat = qMax(1, parser.value(repeatOption).toInt());
+
+    /*
+     * Таймер будит цикл событий, чтобы ожидание
+     * не зависло, если событий долго нет
+    */
+    QTimer ticker;
+    ticker.start(5);
+
+    QJsonArray runs;
+    bool isFailed = false;
+    for (const QString &rows : parser.value(rowsOption).split(",", QString::SkipEmptyParts)) {
+        SqliteFixture fixture(dir + "/bench_" + rows.trimmed() + ".db3", rows.toInt(), columns);
+        if (!fixture.create()) {
+            std::fprintf(stderr, "cannot create %s\n", qPrintable(fixture.path()));
+            return 1;
+        }
+        QString error;
+        runs.append(runFixture(fixture, repeat, error));
+        isFailed = isFailed || !error.isEmpty();
+        QFile::remove(fixture.path());
+    }
+
+    QJsonObject report;
+    report.insert("benchmark", "ModelBenchmark");
+    report.insert("qtVersion", qVersion());
+    report.insert("sqliteVersion", sqlite3_libversion());
+    report.insert("substringKernel", SqliteSubstringSearch::implementation());
+    report.insert("repeat", repeat);
+    report.insert("runs", runs);
+    QByteArray json = QJsonDocument(report).toJson();
+    if (parser.isSet(outputOption)) {
+        QFile output(parser.value(outputOption));
+        if (!output.open(QIODevice::WriteOnly) || output.write(json) != json.size()) {
+            std::fprintf(stderr, "cannot write %s\n", qPrintable(parser.value(outputOption)));
+            return 1;
+        }
+    } else {
+        std::fwrite(json.constData(), 1, json.size(), stdout);
+    }
+    return isFailed ? 1 : 0;
+}
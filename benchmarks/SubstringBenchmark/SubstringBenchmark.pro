@@ -0,0 +1,30 @@
+#-------------------------------------------------
+#
+# Micro-benchmark of the substring filter kernel
+# against the QString::contains filter path.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = SubstringBenchmark
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+LIBS += -lsqlite3
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+        main.cpp \
+    ../../SqliteResultBlock.cpp \
+    ../../SqliteSubstringSearch.cpp
+
+HEADERS += \
+    ../../SqliteResultBlock.h \
+    ../../SqliteSubstringSearch.h
@@ -0,0 +1,259 @@
+#include <QElapsedTimer>
+#include <QList>
+#include <QtAlgorithms>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <sqlite3.h>
+
+#include "SqliteResultBlock.h"
+#include "SqliteSubstringSearch.h"
+
+/*
+ * Сравнение фильтрации широкой таблицы логов:
+ * старый путь - QString::contains по строкам QList<QStringList>,
+ * новый - SqliteSubstringSearch по байтам колоночных блоков,
+ * и в sqlite - instr против функции фильтра.
+ * Замеры идут на длинных сообщениях (около 80 байт) и на коротких
+ * (10-30 байт), где весь поиск укладывается в хвост вектора.
+ * Запуск: SubstringBenchmark [количество строк]
+*/
+
+const int BLOCK_ROWS = 4096;  //строк в одном блоке, как страницы у исполнителя
+const int REPEATS = 5;  //замеров на каждый вариант, берётся лучший
+
+static const char *const LEVELS[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+static const char *const SERVICES[] = {"gateway", "auth", "billing", "storage", "search"};
+
+struct Filter
+{
+    const char *message;  //фильтр колонки message
+    const char *service;  //фильтр колонки service, пустой если нет
+};
+
+/*
+ * Сообщение длиной около 80 байт
+*/
+static void longMessage(char *message, int size, int i)
+{
+    std::snprintf(message, size, "request %08d from 10.0.%d.%d finished with status %d in %d ms, user=u%05d",
+                  i, std::rand() % 256, std::rand() % 256, 200 + (std::rand() % 4) * 100,
+                  std::rand() % 5000, std::rand() % 100000);
+}
+
+/*
+ * Сообщение длиной от 10 до 30 байт в одной из четырёх форм
+*/
+static void shortMessage(char *message, int size)
+{
+    int status = 200 + (std::rand() % 4) * 100;
+    switch (std::rand() % 4) {
+    case 0:
+        std::snprintf(message, size, "status %d", status);
+        break;
+    case 1:
+        std::snprintf(message, size, "user=u%05d", std::rand() % 100000);
+        break;
+    case 2:
+        std::snprintf(message, size, "10.0.%d.%d status %d", std::rand() % 256, std::rand() % 256, status);
+        break;
+    default:
+        std::snprintf(message, size, "status %d user=u%05d", status, std::rand() % 100000);
+        break;
+    }
+}
+
+/*
+ * Таблица log(level, service, message) в памяти
+*/
+static sqlite3 *createDatabase(int rows, bool isShort)
+{
+    sqlite3 *handle = nullptr;
+    sqlite3_open(":memory:", &handle);
+    sqlite3_exec(handle, "create table log(level text, service text, message text)", nullptr, nullptr, nullptr);
+    sqlite3_exec(handle, "begin", nullptr, nullptr, nullptr);
+    sqlite3_stmt *statement = nullptr;
+    sqlite3_prepare_v2(handle, "insert into log values (?, ?, ?)", -1, &statement, nullptr);
+    std::srand(1);
+    for (int i = 0; i < rows; i++) {
+        char message[160];
+        if (isShort) {
+            shortMessage(message, sizeof(message));
+        } else {
+            longMessage(message, sizeof(message), i);
+        }
+        sqlite3_bind_text(statement, 1, LEVELS[std::rand() % 4], -1, SQLITE_STATIC);
+        sqlite3_bind_text(statement, 2, SERVICES[std::rand() % 5], -1, SQLITE_STATIC);
+        sqlite3_bind_text(statement, 3, message, -1, SQLITE_TRANSIENT);
+        sqlite3_step(statement);
+        sqlite3_reset(statement);
+    }
+    sqlite3_finalize(statement);
+    sqlite3_exec(handle, "commit", nullptr, nullptr, nullptr);
+    SqliteSubstringSearch::install(handle);
+    return handle;
+}
+
+/*
+ * Вся таблица в виде колоночных блоков
+*/
+static QList<SqliteResultBlock> readBlocks(sqlite3 *handle)
+{
+    QList<SqliteResultBlock> blocks;
+    sqlite3_stmt *statement = nullptr;
+    sqlite3_prepare_v2(handle, "select * from log", -1, &statement, nullptr);
+    SqliteResultBlock block(sqlite3_column_count(statement));
+    while (sqlite3_step(statement) == SQLITE_ROW) {
+        block.appendRow(statement);
+        if (block.rowCount() == BLOCK_ROWS) {
+            blocks.append(block);
+            block = SqliteResultBlock(sqlite3_column_count(statement));
+        }
+    }
+    if (block.rowCount() > 0) {
+        blocks.append(block);
+    }
+    sqlite3_finalize(statement);
+    return blocks;
+}
+
+/*
+ * Вся таблица так, как её раньше хранила модель
+*/
+static QList<QStringList> readStrings(const QList<SqliteResultBlock> &blocks)
+{
+    QList<QStringList> rows;
+    for (const SqliteResultBlock &block : blocks) {
+        for (int row = 0; row < block.rowCount(); row++) {
+            QStringList tableRow;
+            for (int column = 0; column < block.columnCount(); column++) {
+                tableRow.append(block.text(row, column));
+            }
+            rows.append(tableRow);
+        }
+    }
+    return rows;
+}
+
+static int filterStrings(const QList<QStringList> &rows, const Filter &filter)
+{
+    QString message = QString::fromUtf8(filter.message);
+    QString service = QString::fromUtf8(filter.service);
+    int count = 0;
+    for (const QStringList &row : rows) {
+        if (row[2].contains(message) && (service.isEmpty() || row[1].contains(service))) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static bool containsBytes(const SqliteResultBlock &block, int row, int column, const QByteArray &needle)
+{
+    QByteArray value = block.bytes(row, column);
+    return SqliteSubstringSearch::contains(value.constData(), value.size(), needle.constData(), needle.size());
+}
+
+static int filterBlocks(const QList<SqliteResultBlock> &blocks, const Filter &filter)
+{
+    QByteArray message(filter.message);
+    QByteArray service(filter.service);
+    int count = 0;
+    for (const SqliteResultBlock &block : blocks) {
+        for (int row = 0; row < block.rowCount(); row++) {
+            if (containsBytes(block, row, 2, message) &&
+                    (service.isEmpty() || containsBytes(block, row, 1, service))) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+static int filterSql(sqlite3 *handle, const QByteArray &condition, const Filter &filter)
+{
+    QByteArray sql = "select count(*) from log where " + condition;
+    sqlite3_stmt *statement = nullptr;
+    sqlite3_prepare_v2(handle, sql.constData(), -1, &statement, nullptr);
+    sqlite3_bind_text(statement, 1, filter.message, -1, SQLITE_STATIC);
+    sqlite3_bind_text(statement, 2, filter.service, -1, SQLITE_STATIC);
+    sqlite3_step(statement);
+    int count = sqlite3_column_int(statement, 0);
+    sqlite3_finalize(statement);
+    return count;
+}
+
+/*
+ * Лучшее время из REPEATS запусков, в миллисекундах
+*/
+template <typename Function>
+static double measure(Function function, int &count)
+{
+    double best = -1;
+    for (int i = 0; i < REPEATS; i++) {
+        QElapsedTimer timer;
+        timer.start();
+        count = function();
+        double elapsed = timer.nsecsElapsed() / 1000000.0;
+        if (best < 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+/*
+ * Все фильтры по одной таблице, false при расхождении результатов
+*/
+static bool run(int rows, bool isShort)
+{
+    sqlite3 *handle = createDatabase(rows, isShort);
+    QList<SqliteResultBlock> blocks = readBlocks(handle);
+    QList<QStringList> strings = readStrings(blocks);
+    const Filter filters[] = {
+        {"status 500", ""},
+        {"user=u0421", ""},
+        {"10.0.17.", "billing"},
+        {"no such text", ""},
+    };
+    std::printf("\n%s messages\n", isShort ? "short" : "long");
+    std::printf("%-14s %-8s %10s %14s %10s %14s %8s\n", "message", "service",
+                "contains", "kernel", "instr", "sql function", "matches");
+    bool isConsistent = true;
+    for (const Filter &filter : filters) {
+        int stringCount = 0;
+        int blockCount = 0;
+        int instrCount = 0;
+        int functionCount = 0;
+        double stringTime = measure([&]() { return filterStrings(strings, filter); }, stringCount);
+        double blockTime = measure([&]() { return filterBlocks(blocks, filter); }, blockCount);
+        double instrTime = measure([&]() {
+            return filterSql(handle, "instr(message, ?1) > 0 and instr(service, ?2) > 0", filter);
+        }, instrCount);
+        double functionTime = measure([&]() {
+            return filterSql(handle, QByteArray(SqliteSubstringSearch::FUNCTION_NAME) + "(message, ?1) and " +
+                             SqliteSubstringSearch::FUNCTION_NAME + "(service, ?2)", filter);
+        }, functionCount);
+        std::printf("%-14s %-8s %8.2fms %12.2fms %8.2fms %12.2fms %8d\n", filter.message, filter.service,
+                    stringTime, blockTime, instrTime, functionTime, stringCount);
+        if (blockCount != stringCount || instrCount != stringCount || functionCount != stringCount) {
+            std::printf("  mismatch: %d %d %d %d\n", stringCount, blockCount, instrCount, functionCount);
+            isConsistent = false;
+        }
+    }
+    sqlite3_close(handle);
+    return isConsistent;
+}
+
+int main(int argc, char *argv[])
+{
+    int rows = argc > 1 ? std::atoi(argv[1]) : 500000;
+    std::printf("rows: %d, kernel: %s\n", rows, SqliteSubstringSearch::implementation());
+    bool isConsistent = run(rows, false);
+    isConsistent = run(rows, true) && isConsistent;
+    return isConsistent ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+#-------------------------------------------------
+#
+# Benchmarks of SqliteReader. They are not part of
+# the application build: run qmake on this file
+# to build all of them.
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    SubstringBenchmark \
+    ModelBenchmark
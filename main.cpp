@@ -1,11 +1,29 @@
 #include "SqliteReaderView.h"
+#include "SqliteReaderCli.h"
 #include <QApplication>
+#include <QCoreApplication>
 
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
+    QCoreApplication::setOrganizationName("ITsJust4Fun");  //для QSettings (политики проверок бд)
+    QCoreApplication::setApplicationName("SqliteReader");
+    if (SqliteReaderCli::isRequested(argc, argv)) {
+        QCoreApplication a(argc, argv);  //без виджетов и дисплея
+        SqliteReaderCli cli;
+        if (!cli.parse(a.arguments())) {
+            return cli.exitCode();
+        }
+        cli.start();
+        return a.exec();
+    }
+
+    QApplication a(argc, argv);  //забирает из argv свои опции (-style и т.п.)
     SqliteReaderView w;
     w.show();
+    QStringList arguments = a.arguments();
+    if (arguments.size() > 1 && !arguments[1].startsWith('-')) {
+        w.openFile(arguments[1]);  //бд, переданная через "открыть с помощью"
+    }
 
     return a.exec();
 }